@@ -30,7 +30,7 @@
 PG_MODULE_MAGIC;
 
 /* The number of columns as defined in gp_workfile_mgr_cache_entries view */
-#define NUM_CACHE_ENTRIES_ELEM 12
+#define NUM_CACHE_ENTRIES_ELEM 15
 
 /* The number of columns as defined in gp_workfile_mgr_diskspace view */
 #define NUM_USED_DISKSPACE_ELEM 2
@@ -71,7 +71,7 @@ gp_workfile_mgr_cache_entries(PG_FUNCTION_ARGS)
 		 */
 		TupleDesc tupdesc = CreateTemplateTupleDesc(NUM_CACHE_ENTRIES_ELEM, false);
 
-		Assert(NUM_CACHE_ENTRIES_ELEM == 12);
+		Assert(NUM_CACHE_ENTRIES_ELEM == 15);
 
 		TupleDescInitEntry(tupdesc, (AttrNumber) 1, "segid",
 				INT4OID, -1 /* typmod */, 0 /* attdim */);
@@ -97,6 +97,12 @@ gp_workfile_mgr_cache_entries(PG_FUNCTION_ARGS)
 				TIMESTAMPTZOID, -1, 0);
 		TupleDescInitEntry(tupdesc, (AttrNumber) 12, "numfiles",
 				INT4OID, -1 /* typmod */, 0 /* attdim */);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 13, "rawsize",
+				INT8OID, -1 /* typmod */, 0 /* attdim */);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 14, "compressedsize",
+				INT8OID, -1 /* typmod */, 0 /* attdim */);
+		TupleDescInitEntry(tupdesc, (AttrNumber) 15, "codectime",
+				FLOAT8OID, -1 /* typmod */, 0 /* attdim */);
 
 		funcctx->tuple_desc = BlessTupleDesc(tupdesc);
 
@@ -169,6 +175,9 @@ gp_workfile_mgr_cache_entries(PG_FUNCTION_ARGS)
 		values[9] = UInt32GetDatum(work_set->command_count);
 		values[10] = TimestampTzGetDatum(work_set->session_start_time);
 		values[11] = UInt32GetDatum(work_set->no_files);
+		values[12] = Int64GetDatum(work_set->raw_size);
+		values[13] = Int64GetDatum(work_set->compressed_size);
+		values[14] = Float8GetDatum(work_set->codec_time_us / 1000.0);
 
 		/* Done reading from the payload of the entry, release lock */
 		Cache_UnlockEntry(cache, crtEntry);
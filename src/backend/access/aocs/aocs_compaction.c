@@ -302,18 +302,12 @@ AOCSSegmentFileFullCompaction(Relation aorel,
 	bool	   *proj;
 	int			i;
 	AOTupleId  *aoTupleId;
-	int64		tupleCount = 0;
-	int64		tuplePerPage = INT_MAX;
 
 	Assert(Gp_role == GP_ROLE_EXECUTE || Gp_role == GP_ROLE_UTILITY);
 	Assert(RelationIsAoCols(aorel));
 	Assert(insertDesc);
 
 	compact_segno = fsinfo->segno;
-	if (fsinfo->varblockcount > 0)
-	{
-		tuplePerPage = fsinfo->total_tupcount / fsinfo->varblockcount;
-	}
 	relname = RelationGetRelationName(aorel);
 
 	AppendOnlyVisimap_Init(&visiMap,
@@ -380,13 +374,12 @@ AOCSSegmentFileFullCompaction(Relation aorel,
 		}
 
 		/*
-		 * Check for vacuum delay point after approximatly a var block
+		 * pg_aocsseg doesn't count the blocks of a segment file, so there is
+		 * no tuples per block to space out the vacuum delay points.  Check
+		 * at every tuple, the cost balance decides when to nap.
 		 */
-		tupleCount++;
-		if (VacuumCostActive && tupleCount % tuplePerPage == 0)
-		{
+		if (VacuumCostActive)
 			vacuum_delay_point();
-		}
 
 		aocs_getnext(scanDesc, ForwardScanDirection, slot);
 
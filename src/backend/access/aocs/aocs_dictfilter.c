@@ -0,0 +1,348 @@
+/*------------------------------------------------------------------------------
+ *
+ * AOCSDictFilter
+ *   evaluate the qual of an AOCS scan on the dictionary codes of a column.
+ *
+ * Copyright (c) 2013-Present Pivotal Software, Inc.
+ *
+ *
+ * IDENTIFICATION
+ *	    src/backend/access/aocs/aocs_dictfilter.c
+ *
+ *------------------------------------------------------------------------------
+*/
+#include "postgres.h"
+
+#include "access/aocs_dictfilter.h"
+#include "catalog/pg_proc.h"
+#include "cdb/cdbappendonlyblockdirectory.h"
+#include "cdb/cdbappendonlystorageread.h"
+#include "cdb/cdbappendonlystoragewrite.h"
+#include "nodes/execnodes.h"
+#include "utils/array.h"
+#include "utils/datumstream.h"
+#include "utils/guc.h"
+#include "utils/lsyscache.h"
+#include "utils/memutils.h"
+
+/*
+ * Can the operator be evaluated on every distinct value of a block, including
+ * the values of rows the executor would never have evaluated it on?
+ *
+ * It must not fail, so it has to be leakproof, and it must give the same
+ * answer for the same value, so it has to be immutable.  A strict operator
+ * lets the NULLs be filtered as well.
+ */
+static bool
+dictfilter_op_usable(Oid opno, Oid *funcid)
+{
+	Oid			fn = get_opcode(opno);
+
+	if (!OidIsValid(fn) ||
+		!func_strict(fn) ||
+		func_volatile(fn) != PROVOLATILE_IMMUTABLE ||
+		!get_func_leakproof(fn))
+		return false;
+
+	*funcid = fn;
+	return true;
+}
+
+/*
+ * Turn a qual clause into a dictionary filter key, if it has a suitable
+ * form.  Returns the column the key is on in *attnum.
+ */
+static bool
+dictfilter_key_from_clause(Expr *clause, TupleDesc tupdesc,
+						   AOCSDictFilterKey *key, AttrNumber *attnum)
+{
+	List	   *args;
+	Oid			opno;
+	Oid			collation;
+	Oid			funcid;
+	Node	   *leftop;
+	Node	   *rightop;
+	Var		   *var;
+	Const	   *con;
+	bool		varOnLeft;
+
+	if (IsA(clause, OpExpr))
+	{
+		OpExpr	   *opexpr = (OpExpr *) clause;
+
+		args = opexpr->args;
+		opno = opexpr->opno;
+		collation = opexpr->inputcollid;
+	}
+	else if (IsA(clause, ScalarArrayOpExpr))
+	{
+		ScalarArrayOpExpr *saop = (ScalarArrayOpExpr *) clause;
+
+		/* "column op ALL (array)" is rarely selective, don't bother */
+		if (!saop->useOr)
+			return false;
+
+		args = saop->args;
+		opno = saop->opno;
+		collation = saop->inputcollid;
+	}
+	else
+		return false;
+
+	if (list_length(args) != 2)
+		return false;
+	leftop = linitial(args);
+	rightop = lsecond(args);
+
+	/* e.g. varchar columns are compared with the text operators */
+	if (leftop && IsA(leftop, RelabelType))
+		leftop = (Node *) ((RelabelType *) leftop)->arg;
+	if (rightop && IsA(rightop, RelabelType))
+		rightop = (Node *) ((RelabelType *) rightop)->arg;
+
+	if (IsA(leftop, Var) && IsA(rightop, Const))
+	{
+		var = (Var *) leftop;
+		con = (Const *) rightop;
+		varOnLeft = true;
+	}
+	else if (IsA(clause, OpExpr) && IsA(leftop, Const) && IsA(rightop, Var))
+	{
+		var = (Var *) rightop;
+		con = (Const *) leftop;
+		varOnLeft = false;
+	}
+	else
+		return false;
+
+	/* only variable-length columns are written with a dictionary */
+	if (var->varlevelsup != 0 ||
+		var->varattno <= 0 || var->varattno > tupdesc->natts ||
+		tupdesc->attrs[var->varattno - 1]->atttypid != var->vartype ||
+		tupdesc->attrs[var->varattno - 1]->attlen != -1)
+		return false;
+	if (con->constisnull)
+		return false;
+	if (!dictfilter_op_usable(opno, &funcid))
+		return false;
+
+	fmgr_info(funcid, &key->fn);
+	key->collation = collation;
+	key->varOnLeft = varOnLeft;
+
+	if (IsA(clause, OpExpr))
+	{
+		key->nvalues = 1;
+		key->values = palloc(sizeof(Datum));
+		key->values[0] = con->constvalue;
+	}
+	else
+	{
+		ArrayType  *arr = DatumGetArrayTypeP(con->constvalue);
+		int16		typlen;
+		bool		typbyval;
+		char		typalign;
+		Datum	   *elems;
+		bool	   *nulls;
+		int			nelems;
+		int			i;
+
+		get_typlenbyvalalign(ARR_ELEMTYPE(arr), &typlen, &typbyval, &typalign);
+		deconstruct_array(arr, ARR_ELEMTYPE(arr), typlen, typbyval, typalign,
+						  &elems, &nulls, &nelems);
+
+		/* a NULL element never makes the clause true */
+		key->nvalues = 0;
+		key->values = palloc(sizeof(Datum) * Max(nelems, 1));
+		for (i = 0; i < nelems; i++)
+		{
+			if (!nulls[i])
+				key->values[key->nvalues++] = elems[i];
+		}
+	}
+
+	*attnum = var->varattno;
+	return true;
+}
+
+/*
+ * AOCSDictFilter_BeginScan
+ *
+ * Prepare to filter the rows of a scan of 'aoRel' on the dictionary codes
+ * of one column, using the clauses on that column of 'qual', a list of
+ * ExprStates of the scan's (implicitly ANDed) qual.
+ *
+ * Returns NULL if no clause of the qual can be evaluated on the codes.
+ */
+AOCSDictFilter *
+AOCSDictFilter_BeginScan(Relation aoRel, List *qual)
+{
+	AOCSDictFilter *filter;
+	AOCSDictFilterKey *keys;
+	int			nkeys = 0;
+	AttrNumber	filterAttnum = InvalidAttrNumber;
+	ListCell   *lc;
+
+	if (qual == NIL)
+		return NULL;
+
+	keys = palloc(sizeof(AOCSDictFilterKey) * list_length(qual));
+	foreach(lc, qual)
+	{
+		ExprState  *clause = (ExprState *) lfirst(lc);
+		AttrNumber	attnum;
+
+		if (!dictfilter_key_from_clause(clause->expr, RelationGetDescr(aoRel),
+										&keys[nkeys], &attnum))
+			continue;
+
+		/* the keys are on the column of the first usable clause */
+		if (filterAttnum == InvalidAttrNumber)
+			filterAttnum = attnum;
+		if (attnum == filterAttnum)
+			nkeys++;
+		else
+			pfree(keys[nkeys].values);
+	}
+
+	if (nkeys == 0)
+	{
+		pfree(keys);
+		return NULL;
+	}
+
+	filter = palloc0(sizeof(AOCSDictFilter));
+	filter->aoRel = aoRel;
+	filter->attno = filterAttnum - 1;
+	filter->nkeys = nkeys;
+	filter->keys = keys;
+	filter->blockFirstRowNum = INT64CONST(-1);
+	filter->codeMatches = palloc(sizeof(bool) * DATUMSTREAM_DICT_MAX_COUNT);
+	filter->evalContext = AllocSetContextCreate(CurrentMemoryContext,
+												"AOCS dictionary filter",
+												ALLOCSET_SMALL_MINSIZE,
+												ALLOCSET_SMALL_INITSIZE,
+												ALLOCSET_SMALL_MAXSIZE);
+
+	return filter;
+}
+
+/*
+ * Forget the current block, at the start of a segment file.
+ */
+void
+AOCSDictFilter_Reset(AOCSDictFilter *filter)
+{
+	filter->blockFirstRowNum = INT64CONST(-1);
+}
+
+/*
+ * Evaluate the keys on every distinct value of the current block.
+ */
+static void
+dictfilter_evaluate(AOCSDictFilter *filter, uint8 **entries, int32 dictCount)
+{
+	MemoryContext oldcontext;
+	int32		code;
+
+	oldcontext = MemoryContextSwitchTo(filter->evalContext);
+
+	filter->blockAnyMatch = false;
+	for (code = 0; code < dictCount; code++)
+	{
+		Datum		value = PointerGetDatum(entries[code]);
+		bool		match = true;
+		int			k;
+
+		for (k = 0; k < filter->nkeys && match; k++)
+		{
+			AOCSDictFilterKey *key = &filter->keys[k];
+			int			v;
+
+			match = false;
+			for (v = 0; v < key->nvalues && !match; v++)
+			{
+				Datum		result;
+
+				if (key->varOnLeft)
+					result = FunctionCall2Coll(&key->fn, key->collation,
+											   value, key->values[v]);
+				else
+					result = FunctionCall2Coll(&key->fn, key->collation,
+											   key->values[v], value);
+				match = DatumGetBool(result);
+			}
+		}
+
+		filter->codeMatches[code] = match;
+		if (match)
+			filter->blockAnyMatch = true;
+	}
+
+	MemoryContextSwitchTo(oldcontext);
+	MemoryContextReset(filter->evalContext);
+}
+
+/*
+ * Can the current row of 'ds', the stream of the filter column, satisfy the
+ * keys?
+ *
+ * Rows of blocks without a dictionary always can.  When no row of the
+ * current block can, *skipBlock is set so the caller can skip the rest of
+ * it at once.
+ */
+bool
+AOCSDictFilter_RowMatches(AOCSDictFilter *filter, DatumStreamRead *ds,
+						  bool *skipBlock)
+{
+	int32		code;
+
+	*skipBlock = false;
+
+	if (ds->blockFirstRowNum != filter->blockFirstRowNum)
+	{
+		uint8	  **entries;
+		int32		dictCount;
+
+		filter->blockFirstRowNum = ds->blockFirstRowNum;
+
+		entries = datumstreamread_dict(ds, &dictCount);
+		filter->blockHasDict = (entries != NULL);
+		if (filter->blockHasDict)
+			dictfilter_evaluate(filter, entries, dictCount);
+	}
+
+	if (!filter->blockHasDict)
+		return true;
+
+	if (!filter->blockAnyMatch)
+	{
+		*skipBlock = true;
+		filter->blocksSkipped++;
+		return false;
+	}
+
+	/* The operators are strict, so a NULL never satisfies a key */
+	code = datumstreamread_dict_code(ds);
+	if (code >= 0 && filter->codeMatches[code])
+		return true;
+
+	filter->rowsSkipped++;
+	return false;
+}
+
+void
+AOCSDictFilter_EndScan(AOCSDictFilter *filter)
+{
+	elogif(Debug_appendonly_print_scan, LOG,
+		   "AOCS dictionary filter scan of table '%s' skipped " INT64_FORMAT " rows "
+		   "and " INT64_FORMAT " blocks",
+		   RelationGetRelationName(filter->aoRel),
+		   filter->rowsSkipped,
+		   filter->blocksSkipped);
+
+	MemoryContextDelete(filter->evalContext);
+	pfree(filter->codeMatches);
+	pfree(filter->keys);
+	pfree(filter);
+}
@@ -17,7 +17,10 @@
 
 #include "common/relpath.h"
 #include "access/aocssegfiles.h"
+#include "access/aocs_dictfilter.h"
 #include "access/aomd.h"
+#include "access/appendonly_blockcache.h"
+#include "access/appendonly_zonemap.h"
 #include "access/appendonlytid.h"
 #include "access/appendonlywriter.h"
 #include "access/heapam.h"
@@ -109,11 +112,22 @@ open_all_datumstreamread_segfiles(Relation rel,
 
 	Assert(proj_atts);
 
+	/*
+	 * Open all the files before reading the first block of any of them.
+	 * Opening a file only starts its first read (see BufferedReadSetFile),
+	 * so the first reads of all the columns are in flight together.
+	 */
 	for (i = 0; i < num_proj_atts; i++)
 	{
 		int			attno = proj_atts[i];
 
 		open_datumstreamread_segfile(basepath, rel->rd_node, segInfo, ds[attno], attno);
+	}
+
+	for (i = 0; i < num_proj_atts; i++)
+	{
+		int			attno = proj_atts[i];
+
 		datumstreamread_block(ds[attno], blockDirectory, attno);
 	}
 
@@ -352,6 +366,13 @@ open_next_scan_seg(AOCSScanDesc scan)
 												  scan->num_proj_atts,
 												  scan->blockDirectory);
 
+				scan->skipPastRowNum = INT64CONST(-1);
+				if (scan->zoneMap)
+					AppendOnlyZoneMap_LoadSegmentFile(scan->zoneMap,
+													  curSegInfo->segno);
+				if (scan->dictFilter)
+					AOCSDictFilter_Reset(scan->dictFilter);
+
 				return scan->cur_seg;
 			}
 		}
@@ -503,6 +524,7 @@ aocs_beginscan_internal(Relation relation,
 						   relation->rd_appendonly->visimapidxid,
 						   AccessShareLock,
 						   appendOnlyMetaDataSnapshot);
+	AppendOnlyVisimap_EnableCache(&scan->visibilityMap);
 
 	return scan;
 }
@@ -541,9 +563,55 @@ aocs_endscan(AOCSScanDesc scan)
 
 	AppendOnlyVisimap_Finish(&scan->visibilityMap, AccessShareLock);
 
+	if (scan->zoneMap)
+		AppendOnlyZoneMap_EndScan(scan->zoneMap);
+	if (scan->dictFilter)
+		AOCSDictFilter_EndScan(scan->dictFilter);
+
 	pfree(scan);
 }
 
+/*
+ * Filter the rows of the scan on the dictionary codes of a column, see
+ * aocs_dictfilter.h.  Must be called before the first aocs_getnext.
+ *
+ * The filter column becomes the first projected column, which is read
+ * ahead of the others, so that they only step through the rows that pass.
+ * The scan takes ownership of the filter.
+ */
+void
+aocs_scan_set_dictfilter(AOCSScanDesc scan, AOCSDictFilter *filter)
+{
+	int			i;
+
+	if (filter == NULL)
+		return;
+
+	/* building the block directory needs every block of every column */
+	if (scan->blockDirectory != NULL)
+	{
+		AOCSDictFilter_EndScan(filter);
+		return;
+	}
+
+	for (i = 0; i < scan->num_proj_atts; i++)
+	{
+		if (scan->proj_atts[i] == filter->attno)
+			break;
+	}
+	if (i == scan->num_proj_atts)
+	{
+		AOCSDictFilter_EndScan(filter);
+		return;
+	}
+
+	for (; i > 0; i--)
+		scan->proj_atts[i] = scan->proj_atts[i - 1];
+	scan->proj_atts[0] = filter->attno;
+
+	scan->dictFilter = filter;
+}
+
 /*
  * Upgrades a Datum value from a previous version of the AOCS page format. The
  * DatumStreamRead that is passed must correspond to the column being upgraded.
@@ -618,6 +686,95 @@ static void upgrade_datum_fetch(AOCSFetchDesc fetch, int attno, Datum values[],
 					   values, isnull, formatversion);
 }
 
+/*
+ * Read the next block of the lead column of a scan with zone maps.
+ *
+ * The blocks whose rows all lie in a range that the zone maps exclude are
+ * skipped without reading their content.  If a block is only partly
+ * excluded, the stream is positioned at the last excluded row.  The
+ * excluded range is recorded in skipPastRowNum, for the other projected
+ * columns to skip as well.
+ */
+static int
+aocs_zonemap_read_block(AOCSScanDesc scan, DatumStreamRead *ds)
+{
+	for (;;)
+	{
+		int64		skipPast;
+
+		if (datumstreamread_block_header(ds) < 0)
+			return -1;
+
+		skipPast = AppendOnlyZoneMap_SkipPastRow(scan->zoneMap,
+												 ds->blockFirstRowNum);
+		if (skipPast < 0)
+		{
+			datumstreamread_block_content(ds);
+			return 0;
+		}
+
+		scan->skipPastRowNum = skipPast;
+		if (ds->blockFirstRowNum + ds->blockRowCount - 1 <= skipPast)
+		{
+			datumstreamread_skip_block(ds);
+			scan->zoneMap->blocksSkipped++;
+			continue;
+		}
+
+		datumstreamread_block_content(ds);
+		datumstreamread_find(ds, skipPast - ds->blockFirstRowNum);
+		return 0;
+	}
+}
+
+/*
+ * Advance the lead column, the first projected one, to the next row the scan
+ * may return.
+ *
+ * With a dictionary filter, the rows whose codes cannot satisfy it are
+ * skipped, and so is the rest of a block when none of its codes can.  The
+ * last skipped row is recorded in skipPastRowNum.  Returns -1 at the end of
+ * the segment file.
+ */
+static int
+aocs_advance_lead(AOCSScanDesc scan, int attno)
+{
+	DatumStreamRead *ds = scan->ds[attno];
+	int			err;
+	bool		skipBlock;
+
+	for (;;)
+	{
+		err = datumstreamread_advance(ds);
+		Assert(err >= 0);
+		if (err == 0)
+		{
+			/*
+			 * With zone maps, the lead column decides which rows to skip.
+			 * They are only used when the scan does not build the block
+			 * directory, which needs every block.
+			 */
+			if (scan->zoneMap)
+				err = aocs_zonemap_read_block(scan, ds);
+			else
+				err = datumstreamread_block(ds, scan->blockDirectory, attno);
+			if (err < 0)
+				return err;
+
+			err = datumstreamread_advance(ds);
+			Assert(err > 0);
+		}
+
+		if (scan->dictFilter == NULL ||
+			AOCSDictFilter_RowMatches(scan->dictFilter, ds, &skipBlock))
+			return err;
+
+		if (skipBlock)
+			datumstreamread_find(ds, ds->blockRowCount - 1);
+		scan->skipPastRowNum = ds->blockFirstRowNum + datumstreamread_nth(ds);
+	}
+}
+
 void
 aocs_getnext(AOCSScanDesc scan, ScanDirection direction, TupleTableSlot *slot)
 {
@@ -662,11 +819,9 @@ ReadNext:
 		{
 			int			attno = scan->proj_atts[i];
 
-			err = datumstreamread_advance(scan->ds[attno]);
-			Assert(err >= 0);
-			if (err == 0)
+			if (i == 0)
 			{
-				err = datumstreamread_block(scan->ds[attno], scan->blockDirectory, attno);
+				err = aocs_advance_lead(scan, attno);
 				if (err < 0)
 				{
 					/*
@@ -675,9 +830,30 @@ ReadNext:
 					close_cur_scan_seg(scan);
 					goto ReadNext;
 				}
+			}
+			else
+			{
+				if (scan->skipPastRowNum >= 0)
+					datumstreamread_skip_past_row(scan->ds[attno],
+												  scan->skipPastRowNum);
 
 				err = datumstreamread_advance(scan->ds[attno]);
-				Assert(err > 0);
+				Assert(err >= 0);
+				if (err == 0)
+				{
+					err = datumstreamread_block(scan->ds[attno], scan->blockDirectory, attno);
+					if (err < 0)
+					{
+						/*
+						 * Ha, cannot read next block, we need to go to next seg
+						 */
+						close_cur_scan_seg(scan);
+						goto ReadNext;
+					}
+
+					err = datumstreamread_advance(scan->ds[attno]);
+					Assert(err > 0);
+				}
 			}
 
 			/*
@@ -704,6 +880,8 @@ ReadNext:
 			}
 		}
 
+		scan->skipPastRowNum = INT64CONST(-1);
+
 		AOTupleIdInit_Init(&aoTupleId);
 		AOTupleIdInit_segmentFileNum(&aoTupleId, curseginfo->segno);
 
@@ -770,6 +948,13 @@ OpenAOCSDatumStreams(AOCSInsertDesc desc)
 	open_ds_write(desc->aoi_rel, desc->ds, tupdesc,
 				  desc->aoi_rel->rd_appendonly->checksum);
 
+	/*
+	 * An insert fills the blocks of all the columns at once, so a full block
+	 * of one column can be compressed while the others are being filled.
+	 */
+	for (i = 0; i < nvp; ++i)
+		AppendOnlyStorageWrite_UseCompressPool(&desc->ds[i]->ao_write);
+
 	/* Now open seg info file and get eof mark. */
 	seginfo = GetAOCSFileSegInfo(desc->aoi_rel,
 								 desc->appendOnlyMetaDataSnapshot,
@@ -887,6 +1072,7 @@ aocs_insert_init(Relation rel, int segno, bool update_mode)
 																				 * lock. */
 											(FileSegInfo *) desc->fsInfo, desc->lastSequence,
 											rel, segno, tupleDesc->natts, true);
+	AppendOnlyBlockDirectory_InitZoneMaps(&desc->blockDirectory);
 
 	return desc;
 }
@@ -966,6 +1152,9 @@ aocs_insert_values(AOCSInsertDesc idesc, Datum *d, bool *null, AOTupleId *aoTupl
 			}
 		}
 
+		AppendOnlyBlockDirectory_ZoneAddValue(&idesc->blockDirectory, i,
+											  d[i], null[i]);
+
 		if (toFree1 != NULL)
 			pfree(toFree1);
 	}
@@ -1118,15 +1307,84 @@ scanToFetchValue(AOCSFetchDesc aocsFetchDesc,
 	DatumStreamRead *datumStream = datumStreamFetchDesc->datumStream;
 	bool		found;
 
+	/* the stream will no longer be reading a cached block */
+	if (aocsFetchDesc->blockCache != NULL)
+		aocsFetchDesc->cachedBlockId[colno] = 0;
+
 	found = datumstreamread_find_block(datumStream,
 									   datumStreamFetchDesc,
 									   rowNum);
 	if (found)
+	{
+		/*
+		 * Keep a copy of the block for later fetches.  The blocks of older
+		 * formats are left out, their datums need upgrading on the way out.
+		 */
+		if (aocsFetchDesc->blockCache != NULL &&
+			datumStreamFetchDesc->currentBlock.gotContents &&
+			datumStream->largeObjectState == DatumStreamLargeObjectState_None &&
+			datumStream->ao_read.formatVersion == AORelationVersion_GetLatest())
+		{
+			AppendOnlyBlockCache_Insert(aocsFetchDesc->blockCache,
+										colno,
+										datumStreamFetchDesc->currentSegmentFile.num,
+										datumStreamFetchDesc->currentBlock.firstRowNum,
+										datumStream->getBlockInfo.rowCnt,
+										datumStreamFetchDesc->currentBlock.fileOffset,
+										datumStream->getBlockInfo.execBlockKind,
+										datumStream->buffer_beginp,
+										datumStream->getBlockInfo.contentLen);
+		}
+
 		fetchFromCurrentBlock(aocsFetchDesc, rowNum, slot, colno);
+	}
 
 	return found;
 }
 
+/*
+ * Fetch the value of a column from a cached block.
+ */
+static void
+fetchFromCachedBlock(AOCSFetchDesc aocsFetchDesc,
+					 AppendOnlyBlockCacheEntry *entry,
+					 int64 rowNum,
+					 TupleTableSlot *slot,
+					 int colno)
+{
+	DatumStreamFetchDesc datumStreamFetchDesc =
+	aocsFetchDesc->datumStreamFetchDesc[colno];
+	DatumStreamRead *datumStream = datumStreamFetchDesc->datumStream;
+	Datum		value;
+	bool		null;
+
+	if (aocsFetchDesc->cachedBlockId[colno] != entry->id)
+	{
+		datumstreamread_block_from_cache(datumStream,
+										 entry->firstRowNum,
+										 entry->rowCount,
+										 entry->data,
+										 entry->dataLen);
+		aocsFetchDesc->cachedBlockId[colno] = entry->id;
+
+		/*
+		 * The block of the segment file the stream was at is gone, the next
+		 * fetch that misses the cache has to look it up again.
+		 */
+		datumStreamFetchDesc->currentBlock.have = false;
+	}
+
+	datumstreamread_find(datumStream, rowNum - entry->firstRowNum);
+
+	/* only blocks of the latest format are cached, no upgrade needed */
+	if (slot != NULL)
+		datumstreamread_get(datumStream,
+							&(slot_get_values(slot)[colno]),
+							&(slot_get_isnull(slot)[colno]));
+	else
+		datumstreamread_get(datumStream, &value, &null);
+}
+
 static void
 closeFetchSegmentFile(DatumStreamFetchDesc datumStreamFetchDesc)
 {
@@ -1257,6 +1515,11 @@ aocs_fetch_init(Relation relation,
 	aocsFetchDesc->datumStreamFetchDesc = (DatumStreamFetchDesc *)
 		palloc0(relation->rd_att->natts * sizeof(DatumStreamFetchDesc));
 
+	aocsFetchDesc->blockCache = AppendOnlyBlockCache_Create(relation->rd_att->natts);
+	if (aocsFetchDesc->blockCache != NULL)
+		aocsFetchDesc->cachedBlockId = (uint64 *)
+			palloc0(relation->rd_att->natts * sizeof(uint64));
+
 	for (colno = 0; colno < relation->rd_att->natts; colno++)
 	{
 
@@ -1337,10 +1600,14 @@ aocs_fetch(AOCSFetchDesc aocsFetchDesc,
 
 	Assert(numCols > 0);
 
+	if (aocsFetchDesc->blockCache != NULL)
+		AppendOnlyBlockCache_BeginFetch(aocsFetchDesc->blockCache);
+
 	/*
 	 * Go through columns one by one. Check if the current block has the
-	 * requested tuple. If so, fetch it. Otherwise, read the block that
-	 * contains the requested tuple.
+	 * requested tuple. If so, fetch it. Otherwise, look for the block that
+	 * contains the requested tuple in the block cache, and read it if it is
+	 * not there.
 	 */
 	for (colno = 0; colno < numCols; colno++)
 	{
@@ -1379,7 +1646,34 @@ aocs_fetch(AOCSFetchDesc aocsFetchDesc,
 				fetchFromCurrentBlock(aocsFetchDesc, rowNum, slot, colno);
 				continue;
 			}
+		}
+
+		if (aocsFetchDesc->blockCache != NULL)
+		{
+			AppendOnlyBlockCacheEntry *entry;
 
+			entry = AppendOnlyBlockCache_Lookup(aocsFetchDesc->blockCache,
+												colno,
+												segmentFileNum,
+												rowNum);
+			if (entry != NULL)
+			{
+				if (!isSnapshotAny && !AppendOnlyVisimap_IsVisible(&aocsFetchDesc->visibilityMap, aoTupleId))
+				{
+					found = false;
+					break;
+				}
+
+				fetchFromCachedBlock(aocsFetchDesc, entry, rowNum, slot, colno);
+				continue;
+			}
+		}
+
+		if (datumStreamFetchDesc->currentSegmentFile.isOpen &&
+			datumStreamFetchDesc->currentSegmentFile.num == segmentFileNum &&
+			aocsFetchDesc->blockDirectory.currentSegmentFileNum == segmentFileNum &&
+			datumStreamFetchDesc->currentBlock.have)
+		{
 			/*
 			 * Otherwise, fetch the right block.
 			 */
@@ -1527,6 +1821,12 @@ aocs_fetch_finish(AOCSFetchDesc aocsFetchDesc)
 	}
 	pfree(aocsFetchDesc->datumStreamFetchDesc);
 
+	if (aocsFetchDesc->blockCache != NULL)
+	{
+		AppendOnlyBlockCache_End(aocsFetchDesc->blockCache, relation);
+		pfree(aocsFetchDesc->cachedBlockId);
+	}
+
 	AppendOnlyBlockDirectory_End_forSearch(&aocsFetchDesc->blockDirectory);
 
 	if (aocsFetchDesc->segmentFileInfo)
@@ -0,0 +1,268 @@
+/*------------------------------------------------------------------------------
+ *
+ * AppendOnlyBlockCache
+ *   keep the decompressed content of recently fetched append-only blocks.
+ *
+ * Copyright (c) 2013-Present Pivotal Software, Inc.
+ *
+ *
+ * IDENTIFICATION
+ *	    src/backend/access/appendonly/appendonly_blockcache.c
+ *
+ *------------------------------------------------------------------------------
+*/
+#include "postgres.h"
+
+#include "access/appendonly_blockcache.h"
+#include "utils/guc.h"
+#include "utils/memutils.h"
+#include "utils/rel.h"
+
+int			gp_appendonly_fetch_cache_size = 4096;
+
+/*
+ * AppendOnlyBlockCache_Create
+ *
+ * Create a cache for the blocks of 'ncolumns' columns, sized by
+ * gp_appendonly_fetch_cache_size.  Returns NULL if the cache is disabled.
+ */
+AppendOnlyBlockCache *
+AppendOnlyBlockCache_Create(int ncolumns)
+{
+	AppendOnlyBlockCache *cache;
+	MemoryContext cacheContext;
+
+	Assert(ncolumns > 0);
+
+	if (gp_appendonly_fetch_cache_size <= 0)
+		return NULL;
+
+	cacheContext = AllocSetContextCreate(CurrentMemoryContext,
+										 "AO fetch block cache",
+										 ALLOCSET_DEFAULT_MINSIZE,
+										 ALLOCSET_DEFAULT_INITSIZE,
+										 ALLOCSET_DEFAULT_MAXSIZE);
+
+	cache = MemoryContextAllocZero(cacheContext, sizeof(AppendOnlyBlockCache));
+	cache->memoryContext = cacheContext;
+	cache->maxBytes = (int64) gp_appendonly_fetch_cache_size * 1024;
+	cache->ncolumns = ncolumns;
+	cache->columns = MemoryContextAllocZero(cacheContext,
+											sizeof(AppendOnlyBlockCacheColumn) * ncolumns);
+	cache->nextId = 1;
+
+	return cache;
+}
+
+/*
+ * Start fetching a row.  The entries used by the previous fetches may be
+ * evicted from now on, the ones used by this fetch may not until the next.
+ */
+void
+AppendOnlyBlockCache_BeginFetch(AppendOnlyBlockCache *cache)
+{
+	cache->clock++;
+}
+
+/*
+ * Binary search the entries of a column for the first one that does not
+ * come before (segmentFileNum, rowNum), by segment file number and last row
+ * number.
+ */
+static int
+blockcache_search(AppendOnlyBlockCacheColumn *column,
+				  int segmentFileNum, int64 rowNum)
+{
+	int			low = 0;
+	int			high = column->nentries;
+
+	while (low < high)
+	{
+		int			mid = low + (high - low) / 2;
+		AppendOnlyBlockCacheEntry *entry = column->entries[mid];
+
+		if (entry->segmentFileNum < segmentFileNum ||
+			(entry->segmentFileNum == segmentFileNum &&
+			 entry->lastRowNum < rowNum))
+			low = mid + 1;
+		else
+			high = mid;
+	}
+
+	return low;
+}
+
+/*
+ * AppendOnlyBlockCache_Lookup
+ *
+ * Find the cached block of a column that has the row 'rowNum' of segment
+ * file 'segmentFileNum'.  Returns NULL if there is none.
+ *
+ * The entry returned stays in the cache until the next fetch.
+ */
+AppendOnlyBlockCacheEntry *
+AppendOnlyBlockCache_Lookup(AppendOnlyBlockCache *cache, int column,
+							int segmentFileNum, int64 rowNum)
+{
+	AppendOnlyBlockCacheColumn *col;
+	AppendOnlyBlockCacheEntry *entry;
+	int			i;
+
+	Assert(column >= 0 && column < cache->ncolumns);
+	col = &cache->columns[column];
+
+	i = blockcache_search(col, segmentFileNum, rowNum);
+	if (i < col->nentries)
+	{
+		entry = col->entries[i];
+		if (entry->segmentFileNum == segmentFileNum &&
+			entry->firstRowNum <= rowNum)
+		{
+			entry->lastUsed = cache->clock;
+			cache->hits++;
+			return entry;
+		}
+	}
+
+	cache->misses++;
+	return NULL;
+}
+
+/*
+ * Evict the least recently used entry of any column that was not used by
+ * the current fetch.  Returns false if there is none.
+ */
+static bool
+blockcache_evict_one(AppendOnlyBlockCache *cache)
+{
+	AppendOnlyBlockCacheColumn *victimColumn = NULL;
+	int			victimIndex = -1;
+	uint64		oldest = cache->clock;
+	AppendOnlyBlockCacheEntry *victim;
+	int			c;
+	int			i;
+
+	for (c = 0; c < cache->ncolumns; c++)
+	{
+		AppendOnlyBlockCacheColumn *col = &cache->columns[c];
+
+		for (i = 0; i < col->nentries; i++)
+		{
+			if (col->entries[i]->lastUsed < oldest)
+			{
+				oldest = col->entries[i]->lastUsed;
+				victimColumn = col;
+				victimIndex = i;
+			}
+		}
+	}
+
+	if (victimColumn == NULL)
+		return false;
+
+	victim = victimColumn->entries[victimIndex];
+	memmove(&victimColumn->entries[victimIndex],
+			&victimColumn->entries[victimIndex + 1],
+			sizeof(AppendOnlyBlockCacheEntry *) *
+			(victimColumn->nentries - victimIndex - 1));
+	victimColumn->nentries--;
+
+	cache->usedBytes -= sizeof(AppendOnlyBlockCacheEntry) + victim->dataLen;
+	cache->evictions++;
+	pfree(victim);
+
+	return true;
+}
+
+/*
+ * AppendOnlyBlockCache_Insert
+ *
+ * Add a copy of the content of a block to the cache, evicting older blocks
+ * to make room for it.  The block is not added if it is already in the
+ * cache, if it is too large for the cache to keep a few blocks, or if there
+ * is no room left without evicting the blocks of the current fetch.
+ */
+void
+AppendOnlyBlockCache_Insert(AppendOnlyBlockCache *cache,
+							int column,
+							int segmentFileNum,
+							int64 firstRowNum,
+							int rowCount,
+							int64 fileOffset,
+							int executorBlockKind,
+							uint8 *data,
+							int32 dataLen)
+{
+	AppendOnlyBlockCacheColumn *col;
+	AppendOnlyBlockCacheEntry *entry;
+	int64		entryBytes = sizeof(AppendOnlyBlockCacheEntry) + dataLen;
+	int			i;
+
+	Assert(column >= 0 && column < cache->ncolumns);
+	col = &cache->columns[column];
+
+	if (rowCount <= 0 || entryBytes > cache->maxBytes / 4)
+		return;
+
+	i = blockcache_search(col, segmentFileNum, firstRowNum);
+	if (i < col->nentries &&
+		col->entries[i]->segmentFileNum == segmentFileNum &&
+		col->entries[i]->firstRowNum <= firstRowNum + rowCount - 1)
+		return;
+
+	while (cache->usedBytes + entryBytes > cache->maxBytes)
+	{
+		if (!blockcache_evict_one(cache))
+			return;
+	}
+
+	/* an eviction may have moved the insertion point */
+	i = blockcache_search(col, segmentFileNum, firstRowNum);
+
+	if (col->nentries == col->maxentries)
+	{
+		int			newmax = Max(16, col->maxentries * 2);
+
+		if (col->entries == NULL)
+			col->entries = MemoryContextAlloc(cache->memoryContext,
+											  sizeof(AppendOnlyBlockCacheEntry *) * newmax);
+		else
+			col->entries = repalloc(col->entries,
+									sizeof(AppendOnlyBlockCacheEntry *) * newmax);
+		col->maxentries = newmax;
+	}
+
+	entry = MemoryContextAlloc(cache->memoryContext, entryBytes);
+	entry->id = cache->nextId++;
+	entry->segmentFileNum = segmentFileNum;
+	entry->firstRowNum = firstRowNum;
+	entry->lastRowNum = firstRowNum + rowCount - 1;
+	entry->fileOffset = fileOffset;
+	entry->executorBlockKind = executorBlockKind;
+	entry->rowCount = rowCount;
+	entry->lastUsed = cache->clock;
+	entry->dataLen = dataLen;
+	entry->data = (uint8 *) (entry + 1);
+	memcpy(entry->data, data, dataLen);
+
+	memmove(&col->entries[i + 1], &col->entries[i],
+			sizeof(AppendOnlyBlockCacheEntry *) * (col->nentries - i));
+	col->entries[i] = entry;
+	col->nentries++;
+
+	cache->usedBytes += entryBytes;
+}
+
+void
+AppendOnlyBlockCache_End(AppendOnlyBlockCache *cache, Relation aoRel)
+{
+	elogif(Debug_appendonly_print_scan, LOG,
+		   "Append-only fetch block cache of table '%s': " INT64_FORMAT " hits, "
+		   INT64_FORMAT " misses, " INT64_FORMAT " evictions",
+		   RelationGetRelationName(aoRel),
+		   cache->hits,
+		   cache->misses,
+		   cache->evictions);
+
+	MemoryContextDelete(cache->memoryContext);
+}
@@ -12,6 +12,14 @@
  * the compacted segment files are dropped and the eof/tupcount/varblock
  * information in pg_aoseg_<oid> are reset to 0.
  *
+ * Compaction runs under a lazy VACUUM's ShareUpdateExclusiveLock, so
+ * concurrent inserts carry on into the other segment files.  The reads and
+ * writes of the segment files are charged to the vacuum cost balance by the
+ * buffered read and append code, one page at a time, and the compaction
+ * loops stop at vacuum_delay_point() about once per block (at every tuple
+ * for AOCS): vacuum_cost_delay and vacuum_cost_limit limit the I/O rate of
+ * compaction like they do for heap tables.
+ *
  * Copyright (c) 2013-Present Pivotal Software, Inc.
  *
  *
@@ -364,7 +372,8 @@ AppendOnlySegmentFileFullCompaction(Relation aorel,
 	compact_segno = fsinfo->segno;
 	if (fsinfo->varblockcount > 0)
 	{
-		tuplePerPage = fsinfo->total_tupcount / fsinfo->varblockcount;
+		/* a large value spans several blocks, there may be fewer tuples */
+		tuplePerPage = Max(1, fsinfo->total_tupcount / fsinfo->varblockcount);
 	}
 	relname = RelationGetRelationName(aorel);
 
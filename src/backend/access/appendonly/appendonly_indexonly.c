@@ -0,0 +1,394 @@
+/*------------------------------------------------------------------------------
+ *
+ * AppendOnlyIndexOnly
+ *   decide the visibility of append-only rows for index-only scans.
+ *
+ * Copyright (c) 2013-Present Pivotal Software, Inc.
+ *
+ *
+ * IDENTIFICATION
+ *	    src/backend/access/appendonly/appendonly_indexonly.c
+ *
+ *------------------------------------------------------------------------------
+*/
+#include "postgres.h"
+
+#include "access/aocssegfiles.h"
+#include "access/aomd.h"
+#include "access/aosegfiles.h"
+#include "access/appendonly_indexonly.h"
+#include "access/appendonly_visimap.h"
+#include "cdb/cdbaocsam.h"
+#include "cdb/cdbappendonlyam.h"
+#include "cdb/cdbappendonlyblockdirectory.h"
+#include "cdb/cdbappendonlystorageread.h"
+#include "utils/rel.h"
+
+typedef struct AppendOnlyIndexOnlyDescData
+{
+	Relation	aoRel;
+	Snapshot	snapshot;
+	bool		isAOCol;
+
+	/* the segment files visible to the snapshot */
+	FileSegInfo **segmentFileInfo;
+	AOCSFileSegInfo **aocsSegmentFileInfo;
+	int			totalSegfiles;
+
+	/*
+	 * For a column-oriented table, only the block directory entries of the
+	 * first column are read.
+	 */
+	bool	   *proj;
+
+	AppendOnlyBlockDirectory blockDirectory;
+	AppendOnlyBlockDirectoryEntry blockDirectoryEntry;
+
+	AppendOnlyVisimap visibilityMap;
+
+	/*
+	 * For reading the headers of the blocks that block directory entries
+	 * point to, set up on first use.  The row count of the last block read
+	 * is remembered, as index entries of the same block tend to come
+	 * together.
+	 */
+	bool		storageReadInit;
+	AppendOnlyStorageRead storageRead;
+	AppendOnlyStorageAttributes storageAttributes;
+	char	   *segmentFileName;
+	int			storageReadSegno;	/* segment file open, or -1 */
+	int64		blockFileOffset;	/* block of blockRowCount, or -1 */
+	int			blockRowCount;
+
+	/* for the rows that must be fetched, created on first use */
+	AppendOnlyFetchDesc aoFetchDesc;
+	AOCSFetchDesc aocsFetchDesc;
+} AppendOnlyIndexOnlyDescData;
+
+/*
+ * AppendOnlyIndexOnly_Init
+ *
+ * Set up the visibility checks of an index-only scan of 'aoRel' with
+ * 'snapshot'.
+ */
+AppendOnlyIndexOnlyDesc
+AppendOnlyIndexOnly_Init(Relation aoRel, Snapshot snapshot)
+{
+	AppendOnlyIndexOnlyDesc desc;
+
+	Assert(RelationIsAppendOptimized(aoRel));
+
+	desc = (AppendOnlyIndexOnlyDesc) palloc0(sizeof(AppendOnlyIndexOnlyDescData));
+	desc->aoRel = aoRel;
+	desc->snapshot = snapshot;
+	desc->isAOCol = RelationIsAoCols(aoRel);
+
+	if (desc->isAOCol)
+	{
+		desc->aocsSegmentFileInfo =
+			GetAllAOCSFileSegInfo(aoRel, snapshot, &desc->totalSegfiles);
+
+		desc->proj = palloc0(RelationGetNumberOfAttributes(aoRel) * sizeof(bool));
+		desc->proj[0] = true;
+
+		AppendOnlyBlockDirectory_Init_forSearch(&desc->blockDirectory,
+												snapshot,
+												(FileSegInfo **) desc->aocsSegmentFileInfo,
+												desc->totalSegfiles,
+												aoRel,
+												RelationGetNumberOfAttributes(aoRel),
+												true,
+												desc->proj);
+	}
+	else
+	{
+		desc->segmentFileInfo =
+			GetAllFileSegInfo(aoRel, snapshot, &desc->totalSegfiles);
+
+		AppendOnlyBlockDirectory_Init_forSearch(&desc->blockDirectory,
+												snapshot,
+												desc->segmentFileInfo,
+												desc->totalSegfiles,
+												aoRel,
+												1,
+												false,
+												NULL);
+	}
+
+	AppendOnlyVisimap_Init(&desc->visibilityMap,
+						   aoRel->rd_appendonly->visimaprelid,
+						   aoRel->rd_appendonly->visimapidxid,
+						   AccessShareLock,
+						   snapshot);
+
+	return desc;
+}
+
+/*
+ * The EOF of segment file 'segno' (of the first column, for a column-oriented
+ * table) as the snapshot sees it, and the format version of the file.  Zero
+ * if the snapshot doesn't see the segment file, or it is awaiting drop.
+ */
+static int64
+segmentFileEof(AppendOnlyIndexOnlyDesc desc, int segno, int *formatversion)
+{
+	int			i;
+
+	*formatversion = -1;
+
+	for (i = 0; i < desc->totalSegfiles; i++)
+	{
+		if (desc->isAOCol)
+		{
+			AOCSFileSegInfo *fsInfo = desc->aocsSegmentFileInfo[i];
+
+			if (fsInfo->segno != segno)
+				continue;
+			if (fsInfo->state == AOSEG_STATE_AWAITING_DROP)
+				return 0;
+
+			*formatversion = fsInfo->formatversion;
+			return getAOCSVPEntry(fsInfo, 0)->eof;
+		}
+		else
+		{
+			FileSegInfo *fsInfo = desc->segmentFileInfo[i];
+
+			if (fsInfo->segno != segno)
+				continue;
+			if (fsInfo->state == AOSEG_STATE_AWAITING_DROP)
+				return 0;
+
+			*formatversion = fsInfo->formatversion;
+			return fsInfo->eof;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * Does the snapshot see segment file 'segno' with some data in it?
+ *
+ * The block directory must not be asked about any other segment file: it
+ * expects the segment file to be in the list it was given.
+ */
+static bool
+segmentFileHasData(AppendOnlyIndexOnlyDesc desc, int segno)
+{
+	int			formatversion;
+
+	return segmentFileEof(desc, segno, &formatversion) > 0;
+}
+
+/*
+ * The number of rows in the block that starts at 'fileOffset' in segment
+ * file 'segno', from the block's header.
+ *
+ * The row range of a block directory entry may be wider than its block.
+ * An insert that continues the last minipage of a segment file stretches
+ * the last entry up to its own first row number, so the entry also covers
+ * the row numbers of any aborted insert in between, whose index entries are
+ * still there.
+ */
+static int
+blockRowCount(AppendOnlyIndexOnlyDesc desc, int segno,
+			  int64 fileOffset, int64 afterFileOffset)
+{
+	Relation	aoRel = desc->aoRel;
+	int32		contentLen;
+	int			executorBlockKind;
+	int64		firstRowNum;
+	int			rowCount;
+	bool		isLarge;
+	bool		isCompressed;
+
+	if (desc->storageReadSegno == segno && desc->blockFileOffset == fileOffset)
+		return desc->blockRowCount;
+
+	if (!desc->storageReadInit)
+	{
+		AppendOnlyStorageAttributes *attr = &desc->storageAttributes;
+
+		/* Only headers are read, nothing is decompressed */
+		attr->compress = false;
+		attr->compressType = "none";
+		attr->compressLevel = 0;
+		attr->checksum = aoRel->rd_appendonly->checksum;
+		attr->safeFSWriteSize = aoRel->rd_appendonly->safefswritesize;
+
+		AppendOnlyStorageRead_Init(&desc->storageRead,
+								   CurrentMemoryContext,
+								   aoRel->rd_appendonly->blocksize,
+								   NameStr(aoRel->rd_rel->relname),
+								   "Index-only scan of Append-Only relation",
+								   attr);
+
+		desc->segmentFileName = palloc(AOSegmentFilePathNameLen(aoRel) + 1);
+		desc->storageReadSegno = -1;
+		desc->storageReadInit = true;
+	}
+
+	if (desc->storageReadSegno != segno)
+	{
+		int64		eof;
+		int			formatversion;
+		int32		fileSegNo;
+
+		if (desc->storageReadSegno != -1)
+			AppendOnlyStorageRead_CloseFile(&desc->storageRead);
+		desc->storageReadSegno = -1;
+
+		eof = segmentFileEof(desc, segno, &formatversion);
+		Assert(eof > 0);
+
+		/* column-oriented tables: the file of the first column */
+		MakeAOSegmentFileName(aoRel, segno, desc->isAOCol ? 0 : -1,
+							  &fileSegNo, desc->segmentFileName);
+		AppendOnlyStorageRead_OpenFile(&desc->storageRead,
+									   desc->segmentFileName,
+									   formatversion,
+									   eof);
+		desc->storageReadSegno = segno;
+	}
+
+	AppendOnlyStorageRead_SetTemporaryRange(&desc->storageRead,
+											fileOffset, afterFileOffset);
+	if (AppendOnlyStorageRead_GetBlockInfo(&desc->storageRead,
+										   &contentLen,
+										   &executorBlockKind,
+										   &firstRowNum,
+										   &rowCount,
+										   &isLarge,
+										   &isCompressed))
+		AppendOnlyStorageRead_SkipCurrentBlock(&desc->storageRead);
+	else
+		rowCount = 0;
+
+	desc->blockFileOffset = fileOffset;
+	desc->blockRowCount = rowCount;
+
+	return rowCount;
+}
+
+/*
+ * Fetch the row, for the rows whose existence the block directory cannot
+ * prove.
+ */
+static bool
+fetchRow(AppendOnlyIndexOnlyDesc desc, AOTupleId *aoTupleId)
+{
+	if (desc->isAOCol)
+	{
+		if (desc->aocsFetchDesc == NULL)
+			desc->aocsFetchDesc = aocs_fetch_init(desc->aoRel,
+												  desc->snapshot,
+												  desc->snapshot,
+												  desc->proj);
+
+		return aocs_fetch(desc->aocsFetchDesc, aoTupleId, NULL);
+	}
+	else
+	{
+		if (desc->aoFetchDesc == NULL)
+			desc->aoFetchDesc = appendonly_fetch_init(desc->aoRel,
+													  desc->snapshot,
+													  desc->snapshot);
+
+		return appendonly_fetch(desc->aoFetchDesc, aoTupleId, NULL);
+	}
+}
+
+/*
+ * AppendOnlyIndexOnly_IsVisible
+ *
+ * Is the row 'aoTupleId', found in an index of the table, visible to the
+ * snapshot?  '*fetched' is set to true if the row had to be read from the
+ * table to know.
+ */
+bool
+AppendOnlyIndexOnly_IsVisible(AppendOnlyIndexOnlyDesc desc,
+							  AOTupleId *aoTupleId,
+							  bool *fetched)
+{
+	AppendOnlyBlockDirectoryEntry *entry = &desc->blockDirectoryEntry;
+	int64		rowNum = AOTupleIdGet_rowNum(aoTupleId);
+
+	*fetched = false;
+
+	if (!segmentFileHasData(desc, AOTupleIdGet_segmentFileNum(aoTupleId)))
+		return false;
+
+	/* Deleted or updated. */
+	if (!AppendOnlyVisimap_IsVisible(&desc->visibilityMap, aoTupleId))
+		return false;
+
+	/* Not represented in the block directory, aborted or still running. */
+	if (!AppendOnlyBlockDirectory_GetEntry(&desc->blockDirectory,
+										   aoTupleId,
+										   0,
+										   entry))
+		return false;
+
+	/*
+	 * GetEntry falls back to the last entry before the row, so check that
+	 * the entry really covers it, and that the row is within the rows its
+	 * block really has.  The last entry of a segment file claims all the
+	 * rows after it when entries have a minimum range, and then an entry may
+	 * cover several blocks.  In doubt, let the fetch decide.
+	 */
+	if (gp_blockdirectory_entry_min_range == 0 &&
+		entry->range.afterFileOffset > entry->range.fileOffset &&
+		AppendOnlyBlockDirectoryEntry_RangeHasRow(entry, rowNum) &&
+		rowNum - entry->range.firstRowNum <
+		blockRowCount(desc, AOTupleIdGet_segmentFileNum(aoTupleId),
+					  entry->range.fileOffset, entry->range.afterFileOffset))
+		return true;
+
+	*fetched = true;
+	return fetchRow(desc, aoTupleId);
+}
+
+/*
+ * AppendOnlyIndexOnly_Finish
+ */
+void
+AppendOnlyIndexOnly_Finish(AppendOnlyIndexOnlyDesc desc)
+{
+	if (desc->aoFetchDesc != NULL)
+	{
+		appendonly_fetch_finish(desc->aoFetchDesc);
+		pfree(desc->aoFetchDesc);
+	}
+	if (desc->aocsFetchDesc != NULL)
+	{
+		aocs_fetch_finish(desc->aocsFetchDesc);
+		pfree(desc->aocsFetchDesc);
+	}
+
+	if (desc->storageReadInit)
+	{
+		AppendOnlyStorageRead_CloseFile(&desc->storageRead);
+		AppendOnlyStorageRead_FinishSession(&desc->storageRead);
+		pfree(desc->segmentFileName);
+	}
+
+	AppendOnlyVisimap_Finish(&desc->visibilityMap, AccessShareLock);
+
+	AppendOnlyBlockDirectory_End_forSearch(&desc->blockDirectory);
+
+	if (desc->segmentFileInfo != NULL)
+	{
+		FreeAllSegFileInfo(desc->segmentFileInfo, desc->totalSegfiles);
+		pfree(desc->segmentFileInfo);
+	}
+	if (desc->aocsSegmentFileInfo != NULL)
+	{
+		FreeAllAOCSSegFileInfo(desc->aocsSegmentFileInfo, desc->totalSegfiles);
+		pfree(desc->aocsSegmentFileInfo);
+	}
+	if (desc->proj != NULL)
+		pfree(desc->proj);
+
+	pfree(desc);
+}
@@ -0,0 +1,285 @@
+/*------------------------------------------------------------------------------
+ *
+ * AppendOnlyPrefetch
+ *   hint the kernel about the append-only blocks a bitmap scan will fetch.
+ *
+ * Copyright (c) 2013-Present Pivotal Software, Inc.
+ *
+ *
+ * IDENTIFICATION
+ *	    src/backend/access/appendonly/appendonly_prefetch.c
+ *
+ *------------------------------------------------------------------------------
+*/
+#include "postgres.h"
+
+#include <fcntl.h>
+
+#include "access/aocssegfiles.h"
+#include "access/aomd.h"
+#include "access/aosegfiles.h"
+#include "access/appendonly_prefetch.h"
+#include "cdb/cdbappendonlyblockdirectory.h"
+#include "storage/fd.h"
+#include "utils/rel.h"
+
+/*
+ * What is known of a column's segment file and the entry prefetched last.
+ * A row-oriented table has a single one.
+ */
+typedef struct AppendOnlyPrefetchColumn
+{
+	int			segno;			/* segment file 'file' belongs to, or -1 */
+	File		file;			/* or -1, if it could not be opened */
+
+	bool		haveEntry;
+	AppendOnlyBlockDirectoryEntry entry;
+} AppendOnlyPrefetchColumn;
+
+typedef struct AppendOnlyPrefetchDescData
+{
+	Relation	aoRel;
+	bool		isAOCol;
+	int			blocksize;
+
+	/* the segment files visible to the snapshot */
+	FileSegInfo **segmentFileInfo;
+	AOCSFileSegInfo **aocsSegmentFileInfo;
+	int			totalSegfiles;
+
+	int			ncolumns;
+	bool	   *proj;
+
+	AppendOnlyBlockDirectory blockDirectory;
+
+	AppendOnlyPrefetchColumn *columns;
+} AppendOnlyPrefetchDescData;
+
+/*
+ * AppendOnlyPrefetch_Init
+ *
+ * Set up the prefetching of the rows of 'aoRel'.  For a column-oriented
+ * table, 'proj' tells the columns to prefetch; it is copied.
+ */
+AppendOnlyPrefetchDesc
+AppendOnlyPrefetch_Init(Relation aoRel, Snapshot appendOnlyMetaDataSnapshot,
+						bool *proj)
+{
+	AppendOnlyPrefetchDesc desc;
+	int			i;
+
+	Assert(RelationIsAppendOptimized(aoRel));
+
+	desc = (AppendOnlyPrefetchDesc) palloc0(sizeof(AppendOnlyPrefetchDescData));
+	desc->aoRel = aoRel;
+	desc->isAOCol = RelationIsAoCols(aoRel);
+	desc->blocksize = aoRel->rd_appendonly->blocksize;
+
+	if (desc->isAOCol)
+	{
+		Assert(proj != NULL);
+
+		desc->ncolumns = RelationGetNumberOfAttributes(aoRel);
+		desc->proj = palloc(desc->ncolumns * sizeof(bool));
+		memcpy(desc->proj, proj, desc->ncolumns * sizeof(bool));
+
+		desc->aocsSegmentFileInfo =
+			GetAllAOCSFileSegInfo(aoRel, appendOnlyMetaDataSnapshot,
+								  &desc->totalSegfiles);
+
+		AppendOnlyBlockDirectory_Init_forSearch(&desc->blockDirectory,
+												appendOnlyMetaDataSnapshot,
+												(FileSegInfo **) desc->aocsSegmentFileInfo,
+												desc->totalSegfiles,
+												aoRel,
+												desc->ncolumns,
+												true,
+												desc->proj);
+	}
+	else
+	{
+		desc->ncolumns = 1;
+
+		desc->segmentFileInfo =
+			GetAllFileSegInfo(aoRel, appendOnlyMetaDataSnapshot,
+							  &desc->totalSegfiles);
+
+		AppendOnlyBlockDirectory_Init_forSearch(&desc->blockDirectory,
+												appendOnlyMetaDataSnapshot,
+												desc->segmentFileInfo,
+												desc->totalSegfiles,
+												aoRel,
+												1,
+												false,
+												NULL);
+	}
+
+	desc->columns = palloc0(desc->ncolumns * sizeof(AppendOnlyPrefetchColumn));
+	for (i = 0; i < desc->ncolumns; i++)
+	{
+		desc->columns[i].segno = -1;
+		desc->columns[i].file = -1;
+	}
+
+	return desc;
+}
+
+/*
+ * Does the snapshot see data of column 'colno' in segment file 'segno'?
+ *
+ * The block directory must not be asked about any other segment file: it
+ * expects the segment file to be in the list it was given.
+ */
+static bool
+segmentFileHasData(AppendOnlyPrefetchDesc desc, int segno, int colno)
+{
+	int			i;
+
+	for (i = 0; i < desc->totalSegfiles; i++)
+	{
+		if (desc->isAOCol)
+		{
+			AOCSFileSegInfo *fsInfo = desc->aocsSegmentFileInfo[i];
+
+			if (fsInfo->segno != segno)
+				continue;
+
+			return fsInfo->state != AOSEG_STATE_AWAITING_DROP &&
+				colno < fsInfo->vpinfo.nEntry &&
+				getAOCSVPEntry(fsInfo, colno)->eof > 0;
+		}
+		else
+		{
+			FileSegInfo *fsInfo = desc->segmentFileInfo[i];
+
+			if (fsInfo->segno != segno)
+				continue;
+
+			return fsInfo->state != AOSEG_STATE_AWAITING_DROP &&
+				fsInfo->eof > 0;
+		}
+	}
+
+	return false;
+}
+
+/*
+ * Make column->file the segment file 'segno' of column 'colno'.  Returns
+ * false if it cannot be opened.
+ */
+static bool
+openSegmentFile(AppendOnlyPrefetchDesc desc, AppendOnlyPrefetchColumn *column,
+				int segno, int colno)
+{
+	char		filepathname[MAXPGPATH];
+	int32		fileSegNo;
+
+	if (column->segno == segno)
+		return column->file >= 0;
+
+	if (column->file >= 0)
+		FileClose(column->file);
+
+	MakeAOSegmentFileName(desc->aoRel, segno, desc->isAOCol ? colno : -1,
+						  &fileSegNo, filepathname);
+
+	column->segno = segno;
+	column->file = PathNameOpenFile(filepathname, O_RDONLY | PG_BINARY, 0600);
+	column->haveEntry = false;
+
+	return column->file >= 0;
+}
+
+static void
+prefetchColumn(AppendOnlyPrefetchDesc desc, AOTupleId *aoTupleId, int colno)
+{
+	AppendOnlyPrefetchColumn *column = &desc->columns[colno];
+	AppendOnlyBlockDirectoryEntry *entry = &column->entry;
+	int			segno = AOTupleIdGet_segmentFileNum(aoTupleId);
+	int64		rowNum = AOTupleIdGet_rowNum(aoTupleId);
+	int64		amount;
+
+	/* In the varblock prefetched last? */
+	if (column->haveEntry && column->segno == segno &&
+		AppendOnlyBlockDirectoryEntry_RangeHasRow(entry, rowNum))
+		return;
+
+	if (!segmentFileHasData(desc, segno, colno))
+		return;
+
+	if (!openSegmentFile(desc, column, segno, colno))
+		return;
+
+	column->haveEntry = AppendOnlyBlockDirectory_GetEntry(&desc->blockDirectory,
+														  aoTupleId,
+														  colno,
+														  entry);
+	if (!column->haveEntry)
+		return;
+
+	/*
+	 * GetEntry falls back to the last entry before the row, which the fetch
+	 * reads from too.  An entry normally spans one varblock; the last one of
+	 * a segment file may claim all the rows after it when entries have a
+	 * minimum range (gp_blockdirectory_entry_min_range), so read no more
+	 * than a block ahead.
+	 */
+	amount = entry->range.afterFileOffset - entry->range.fileOffset;
+	if (amount <= 0 || amount > desc->blocksize)
+		amount = desc->blocksize;
+
+	(void) FilePrefetch(column->file, entry->range.fileOffset, (int) amount);
+}
+
+/*
+ * AppendOnlyPrefetch_Row
+ *
+ * Start reading the varblocks that hold row 'aoTupleId', unless they were
+ * asked for already.
+ */
+void
+AppendOnlyPrefetch_Row(AppendOnlyPrefetchDesc desc, AOTupleId *aoTupleId)
+{
+	int			colno;
+
+	for (colno = 0; colno < desc->ncolumns; colno++)
+	{
+		if (desc->isAOCol && !desc->proj[colno])
+			continue;
+
+		prefetchColumn(desc, aoTupleId, colno);
+	}
+}
+
+/*
+ * AppendOnlyPrefetch_Finish
+ */
+void
+AppendOnlyPrefetch_Finish(AppendOnlyPrefetchDesc desc)
+{
+	int			i;
+
+	for (i = 0; i < desc->ncolumns; i++)
+	{
+		if (desc->columns[i].file >= 0)
+			FileClose(desc->columns[i].file);
+	}
+	pfree(desc->columns);
+
+	AppendOnlyBlockDirectory_End_forSearch(&desc->blockDirectory);
+
+	if (desc->segmentFileInfo != NULL)
+	{
+		FreeAllSegFileInfo(desc->segmentFileInfo, desc->totalSegfiles);
+		pfree(desc->segmentFileInfo);
+	}
+	if (desc->aocsSegmentFileInfo != NULL)
+	{
+		FreeAllAOCSSegFileInfo(desc->aocsSegmentFileInfo, desc->totalSegfiles);
+		pfree(desc->aocsSegmentFileInfo);
+	}
+	if (desc->proj != NULL)
+		pfree(desc->proj);
+
+	pfree(desc);
+}
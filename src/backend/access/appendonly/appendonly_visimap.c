@@ -18,8 +18,10 @@
 #include "access/appendonly_visimap_store.h"
 #include "access/appendonlytid.h"
 #include "access/hash.h"
+#include "catalog/aovisimap.h"
 #include "cdb/cdbappendonlyblockdirectory.h"
 #include "storage/fd.h"
+#include "utils/fmgroids.h"
 #include "utils/guc.h"
 #include "utils/memutils.h"
 #include "utils/snapmgr.h"
@@ -140,6 +142,8 @@ AppendOnlyVisimap_Init(
 								appendOnlyMetaDataSnapshot,
 								visiMap->memoryContext);
 
+	visiMap->cache = NULL;
+
 	MemoryContextSwitchTo(oldContext);
 }
 
@@ -179,6 +183,73 @@ AppendOnlyVisimap_Find(
 	}
 }
 
+/*
+ * Lets the visibility checks load the visibility map of a segment file at
+ * once, when they move to it.  Only for visibility maps that are not
+ * changed, i.e. those of scans.  Does nothing if the cache is disabled.
+ */
+void
+AppendOnlyVisimap_EnableCache(
+							  AppendOnlyVisimap *visiMap)
+{
+	Assert(visiMap);
+	Assert(visiMap->cache == NULL);
+
+	visiMap->cache = AppendOnlyVisimapCache_Create(visiMap->memoryContext);
+}
+
+/*
+ * Loads all visibility map entries of the given segment file into the
+ * cache.  If they don't fit, the cache is left incomplete, and the
+ * visibility checks of the segment file use the visimap entry as usual.
+ */
+static void
+AppendOnlyVisimap_LoadCache(
+							AppendOnlyVisimap *visiMap,
+							int segno)
+{
+	AppendOnlyVisimapCache *cache = visiMap->cache;
+	ScanKeyData scanKey;
+	IndexScanDesc indexScan;
+	int			nentries = 0;
+
+	Assert(!AppendOnlyVisimapEntry_HasChanged(&visiMap->visimapEntry));
+
+	AppendOnlyVisimapCache_Reset(cache, segno);
+
+	ScanKeyInit(&scanKey,
+				Anum_pg_aovisimap_segno,	/* segno */
+				BTEqualStrategyNumber,
+				F_INT4EQ,
+				Int32GetDatum(segno));
+
+	indexScan = AppendOnlyVisimapStore_BeginScan(&visiMap->visimapStore,
+												 1,
+												 &scanKey);
+
+	while (AppendOnlyVisimapStore_GetNext(&visiMap->visimapStore,
+										  indexScan,
+										  ForwardScanDirection,
+										  &visiMap->visimapEntry,
+										  NULL))
+	{
+		nentries++;
+		if (!AppendOnlyVisimapCache_AddRange(cache,
+											 visiMap->visimapEntry.firstRowNum,
+											 visiMap->visimapEntry.bitmap))
+			break;
+	}
+	AppendOnlyVisimapStore_EndScan(&visiMap->visimapStore, indexScan);
+
+	/* the entry now has the last range read, not the one Find looked for */
+	AppendOnlyVisimapEntry_Reset(&visiMap->visimapEntry);
+
+	elogif(Debug_appendonly_print_visimap, LOG,
+		   "Append-only visi map: Loaded %d entries of segment file %d "
+		   "into the cache (complete %d, " INT64_FORMAT " bytes)",
+		   nentries, segno, (int) cache->complete, cache->usedBytes);
+}
+
 /*
  * Checks if a tuple is visible according to the visibility map.
  * A positive result is a necessary but not sufficient condition for
@@ -198,6 +269,17 @@ AppendOnlyVisimap_IsVisible(
 		   "(tupleId) = %s",
 		   AOTupleIdToString(aoTupleId));
 
+	if (visiMap->cache != NULL)
+	{
+		if (visiMap->cache->segmentFileNum != AOTupleIdGet_segmentFileNum(aoTupleId))
+			AppendOnlyVisimap_LoadCache(visiMap,
+										AOTupleIdGet_segmentFileNum(aoTupleId));
+
+		if (visiMap->cache->complete)
+			return AppendOnlyVisimapCache_IsVisible(visiMap->cache,
+													AOTupleIdGet_rowNum(aoTupleId));
+	}
+
 	if (!AppendOnlyVisimapEntry_CoversTuple(&visiMap->visimapEntry,
 											aoTupleId))
 	{
@@ -0,0 +1,205 @@
+/*------------------------------------------------------------------------------
+ *
+ * AppendOnlyVisimapCache
+ *   keep the visibility map of a segment file in memory during a scan.
+ *
+ * Copyright (c) 2013-Present Pivotal Software, Inc.
+ *
+ *
+ * IDENTIFICATION
+ *	    src/backend/access/appendonly/appendonly_visimap_cache.c
+ *
+ *------------------------------------------------------------------------------
+*/
+#include "postgres.h"
+
+#include "access/appendonly_visimap.h"
+#include "access/appendonly_visimap_cache.h"
+#include "utils/guc.h"
+#include "utils/memutils.h"
+
+int			gp_appendonly_visimap_cache_size = 16384;
+
+/*
+ * AppendOnlyVisimapCache_Create
+ *
+ * Create a cache sized by gp_appendonly_visimap_cache_size, in a child of
+ * parentContext.  Returns NULL if the cache is disabled.
+ */
+AppendOnlyVisimapCache *
+AppendOnlyVisimapCache_Create(MemoryContext parentContext)
+{
+	AppendOnlyVisimapCache *cache;
+	MemoryContext cacheContext;
+
+	if (gp_appendonly_visimap_cache_size <= 0)
+		return NULL;
+
+	cacheContext = AllocSetContextCreate(parentContext,
+										 "VisiMapCacheContext",
+										 ALLOCSET_DEFAULT_MINSIZE,
+										 ALLOCSET_DEFAULT_INITSIZE,
+										 ALLOCSET_DEFAULT_MAXSIZE);
+
+	cache = MemoryContextAllocZero(cacheContext, sizeof(AppendOnlyVisimapCache));
+	cache->memoryContext = cacheContext;
+	cache->rangeContext = AllocSetContextCreate(cacheContext,
+												"VisiMapCacheRangeContext",
+												ALLOCSET_DEFAULT_MINSIZE,
+												ALLOCSET_DEFAULT_INITSIZE,
+												ALLOCSET_DEFAULT_MAXSIZE);
+	cache->segmentFileNum = -1;
+	cache->maxBytes = (int64) gp_appendonly_visimap_cache_size * 1024;
+
+	return cache;
+}
+
+/*
+ * Forget the ranges loaded so far, and start loading those of segment file
+ * 'segmentFileNum'.
+ */
+void
+AppendOnlyVisimapCache_Reset(AppendOnlyVisimapCache *cache,
+							 int segmentFileNum)
+{
+	MemoryContextReset(cache->rangeContext);
+
+	cache->segmentFileNum = segmentFileNum;
+	cache->complete = true;
+	cache->ranges = NULL;
+	cache->nranges = 0;
+	cache->maxranges = 0;
+	cache->usedBytes = 0;
+}
+
+/*
+ * AppendOnlyVisimapCache_AddRange
+ *
+ * Add the range of the current segment file that starts at 'firstRowNum',
+ * whose hidden rows are the members of 'hidden'.  The set is copied.
+ *
+ * Returns false, and marks the cache incomplete, if the range does not fit.
+ */
+bool
+AppendOnlyVisimapCache_AddRange(AppendOnlyVisimapCache *cache,
+								int64 firstRowNum,
+								Bitmapset *hidden)
+{
+	AppendOnlyVisimapCacheRange *range;
+	int64		rangeNum = firstRowNum / APPENDONLY_VISIMAP_MAX_RANGE;
+	int			hiddenCount;
+	int64		offsetsBytes;
+	int64		bitmapBytes;
+	MemoryContext oldContext;
+
+	Assert(cache->segmentFileNum >= 0);
+	Assert(firstRowNum % APPENDONLY_VISIMAP_MAX_RANGE == 0);
+
+	if (!cache->complete)
+		return false;
+
+	hiddenCount = bms_num_members(hidden);
+	if (hiddenCount == 0)
+		return true;
+
+	offsetsBytes = sizeof(uint16) * hiddenCount;
+	bitmapBytes = offsetof(Bitmapset, words) + sizeof(bitmapword) * hidden->nwords;
+
+	/* the range array is at most a few hundred kB, it is not counted */
+	if (cache->usedBytes + Min(offsetsBytes, bitmapBytes) > cache->maxBytes ||
+		rangeNum >= MaxAllocSize / sizeof(AppendOnlyVisimapCacheRange))
+	{
+		cache->complete = false;
+		return false;
+	}
+
+	oldContext = MemoryContextSwitchTo(cache->rangeContext);
+
+	if (rangeNum >= cache->maxranges)
+	{
+		int			newmax = Max(Max(16, cache->maxranges * 2), rangeNum + 1);
+
+		if (cache->ranges == NULL)
+			cache->ranges = palloc0(sizeof(AppendOnlyVisimapCacheRange) * newmax);
+		else
+		{
+			cache->ranges = repalloc(cache->ranges,
+									 sizeof(AppendOnlyVisimapCacheRange) * newmax);
+			memset(&cache->ranges[cache->maxranges], 0,
+				   sizeof(AppendOnlyVisimapCacheRange) * (newmax - cache->maxranges));
+		}
+		cache->maxranges = newmax;
+	}
+	if (rangeNum >= cache->nranges)
+		cache->nranges = rangeNum + 1;
+
+	range = &cache->ranges[rangeNum];
+	Assert(range->hiddenCount == 0);
+	range->hiddenCount = hiddenCount;
+
+	if (offsetsBytes < bitmapBytes)
+	{
+		Bitmapset  *tmp = bms_copy(hidden);
+		int			offset;
+		int			i = 0;
+
+		range->offsets = palloc(offsetsBytes);
+		while ((offset = bms_first_member(tmp)) >= 0)
+			range->offsets[i++] = (uint16) offset;
+		Assert(i == hiddenCount);
+		bms_free(tmp);
+
+		cache->usedBytes += offsetsBytes;
+	}
+	else
+	{
+		range->bitmap = bms_copy(hidden);
+		cache->usedBytes += bitmapBytes;
+	}
+
+	MemoryContextSwitchTo(oldContext);
+
+	return true;
+}
+
+/*
+ * AppendOnlyVisimapCache_IsVisible
+ *
+ * Is row 'rowNum' of the loaded segment file visible according to the
+ * visibility map?  The cache must be complete.
+ */
+bool
+AppendOnlyVisimapCache_IsVisible(AppendOnlyVisimapCache *cache, int64 rowNum)
+{
+	AppendOnlyVisimapCacheRange *range;
+	int64		rangeNum = rowNum / APPENDONLY_VISIMAP_MAX_RANGE;
+	int			offset = rowNum % APPENDONLY_VISIMAP_MAX_RANGE;
+	int			low;
+	int			high;
+
+	Assert(cache->complete);
+
+	if (rangeNum >= cache->nranges)
+		return true;
+
+	range = &cache->ranges[rangeNum];
+	if (range->hiddenCount == 0)
+		return true;
+
+	if (range->bitmap != NULL)
+		return !bms_is_member(offset, range->bitmap);
+
+	low = 0;
+	high = range->hiddenCount;
+	while (low < high)
+	{
+		int			mid = low + (high - low) / 2;
+
+		if (range->offsets[mid] < offset)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+
+	return !(low < range->hiddenCount && range->offsets[low] == offset);
+}
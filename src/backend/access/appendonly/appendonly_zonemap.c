@@ -0,0 +1,496 @@
+/*------------------------------------------------------------------------------
+ *
+ * AppendOnlyZoneMap
+ *   skip append-only blocks using the min/max summaries kept in the
+ *   block directory.
+ *
+ * Copyright (c) 2013-Present Pivotal Software, Inc.
+ *
+ *
+ * IDENTIFICATION
+ *	    src/backend/access/appendonly/appendonly_zonemap.c
+ *
+ *------------------------------------------------------------------------------
+*/
+#include "postgres.h"
+
+#include "access/appendonly_zonemap.h"
+#include "access/nbtree.h"
+#include "catalog/pg_am.h"
+#include "catalog/pg_type.h"
+#include "cdb/cdbappendonlyblockdirectory.h"
+#include "cdb/cdbvars.h"
+#include "commands/defrem.h"
+#include "nodes/execnodes.h"
+#include "utils/date.h"
+#include "utils/lsyscache.h"
+#include "utils/timestamp.h"
+
+typedef struct ZoneMapLoadState
+{
+	AppendOnlyZoneMapScan *zoneMap;
+	int			columnGroupNo;
+} ZoneMapLoadState;
+
+/*
+ * Can the values of the given type be summarized in a MinipageZone?
+ *
+ * Only types whose Datums are integers that sort like the values they
+ * represent qualify.
+ */
+bool
+AppendOnlyZoneMap_TypeIsSupported(Oid typid)
+{
+	switch (typid)
+	{
+		case INT2OID:
+		case INT4OID:
+		case INT8OID:
+		case DATEOID:
+#ifdef HAVE_INT64_TIMESTAMP
+		case TIMEOID:
+		case TIMESTAMPOID:
+		case TIMESTAMPTZOID:
+#endif
+			return true;
+		default:
+			return false;
+	}
+}
+
+/*
+ * Convert a value of a supported type to the int64 stored in a zone.
+ */
+int64
+AppendOnlyZoneMap_DatumGetInt64(Oid typid, Datum value)
+{
+	switch (typid)
+	{
+		case INT2OID:
+			return (int64) DatumGetInt16(value);
+		case INT4OID:
+			return (int64) DatumGetInt32(value);
+		case INT8OID:
+			return DatumGetInt64(value);
+		case DATEOID:
+			return (int64) DatumGetDateADT(value);
+#ifdef HAVE_INT64_TIMESTAMP
+		case TIMEOID:
+			return (int64) DatumGetTimeADT(value);
+		case TIMESTAMPOID:
+		case TIMESTAMPTZOID:
+			return (int64) DatumGetTimestamp(value);
+#endif
+		default:
+			elog(ERROR, "type %u cannot be summarized in a zone map", typid);
+	}
+	return 0;					/* keep compiler quiet */
+}
+
+/*
+ * Can a value of type 'righttype' be compared to the zone of a column of
+ * type 'lefttype' by comparing their int64 representations?
+ */
+static bool
+zonemap_types_comparable(Oid lefttype, Oid righttype)
+{
+	if (lefttype == righttype)
+		return true;
+
+	/* the integer types share their representation */
+	return (lefttype == INT2OID || lefttype == INT4OID || lefttype == INT8OID) &&
+		(righttype == INT2OID || righttype == INT4OID || righttype == INT8OID);
+}
+
+/*
+ * Turn a qual clause into a zone map key, if it has a suitable form.
+ */
+static bool
+zonemap_key_from_clause(Expr *clause, TupleDesc tupdesc,
+						AppendOnlyZoneMapKey *key)
+{
+	Var		   *var;
+
+	if (IsA(clause, OpExpr))
+	{
+		OpExpr	   *opexpr = (OpExpr *) clause;
+		Oid			opno = opexpr->opno;
+		Node	   *leftop;
+		Node	   *rightop;
+		Const	   *con;
+		Oid			lefttype;
+		Oid			righttype;
+		Oid			opclass;
+		int			strategy;
+
+		if (list_length(opexpr->args) != 2)
+			return false;
+		leftop = linitial(opexpr->args);
+		rightop = lsecond(opexpr->args);
+
+		/* commute "const op column" */
+		if (IsA(leftop, Const) && IsA(rightop, Var))
+		{
+			Node	   *tmp = leftop;
+
+			leftop = rightop;
+			rightop = tmp;
+			opno = get_commutator(opno);
+			if (!OidIsValid(opno))
+				return false;
+		}
+		if (!IsA(leftop, Var) || !IsA(rightop, Const))
+			return false;
+
+		var = (Var *) leftop;
+		con = (Const *) rightop;
+
+		if (var->varlevelsup != 0 ||
+			var->varattno <= 0 || var->varattno > tupdesc->natts ||
+			tupdesc->attrs[var->varattno - 1]->atttypid != var->vartype)
+			return false;
+		if (con->constisnull)
+			return false;
+		if (!AppendOnlyZoneMap_TypeIsSupported(var->vartype) ||
+			!AppendOnlyZoneMap_TypeIsSupported(con->consttype) ||
+			!zonemap_types_comparable(var->vartype, con->consttype))
+			return false;
+
+		op_input_types(opno, &lefttype, &righttype);
+		if (lefttype != var->vartype || righttype != con->consttype)
+			return false;
+
+		opclass = GetDefaultOpClass(var->vartype, BTREE_AM_OID);
+		if (!OidIsValid(opclass))
+			return false;
+		strategy = get_op_opfamily_strategy(opno, get_opclass_family(opclass));
+		if (strategy == InvalidStrategy)
+			return false;
+
+		key->attnum = var->varattno;
+		key->strategy = (StrategyNumber) strategy;
+		key->value = AppendOnlyZoneMap_DatumGetInt64(con->consttype,
+													 con->constvalue);
+		key->searchNull = false;
+		return true;
+	}
+	else if (IsA(clause, NullTest))
+	{
+		NullTest   *ntest = (NullTest *) clause;
+
+		if (ntest->argisrow || !IsA(ntest->arg, Var))
+			return false;
+
+		var = (Var *) ntest->arg;
+		if (var->varlevelsup != 0 ||
+			var->varattno <= 0 || var->varattno > tupdesc->natts ||
+			tupdesc->attrs[var->varattno - 1]->atttypid != var->vartype ||
+			!AppendOnlyZoneMap_TypeIsSupported(var->vartype))
+			return false;
+
+		key->attnum = var->varattno;
+		key->strategy = InvalidStrategy;
+		key->value = 0;
+		key->searchNull = (ntest->nulltesttype == IS_NULL);
+		return true;
+	}
+
+	return false;
+}
+
+/*
+ * AppendOnlyZoneMap_BeginScan
+ *
+ * Prepare to skip blocks of a scan of 'aoRel' that cannot satisfy 'qual',
+ * a list of ExprStates of the scan's (implicitly ANDed) qual.
+ *
+ * Returns NULL if zone maps are disabled, the relation has no block
+ * directory, or no clause of the qual can be checked against a zone.
+ */
+AppendOnlyZoneMapScan *
+AppendOnlyZoneMap_BeginScan(Relation aoRel,
+							Snapshot appendOnlyMetaDataSnapshot,
+							List *qual)
+{
+	AppendOnlyZoneMapScan *zoneMap;
+	AppendOnlyZoneMapKey *keys;
+	int			nkeys = 0;
+	ListCell   *lc;
+
+	if (!gp_appendonly_zone_maps || qual == NIL)
+		return NULL;
+	if (!OidIsValid(aoRel->rd_appendonly->blkdirrelid))
+		return NULL;
+
+	keys = palloc(sizeof(AppendOnlyZoneMapKey) * list_length(qual));
+	foreach(lc, qual)
+	{
+		ExprState  *clause = (ExprState *) lfirst(lc);
+
+		if (zonemap_key_from_clause(clause->expr, RelationGetDescr(aoRel),
+									&keys[nkeys]))
+			nkeys++;
+	}
+
+	if (nkeys == 0)
+	{
+		pfree(keys);
+		return NULL;
+	}
+
+	zoneMap = palloc0(sizeof(AppendOnlyZoneMapScan));
+	zoneMap->aoRel = aoRel;
+	zoneMap->appendOnlyMetaDataSnapshot = appendOnlyMetaDataSnapshot;
+	zoneMap->memoryContext = CurrentMemoryContext;
+	zoneMap->nkeys = nkeys;
+	zoneMap->keys = keys;
+
+	return zoneMap;
+}
+
+/*
+ * Can no row summarized by 'zone' satisfy 'key'?
+ */
+static bool
+zone_excludes(MinipageZone *zone, AppendOnlyZoneMapKey *key)
+{
+	if ((zone->flags & MINIPAGE_ZONE_VALID) == 0)
+		return false;
+
+	if (key->strategy == InvalidStrategy)
+	{
+		if (key->searchNull)
+			return zone->nullCount == 0;
+		else
+			return (zone->flags & MINIPAGE_ZONE_HASVALUES) == 0;
+	}
+
+	/* The comparison operators are strict: NULLs never pass */
+	if ((zone->flags & MINIPAGE_ZONE_HASVALUES) == 0)
+		return true;
+
+	switch (key->strategy)
+	{
+		case BTLessStrategyNumber:
+			return zone->minValue >= key->value;
+		case BTLessEqualStrategyNumber:
+			return zone->minValue > key->value;
+		case BTEqualStrategyNumber:
+			return key->value < zone->minValue || key->value > zone->maxValue;
+		case BTGreaterEqualStrategyNumber:
+			return zone->maxValue < key->value;
+		case BTGreaterStrategyNumber:
+			return zone->maxValue <= key->value;
+		default:
+			return false;
+	}
+}
+
+static void
+zonemap_load_entry(void *arg, int64 firstRowNum, int64 rowCount,
+				   MinipageZone *zones, int nZones)
+{
+	ZoneMapLoadState *state = (ZoneMapLoadState *) arg;
+	AppendOnlyZoneMapScan *zoneMap = state->zoneMap;
+	bool		isAOCol = RelationIsAoCols(zoneMap->aoRel);
+	int			keyNo;
+
+	for (keyNo = 0; keyNo < zoneMap->nkeys; keyNo++)
+	{
+		AppendOnlyZoneMapKey *key = &zoneMap->keys[keyNo];
+		int			zoneNo;
+
+		if (isAOCol && key->attnum - 1 != state->columnGroupNo)
+			continue;
+
+		for (zoneNo = 0; zoneNo < nZones; zoneNo++)
+		{
+			if (zones[zoneNo].attnum == key->attnum)
+				break;
+		}
+		if (zoneNo == nZones || !zone_excludes(&zones[zoneNo], key))
+			continue;
+
+		if (zoneMap->nranges == zoneMap->maxranges)
+		{
+			zoneMap->maxranges = Max(64, zoneMap->maxranges * 2);
+			if (zoneMap->ranges == NULL)
+				zoneMap->ranges = palloc(sizeof(AppendOnlyZoneMapRange) *
+										 zoneMap->maxranges);
+			else
+				zoneMap->ranges = repalloc(zoneMap->ranges,
+										   sizeof(AppendOnlyZoneMapRange) *
+										   zoneMap->maxranges);
+		}
+		zoneMap->ranges[zoneMap->nranges].firstRowNum = firstRowNum;
+		zoneMap->ranges[zoneMap->nranges].lastRowNum = firstRowNum + rowCount - 1;
+		zoneMap->nranges++;
+
+		/* one failing key is enough */
+		break;
+	}
+}
+
+static int
+zonemap_range_cmp(const void *a, const void *b)
+{
+	const AppendOnlyZoneMapRange *ra = (const AppendOnlyZoneMapRange *) a;
+	const AppendOnlyZoneMapRange *rb = (const AppendOnlyZoneMapRange *) b;
+
+	if (ra->firstRowNum < rb->firstRowNum)
+		return -1;
+	if (ra->firstRowNum > rb->firstRowNum)
+		return 1;
+	return 0;
+}
+
+/*
+ * AppendOnlyZoneMap_LoadSegmentFile
+ *
+ * Compute the excluded row ranges of a segment file from its block
+ * directory entries.  Must be called before the scan reads the file.
+ */
+void
+AppendOnlyZoneMap_LoadSegmentFile(AppendOnlyZoneMapScan *zoneMap, int segno)
+{
+	ZoneMapLoadState state;
+	MemoryContext oldcxt;
+	int			keyNo;
+	int			i;
+	int			n;
+
+	zoneMap->nranges = 0;
+	zoneMap->currange = 0;
+	state.zoneMap = zoneMap;
+
+	oldcxt = MemoryContextSwitchTo(zoneMap->memoryContext);
+
+	if (RelationIsAoCols(zoneMap->aoRel))
+	{
+		/* each key column has its own column group */
+		for (keyNo = 0; keyNo < zoneMap->nkeys; keyNo++)
+		{
+			int			prevNo;
+
+			for (prevNo = 0; prevNo < keyNo; prevNo++)
+			{
+				if (zoneMap->keys[prevNo].attnum == zoneMap->keys[keyNo].attnum)
+					break;
+			}
+			if (prevNo < keyNo)
+				continue;
+
+			state.columnGroupNo = zoneMap->keys[keyNo].attnum - 1;
+			AppendOnlyBlockDirectory_ScanZones(zoneMap->aoRel,
+											   zoneMap->appendOnlyMetaDataSnapshot,
+											   segno,
+											   state.columnGroupNo,
+											   zonemap_load_entry,
+											   &state);
+		}
+	}
+	else
+	{
+		state.columnGroupNo = 0;
+		AppendOnlyBlockDirectory_ScanZones(zoneMap->aoRel,
+										   zoneMap->appendOnlyMetaDataSnapshot,
+										   segno,
+										   0,
+										   zonemap_load_entry,
+										   &state);
+	}
+
+	MemoryContextSwitchTo(oldcxt);
+
+	if (zoneMap->nranges <= 1)
+		return;
+
+	/* Sort the ranges, and merge the overlapping or adjacent ones */
+	qsort(zoneMap->ranges, zoneMap->nranges, sizeof(AppendOnlyZoneMapRange),
+		  zonemap_range_cmp);
+
+	n = 0;
+	for (i = 1; i < zoneMap->nranges; i++)
+	{
+		AppendOnlyZoneMapRange *last = &zoneMap->ranges[n];
+		AppendOnlyZoneMapRange *range = &zoneMap->ranges[i];
+
+		if (range->firstRowNum <= last->lastRowNum + 1)
+			last->lastRowNum = Max(last->lastRowNum, range->lastRowNum);
+		else
+			zoneMap->ranges[++n] = *range;
+	}
+	zoneMap->nranges = n + 1;
+}
+
+/*
+ * Find the excluded range that contains rowNum, or return NULL.
+ *
+ * The scan reads the segment file in row number order, so the ranges
+ * before rowNum are never looked at again.
+ */
+static AppendOnlyZoneMapRange *
+zonemap_find_range(AppendOnlyZoneMapScan *zoneMap, int64 rowNum)
+{
+	while (zoneMap->currange < zoneMap->nranges &&
+		   zoneMap->ranges[zoneMap->currange].lastRowNum < rowNum)
+		zoneMap->currange++;
+
+	if (zoneMap->currange < zoneMap->nranges &&
+		zoneMap->ranges[zoneMap->currange].firstRowNum <= rowNum)
+		return &zoneMap->ranges[zoneMap->currange];
+
+	return NULL;
+}
+
+/*
+ * AppendOnlyZoneMap_ExcludesRows
+ *
+ * Can none of the rows firstRowNum .. firstRowNum + rowCount - 1 satisfy
+ * the scan's qual?
+ */
+bool
+AppendOnlyZoneMap_ExcludesRows(AppendOnlyZoneMapScan *zoneMap,
+							   int64 firstRowNum,
+							   int64 rowCount)
+{
+	AppendOnlyZoneMapRange *range = zonemap_find_range(zoneMap, firstRowNum);
+
+	if (range != NULL && firstRowNum + rowCount - 1 <= range->lastRowNum)
+	{
+		zoneMap->blocksSkipped++;
+		return true;
+	}
+	return false;
+}
+
+/*
+ * AppendOnlyZoneMap_SkipPastRow
+ *
+ * If rowNum cannot satisfy the scan's qual, return the last row number of
+ * the excluded range it is in; the scan may continue after that row.
+ * Otherwise return -1.
+ */
+int64
+AppendOnlyZoneMap_SkipPastRow(AppendOnlyZoneMapScan *zoneMap, int64 rowNum)
+{
+	AppendOnlyZoneMapRange *range = zonemap_find_range(zoneMap, rowNum);
+
+	if (range == NULL)
+		return INT64CONST(-1);
+	return range->lastRowNum;
+}
+
+void
+AppendOnlyZoneMap_EndScan(AppendOnlyZoneMapScan *zoneMap)
+{
+	elogif(Debug_appendonly_print_scan, LOG,
+		   "Append-only zone map scan of table '%s' skipped " INT64_FORMAT " blocks",
+		   RelationGetRelationName(zoneMap->aoRel),
+		   zoneMap->blocksSkipped);
+
+	if (zoneMap->ranges)
+		pfree(zoneMap->ranges);
+	pfree(zoneMap->keys);
+	pfree(zoneMap);
+}
@@ -31,6 +31,8 @@
 #include "postgres.h"
 
 #include "access/aosegfiles.h"
+#include "access/appendonly_blockcache.h"
+#include "access/appendonly_zonemap.h"
 #include "access/appendonlytid.h"
 #include "access/appendonlywriter.h"
 #include "access/aomd.h"
@@ -323,6 +325,9 @@ SetNextFileSegForRead(AppendOnlyScanDesc scan)
 
 	Assert(scan->initedStorageRoutines);
 
+	if (scan->zoneMap)
+		AppendOnlyZoneMap_LoadSegmentFile(scan->zoneMap, segno);
+
 	AppendOnlyStorageRead_OpenFile(
 								   &scan->storageRead,
 								   scan->aos_filenamepath,
@@ -1261,19 +1266,36 @@ getNextBlock(AppendOnlyScanDesc scan)
 			return false;
 	}
 
-	if (!AppendOnlyExecutorReadBlock_GetBlockInfo(
-												  &scan->storageRead,
-												  &scan->executorReadBlock))
+	for (;;)
 	{
-		if (scan->blockDirectory)
+		if (!AppendOnlyExecutorReadBlock_GetBlockInfo(
+													  &scan->storageRead,
+													  &scan->executorReadBlock))
 		{
-			AppendOnlyBlockDirectory_End_forInsert(scan->blockDirectory);
+			if (scan->blockDirectory)
+			{
+				AppendOnlyBlockDirectory_End_forInsert(scan->blockDirectory);
+			}
+
+			/* done reading the file */
+			CloseScannedFileSeg(scan);
+
+			return false;
 		}
 
-		/* done reading the file */
-		CloseScannedFileSeg(scan);
+		if (scan->zoneMap == NULL ||
+			!AppendOnlyZoneMap_ExcludesRows(scan->zoneMap,
+											scan->executorReadBlock.blockFirstRowNum,
+											scan->executorReadBlock.rowCount))
+			break;
 
-		return false;
+		/*
+		 * The zone maps show that no row of this block satisfies the qual,
+		 * so skip over it without reading or decompressing it.
+		 */
+		Assert(scan->blockDirectory == NULL);
+		AppendOnlyStorageRead_SkipCurrentBlock(&scan->storageRead);
+		AppendOnlyExecutionReadBlock_FinishedScanBlock(&scan->executorReadBlock);
 	}
 
 	if (scan->blockDirectory)
@@ -1660,6 +1682,7 @@ appendonly_beginrangescan_internal(Relation relation,
 						   relation->rd_appendonly->visimapidxid,
 						   AccessShareLock,
 						   appendOnlyMetaDataSnapshot);
+	AppendOnlyVisimap_EnableCache(&scan->visibilityMap);
 
 	return scan;
 }
@@ -1785,6 +1808,10 @@ appendonly_endscan(AppendOnlyScanDesc scan)
 	AppendOnlyExecutorReadBlock_Finish(&scan->executorReadBlock);
 
 	AppendOnlyVisimap_Finish(&scan->visibilityMap, AccessShareLock);
+
+	if (scan->zoneMap)
+		AppendOnlyZoneMap_EndScan(scan->zoneMap);
+
 	pfree(scan->aos_filenamepath);
 
 	pfree(scan->title);
@@ -1944,12 +1971,34 @@ fetchFromCurrentBlock(AppendOnlyFetchDesc aoFetchDesc,
 
 	if (!aoFetchDesc->currentBlock.gotContents)
 	{
+		AppendOnlyExecutorReadBlock *executorReadBlock =
+		&aoFetchDesc->executorReadBlock;
+
 		/*
 		 * Do decompression if necessary and get contents.
 		 */
-		AppendOnlyExecutorReadBlock_GetContents(&aoFetchDesc->executorReadBlock);
+		AppendOnlyExecutorReadBlock_GetContents(executorReadBlock);
 
 		aoFetchDesc->currentBlock.gotContents = true;
+
+		/*
+		 * Keep a copy of the block for later fetches.  The blocks of older
+		 * formats are left out, their tuples need upgrading on the way out.
+		 */
+		if (aoFetchDesc->blockCache != NULL &&
+			!executorReadBlock->isLarge &&
+			aoFetchDesc->storageRead.formatVersion == AORelationVersion_GetLatest())
+		{
+			AppendOnlyBlockCache_Insert(aoFetchDesc->blockCache,
+										0,
+										executorReadBlock->segmentFileNum,
+										executorReadBlock->blockFirstRowNum,
+										executorReadBlock->rowCount,
+										executorReadBlock->headerOffsetInFile,
+										executorReadBlock->executorBlockKind,
+										executorReadBlock->dataBuffer,
+										executorReadBlock->dataLen);
+		}
 	}
 
 	return AppendOnlyExecutorReadBlock_FetchTuple(&aoFetchDesc->executorReadBlock,
@@ -1959,6 +2008,61 @@ fetchFromCurrentBlock(AppendOnlyFetchDesc aoFetchDesc,
 												  slot);
 }
 
+/*
+ * Fetch a row from a cached block.
+ */
+static bool
+fetchFromCachedBlock(AppendOnlyFetchDesc aoFetchDesc,
+					 AppendOnlyBlockCacheEntry *entry,
+					 int64 rowNum,
+					 TupleTableSlot *slot)
+{
+	AppendOnlyExecutorReadBlock *executorReadBlock =
+	&aoFetchDesc->executorReadBlock;
+
+	if (aoFetchDesc->cachedBlockId != entry->id)
+	{
+		/*
+		 * The block of the segment file executorReadBlock was at is gone, the
+		 * next fetch that misses the cache has to look it up again.
+		 */
+		aoFetchDesc->currentBlock.have = false;
+
+		executorReadBlock->segmentFileNum = entry->segmentFileNum;
+		executorReadBlock->blockFirstRowNum = entry->firstRowNum;
+		executorReadBlock->headerOffsetInFile = entry->fileOffset;
+		executorReadBlock->dataBuffer = entry->data;
+		executorReadBlock->dataLen = entry->dataLen;
+		executorReadBlock->executorBlockKind = entry->executorBlockKind;
+		executorReadBlock->rowCount = entry->rowCount;
+		executorReadBlock->isLarge = false;
+		executorReadBlock->isCompressed = false;
+
+		/* the block was checked when it was read */
+		if (entry->executorBlockKind == AoExecutorBlockKind_VarBlock)
+		{
+			VarBlockReaderInit(&executorReadBlock->varBlockReader,
+							   executorReadBlock->dataBuffer,
+							   executorReadBlock->dataLen);
+			executorReadBlock->readerItemCount = entry->rowCount;
+			executorReadBlock->currentItemCount = 0;
+		}
+		else
+		{
+			executorReadBlock->singleRow = executorReadBlock->dataBuffer;
+			executorReadBlock->singleRowLen = executorReadBlock->dataLen;
+		}
+
+		aoFetchDesc->cachedBlockId = entry->id;
+	}
+
+	return AppendOnlyExecutorReadBlock_FetchTuple(executorReadBlock,
+												  rowNum,
+												   /* nkeys */ 0,
+												   /* key */ NULL,
+												  slot);
+}
+
 static void
 positionFirstBlockOfRange(AppendOnlyFetchDesc aoFetchDesc)
 {
@@ -2012,6 +2116,9 @@ scanToFetchTuple(AppendOnlyFetchDesc aoFetchDesc,
 		return false;
 /* UNDONE:Why does our next scan position go beyond logical EOF ? */
 
+	/* executorReadBlock will no longer be reading a cached block */
+	aoFetchDesc->cachedBlockId = 0;
+
 	/*
 	 * Temporarily restrict our reading to just the range.
 	 */
@@ -2214,6 +2321,8 @@ appendonly_fetch_init(Relation relation,
 						   AccessShareLock,
 						   appendOnlyMetaDataSnapshot);
 
+	aoFetchDesc->blockCache = AppendOnlyBlockCache_Create(1);
+
 	return aoFetchDesc;
 
 }
@@ -2234,6 +2343,9 @@ appendonly_fetch(AppendOnlyFetchDesc aoFetchDesc,
 	int64		rowNum = AOTupleIdGet_rowNum(aoTupleId);
 	bool		isSnapshotAny = (aoFetchDesc->snapshot == SnapshotAny);
 
+	if (aoFetchDesc->blockCache != NULL)
+		AppendOnlyBlockCache_BeginFetch(aoFetchDesc->blockCache);
+
 	/*
 	 * Do we have a current block?  If it has the requested tuple, that would
 	 * be a great performance optimization.
@@ -2260,6 +2372,44 @@ appendonly_fetch(AppendOnlyFetchDesc aoFetchDesc,
 				}
 				return fetchFromCurrentBlock(aoFetchDesc, rowNum, slot);
 			}
+		}
+	}
+
+	/*
+	 * Next best is a copy of the block in the block cache.  Only blocks of
+	 * the latest format are cached, so they can only be used while the
+	 * segment file being read, whose format governs the processing of the
+	 * tuples, is of that format too.
+	 */
+	if (aoFetchDesc->blockCache != NULL &&
+		aoFetchDesc->storageRead.formatVersion == AORelationVersion_GetLatest())
+	{
+		AppendOnlyBlockCacheEntry *entry;
+
+		entry = AppendOnlyBlockCache_Lookup(aoFetchDesc->blockCache,
+											0,
+											segmentFileNum,
+											rowNum);
+		if (entry != NULL)
+		{
+			if (!isSnapshotAny && !AppendOnlyVisimap_IsVisible(&aoFetchDesc->visibilityMap, aoTupleId))
+			{
+				if (slot != NULL)
+				{
+					ExecClearTuple(slot);
+				}
+				return false;	/* row has been deleted or updated. */
+			}
+			return fetchFromCachedBlock(aoFetchDesc, entry, rowNum, slot);
+		}
+	}
+
+	if (aoFetchDesc->currentBlock.have)
+	{
+		if (segmentFileNum == aoFetchDesc->currentSegmentFile.num &&
+			segmentFileNum == aoFetchDesc->blockDirectory.currentSegmentFileNum &&
+			segmentFileNum == aoFetchDesc->executorReadBlock.segmentFileNum)
+		{
 
 			/*
 			 * Otherwize, if the current Block Directory entry covers the
@@ -2419,6 +2569,9 @@ appendonly_fetch_finish(AppendOnlyFetchDesc aoFetchDesc)
 
 	AppendOnlyExecutorReadBlock_Finish(&aoFetchDesc->executorReadBlock);
 
+	if (aoFetchDesc->blockCache != NULL)
+		AppendOnlyBlockCache_End(aoFetchDesc->blockCache, aoFetchDesc->relation);
+
 	AppendOnlyBlockDirectory_End_forSearch(&aoFetchDesc->blockDirectory);
 
 	if (aoFetchDesc->segmentFileInfo)
@@ -2794,6 +2947,7 @@ appendonly_insert_init(Relation rel, int segno, bool update_mode)
 aoInsertDesc->appendOnlyMetaDataSnapshot, //CONCERN:Safe to assume all block directory entries for segment are "covered" by same exclusive lock.
 											aoInsertDesc->fsInfo, aoInsertDesc->lastSequence,
 											rel, segno, 1, false);
+	AppendOnlyBlockDirectory_InitZoneMaps(&aoInsertDesc->blockDirectory);
 
 	return aoInsertDesc;
 }
@@ -2993,6 +3147,9 @@ appendonly_insert(AppendOnlyInsertDesc aoInsertDesc,
 
 		if (itemLen > 0)
 			memcpy(itemPtr, tup, itemLen);
+
+		AppendOnlyBlockDirectory_ZoneAddMemTuple(&aoInsertDesc->blockDirectory,
+												 tup, aoInsertDesc->mt_bind);
 	}
 	else
 	{
@@ -3022,6 +3179,15 @@ appendonly_insert(AppendOnlyInsertDesc aoInsertDesc,
 		Assert(aoInsertDesc->nonCompressedData == NULL);
 		Assert(!AppendOnlyStorageWrite_IsBufferAllocated(&aoInsertDesc->storageWrite));
 
+		/*
+		 * The large row gets no block directory entry of its own, it falls
+		 * in the range of the last entry.
+		 */
+		AppendOnlyBlockDirectory_ZoneAddMemTuple(&aoInsertDesc->blockDirectory,
+												 tup, aoInsertDesc->mt_bind);
+		AppendOnlyBlockDirectory_ZoneAttachToLastEntry(&aoInsertDesc->blockDirectory,
+													   0);
+
 		setupNextWriteBlock(aoInsertDesc);
 	}
 
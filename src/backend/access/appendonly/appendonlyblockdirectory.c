@@ -16,6 +16,7 @@
 
 #include "cdb/cdbappendonlyblockdirectory.h"
 #include "catalog/aoblkdir.h"
+#include "access/appendonly_zonemap.h"
 #include "access/heapam.h"
 #include "access/genam.h"
 #include "catalog/indexing.h"
@@ -28,6 +29,7 @@
 
 int			gp_blockdirectory_entry_min_range = 0;
 int			gp_blockdirectory_minipage_size = NUM_MINIPAGE_ENTRIES;
+bool		gp_appendonly_zone_maps = false;
 
 static inline uint32
 minipage_size(uint32 nEntry)
@@ -36,6 +38,16 @@ minipage_size(uint32 nEntry)
 		sizeof(MinipageEntry) * nEntry;
 }
 
+/* The zone map trailer starts with nZoneAtts and 4 bytes of padding */
+#define MINIPAGE_ZONE_HEADER_SIZE (2 * sizeof(int32))
+
+static inline uint32
+minipage_zonemap_size(uint32 nEntry, int nZoneAtts)
+{
+	return minipage_size(nEntry) + MINIPAGE_ZONE_HEADER_SIZE +
+		sizeof(MinipageZone) * nEntry * nZoneAtts;
+}
+
 static void load_last_minipage(
 				   AppendOnlyBlockDirectory *blockDirectory,
 				   int64 lastSequence,
@@ -56,6 +68,7 @@ static void extract_minipage(
 static void write_minipage(AppendOnlyBlockDirectory *blockDirectory,
 			   int columnGroupNo,
 			   MinipagePerColumnGroup *minipageInfo);
+static void init_zone_maps(AppendOnlyBlockDirectory *blockDirectory);
 static bool insert_new_entry(AppendOnlyBlockDirectory *blockDirectory,
 				 int columnGroupNo,
 				 int64 firstRowNum,
@@ -136,6 +149,8 @@ init_internal(AppendOnlyBlockDirectory *blockDirectory)
 				  blockDirectory->scanKeys,
 				  blockDirectory->strategyNumbers);
 
+	blockDirectory->summarizeZones = false;
+
 	/* Initialize the last minipage */
 	blockDirectory->minipages =
 		palloc0(sizeof(MinipagePerColumnGroup) * blockDirectory->numColumnGroups);
@@ -157,6 +172,268 @@ init_internal(AppendOnlyBlockDirectory *blockDirectory)
 	MemoryContextSwitchTo(oldcxt);
 }
 
+/*
+ * Empty a zone.  A zone that is not valid never excludes any row.
+ */
+static inline void
+reset_zone(MinipageZone *zone, AttrNumber attnum, bool valid)
+{
+	zone->minValue = 0;
+	zone->maxValue = 0;
+	zone->nullCount = 0;
+	zone->attnum = attnum;
+	zone->flags = valid ? MINIPAGE_ZONE_VALID : 0;
+	zone->padding = 0;
+}
+
+static inline void
+zone_add_value(MinipageZone *zone, Oid typid, Datum value, bool isnull)
+{
+	int64		v;
+
+	if (isnull)
+	{
+		zone->nullCount++;
+		return;
+	}
+
+	v = AppendOnlyZoneMap_DatumGetInt64(typid, value);
+	if ((zone->flags & MINIPAGE_ZONE_HASVALUES) == 0)
+	{
+		zone->minValue = v;
+		zone->maxValue = v;
+		zone->flags |= MINIPAGE_ZONE_HASVALUES;
+	}
+	else if (v < zone->minValue)
+		zone->minValue = v;
+	else if (v > zone->maxValue)
+		zone->maxValue = v;
+}
+
+/*
+ * Widen 'zone' to also cover the rows summarized by 'other'.
+ */
+static inline void
+merge_zone(MinipageZone *zone, MinipageZone *other)
+{
+	Assert(zone->attnum == other->attnum);
+
+	if ((other->flags & MINIPAGE_ZONE_VALID) == 0)
+		zone->flags &= ~MINIPAGE_ZONE_VALID;
+
+	zone->nullCount += other->nullCount;
+
+	if ((other->flags & MINIPAGE_ZONE_HASVALUES) == 0)
+		return;
+	if ((zone->flags & MINIPAGE_ZONE_HASVALUES) == 0)
+	{
+		zone->minValue = other->minValue;
+		zone->maxValue = other->maxValue;
+		zone->flags |= MINIPAGE_ZONE_HASVALUES;
+	}
+	else
+	{
+		zone->minValue = Min(zone->minValue, other->minValue);
+		zone->maxValue = Max(zone->maxValue, other->maxValue);
+	}
+}
+
+static void
+reset_pending_zones(AppendOnlyBlockDirectory *blockDirectory,
+					MinipagePerColumnGroup *minipageInfo)
+{
+	int			zoneNo;
+
+	for (zoneNo = 0; zoneNo < minipageInfo->nZoneAtts; zoneNo++)
+		reset_zone(&minipageInfo->pendingZones[zoneNo],
+				   minipageInfo->pendingZones[zoneNo].attnum,
+				   blockDirectory->summarizeZones);
+}
+
+/*
+ * init_zone_maps
+ *
+ * Choose the columns summarized in the minipages written by an insert.
+ * A column-oriented table summarizes the column of each column group, a
+ * row-oriented table the first MAX_ZONE_ATTS_PER_MINIPAGE columns that
+ * can be summarized.
+ *
+ * Until AppendOnlyBlockDirectory_InitZoneMaps() is called, the new entries
+ * get summaries that are not valid; this keeps the block directory built
+ * by the first CREATE INDEX correct without summarizing the existing rows.
+ */
+static void
+init_zone_maps(AppendOnlyBlockDirectory *blockDirectory)
+{
+	TupleDesc	tupdesc = RelationGetDescr(blockDirectory->aoRel);
+	MemoryContext oldcxt;
+	int			groupNo;
+
+	if (!gp_appendonly_zone_maps)
+		return;
+
+	oldcxt = MemoryContextSwitchTo(blockDirectory->memoryContext);
+
+	for (groupNo = 0; groupNo < blockDirectory->numColumnGroups; groupNo++)
+	{
+		MinipagePerColumnGroup *minipageInfo =
+		&blockDirectory->minipages[groupNo];
+		AttrNumber	attnums[MAX_ZONE_ATTS_PER_MINIPAGE];
+		int			nZoneAtts = 0;
+		int			attno;
+		int			zoneNo;
+
+		for (attno = 0; attno < tupdesc->natts; attno++)
+		{
+			Form_pg_attribute attr = tupdesc->attrs[attno];
+
+			if (blockDirectory->isAOCol && attno != groupNo)
+				continue;
+			if (attr->attisdropped ||
+				!AppendOnlyZoneMap_TypeIsSupported(attr->atttypid))
+				continue;
+
+			attnums[nZoneAtts++] = attno + 1;
+			if (nZoneAtts == MAX_ZONE_ATTS_PER_MINIPAGE)
+				break;
+		}
+
+		if (nZoneAtts == 0)
+			continue;
+
+		minipageInfo->nZoneAtts = nZoneAtts;
+		minipageInfo->zoneTypes = palloc(sizeof(Oid) * nZoneAtts);
+		minipageInfo->zones =
+			palloc0(sizeof(MinipageZone) * NUM_MINIPAGE_ENTRIES * nZoneAtts);
+		minipageInfo->pendingZones = palloc(sizeof(MinipageZone) * nZoneAtts);
+
+		for (zoneNo = 0; zoneNo < nZoneAtts; zoneNo++)
+		{
+			minipageInfo->zoneTypes[zoneNo] =
+				tupdesc->attrs[attnums[zoneNo] - 1]->atttypid;
+			reset_zone(&minipageInfo->pendingZones[zoneNo], attnums[zoneNo],
+					   false);
+		}
+	}
+
+	MemoryContextSwitchTo(oldcxt);
+}
+
+/*
+ * AppendOnlyBlockDirectory_InitZoneMaps
+ *
+ * Called by an inserter that reports every row it adds through
+ * AppendOnlyBlockDirectory_ZoneAddValue() or _ZoneAddMemTuple(), so that
+ * the entries it creates get valid zone maps.
+ */
+void
+AppendOnlyBlockDirectory_InitZoneMaps(AppendOnlyBlockDirectory *blockDirectory)
+{
+	int			groupNo;
+
+	if (blockDirectory->blkdirRel == NULL ||
+		blockDirectory->blkdirIdx == NULL)
+		return;
+
+	blockDirectory->summarizeZones = true;
+	for (groupNo = 0; groupNo < blockDirectory->numColumnGroups; groupNo++)
+		reset_pending_zones(blockDirectory, &blockDirectory->minipages[groupNo]);
+}
+
+/*
+ * AppendOnlyBlockDirectory_ZoneAddValue
+ *
+ * Summarize the value of a column-oriented table's column group for the
+ * row being inserted.
+ */
+void
+AppendOnlyBlockDirectory_ZoneAddValue(AppendOnlyBlockDirectory *blockDirectory,
+									  int columnGroupNo,
+									  Datum value,
+									  bool isnull)
+{
+	MinipagePerColumnGroup *minipageInfo;
+
+	if (blockDirectory->blkdirRel == NULL ||
+		!blockDirectory->summarizeZones)
+		return;
+
+	minipageInfo = &blockDirectory->minipages[columnGroupNo];
+	if (minipageInfo->nZoneAtts == 0)
+		return;
+
+	Assert(minipageInfo->nZoneAtts == 1);
+	zone_add_value(&minipageInfo->pendingZones[0],
+				   minipageInfo->zoneTypes[0], value, isnull);
+}
+
+/*
+ * AppendOnlyBlockDirectory_ZoneAddMemTuple
+ *
+ * Summarize a row being inserted into a row-oriented table.
+ */
+void
+AppendOnlyBlockDirectory_ZoneAddMemTuple(AppendOnlyBlockDirectory *blockDirectory,
+										 MemTuple tuple,
+										 MemTupleBinding *binding)
+{
+	MinipagePerColumnGroup *minipageInfo;
+	int			zoneNo;
+
+	if (blockDirectory->blkdirRel == NULL ||
+		!blockDirectory->summarizeZones)
+		return;
+
+	minipageInfo = &blockDirectory->minipages[0];
+	for (zoneNo = 0; zoneNo < minipageInfo->nZoneAtts; zoneNo++)
+	{
+		MinipageZone *zone = &minipageInfo->pendingZones[zoneNo];
+		Datum		value;
+		bool		isnull;
+
+		value = memtuple_getattr(tuple, binding, zone->attnum, &isnull);
+		zone_add_value(zone, minipageInfo->zoneTypes[zoneNo], value, isnull);
+	}
+}
+
+/*
+ * AppendOnlyBlockDirectory_ZoneAttachToLastEntry
+ *
+ * Rows that are written without a block directory entry of their own
+ * (large rows of a row-oriented table) end up in the range of the last
+ * entry.  Add the rows summarized so far to that entry's zones.
+ */
+void
+AppendOnlyBlockDirectory_ZoneAttachToLastEntry(AppendOnlyBlockDirectory *blockDirectory,
+											   int columnGroupNo)
+{
+	MinipagePerColumnGroup *minipageInfo;
+	int			zoneNo;
+
+	if (blockDirectory->blkdirRel == NULL ||
+		!blockDirectory->summarizeZones)
+		return;
+
+	minipageInfo = &blockDirectory->minipages[columnGroupNo];
+	if (minipageInfo->nZoneAtts == 0)
+		return;
+
+	/*
+	 * Without an entry in the current minipage, the rows are not covered by
+	 * any entry until the next one is inserted after them.
+	 */
+	if (minipageInfo->numMinipageEntries > 0)
+	{
+		MinipageZone *zones = &minipageInfo->zones[
+			(minipageInfo->numMinipageEntries - 1) * minipageInfo->nZoneAtts];
+
+		for (zoneNo = 0; zoneNo < minipageInfo->nZoneAtts; zoneNo++)
+			merge_zone(&zones[zoneNo], &minipageInfo->pendingZones[zoneNo]);
+	}
+
+	reset_pending_zones(blockDirectory, minipageInfo);
+}
+
 /*
  * AppendOnlyBlockDirectory_Init_forSearch
  *
@@ -270,6 +547,7 @@ AppendOnlyBlockDirectory_Init_forInsert(
 		index_open(aoRel->rd_appendonly->blkdiridxid, RowExclusiveLock);
 
 	init_internal(blockDirectory);
+	init_zone_maps(blockDirectory);
 
 	ereportif(Debug_appendonly_print_blockdirectory, LOG,
 			  (errmsg("Append-only block directory init for insert: "
@@ -733,7 +1011,20 @@ insert_new_entry(
 
 		if (gp_blockdirectory_entry_min_range > 0 &&
 			fileOffset - entry->fileOffset < gp_blockdirectory_entry_min_range)
+		{
+			/* The rows of the new block become part of the last entry */
+			if (minipageInfo->nZoneAtts > 0)
+			{
+				MinipageZone *zones =
+				&minipageInfo->zones[lastEntryNo * minipageInfo->nZoneAtts];
+				int			zoneNo;
+
+				for (zoneNo = 0; zoneNo < minipageInfo->nZoneAtts; zoneNo++)
+					merge_zone(&zones[zoneNo], &minipageInfo->pendingZones[zoneNo]);
+				reset_pending_zones(blockDirectory, minipageInfo);
+			}
 			return true;
+		}
 
 		/* Update the rowCount in the latest entry */
 		Assert(entry->rowCount <= firstRowNum - entry->firstRowNum);
@@ -774,6 +1065,15 @@ insert_new_entry(
 	entry->fileOffset = fileOffset;
 	entry->rowCount = rowCount;
 
+	if (minipageInfo->nZoneAtts > 0)
+	{
+		memcpy(&minipageInfo->zones[minipageInfo->numMinipageEntries *
+									minipageInfo->nZoneAtts],
+			   minipageInfo->pendingZones,
+			   sizeof(MinipageZone) * minipageInfo->nZoneAtts);
+		reset_pending_zones(blockDirectory, minipageInfo);
+	}
+
 	minipageInfo->numMinipageEntries++;
 
 	ereportif(Debug_appendonly_print_blockdirectory, LOG,
@@ -832,6 +1132,93 @@ AppendOnlyBlockDirectory_DeleteSegmentFile(Relation aoRel,
 
 }
 
+/*
+ * AppendOnlyBlockDirectory_ScanZones
+ *
+ * Call 'callback' for every entry of the given segment file and column
+ * group whose minipage carries zone maps.
+ */
+void
+AppendOnlyBlockDirectory_ScanZones(Relation aoRel,
+								   Snapshot snapshot,
+								   int segno,
+								   int columnGroupNo,
+								   MinipageZoneCallback callback,
+								   void *arg)
+{
+	Relation	blkdirRel;
+	Relation	blkdirIdx;
+	TupleDesc	heapTupleDesc;
+	ScanKeyData scanKeys[2];
+	IndexScanDesc indexScan;
+	HeapTuple	tuple;
+
+	Assert(OidIsValid(aoRel->rd_appendonly->blkdirrelid));
+	Assert(OidIsValid(aoRel->rd_appendonly->blkdiridxid));
+
+	blkdirRel = heap_open(aoRel->rd_appendonly->blkdirrelid, AccessShareLock);
+	blkdirIdx = index_open(aoRel->rd_appendonly->blkdiridxid, AccessShareLock);
+	heapTupleDesc = RelationGetDescr(blkdirRel);
+
+	ScanKeyInit(&scanKeys[0],
+				Anum_pg_aoblkdir_segno,
+				BTEqualStrategyNumber,
+				F_INT4EQ,
+				Int32GetDatum(segno));
+	ScanKeyInit(&scanKeys[1],
+				Anum_pg_aoblkdir_columngroupno,
+				BTEqualStrategyNumber,
+				F_INT4EQ,
+				Int32GetDatum(columnGroupNo));
+
+	indexScan = index_beginscan(blkdirRel, blkdirIdx, snapshot, 2, 0);
+	index_rescan(indexScan, scanKeys, 2, NULL, 0);
+
+	while ((tuple = index_getnext(indexScan, ForwardScanDirection)) != NULL)
+	{
+		Datum		value;
+		bool		isnull;
+		struct varlena *detoast_value;
+		Minipage   *minipage;
+		MinipageZone *zones;
+		int32		nZoneAtts;
+		uint32		entryNo;
+
+		value = heap_getattr(tuple, Anum_pg_aoblkdir_minipage,
+							 heapTupleDesc, &isnull);
+		if (isnull)
+			continue;
+
+		/* Make an aligned copy, the zones are accessed in place */
+		detoast_value = pg_detoast_datum((struct varlena *) DatumGetPointer(value));
+		minipage = palloc(VARSIZE(detoast_value));
+		memcpy(minipage, detoast_value, VARSIZE(detoast_value));
+		if (detoast_value != (struct varlena *) DatumGetPointer(value))
+			pfree(detoast_value);
+
+		if (minipage->version == MINIPAGE_VERSION_ZONEMAP)
+		{
+			char	   *trailer = (char *) minipage + minipage_size(minipage->nEntry);
+
+			memcpy(&nZoneAtts, trailer, sizeof(int32));
+			zones = (MinipageZone *) (trailer + MINIPAGE_ZONE_HEADER_SIZE);
+
+			for (entryNo = 0; entryNo < minipage->nEntry; entryNo++)
+				callback(arg,
+						 minipage->entry[entryNo].firstRowNum,
+						 minipage->entry[entryNo].rowCount,
+						 &zones[entryNo * nZoneAtts],
+						 nZoneAtts);
+		}
+
+		pfree(minipage);
+	}
+
+	index_endscan(indexScan);
+	index_close(blkdirIdx, AccessShareLock);
+	heap_close(blkdirRel, AccessShareLock);
+}
+
 /*
  * init_scankeys
  *
@@ -898,6 +1285,57 @@ init_scankeys(TupleDesc tupleDesc,
 	}
 }
 
+/*
+ * copy_out_zones
+ *
+ * Copy out the zone maps of the summarized columns from a stored minipage.
+ * Columns that the stored minipage does not summarize get zones that are
+ * not valid.
+ */
+static void
+copy_out_zones(MinipagePerColumnGroup *minipageInfo, char *stored)
+{
+	uint32		nEntry = minipageInfo->minipage->nEntry;
+	int32		nStoredAtts = 0;
+	char	   *storedZones = NULL;
+	uint32		entryNo;
+	int			zoneNo;
+	int			storedNo;
+
+	if (minipageInfo->minipage->version == MINIPAGE_VERSION_ZONEMAP)
+	{
+		memcpy(&nStoredAtts, stored + minipage_size(nEntry), sizeof(int32));
+		storedZones = stored + minipage_size(nEntry) + MINIPAGE_ZONE_HEADER_SIZE;
+	}
+
+	for (entryNo = 0; entryNo < nEntry; entryNo++)
+	{
+		for (zoneNo = 0; zoneNo < minipageInfo->nZoneAtts; zoneNo++)
+		{
+			MinipageZone *zone =
+			&minipageInfo->zones[entryNo * minipageInfo->nZoneAtts + zoneNo];
+			AttrNumber	attnum = minipageInfo->pendingZones[zoneNo].attnum;
+
+			reset_zone(zone, attnum, false);
+
+			for (storedNo = 0; storedNo < nStoredAtts; storedNo++)
+			{
+				MinipageZone storedZone;
+
+				memcpy(&storedZone,
+					   storedZones +
+					   (entryNo * nStoredAtts + storedNo) * sizeof(MinipageZone),
+					   sizeof(MinipageZone));
+				if (storedZone.attnum == attnum)
+				{
+					*zone = storedZone;
+					break;
+				}
+			}
+		}
+	}
+}
+
 /*
  * copy_out_minipage
  *
@@ -916,15 +1354,19 @@ copy_out_minipage(MinipagePerColumnGroup *minipageInfo,
 	value = (struct varlena *)
 		DatumGetPointer(minipage_value);
 	detoast_value = pg_detoast_datum(value);
-	Assert(VARSIZE(detoast_value) <= minipage_size(NUM_MINIPAGE_ENTRIES));
+	Assert(((Minipage *) detoast_value)->nEntry <= NUM_MINIPAGE_ENTRIES);
 
-	memcpy(minipageInfo->minipage, detoast_value, VARSIZE(detoast_value));
-	if (detoast_value != value)
-		pfree(detoast_value);
-
-	Assert(minipageInfo->minipage->nEntry <= NUM_MINIPAGE_ENTRIES);
+	/* Copy the entries; any zone maps follow them */
+	memcpy(minipageInfo->minipage, detoast_value,
+		   minipage_size(((Minipage *) detoast_value)->nEntry));
 
 	minipageInfo->numMinipageEntries = minipageInfo->minipage->nEntry;
+
+	if (minipageInfo->nZoneAtts > 0)
+		copy_out_zones(minipageInfo, (char *) detoast_value);
+
+	if (detoast_value != value)
+		pfree(detoast_value);
 }
 
 
@@ -1126,6 +1568,37 @@ find_minipage_entry(Minipage *minipage,
 		return -1;
 }
 
+/*
+ * form_zonemap_minipage
+ *
+ * Form a MINIPAGE_VERSION_ZONEMAP minipage from the in-memory minipage
+ * and its zone maps.
+ */
+static Minipage *
+form_zonemap_minipage(MinipagePerColumnGroup *minipageInfo)
+{
+	uint32		nEntry = minipageInfo->numMinipageEntries;
+	int32		header[2];
+	char	   *buf;
+	Minipage   *minipage;
+
+	buf = palloc(minipage_zonemap_size(nEntry, minipageInfo->nZoneAtts));
+	memcpy(buf, minipageInfo->minipage, minipage_size(nEntry));
+
+	header[0] = minipageInfo->nZoneAtts;
+	header[1] = 0;
+	memcpy(buf + minipage_size(nEntry), header, MINIPAGE_ZONE_HEADER_SIZE);
+	memcpy(buf + minipage_size(nEntry) + MINIPAGE_ZONE_HEADER_SIZE,
+		   minipageInfo->zones,
+		   sizeof(MinipageZone) * nEntry * minipageInfo->nZoneAtts);
+
+	minipage = (Minipage *) buf;
+	SET_VARSIZE(minipage, minipage_zonemap_size(nEntry, minipageInfo->nZoneAtts));
+	minipage->version = MINIPAGE_VERSION_ZONEMAP;
+
+	return minipage;
+}
+
 /*
  * write_minipage
  *
@@ -1141,6 +1614,7 @@ write_minipage(AppendOnlyBlockDirectory *blockDirectory,
 	bool	   *nulls = blockDirectory->nulls;
 	Relation	blkdirRel = blockDirectory->blkdirRel;
 	TupleDesc	heapTupleDesc = RelationGetDescr(blkdirRel);
+	Minipage   *minipage;
 
 	Assert(minipageInfo->numMinipageEntries > 0);
 
@@ -1163,8 +1637,12 @@ write_minipage(AppendOnlyBlockDirectory *blockDirectory,
 	SET_VARSIZE(minipageInfo->minipage,
 				minipage_size(minipageInfo->numMinipageEntries));
 	minipageInfo->minipage->nEntry = minipageInfo->numMinipageEntries;
-	values[Anum_pg_aoblkdir_minipage - 1] =
-		PointerGetDatum(minipageInfo->minipage);
+	minipageInfo->minipage->version = MINIPAGE_VERSION_ORIGINAL;
+	if (minipageInfo->nZoneAtts > 0)
+		minipage = form_zonemap_minipage(minipageInfo);
+	else
+		minipage = minipageInfo->minipage;
+	values[Anum_pg_aoblkdir_minipage - 1] = PointerGetDatum(minipage);
 	nulls[Anum_pg_aoblkdir_minipage - 1] = false;
 
 	tuple = heaptuple_form_to(heapTupleDesc,
@@ -1173,6 +1651,9 @@ write_minipage(AppendOnlyBlockDirectory *blockDirectory,
 							  NULL,
 							  NULL);
 
+	if (minipage != minipageInfo->minipage)
+		pfree(minipage);
+
 	/*
 	 * Write out the minipage to the block directory relation. If this
 	 * minipage is already in the relation, we update the row. Otherwise, a
@@ -0,0 +1,133 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include "cmockery.h"
+
+#include "postgres.h"
+#include "utils/memutils.h"
+
+#include "../appendonly_blockcache.c"
+
+#define BLOCK_LEN 1000
+
+static uint8 blockData[BLOCK_LEN];
+
+static void
+insert_block(AppendOnlyBlockCache *cache, int column, int segno,
+			 int64 firstRowNum, int rowCount)
+{
+	AppendOnlyBlockCache_Insert(cache, column, segno, firstRowNum, rowCount,
+								/* fileOffset */ 0,
+								/* executorBlockKind */ 1,
+								blockData, BLOCK_LEN);
+}
+
+void
+test__AppendOnlyBlockCache_Lookup(void **state)
+{
+	AppendOnlyBlockCache *cache;
+	AppendOnlyBlockCacheEntry *entry;
+
+	gp_appendonly_fetch_cache_size = 64;
+	cache = AppendOnlyBlockCache_Create(2);
+	assert_true(cache != NULL);
+
+	AppendOnlyBlockCache_BeginFetch(cache);
+	insert_block(cache, 0, 1, 100, 100);
+	insert_block(cache, 0, 1, 1, 99);
+	insert_block(cache, 0, 2, 1, 50);
+
+	/* first, middle and last row of a block */
+	entry = AppendOnlyBlockCache_Lookup(cache, 0, 1, 100);
+	assert_true(entry != NULL && entry->firstRowNum == 100);
+	entry = AppendOnlyBlockCache_Lookup(cache, 0, 1, 150);
+	assert_true(entry != NULL && entry->firstRowNum == 100);
+	entry = AppendOnlyBlockCache_Lookup(cache, 0, 1, 199);
+	assert_true(entry != NULL && entry->firstRowNum == 100);
+	entry = AppendOnlyBlockCache_Lookup(cache, 0, 1, 99);
+	assert_true(entry != NULL && entry->firstRowNum == 1);
+	assert_int_equal(memcmp(entry->data, blockData, BLOCK_LEN), 0);
+
+	/* other segment file, other column, past the last block */
+	entry = AppendOnlyBlockCache_Lookup(cache, 0, 2, 10);
+	assert_true(entry != NULL && entry->segmentFileNum == 2);
+	assert_true(AppendOnlyBlockCache_Lookup(cache, 0, 2, 51) == NULL);
+	assert_true(AppendOnlyBlockCache_Lookup(cache, 0, 1, 200) == NULL);
+	assert_true(AppendOnlyBlockCache_Lookup(cache, 1, 1, 150) == NULL);
+	assert_true(AppendOnlyBlockCache_Lookup(cache, 0, 3, 1) == NULL);
+
+	/* a block that is already cached is not added again */
+	insert_block(cache, 0, 1, 100, 100);
+	assert_int_equal(cache->columns[0].nentries, 3);
+
+	AppendOnlyBlockCache_End(cache, NULL);
+}
+
+void
+test__AppendOnlyBlockCache_Evict(void **state)
+{
+	AppendOnlyBlockCache *cache;
+	int64		entryBytes = sizeof(AppendOnlyBlockCacheEntry) + BLOCK_LEN;
+	int			maxEntries;
+	int			i;
+
+	gp_appendonly_fetch_cache_size = 8;
+	cache = AppendOnlyBlockCache_Create(1);
+	maxEntries = cache->maxBytes / entryBytes;
+
+	/* fill the cache, one block per fetch */
+	for (i = 0; i < maxEntries; i++)
+	{
+		AppendOnlyBlockCache_BeginFetch(cache);
+		insert_block(cache, 0, 1, i * 10 + 1, 10);
+	}
+	assert_int_equal(cache->columns[0].nentries, maxEntries);
+
+	/* use the first block again, the second is now the oldest */
+	AppendOnlyBlockCache_BeginFetch(cache);
+	assert_true(AppendOnlyBlockCache_Lookup(cache, 0, 1, 1) != NULL);
+
+	AppendOnlyBlockCache_BeginFetch(cache);
+	insert_block(cache, 0, 1, maxEntries * 10 + 1, 10);
+	assert_int_equal(cache->evictions, 1);
+	assert_true(AppendOnlyBlockCache_Lookup(cache, 0, 1, 1) != NULL);
+	assert_true(AppendOnlyBlockCache_Lookup(cache, 0, 1, 11) == NULL);
+	assert_true(AppendOnlyBlockCache_Lookup(cache, 0, 1, maxEntries * 10 + 1) != NULL);
+
+	/*
+	 * The blocks used by the current fetch are never evicted, the block is
+	 * not added if there is no room otherwise.
+	 */
+	AppendOnlyBlockCache_BeginFetch(cache);
+	for (i = 0; i <= maxEntries; i++)
+		(void) AppendOnlyBlockCache_Lookup(cache, 0, 1, i * 10 + 1);
+	insert_block(cache, 0, 1, 100000, 10);
+	assert_true(AppendOnlyBlockCache_Lookup(cache, 0, 1, 100000) == NULL);
+	assert_int_equal(cache->evictions, 1);
+	assert_true(cache->usedBytes <= cache->maxBytes);
+
+	AppendOnlyBlockCache_End(cache, NULL);
+}
+
+void
+test__AppendOnlyBlockCache_Disabled(void **state)
+{
+	gp_appendonly_fetch_cache_size = 0;
+	assert_true(AppendOnlyBlockCache_Create(1) == NULL);
+}
+
+int
+main(int argc, char *argv[])
+{
+	cmockery_parse_arguments(argc, argv);
+
+	const		UnitTest tests[] = {
+		unit_test(test__AppendOnlyBlockCache_Lookup),
+		unit_test(test__AppendOnlyBlockCache_Evict),
+		unit_test(test__AppendOnlyBlockCache_Disabled)
+	};
+
+	MemoryContextInit();
+
+	return run_tests(tests);
+}
@@ -0,0 +1,127 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include "cmockery.h"
+
+#include "postgres.h"
+#include "utils/memutils.h"
+
+#include "../appendonly_visimap_cache.c"
+
+static AppendOnlyVisimapCache *
+create_cache(int sizeKB)
+{
+	AppendOnlyVisimapCache *cache;
+
+	gp_appendonly_visimap_cache_size = sizeKB;
+	cache = AppendOnlyVisimapCache_Create(CurrentMemoryContext);
+	assert_true(cache != NULL);
+	AppendOnlyVisimapCache_Reset(cache, 1);
+
+	return cache;
+}
+
+void
+test__AppendOnlyVisimapCache_IsVisible(void **state)
+{
+	AppendOnlyVisimapCache *cache = create_cache(64);
+	Bitmapset  *sparse = NULL;
+	Bitmapset  *dense = NULL;
+	int			i;
+
+	/* a few hidden rows are kept as offsets, many as a bitmap */
+	sparse = bms_add_member(sparse, 0);
+	sparse = bms_add_member(sparse, 1000);
+	sparse = bms_add_member(sparse, APPENDONLY_VISIMAP_MAX_RANGE - 1);
+	for (i = 0; i < 2000; i += 2)
+		dense = bms_add_member(dense, i);
+
+	assert_true(AppendOnlyVisimapCache_AddRange(cache, 0, sparse));
+	assert_true(AppendOnlyVisimapCache_AddRange(cache,
+												2 * APPENDONLY_VISIMAP_MAX_RANGE,
+												dense));
+	assert_true(cache->ranges[0].offsets != NULL);
+	assert_true(cache->ranges[2].bitmap != NULL);
+
+	assert_false(AppendOnlyVisimapCache_IsVisible(cache, 0));
+	assert_true(AppendOnlyVisimapCache_IsVisible(cache, 1));
+	assert_true(AppendOnlyVisimapCache_IsVisible(cache, 999));
+	assert_false(AppendOnlyVisimapCache_IsVisible(cache, 1000));
+	assert_true(AppendOnlyVisimapCache_IsVisible(cache, 1001));
+	assert_false(AppendOnlyVisimapCache_IsVisible(cache,
+												  APPENDONLY_VISIMAP_MAX_RANGE - 1));
+
+	/* a range without an entry */
+	assert_true(AppendOnlyVisimapCache_IsVisible(cache,
+												 APPENDONLY_VISIMAP_MAX_RANGE + 1000));
+
+	assert_false(AppendOnlyVisimapCache_IsVisible(cache,
+												  2 * APPENDONLY_VISIMAP_MAX_RANGE + 10));
+	assert_true(AppendOnlyVisimapCache_IsVisible(cache,
+												 2 * APPENDONLY_VISIMAP_MAX_RANGE + 11));
+	assert_true(AppendOnlyVisimapCache_IsVisible(cache,
+												 2 * APPENDONLY_VISIMAP_MAX_RANGE + 2000));
+
+	/* past the last range */
+	assert_true(AppendOnlyVisimapCache_IsVisible(cache,
+												 10 * APPENDONLY_VISIMAP_MAX_RANGE));
+
+	/* another segment file starts empty */
+	AppendOnlyVisimapCache_Reset(cache, 2);
+	assert_true(cache->complete);
+	assert_true(AppendOnlyVisimapCache_IsVisible(cache, 0));
+	assert_true(AppendOnlyVisimapCache_IsVisible(cache, 1000));
+
+	MemoryContextDelete(cache->memoryContext);
+}
+
+void
+test__AppendOnlyVisimapCache_Full(void **state)
+{
+	AppendOnlyVisimapCache *cache = create_cache(10);
+	Bitmapset  *dense = NULL;
+	int			i;
+
+	for (i = 0; i < APPENDONLY_VISIMAP_MAX_RANGE; i += 3)
+		dense = bms_add_member(dense, i);
+
+	/* a bit over 4 kB each, the third does not fit */
+	assert_true(AppendOnlyVisimapCache_AddRange(cache, 0, dense));
+	assert_true(AppendOnlyVisimapCache_AddRange(cache,
+												APPENDONLY_VISIMAP_MAX_RANGE,
+												dense));
+	assert_false(AppendOnlyVisimapCache_AddRange(cache,
+												 2 * APPENDONLY_VISIMAP_MAX_RANGE,
+												 dense));
+	assert_false(cache->complete);
+	assert_true(cache->usedBytes <= cache->maxBytes);
+
+	AppendOnlyVisimapCache_Reset(cache, 2);
+	assert_true(cache->complete);
+	assert_int_equal(cache->usedBytes, 0);
+
+	MemoryContextDelete(cache->memoryContext);
+}
+
+void
+test__AppendOnlyVisimapCache_Disabled(void **state)
+{
+	gp_appendonly_visimap_cache_size = 0;
+	assert_true(AppendOnlyVisimapCache_Create(CurrentMemoryContext) == NULL);
+}
+
+int
+main(int argc, char *argv[])
+{
+	cmockery_parse_arguments(argc, argv);
+
+	const		UnitTest tests[] = {
+		unit_test(test__AppendOnlyVisimapCache_IsVisible),
+		unit_test(test__AppendOnlyVisimapCache_Full),
+		unit_test(test__AppendOnlyVisimapCache_Disabled)
+	};
+
+	MemoryContextInit();
+
+	return run_tests(tests);
+}
@@ -541,7 +541,10 @@ bmbuildCallback(Relation index, ItemPointer tupleId, Datum *attdata,
 {
 	BMBuildState *bstate = (BMBuildState *) state;
 
-	_bitmap_buildinsert(index, *tupleId, attdata, nulls, bstate);
+	if (bstate->bm_sortstate)
+		_bitmap_spool(tupleId, attdata, nulls, bstate);
+	else
+		_bitmap_buildinsert(index, *tupleId, attdata, nulls, bstate);
 	bstate->ituples += 1;
 
 	if (((int)bstate->ituples) % 1000 == 0)
@@ -667,7 +670,7 @@ pull_stream(StreamBMIterator *iterator, PagetableEntry *e)
 	/* have we already got an entry? */
 	if(next && iterator->nextblock <= next->blockno)
 	{
-		memcpy(e, next, sizeof(PagetableEntry));
+		tbm_copy_entry(e, next);
 		return true;
 	}
 	else if (so->is_done)
@@ -737,8 +740,8 @@ pull_stream(StreamBMIterator *iterator, PagetableEntry *e)
 	if (scanPos->bm_result.nextTid / BM_MAX_TUPLES_PER_PAGE > e->blockno + 1)
 		iterator->nextblock = scanPos->bm_result.nextTid / BM_MAX_TUPLES_PER_PAGE;
 	if (so->entry == NULL)
-		so->entry = (PagetableEntry *) palloc(sizeof(PagetableEntry));
-	memcpy(so->entry, e, sizeof(PagetableEntry));
+		so->entry = (PagetableEntry *) palloc0(sizeof(PagetableEntry));
+	tbm_copy_entry(so->entry, e);
 
 	return res;
 }
@@ -1011,7 +1014,11 @@ restart:
 		{
 			Assert(newwordno < WORDS_PER_PAGE || newwordno < WORDS_PER_CHUNK);
 
-			entry->words[newwordno] |= newWord;
+			if (newWord != 0)
+			{
+				entry->words[newwordno] |= newWord;
+				entry->nwords = Max(entry->nwords, newwordno + 1);
+			}
 			newwordno++;
 
 			/* reset newWord */
@@ -1022,7 +1029,11 @@ restart:
 	if (hrlwordno % nhrlwords != 0)
 	{
 		Assert(newwordno < WORDS_PER_PAGE || newwordno < WORDS_PER_CHUNK);
-		entry->words[newwordno] |= newWord;
+		if (newWord != 0)
+		{
+			entry->words[newwordno] |= newWord;
+			entry->nwords = Max(entry->nwords, newwordno + 1);
+		}
 	}
 
 	entry->blockno = blockno;
@@ -23,12 +23,15 @@
 #include "access/heapam.h"
 #include "access/bitmap.h"
 #include "access/transam.h"
+#include "executor/tuptable.h"
 #include "parser/parse_oper.h"
 #include "utils/builtins.h"
 #include "utils/datum.h"
 #include "utils/guc.h"
 #include "utils/lsyscache.h"
+#include "utils/memutils.h"
 #include "utils/snapmgr.h"
+#include "utils/tuplesort.h"
 
 /*
  * The following structure along with BMTIDBuffer are used to buffer
@@ -112,6 +115,9 @@ static uint16 buf_free_mem(Relation rel, BMTIDBuffer *buf,
 			  			   BlockNumber lov_block, OffsetNumber off, 
 						   bool use_wal);
 static uint16 _bitmap_free_tidbuf(BMTIDBuffer* buf);
+static bool sorted_values_equal(TupleDesc tupDesc, FmgrInfo *eqFuncs,
+								Oid *collations, Datum *values1, bool *nulls1,
+								Datum *values2, bool *nulls2);
 
 #define BUF_INIT_WORDS 8 /* as good a point as any */
 
@@ -2502,6 +2508,235 @@ _bitmap_buildinsert(Relation rel, ItemPointerData ht_ctid, Datum *attdata,
 							  tupDesc, attdata, nulls, state);
 }
 
+/*
+ * _bitmap_spool() -- add an index tuple to the sort of a sort-based build.
+ */
+void
+_bitmap_spool(ItemPointer ht_ctid, Datum *attdata, bool *nulls,
+			  BMBuildState *state)
+{
+	TupleTableSlot *slot = state->bm_sortslot;
+	int			natts = state->bm_tupDesc->natts;
+	Datum	   *values;
+	bool	   *isnull;
+
+	ExecClearTuple(slot);
+	values = slot_get_values(slot);
+	isnull = slot_get_isnull(slot);
+
+	memcpy(values, attdata, natts * sizeof(Datum));
+	memcpy(isnull, nulls, natts * sizeof(bool));
+	values[natts] = ItemPointerGetDatum(ht_ctid);
+	isnull[natts] = false;
+	ExecStoreVirtualTuple(slot);
+
+	tuplesort_puttupleslot(state->bm_sortstate, slot);
+}
+
+/*
+ * sorted_values_equal() -- are two sets of indexed values the same value
+ * of the index? NULLs are equal to each other.
+ */
+static bool
+sorted_values_equal(TupleDesc tupDesc, FmgrInfo *eqFuncs, Oid *collations,
+					Datum *values1, bool *nulls1, Datum *values2, bool *nulls2)
+{
+	int			attno;
+
+	for (attno = 0; attno < tupDesc->natts; attno++)
+	{
+		if (nulls1[attno] || nulls2[attno])
+		{
+			if (nulls1[attno] != nulls2[attno])
+				return false;
+		}
+		else if (!DatumGetBool(FunctionCall2Coll(&eqFuncs[attno],
+												 collations[attno],
+												 values1[attno],
+												 values2[attno])))
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * _bitmap_write_sorted() -- write the bitmap vectors of a sort-based build.
+ *
+ * The spooled tuples come out of the sort grouped by value, and in tid
+ * order within each value. So each value gets a new LOV item, and its
+ * bitmap vector is compressed into a single BMTIDBuffer that is flushed
+ * to newly allocated bitmap pages whenever it fills up, without looking
+ * up the value in the LOV heap, and without keeping a buffer for every
+ * distinct value in memory.
+ *
+ * The LOV buffer stays pinned while a value is written, but it is only
+ * locked to add each tid, so that the build can be cancelled.
+ */
+void
+_bitmap_write_sorted(Relation rel, BMBuildState *state)
+{
+	TupleDesc	tupDesc = state->bm_tupDesc;
+	int			natts = tupDesc->natts;
+	TupleTableSlot *slot = state->bm_sortslot;
+	FmgrInfo   *eqFuncs;
+	Oid		   *collations;
+	Datum	   *lastValues;
+	bool	   *lastNulls;
+	bool		haveValue = false;
+	MemoryContext valueContext;
+	MemoryContext tmpContext;
+	MemoryContext oldContext;
+	BMTIDBuffer buf;
+	Buffer		lovBuffer = InvalidBuffer;
+	BlockNumber lovBlock;
+	OffsetNumber lovOffset = InvalidOffsetNumber;
+	int			attno;
+
+	tuplesort_performsort(state->bm_sortstate);
+
+	eqFuncs = (FmgrInfo *) palloc(natts * sizeof(FmgrInfo));
+	collations = (Oid *) palloc(natts * sizeof(Oid));
+	lastValues = (Datum *) palloc(natts * sizeof(Datum));
+	lastNulls = (bool *) palloc(natts * sizeof(bool));
+
+	for (attno = 0; attno < natts; attno++)
+	{
+		Oid			eq_opr;
+
+		get_sort_group_operators(tupDesc->attrs[attno]->atttypid,
+								 false, true, false,
+								 NULL, &eq_opr, NULL, NULL);
+		fmgr_info(get_opcode(eq_opr), &eqFuncs[attno]);
+		collations[attno] = rel->rd_indcollation[attno];
+	}
+
+	valueContext = AllocSetContextCreate(CurrentMemoryContext,
+										 "Bitmap sorted build value",
+										 ALLOCSET_SMALL_MINSIZE,
+										 ALLOCSET_SMALL_INITSIZE,
+										 ALLOCSET_SMALL_MAXSIZE);
+	tmpContext = AllocSetContextCreate(CurrentMemoryContext,
+									   "Bitmap sorted build temp space",
+									   ALLOCSET_SMALL_MINSIZE,
+									   ALLOCSET_SMALL_INITSIZE,
+									   ALLOCSET_SMALL_MAXSIZE);
+
+	MemSet(&buf, 0, sizeof(buf));
+
+	while (tuplesort_gettupleslot(state->bm_sortstate, true, slot))
+	{
+		Datum	   *values;
+		bool	   *nulls;
+		uint64		tidnum;
+		bool		sameValue;
+
+		CHECK_FOR_INTERRUPTS();
+
+		slot_getallattrs(slot);
+		values = slot_get_values(slot);
+		nulls = slot_get_isnull(slot);
+		tidnum = BM_IPTR_TO_INT(DatumGetItemPointer(values[natts]));
+
+		/* the equality functions may leak */
+		MemoryContextReset(tmpContext);
+		oldContext = MemoryContextSwitchTo(tmpContext);
+		sameValue = haveValue &&
+			sorted_values_equal(tupDesc, eqFuncs, collations,
+								lastValues, lastNulls, values, nulls);
+		MemoryContextSwitchTo(oldContext);
+
+		if (!sameValue)
+		{
+			Page		lovPage;
+			BMLOVItem	lovItem;
+			bool		allNulls = true;
+
+			/* write out the rest of the previous value's bitmap vector */
+			if (haveValue)
+			{
+				LockBuffer(lovBuffer, BM_WRITE);
+				buf_free_mem_block(rel, &buf, lovBuffer, lovOffset,
+								   state->use_wal);
+				_bitmap_relbuf(lovBuffer);
+			}
+
+			MemoryContextReset(valueContext);
+			oldContext = MemoryContextSwitchTo(valueContext);
+			for (attno = 0; attno < natts; attno++)
+			{
+				Form_pg_attribute at = tupDesc->attrs[attno];
+
+				lastNulls[attno] = nulls[attno];
+				if (nulls[attno])
+					lastValues[attno] = (Datum) 0;
+				else
+				{
+					lastValues[attno] = datumCopy(values[attno], at->attbyval,
+												  at->attlen);
+					allNulls = false;
+				}
+			}
+			MemoryContextSwitchTo(oldContext);
+			haveValue = true;
+
+			/*
+			 * The NULL value has its LOV item from the start, any other
+			 * value is new.
+			 */
+			if (allNulls)
+			{
+				lovBlock = BM_LOV_STARTPAGE;
+				lovOffset = 1;
+			}
+			else
+			{
+				Buffer		metabuf;
+
+				metabuf = _bitmap_getbuf(rel, BM_METAPAGE, BM_WRITE);
+				create_lovitem(rel, metabuf, tidnum, tupDesc, values, nulls,
+							   state->bm_lov_heap, state->bm_lov_index,
+							   &lovBlock, &lovOffset, state->use_wal);
+				_bitmap_wrtbuf(metabuf);
+			}
+
+			/* start the bitmap vector from the last words of the LOV item */
+			lovBuffer = _bitmap_getbuf(rel, lovBlock, BM_WRITE);
+			lovPage = BufferGetPage(lovBuffer);
+			lovItem = (BMLOVItem) PageGetItem(lovPage,
+											  PageGetItemId(lovPage, lovOffset));
+
+			MemSet(&buf, 0, sizeof(buf));
+			buf.last_tid = lovItem->bm_last_setbit;
+			buf.last_compword = lovItem->bm_last_compword;
+			buf.last_word = lovItem->bm_last_word;
+			buf.is_last_compword_fill = (lovItem->lov_words_header == 2);
+			buf_extend(&buf);
+
+			LockBuffer(lovBuffer, BUFFER_LOCK_UNLOCK);
+		}
+
+		LockBuffer(lovBuffer, BM_WRITE);
+		buf_add_tid_with_fill(rel, &buf, lovBuffer, lovOffset, tidnum,
+							  state->use_wal);
+		LockBuffer(lovBuffer, BUFFER_LOCK_UNLOCK);
+	}
+
+	if (haveValue)
+	{
+		LockBuffer(lovBuffer, BM_WRITE);
+		buf_free_mem_block(rel, &buf, lovBuffer, lovOffset, state->use_wal);
+		_bitmap_relbuf(lovBuffer);
+	}
+
+	MemoryContextDelete(valueContext);
+	MemoryContextDelete(tmpContext);
+	pfree(eqFuncs);
+	pfree(collations);
+	pfree(lastValues);
+	pfree(lastNulls);
+}
+
 /*
  * _bitmap_doinsert() -- insert an index tuple for a given tuple.
  */
@@ -21,12 +21,17 @@
 #include "access/genam.h"
 #include "access/tupdesc.h"
 #include "access/bitmap.h"
+#include "catalog/pg_operator.h"
+#include "catalog/pg_type.h"
+#include "executor/tuptable.h"
 #include "parser/parse_oper.h"
 #include "storage/lmgr.h"
+#include "utils/guc.h"
 #include "utils/memutils.h"
 #include "utils/lsyscache.h"
 #include "utils/snapmgr.h"
 #include "utils/syscache.h"
+#include "utils/tuplesort.h"
 
 /* 
  * Helper functions for hashing and matching build data. At this stage, the
@@ -49,6 +54,8 @@ static BMBuildHashData *cur_bmbuild = NULL;
 static uint32 build_hash_key(const void *key, Size keysize);
 static int build_match_key(const void *key1, const void *key2, Size keysize);
 static void *build_keycopy(void *dest, const void *src, Size keysize);
+static bool begin_sorted_build(Relation index, BMBuildState *bmstate);
+
 /*
  * _bitmap_getbuf() -- return the buffer for the given block number and
  * 					   the access method.
@@ -181,7 +188,27 @@ _bitmap_init_buildstate(Relation index, BMBuildState *bmstate)
 								  RowExclusiveLock);
 
 	_bitmap_relbuf(metabuf);
-	
+
+	/*
+	 * We need to log index creation in WAL iff WAL archiving is enabled
+	 * AND it's not a temp index. Currently, since building an index
+	 * writes page to the shared buffer, we can't disable WAL archiving.
+	 * We will add this shortly.
+	 */
+	bmstate->use_wal = RelationNeedsWAL(index);
+
+	bmstate->bm_sortstate = NULL;
+	bmstate->bm_sortslot = NULL;
+	if (gp_enable_bitmap_sort_build && begin_sorted_build(index, bmstate))
+	{
+		/* the values are not looked up, each one is new once sorted */
+		bmstate->lovitem_hash = NULL;
+		bmstate->lovitem_hashKeySize = 0;
+		bmstate->bm_lov_scanKeys = NULL;
+		bmstate->bm_lov_scanDesc = NULL;
+		return;
+	}
+
 	cur_bmbuild = (BMBuildHashData *)palloc(sizeof(BMBuildHashData));
 	cur_bmbuild->hash_funcs = (FmgrInfo *)
 						palloc(sizeof(FmgrInfo) * bmstate->bm_tupDesc->natts);
@@ -295,14 +322,81 @@ _bitmap_init_buildstate(Relation index, BMBuildState *bmstate)
 					 bmstate->bm_lov_scanKeys, bmstate->bm_tupDesc->natts,
 					 NULL, 0);
 	}
+}
 
-	/*
-	 * We need to log index creation in WAL iff WAL archiving is enabled
-	 * AND it's not a temp index. Currently, since building an index
-	 * writes page to the shared buffer, we can't disable WAL archiving.
-	 * We will add this shortly.
-	 */	
-	bmstate->use_wal = RelationNeedsWAL(index);
+/*
+ * begin_sorted_build() -- set up the sort of a sort-based build.
+ *
+ * The heap tuples are sorted on the indexed values, and on their tids
+ * within each value, so that _bitmap_write_sorted() can create the LOV
+ * item of each value and write its bitmap vector from start to end.
+ *
+ * Returns false, for an insertion-based build, if a type of the indexed
+ * values has no ordering operator.
+ */
+static bool
+begin_sorted_build(Relation index, BMBuildState *bmstate)
+{
+	TupleDesc	tupDesc = bmstate->bm_tupDesc;
+	int			natts = tupDesc->natts;
+	TupleDesc	sortTupDesc;
+	AttrNumber *attNums;
+	Oid		   *sortOperators;
+	Oid		   *sortCollations;
+	bool	   *nullsFirstFlags;
+	int			i;
+
+	attNums = (AttrNumber *) palloc((natts + 1) * sizeof(AttrNumber));
+	sortOperators = (Oid *) palloc((natts + 1) * sizeof(Oid));
+	sortCollations = (Oid *) palloc((natts + 1) * sizeof(Oid));
+	nullsFirstFlags = (bool *) palloc((natts + 1) * sizeof(bool));
+
+	for (i = 0; i < natts; i++)
+	{
+		Oid			lt_opr;
+
+		get_sort_group_operators(tupDesc->attrs[i]->atttypid,
+								 false, false, false,
+								 &lt_opr, NULL, NULL, NULL);
+		if (!OidIsValid(lt_opr))
+		{
+			pfree(attNums);
+			pfree(sortOperators);
+			pfree(sortCollations);
+			pfree(nullsFirstFlags);
+			return false;
+		}
+
+		attNums[i] = i + 1;
+		sortOperators[i] = lt_opr;
+		sortCollations[i] = index->rd_indcollation[i];
+		nullsFirstFlags[i] = false;
+	}
+
+	/* the tid of the heap tuple comes last */
+	sortTupDesc = CreateTemplateTupleDesc(natts + 1, false);
+	for (i = 0; i < natts; i++)
+		TupleDescCopyEntry(sortTupDesc, i + 1, tupDesc, i + 1);
+	TupleDescInitEntry(sortTupDesc, natts + 1, "tid", TIDOID, -1, 0);
+
+	attNums[natts] = natts + 1;
+	sortOperators[natts] = TIDLessOperator;
+	sortCollations[natts] = InvalidOid;
+	nullsFirstFlags[natts] = false;
+
+	bmstate->bm_sortslot = MakeSingleTupleTableSlot(sortTupDesc);
+	bmstate->bm_sortstate = tuplesort_begin_heap(NULL, sortTupDesc,
+												 natts + 1, attNums,
+												 sortOperators, sortCollations,
+												 nullsFirstFlags,
+												 maintenance_work_mem, false);
+
+	pfree(attNums);
+	pfree(sortOperators);
+	pfree(sortCollations);
+	pfree(nullsFirstFlags);
+
+	return true;
 }
 
 /*
@@ -318,7 +412,17 @@ _bitmap_cleanup_buildstate(Relation index, BMBuildState *bmstate)
 
 	pfree(bmstate->bm_tidLocsBuffer);
 
-	if (cur_bmbuild)
+	if (bmstate->bm_sortstate)
+	{
+		/* a sort-based build writes the bitmap vectors only now */
+		_bitmap_write_sorted(index, bmstate);
+
+		tuplesort_end(bmstate->bm_sortstate);
+		bmstate->bm_sortstate = NULL;
+		ExecDropSingleTupleTableSlot(bmstate->bm_sortslot);
+		bmstate->bm_sortslot = NULL;
+	}
+	else if (cur_bmbuild)
 	{
 		MemoryContextDelete(cur_bmbuild->tmpcxt);
 		MemoryContextDelete(cur_bmbuild->hash_cxt);
@@ -20,6 +20,7 @@
 #include "access/genam.h"
 #include "access/tupdesc.h"
 #include "access/bitmap.h"
+#include "storage/bufmgr.h"
 #include "storage/lmgr.h"
 #include "parser/parse_oper.h"
 #include "utils/lsyscache.h"
@@ -293,6 +294,16 @@ read_words(Relation rel, Buffer lovBuffer, OffsetNumber lovOffset,
 		*nextBlockNoP = bo->bm_bitmap_next;
 
 		_bitmap_relbuf(bitmapBuffer);
+
+#ifdef USE_PREFETCH
+		/*
+		 * The words of a bitmap vector are a chain of pages, so only the
+		 * next page is known.  Ask for it now, for it to be read while the
+		 * words of this page are consumed.
+		 */
+		if (target_prefetch_pages > 0 && BlockNumberIsValid(*nextBlockNoP))
+			PrefetchBuffer(rel, MAIN_FORKNUM, *nextBlockNoP);
+#endif   /* USE_PREFETCH */
 		
 		*readLastWords = false;
 
@@ -25,7 +25,10 @@
 
 static void _bitmap_findnextword(BMBatchWords* words, uint64 nextReadNo);
 static void _bitmap_resetWord(BMBatchWords *words, uint32 prevStartNo);
-static uint8 _bitmap_find_bitset(BM_HRL_WORD word, uint8 lastPos);
+static uint32 _bitmap_union_literals(BMBatchWords **batches, uint32 numBatches,
+					   uint64 nextReadNo, BMBatchWords *result);
+static inline int _bitmap_leftmost_bit(BM_HRL_WORD word);
+static inline int _bitmap_rightmost_bit(BM_HRL_WORD word);
 
 /*
  * _bitmap_formitem() -- construct a LOV entry.
@@ -282,19 +285,25 @@ _bitmap_findnexttids(BMBatchWords *words, BMIterateResult *result,
 				 && GET_FILL_BIT(word) == 1)
 		{
 			uint64	nfillwords = FILL_LENGTH(word);
+			uint32	numOfTids = result->numOfTids;
+			uint64	nextTid = result->nextTid;
 			uint8 	bitNo;
 
-			while (result->numOfTids + BM_HRL_WORD_SIZE <= maxTids &&
+			while (numOfTids + BM_HRL_WORD_SIZE <= maxTids &&
 				   nfillwords > 0)
 			{
 				/* explain the fill word */
 				for (bitNo = 0; bitNo < BM_HRL_WORD_SIZE; bitNo++)
-					result->nextTids[result->numOfTids++] = ++result->nextTid;
+					result->nextTids[numOfTids + bitNo] = nextTid + bitNo + 1;
 
+				numOfTids += BM_HRL_WORD_SIZE;
+				nextTid += BM_HRL_WORD_SIZE;
 				nfillwords--;
 				/* update fill word to reflect expansion */
 				words->cwords[result->lastScanWordNo]--;
 			}
+			result->numOfTids = numOfTids;
+			result->nextTid = nextTid;
 
 			if (nfillwords == 0)
 			{
@@ -311,34 +320,38 @@ _bitmap_findnexttids(BMBatchWords *words, BMIterateResult *result,
 		}
 		else
 		{
-			if(oldScanPos == 0)
-				oldScanPos = BM_HRL_WORD_SIZE + 1;
-
-			while (oldScanPos != 0 && result->numOfTids < maxTids)
+			/*
+			 * A literal word.  Bit position p, counting from 1 at the
+			 * rightmost bit, is the tid firstTid + p.  The bits up to
+			 * lastScanPos have been returned already.
+			 */
+			uint64	firstTid = result->nextTid - oldScanPos;
+			uint8	lastPos = oldScanPos;
+
+			if (oldScanPos > 0)
+				word &= ~(LITERAL_ALL_ONE >> (BM_HRL_WORD_SIZE - oldScanPos));
+
+			while (word != 0 && result->numOfTids < maxTids)
 			{
-				BM_HRL_WORD		w;
-
-				if (oldScanPos == BM_HRL_WORD_SIZE + 1)
-					oldScanPos = 0;
+				lastPos = _bitmap_rightmost_bit(word) + 1;
+				result->nextTids[result->numOfTids++] = firstTid + lastPos;
 
-				w = words->cwords[result->lastScanWordNo];
-				result->lastScanPos = _bitmap_find_bitset(w, oldScanPos);
+				/* clear the bit */
+				word &= word - 1;
+			}
 
-				/* did we fine a bit set in this word? */
-				if (result->lastScanPos != 0)
-				{
-					result->nextTid += (result->lastScanPos - oldScanPos);
-					result->nextTids[result->numOfTids++] = result->nextTid;
-				}
-				else
-				{
-					result->nextTid += BM_HRL_WORD_SIZE - oldScanPos;
-					/* start scanning a new word */
-					words->nwords--;
-					result->lastScanWordNo++;
-					result->lastScanPos = 0;
-				}
-				oldScanPos = result->lastScanPos;
+			if (word == 0)
+			{
+				/* start scanning a new word */
+				result->nextTid = firstTid + BM_HRL_WORD_SIZE;
+				words->nwords--;
+				result->lastScanWordNo++;
+				result->lastScanPos = 0;
+			}
+			else
+			{
+				result->nextTid = firstTid + lastPos;
+				result->lastScanPos = lastPos;
 			}
 		}
 	}
@@ -584,6 +597,16 @@ _bitmap_union(BMBatchWords **batches, uint32 numBatches, BMBatchWords *result)
 		BM_HRL_WORD orWord = LITERAL_ALL_ZERO;
 		BM_HRL_WORD	word;
 		bool		orWordIsLiteral = true;
+		uint32		nliterals;
+
+		/* runs of literal words common to all batches are ORed at once */
+		nliterals = _bitmap_union_literals(batches, numBatches, nextReadNo,
+										   result);
+		if (nliterals > 0)
+		{
+			nextReadNo += nliterals;
+			continue;
+		}
 
 		for (batchNo = 0; batchNo < numBatches; batchNo++)
 		{
@@ -679,6 +702,94 @@ _bitmap_union(BMBatchWords **batches, uint32 numBatches, BMBatchWords *result)
 	pfree(prevstarts);
 }
 
+/*
+ * _bitmap_union_literals() -- OR the run of literal words that all
+ *        	                   batches have from 'nextReadNo' on.
+ *
+ * Returns the number of words appended to 'result', 0 if a batch is not at
+ * 'nextReadNo' yet or its word there is a fill word, in which case the
+ * batches are left alone.
+ *
+ * This is where unions of bitmaps with many literal words, e.g. on columns
+ * of a few thousand distinct values, spend their time.  Rather than going
+ * through the batches for each word, each batch is ORed into the result a
+ * run of words at a time, in loops simple enough for the compiler to
+ * vectorize.
+ */
+static uint32
+_bitmap_union_literals(BMBatchWords **batches, uint32 numBatches,
+					   uint64 nextReadNo, BMBatchWords *result)
+{
+	BM_HRL_WORD *out = &result->cwords[result->nwords];
+	uint32		nwords = result->maxNumOfWords - result->nwords;
+	uint32		batchNo;
+	uint32		i;
+
+	/* quick check that every batch is at a literal word first */
+	for (batchNo = 0; batchNo < numBatches; batchNo++)
+	{
+		BMBatchWords *bch = batches[batchNo];
+
+		if (bch->nwords == 0 ||
+			bch->nwordsread != nextReadNo - 1 ||
+			CUR_WORD_IS_FILL(bch))
+			return 0;
+	}
+
+	for (batchNo = 0; batchNo < numBatches; batchNo++)
+	{
+		BMBatchWords *bch = batches[batchNo];
+		uint32		n = 0;
+
+		/*
+		 * Count the literal words from the header bits, which are set for
+		 * fill words: the leading zero bits of each header word, starting
+		 * with the bit of the current word.
+		 */
+		nwords = Min(nwords, bch->nwords);
+		while (n < nwords)
+		{
+			uint32		wordNo = bch->startNo + n;
+			uint32		offset = wordNo % BM_HRL_WORD_SIZE;
+			BM_HRL_WORD	hword = bch->hwords[wordNo / BM_HRL_WORD_SIZE] << offset;
+
+			if (hword == 0)
+				n += BM_HRL_WORD_SIZE - offset;
+			else
+			{
+				n += BM_HRL_WORD_LEFTMOST - _bitmap_leftmost_bit(hword);
+				break;
+			}
+		}
+		nwords = Min(nwords, n);
+	}
+
+	if (nwords == 0)
+		return 0;
+
+	memcpy(out, &batches[0]->cwords[batches[0]->startNo],
+		   nwords * sizeof(BM_HRL_WORD));
+	for (batchNo = 1; batchNo < numBatches; batchNo++)
+	{
+		BM_HRL_WORD *in = &batches[batchNo]->cwords[batches[batchNo]->startNo];
+
+		for (i = 0; i < nwords; i++)
+			out[i] |= in[i];
+	}
+
+	for (batchNo = 0; batchNo < numBatches; batchNo++)
+	{
+		batches[batchNo]->nwordsread += nwords;
+		batches[batchNo]->startNo += nwords;
+		batches[batchNo]->nwords -= nwords;
+	}
+
+	/* the header bits of the result words are left 0, for literal words */
+	result->nwords += nwords;
+
+	return nwords;
+}
+
 /*
  * _bitmap_findnextword() -- Find the next word whose position is
  *        	                'nextReadNo' in an uncompressed format.
@@ -749,35 +860,52 @@ _bitmap_resetWord(BMBatchWords *words, uint32 prevStartNo)
 
 
 /*
- * _bitmap_find_bitset() -- find the rightmost set bit (bit=1) in the 
- * 		given word since 'lastPos', not including 'lastPos'.
- *
- * The rightmost bit in the given word is considered the position 1, and
- * the leftmost bit is considered the position BM_HRL_WORD_SIZE.
- *
- * If such set bit does not exist in this word, 0 is returned.
+ * Positions of the bits, indexed by the top 6 bits of the product of the
+ * word with only that bit set and BM_DEBRUIJN_64, a de Bruijn sequence in
+ * which each 6-bit pattern appears exactly once.
  */
-static uint8
-_bitmap_find_bitset(BM_HRL_WORD word, uint8 lastPos)
-{
-	uint8 pos = lastPos + 1;
-	BM_HRL_WORD	rightmostBitWord;
+#define BM_DEBRUIJN_64	UINT64CONST(0x03f79d71b4cb0a89)
 
-	if (pos > BM_HRL_WORD_SIZE)
-	  return 0;
+static const uint8 debruijn_bit_pos[64] = {
+	0, 1, 48, 2, 57, 49, 28, 3, 61, 58, 50, 42, 38, 29, 17, 4,
+	62, 55, 59, 36, 53, 51, 43, 22, 45, 39, 33, 30, 24, 18, 12, 5,
+	63, 47, 56, 27, 60, 41, 37, 16, 54, 35, 52, 21, 44, 32, 23, 11,
+	46, 26, 40, 15, 34, 20, 31, 10, 25, 14, 19, 9, 13, 8, 7, 6
+};
 
-	rightmostBitWord = (((BM_HRL_WORD)1) << (pos-1));
+/*
+ * _bitmap_leftmost_bit() -- the position of the leftmost set bit in a
+ *        	                 nonzero word, counting from 0.
+ */
+static inline int
+_bitmap_leftmost_bit(BM_HRL_WORD word)
+{
+	Assert(word != 0);
 
-	while (pos <= BM_HRL_WORD_SIZE && (word & rightmostBitWord) == 0)
-	{
-		rightmostBitWord <<= 1;
-		pos++;
-	}
+	/* set all the bits right of the leftmost one, then keep only that one */
+	word |= word >> 1;
+	word |= word >> 2;
+	word |= word >> 4;
+	word |= word >> 8;
+	word |= word >> 16;
+	word |= word >> 32;
+
+	return debruijn_bit_pos[((word ^ (word >> 1)) * BM_DEBRUIJN_64) >> 58];
+}
 
-	if (pos > BM_HRL_WORD_SIZE)
-		pos = 0;
+/*
+ * _bitmap_rightmost_bit() -- the position of the rightmost set bit in a
+ *        	                  nonzero word, counting from 0.
+ *
+ * Isolates the bit and looks its position up, without a branch, rather
+ * than going bit by bit.
+ */
+static inline int
+_bitmap_rightmost_bit(BM_HRL_WORD word)
+{
+	Assert(word != 0);
 
-	return pos;
+	return debruijn_bit_pos[((word & -word) * BM_DEBRUIJN_64) >> 58];
 }
 
 /*
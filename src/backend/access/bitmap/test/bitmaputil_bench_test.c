@@ -0,0 +1,184 @@
+/*
+ * Micro-benchmark of the unions of HRL-compressed batches of bitmap words,
+ * and of the extraction of tids from the result, as done by bitmap index
+ * scans with several predicates.  Not run by "make check"; run it with
+ * "make bench", and compare the times against a build of another version
+ * of bitmaputil.c.
+ */
+#include "postgres.h"
+
+#include "access/bitmap.h"
+#include "portability/instr_time.h"
+#include "utils/memutils.h"
+
+#define NUM_WORDS	2000
+#define NUM_LOOPS	1000
+
+/*
+ * Fill 'words' with runs of all-zero, all-one and literal words, a literal
+ * run being chosen with probability 'literalPct' percent.  The runs of fill
+ * words are like the bitmaps of a column of a few hundred distinct values.
+ */
+static void
+make_words(BM_HRL_WORD *words, int nwords, int literalPct, unsigned int seed)
+{
+	int			i = 0;
+
+	srandom(seed);
+	while (i < nwords)
+	{
+		bool		literal = (random() % 100 < literalPct);
+		bool		ones = (random() % 2 == 0);
+		int			len = 1 + random() % 100;
+
+		for (; len > 0 && i < nwords; len--, i++)
+		{
+			if (literal)
+				words[i] = ((BM_HRL_WORD) random() << 32 | random()) &
+					((BM_HRL_WORD) random() << 32 | random());
+			else
+				words[i] = ones ? LITERAL_ALL_ONE : LITERAL_ALL_ZERO;
+		}
+	}
+}
+
+/*
+ * HRL-compress 'words' into 'batch'.
+ */
+static void
+make_batch(BMBatchWords *batch, BM_HRL_WORD *words, int nwords)
+{
+	int			i = 0;
+
+	batch->maxNumOfWords = nwords;
+	batch->hwords = palloc0(sizeof(BM_HRL_WORD) * BM_CALC_H_WORDS(nwords));
+	batch->cwords = palloc0(sizeof(BM_HRL_WORD) * nwords);
+	batch->nwords = 0;
+
+	while (i < nwords)
+	{
+		if (words[i] == LITERAL_ALL_ZERO || words[i] == LITERAL_ALL_ONE)
+		{
+			int			fillBit = (words[i] == LITERAL_ALL_ONE);
+			int			j = i;
+
+			while (j < nwords && words[j] == words[i])
+				j++;
+			batch->hwords[batch->nwords / BM_HRL_WORD_SIZE] |=
+				WORDNO_GET_HEADER_BIT(batch->nwords);
+			batch->cwords[batch->nwords++] =
+				BM_MAKE_FILL_WORD(fillBit, j - i);
+			i = j;
+		}
+		else
+			batch->cwords[batch->nwords++] = words[i++];
+	}
+}
+
+/*
+ * Make 'dst' a fresh copy of 'src', positioned at its start.  The union
+ * consumes the words of its input batches.
+ */
+static void
+reset_batch(BMBatchWords *dst, BMBatchWords *src)
+{
+	dst->maxNumOfWords = src->maxNumOfWords;
+	dst->nwords = src->nwords;
+	memcpy(dst->hwords, src->hwords,
+		   sizeof(BM_HRL_WORD) * BM_CALC_H_WORDS(src->maxNumOfWords));
+	memcpy(dst->cwords, src->cwords, sizeof(BM_HRL_WORD) * src->nwords);
+	dst->nwordsread = 0;
+	dst->nextread = 1;
+	dst->firstTid = 1;
+	dst->startNo = 0;
+}
+
+static void
+bench_union(const char *name, int nbatches, int literalPct)
+{
+	BM_HRL_WORD words[NUM_WORDS];
+	BMBatchWords *pristine[8];
+	BMBatchWords *batches[8];
+	BMBatchWords result;
+	BMIterateResult *iter = palloc0(sizeof(BMIterateResult));
+	instr_time	start;
+	instr_time	end;
+	instr_time	unionTime;
+	instr_time	iterateTime;
+	uint64		ntids = 0;
+	int			loop;
+	int			b;
+
+	Assert(nbatches <= 8);
+	for (b = 0; b < nbatches; b++)
+	{
+		make_words(words, NUM_WORDS, literalPct, b + 1);
+		pristine[b] = palloc(sizeof(BMBatchWords));
+		make_batch(pristine[b], words, NUM_WORDS);
+
+		batches[b] = palloc(sizeof(BMBatchWords));
+		batches[b]->hwords = palloc(sizeof(BM_HRL_WORD) * BM_CALC_H_WORDS(NUM_WORDS));
+		batches[b]->cwords = palloc(sizeof(BM_HRL_WORD) * NUM_WORDS);
+	}
+
+	result.maxNumOfWords = NUM_WORDS;
+	result.hwords = palloc0(sizeof(BM_HRL_WORD) * BM_CALC_H_WORDS(NUM_WORDS));
+	result.cwords = palloc0(sizeof(BM_HRL_WORD) * NUM_WORDS);
+
+	INSTR_TIME_SET_ZERO(unionTime);
+	INSTR_TIME_SET_ZERO(iterateTime);
+
+	for (loop = 0; loop < NUM_LOOPS; loop++)
+	{
+		uint64		nextTid = 0;
+
+		for (b = 0; b < nbatches; b++)
+			reset_batch(batches[b], pristine[b]);
+
+		for (;;)
+		{
+			result.nwordsread = 0;
+			result.nextread = 1;
+			result.firstTid = nextTid;
+			_bitmap_reset_batchwords(&result);
+
+			INSTR_TIME_SET_CURRENT(start);
+			_bitmap_union(batches, nbatches, &result);
+			INSTR_TIME_SET_CURRENT(end);
+			INSTR_TIME_ACCUM_DIFF(unionTime, end, start);
+			if (result.nwords == 0)
+				break;
+
+			INSTR_TIME_SET_CURRENT(start);
+			_bitmap_begin_iterate(&result, iter);
+			while (result.nwords > 0)
+			{
+				_bitmap_findnexttids(&result, iter, BM_BATCH_TIDS);
+				ntids += iter->numOfTids;
+			}
+			INSTR_TIME_SET_CURRENT(end);
+			INSTR_TIME_ACCUM_DIFF(iterateTime, end, start);
+			nextTid = iter->nextTid;
+		}
+	}
+
+	printf("%-28s union %8.1f ms  iterate %8.1f ms  (" UINT64_FORMAT " tids)\n",
+		   name,
+		   INSTR_TIME_GET_MILLISEC(unionTime),
+		   INSTR_TIME_GET_MILLISEC(iterateTime),
+		   ntids / NUM_LOOPS);
+}
+
+int
+main(int argc, char *argv[])
+{
+	MemoryContextInit();
+
+	printf("batches of %d words, each union done %d times:\n",
+		   NUM_WORDS, NUM_LOOPS);
+	bench_union("3 batches, mixed runs", 3, 50);
+	bench_union("5 batches, mostly literal", 5, 90);
+	bench_union("8 batches, mixed runs", 8, 50);
+
+	return 0;
+}
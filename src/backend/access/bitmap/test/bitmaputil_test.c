@@ -0,0 +1,225 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include "cmockery.h"
+
+#include "postgres.h"
+#include "utils/memutils.h"
+
+#include "../bitmaputil.c"
+
+#define NUM_WORDS 2000
+
+/*
+ * Fill 'words' with a mix of runs of all-zero, all-one and literal words,
+ * like the bitmaps of a column of a few hundred distinct values.
+ */
+static void
+make_words(BM_HRL_WORD *words, int nwords, unsigned int seed)
+{
+	int			i = 0;
+
+	srandom(seed);
+	while (i < nwords)
+	{
+		int			kind = random() % 4;
+		int			len = 1 + random() % 100;
+
+		for (; len > 0 && i < nwords; len--, i++)
+		{
+			if (kind == 0)
+				words[i] = LITERAL_ALL_ZERO;
+			else if (kind == 1)
+				words[i] = LITERAL_ALL_ONE;
+			else
+				words[i] = ((BM_HRL_WORD) random() << 32 | random()) &
+					((BM_HRL_WORD) random() << 32 | random());
+		}
+	}
+}
+
+/*
+ * HRL-compress 'words' into a batch.
+ */
+static void
+make_batch(BMBatchWords *batch, BM_HRL_WORD *words, int nwords)
+{
+	int			i = 0;
+
+	batch->maxNumOfWords = nwords;
+	batch->hwords = palloc0(sizeof(BM_HRL_WORD) * BM_CALC_H_WORDS(nwords));
+	batch->cwords = palloc0(sizeof(BM_HRL_WORD) * nwords);
+	batch->nwordsread = 0;
+	batch->nextread = 1;
+	batch->firstTid = 1;
+	batch->startNo = 0;
+	batch->nwords = 0;
+
+	while (i < nwords)
+	{
+		if (words[i] == LITERAL_ALL_ZERO || words[i] == LITERAL_ALL_ONE)
+		{
+			int			fillBit = (words[i] == LITERAL_ALL_ONE);
+			int			j = i;
+
+			while (j < nwords && words[j] == words[i])
+				j++;
+			batch->hwords[batch->nwords / BM_HRL_WORD_SIZE] |=
+				WORDNO_GET_HEADER_BIT(batch->nwords);
+			batch->cwords[batch->nwords++] =
+				BM_MAKE_FILL_WORD(fillBit, j - i);
+			i = j;
+		}
+		else
+			batch->cwords[batch->nwords++] = words[i++];
+	}
+}
+
+/*
+ * Union the batches into results of at most 'maxResultWords' words, and
+ * check that the tids read from them, 'maxTids' at a time, are the set bits
+ * of 'expected'.
+ */
+static void
+check_union(BMBatchWords **batches, int nbatches, BM_HRL_WORD *expected,
+			uint32 maxResultWords, uint32 maxTids)
+{
+	BMBatchWords result;
+	BMIterateResult *iter = palloc0(sizeof(BMIterateResult));
+	uint64		nextTid = 0;
+	uint64		expectedTid = 0;
+	int			i;
+
+	result.maxNumOfWords = maxResultWords;
+	result.hwords = palloc0(sizeof(BM_HRL_WORD) * BM_CALC_H_WORDS(maxResultWords));
+	result.cwords = palloc0(sizeof(BM_HRL_WORD) * maxResultWords);
+
+	for (;;)
+	{
+		result.nwordsread = 0;
+		result.nextread = 1;
+		result.firstTid = nextTid;
+		_bitmap_reset_batchwords(&result);
+
+		_bitmap_union(batches, nbatches, &result);
+		if (result.nwords == 0)
+			break;
+
+		_bitmap_begin_iterate(&result, iter);
+		while (result.nwords > 0)
+		{
+			_bitmap_findnexttids(&result, iter, maxTids);
+			assert_true(iter->numOfTids <= maxTids);
+
+			for (i = 0; i < iter->numOfTids; i++)
+			{
+				/* the next set bit of the expected words */
+				do
+				{
+					expectedTid++;
+				} while (!(expected[(expectedTid - 1) / BM_HRL_WORD_SIZE] &
+						   ((BM_HRL_WORD) 1 << ((expectedTid - 1) % BM_HRL_WORD_SIZE))));
+
+				assert_int_equal(iter->nextTids[i], expectedTid);
+			}
+		}
+		nextTid = iter->nextTid;
+	}
+
+	/* no set bit was missed */
+	while (expectedTid < NUM_WORDS * BM_HRL_WORD_SIZE)
+	{
+		assert_false(expected[expectedTid / BM_HRL_WORD_SIZE] &
+					 ((BM_HRL_WORD) 1 << (expectedTid % BM_HRL_WORD_SIZE)));
+		expectedTid++;
+	}
+}
+
+static void
+check_union_of(int nbatches, uint32 maxResultWords, uint32 maxTids)
+{
+	BM_HRL_WORD words[NUM_WORDS];
+	BM_HRL_WORD expected[NUM_WORDS];
+	BMBatchWords *batches[8];
+	int			b;
+	int			i;
+
+	memset(expected, 0, sizeof(expected));
+	for (b = 0; b < nbatches; b++)
+	{
+		make_words(words, NUM_WORDS, b + 1);
+		for (i = 0; i < NUM_WORDS; i++)
+			expected[i] |= words[i];
+
+		batches[b] = palloc(sizeof(BMBatchWords));
+		make_batch(batches[b], words, NUM_WORDS);
+	}
+
+	check_union(batches, nbatches, expected, maxResultWords, maxTids);
+}
+
+void
+test__bitmap_union_one_batch(void **state)
+{
+	check_union_of(1, 4096, BM_BATCH_TIDS);
+}
+
+void
+test__bitmap_union(void **state)
+{
+	check_union_of(2, 4096, BM_BATCH_TIDS);
+	check_union_of(5, 4096, BM_BATCH_TIDS);
+}
+
+void
+test__bitmap_union_small_result(void **state)
+{
+	/* the runs of literal words are cut by the end of the result */
+	check_union_of(3, 37, BM_BATCH_TIDS);
+}
+
+void
+test__bitmap_findnexttids_partial(void **state)
+{
+	/*
+	 * Words are left in the middle, literal as well as fill words.  A fill
+	 * word is only expanded a whole word at a time, so at least a word's
+	 * worth of tids must fit.
+	 */
+	check_union_of(3, 4096, 100);
+	check_union_of(1, 4096, 1000);
+}
+
+void
+test__bitmap_rightmost_bit(void **state)
+{
+	int			i;
+
+	for (i = 0; i < BM_HRL_WORD_SIZE; i++)
+	{
+		BM_HRL_WORD bit = (BM_HRL_WORD) 1 << i;
+
+		assert_int_equal(_bitmap_rightmost_bit(bit), i);
+		assert_int_equal(_bitmap_rightmost_bit(bit | LITERAL_ALL_ONE << i), i);
+		assert_int_equal(_bitmap_leftmost_bit(bit), i);
+		assert_int_equal(_bitmap_leftmost_bit(bit | (bit - 1)), i);
+	}
+}
+
+int
+main(int argc, char *argv[])
+{
+	cmockery_parse_arguments(argc, argv);
+
+	const		UnitTest tests[] = {
+		unit_test(test__bitmap_union_one_batch),
+		unit_test(test__bitmap_union),
+		unit_test(test__bitmap_union_small_result),
+		unit_test(test__bitmap_findnexttids_partial),
+		unit_test(test__bitmap_rightmost_bit)
+	};
+
+	MemoryContextInit();
+
+	return run_tests(tests);
+}
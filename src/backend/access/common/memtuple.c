@@ -80,12 +80,20 @@ void destroy_memtuple_binding(MemTupleBinding *pbind)
 		pfree(pbind->bind.null_saves_aligned);
 	if(pbind->bind.bindings)
 		pfree(pbind->bind.bindings);
+	if(pbind->bind.phys_order)
+		pfree(pbind->bind.phys_order);
+	if(pbind->bind.phys_limit)
+		pfree(pbind->bind.phys_limit);
 	if(pbind->large_bind.null_saves)
 		pfree(pbind->large_bind.null_saves);
 	if(pbind->large_bind.null_saves_aligned)
 		pfree(pbind->large_bind.null_saves_aligned);
 	if(pbind->large_bind.bindings)
 		pfree(pbind->large_bind.bindings);
+	if(pbind->large_bind.phys_order)
+		pfree(pbind->large_bind.phys_order);
+	if(pbind->large_bind.phys_limit)
+		pfree(pbind->large_bind.phys_limit);
 	pfree(pbind);
 }
 
@@ -214,6 +222,8 @@ static void create_col_bind(MemTupleBindingCols *colbind, bool islarge, TupleDes
 
 	/* alloc bindings, no need to zero because we will fill them out  */
 	colbind->bindings = (MemTupleAttrBinding *) palloc(sizeof(MemTupleAttrBinding) * tupdesc->natts);
+	colbind->phys_order = (int *) palloc(sizeof(int) * (tupdesc->natts + 1));
+	colbind->phys_limit = (int *) palloc(sizeof(int) * (tupdesc->natts + 1));
 	
 	/*
 	 * The length of each binding is determined according to the alignment
@@ -261,6 +271,7 @@ static void create_col_bind(MemTupleBindingCols *colbind, bool islarge, TupleDes
 				bind->null_byte = physical_col >> 3;
 				bind->null_mask = 1 << (physical_col-(bind->null_byte << 3));
 
+				colbind->phys_order[physical_col] = i;
 				physical_col += 1;
 				cur_offset = bind->offset + bind->len;
 				previous_bind = bind;
@@ -299,6 +310,7 @@ static void create_col_bind(MemTupleBindingCols *colbind, bool islarge, TupleDes
 				bind->null_byte = physical_col >> 3;
 				bind->null_mask = 1 << (physical_col-(bind->null_byte << 3));
 
+				colbind->phys_order[physical_col] = i;
 				physical_col += 1;
 				cur_offset = bind->offset + bind->len;
 				previous_bind = bind;
@@ -337,6 +349,7 @@ static void create_col_bind(MemTupleBindingCols *colbind, bool islarge, TupleDes
 				bind->null_byte = physical_col >> 3;
 				bind->null_mask = 1 << (physical_col-(bind->null_byte << 3));
 
+				colbind->phys_order[physical_col] = i;
 				physical_col += 1;
 				cur_offset = bind->offset + bind->len;
 				previous_bind = bind;
@@ -378,6 +391,7 @@ static void create_col_bind(MemTupleBindingCols *colbind, bool islarge, TupleDes
 				bind->null_byte = physical_col >> 3;
 				bind->null_mask = 1 << (physical_col-(bind->null_byte << 3));
 
+				colbind->phys_order[physical_col] = i;
 				physical_col += 1;
 				cur_offset = bind->offset + bind->len;
 				previous_bind = bind;
@@ -397,6 +411,23 @@ static void create_col_bind(MemTupleBindingCols *colbind, bool islarge, TupleDes
 		colbind->null_saves = NULL;
 	}
 
+	/*
+	 * To deform the first n+1 logical attributes of a tuple with nulls, we
+	 * walk the physical columns up to the last one holding any of them, so
+	 * that the saved space can be accumulated on the way.  phys_limit[n] is
+	 * the number of physical columns to walk.
+	 */
+	{
+		int		   *limit = colbind->phys_limit;
+
+		for (i = 0; i < tupdesc->natts; ++i)
+			limit[i] = 0;
+		for (i = 0; i < physical_col; ++i)
+			limit[colbind->phys_order[i]] = i + 1;
+		for (i = 1; i < tupdesc->natts; ++i)
+			limit[i] = Max(limit[i], limit[i - 1]);
+	}
+
 #ifdef USE_DEBUG_ASSERT
 	for(i=0; i<tupdesc->natts; ++i)
 	{
@@ -955,9 +986,100 @@ static void memtuple_get_values(MemTuple mtup, MemTupleBinding *pbind, Datum *da
 		datum[i] = memtuple_getattr_by_alignment(mtup, pbind, i+1, &isnull[i], use_null_saves_aligned);
 }
 
+/*
+ * Fetch an attribute located 'ns' bytes before its binding offset.  This is
+ * fetchatt() specialized on the binding, so it does not need to look at the
+ * tuple descriptor.
+ */
+static inline Datum
+memtuple_fetch_bound_attr(char *start, MemTupleAttrBinding *bind, int ns)
+{
+	char	   *p = start + bind->offset - ns;
+
+	switch (bind->flag)
+	{
+		case MTB_ByVal_Native:
+			return fetch_att(p, true, bind->len);
+		case MTB_ByVal_Ptr:
+			return PointerGetDatum(p);
+		default:
+			if (bind->len == 2)
+				return PointerGetDatum(start + *(uint16 *) p);
+			Assert(bind->len == 4);
+			return PointerGetDatum(start + *(uint32 *) p);
+	}
+}
+
+/*
+ * Deform the first 'natts' attributes of a memtuple.
+ *
+ * Unlike memtuple_getattr(), which recomputes the space saved by nulls from
+ * the start of the null bitmap for every attribute, this walks the physical
+ * columns once and accumulates the saved space as it goes.  A tuple without
+ * nulls has every attribute at its binding offset, so that case is a
+ * straight loop over the bindings.  Attributes past 'natts' are not touched,
+ * except where a physically preceding column must be stepped over.
+ */
+void
+memtuple_deform_upto(MemTuple mtup, MemTupleBinding *pbind, int natts,
+					 Datum *datum, bool *isnull)
+{
+	MemTupleBindingCols *colbind = memtuple_get_islarge(mtup) ? &pbind->large_bind : &pbind->bind;
+	MemTupleAttrBinding *bindings = colbind->bindings;
+	char	   *start;
+	int			i;
+
+	Assert(mtup && pbind && pbind->tupdesc);
+	Assert(natts >= 0 && natts <= pbind->tupdesc->natts);
+
+	if (natts == 0)
+		return;
+
+	if (!memtuple_get_hasnull(mtup))
+	{
+		start = (char *) mtup;
+		for (i = 0; i < natts; ++i)
+		{
+			datum[i] = memtuple_fetch_bound_attr(start, &bindings[i], 0);
+			isnull[i] = false;
+		}
+	}
+	else
+	{
+		unsigned char *nullp = memtuple_get_nullp(mtup, pbind);
+		int			limit = colbind->phys_limit[natts - 1];
+		int			ns = 0;
+		int			p;
+
+		start = (char *) mtup + pbind->null_bitmap_extra_size;
+		for (p = 0; p < limit; ++p)
+		{
+			MemTupleAttrBinding *bind;
+
+			i = colbind->phys_order[p];
+			bind = &bindings[i];
+
+			if (nullp[bind->null_byte] & bind->null_mask)
+			{
+				if (i < natts)
+				{
+					datum[i] = 0;
+					isnull[i] = true;
+				}
+				ns += bind->len_aligned;
+			}
+			else if (i < natts)
+			{
+				datum[i] = memtuple_fetch_bound_attr(start, bind, ns);
+				isnull[i] = false;
+			}
+		}
+	}
+}
+
 void memtuple_deform(MemTuple mtup, MemTupleBinding *pbind, Datum *datum, bool *isnull)
 {
-	memtuple_get_values(mtup, pbind, datum, isnull, true /* aligned */);
+	memtuple_deform_upto(mtup, pbind, pbind->tupdesc->natts, datum, isnull);
 }
 
 
@@ -42,6 +42,7 @@
 #include "miscadmin.h"
 #include "pg_trace.h"
 #include "pgstat.h"
+#include "postmaster/autostats.h"
 #include "replication/walsender.h"
 #include "replication/syncrep.h"
 #include "storage/bufmgr.h"
@@ -73,6 +74,7 @@
 #include "cdb/cdbdistributedsnapshot.h"
 #include "cdb/cdbgang.h"
 #include "cdb/cdblocaldistribxact.h"
+#include "cdb/cdbcompresspool.h"
 #include "cdb/cdbtm.h"
 #include "cdb/cdbvars.h" /* Gp_role, Gp_is_writer, interconnect_setup_timeout */
 #include "utils/vmem_tracker.h"
@@ -2763,7 +2765,9 @@ CommitTransaction(void)
 	AtEOXact_CatCache(true);
 
 	AtEOXact_AppendOnly();
+	AtEOXact_CompressPool(true);
 	AtCommit_Notify();
+	AtEOXact_AutoStats(true);
 	AtEOXact_GUC(true, 1);
 	AtEOXact_SPI(true);
 	AtEOXact_on_commit_actions(true);
@@ -3080,6 +3084,9 @@ PrepareTransaction(void)
 	/* Check we've released all catcache entries */
 	AtEOXact_CatCache(true);
 
+	/* Tables to auto-analyze are not carried over a PREPARE */
+	AtEOXact_AutoStats(false);
+
 	/* PREPARE acts the same as COMMIT as far as GUC is concerned */
 	AtEOXact_GUC(true, 1);
 	AtEOXact_SPI(true);
@@ -3222,11 +3229,13 @@ AbortTransaction(void)
 		
 	/* Perform any AO table abort processing */
 	AtAbort_AppendOnly();
+	AtEOXact_CompressPool(false);
 
 	AtEOXact_DispatchOids(false);
 
 	AtEOXact_LargeObject(false);
 	AtAbort_Notify();
+	AtEOXact_AutoStats(false);
 	AtEOXact_RelationMap(false);
 	AtAbort_Twophase();
 
@@ -5345,6 +5354,8 @@ CommitSubTransaction(void)
 						s->parent->curTransactionOwner);
 	AtEOSubXact_LargeObject(true, s->subTransactionId,
 							s->parent->subTransactionId);
+	AtEOSubXact_CompressPool(true, s->subTransactionId,
+							 s->parent->subTransactionId);
 	AtSubCommit_Notify();
 
 	CallSubXactCallbacks(SUBXACT_EVENT_COMMIT_SUB, s->subTransactionId,
@@ -5488,6 +5499,8 @@ AbortSubTransaction(void)
 		AtEOXact_DispatchOids(false);
 		AtEOSubXact_LargeObject(false, s->subTransactionId,
 								s->parent->subTransactionId);
+		AtEOSubXact_CompressPool(false, s->subTransactionId,
+								 s->parent->subTransactionId);
 		AtSubAbort_Notify();
 
 		/* Advertise the fact that we aborted in pg_clog. */
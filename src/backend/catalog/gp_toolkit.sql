@@ -1996,7 +1996,10 @@ LANGUAGE C IMMUTABLE STRICT NO SQL;
 --        int - sessionid,
 --        int - command_cnt,
 --        timestamptz - time of query start,
---        int - number of files
+--        int - number of files,
+--        bigint - bytes written to closed bfz files, before compression,
+--        bigint - bytes written to closed bfz files, after compression,
+--        float8 - milliseconds spent compressing and decompressing
 --
 -- @doc:
 --        UDF to retrieve workfile sets currently present on disk on one segment
@@ -2042,7 +2045,10 @@ WITH all_entries AS (
             sessionid int,
             commandid int,
             query_start timestamptz,
-            numfiles int
+            numfiles int,
+            rawsize bigint,
+            compressedsize bigint,
+            codectime float8
           )
     UNION ALL
     SELECT C.*
@@ -2058,7 +2064,10 @@ WITH all_entries AS (
             sessionid int,
             commandid int,
             query_start timestamptz,
-            numfiles int
+            numfiles int,
+            rawsize bigint,
+            compressedsize bigint,
+            codectime float8
           ))
 SELECT S.datname,
        (CASE WHEN (C.state = 1) THEN S.pid ELSE NULL END) AS pid,
@@ -2073,7 +2082,9 @@ SELECT S.datname,
        C.size,
        C.numfiles,
        C.path as directory,
-       (CASE WHEN (C.state = 1) THEN 'RUNNING' WHEN (C.state = 2) THEN 'CACHED' WHEN (C.state = 3) THEN 'DELETING' ELSE 'UNKNOWN' END) as state
+       (CASE WHEN (C.state = 1) THEN 'RUNNING' WHEN (C.state = 2) THEN 'CACHED' WHEN (C.state = 3) THEN 'DELETING' ELSE 'UNKNOWN' END) as state,
+       (CASE WHEN (C.compressedsize > 0) THEN round((C.rawsize::numeric / C.compressedsize), 2) ELSE NULL END) as compression_ratio,
+       C.codectime as compression_time_ms
 FROM all_entries C LEFT OUTER JOIN
 pg_stat_activity as S
 ON C.sessionid = S.sess_id;
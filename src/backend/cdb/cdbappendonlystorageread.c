@@ -21,6 +21,7 @@
 #include <sys/file.h>
 #include <unistd.h>
 
+#include "access/xlogdefs.h"
 #include "catalog/pg_compression.h"
 #include "cdb/cdbappendonlystorage.h"
 #include "cdb/cdbappendonlystoragelayer.h"
@@ -223,10 +224,14 @@ AppendOnlyStorageRead_FinishSession(AppendOnlyStorageRead *storageRead)
  * the logical EOF.
  *
  * filePathName - name of the segment file to open.
+ *
+ * With gp_appendonly_direct_io, the file is opened with O_DIRECT, unless the
+ * file system does not support it.  *directIO tells which.
  */
 static File
 AppendOnlyStorageRead_DoOpenFile(AppendOnlyStorageRead *storageRead,
-								 char *filePathName)
+								 char *filePathName,
+								 bool *directIO)
 {
 	int			fileFlags = O_RDONLY | PG_BINARY;
 
@@ -248,6 +253,21 @@ AppendOnlyStorageRead_DoOpenFile(AppendOnlyStorageRead *storageRead,
 	/*
 	 * Open the file for read.
 	 */
+	*directIO = false;
+	if (gp_appendonly_direct_io && PG_O_DIRECT != 0)
+	{
+		file = PathNameOpenFile(filePathName, fileFlags | PG_O_DIRECT, fileMode);
+		if (file >= 0)
+		{
+			*directIO = true;
+			return file;
+		}
+
+		/* e.g. tmpfs refuses O_DIRECT; fall back to a buffered open */
+		if (errno != EINVAL)
+			return file;
+	}
+
 	file = PathNameOpenFile(filePathName, fileFlags, fileMode);
 
 	return file;
@@ -261,13 +281,15 @@ AppendOnlyStorageRead_DoOpenFile(AppendOnlyStorageRead *storageRead,
  * version		- AO table format version the file is in.
  * logicalEof	- snapshot version of the EOF value to use as the read end
  *				  of the segment file.
+ * directIO		- whether the file was opened with O_DIRECT.
  */
 static void
 AppendOnlyStorageRead_FinishOpenFile(AppendOnlyStorageRead *storageRead,
 									 File file,
 									 char *filePathName,
 									 int version,
-									 int64 logicalEof)
+									 int64 logicalEof,
+									 bool directIO)
 {
 	int64		seekResult;
 	MemoryContext oldMemoryContext;
@@ -307,16 +329,18 @@ AppendOnlyStorageRead_FinishOpenFile(AppendOnlyStorageRead *storageRead,
 	storageRead->segmentFileName = (char *) palloc(segmentFileNameLen + 1);
 	memcpy(storageRead->segmentFileName, filePathName, segmentFileNameLen + 1);
 
-	/* Allocation is done.  Go back to caller memory-context. */
-	MemoryContextSwitchTo(oldMemoryContext);
-
 	storageRead->logicalEof = logicalEof;
 
+	/* This allocates the buffer for direct I/O, the first time. */
 	BufferedReadSetFile(
 						&storageRead->bufferedRead,
 						storageRead->file,
 						storageRead->segmentFileName,
-						logicalEof);
+						logicalEof,
+						directIO);
+
+	/* Allocation is done.  Go back to caller memory-context. */
+	MemoryContextSwitchTo(oldMemoryContext);
 }
 
 /*
@@ -337,6 +361,7 @@ AppendOnlyStorageRead_OpenFile(AppendOnlyStorageRead *storageRead,
 							   int64 logicalEof)
 {
 	File		file;
+	bool		directIO;
 
 	Assert(storageRead != NULL);
 	Assert(storageRead->isActive);
@@ -355,7 +380,8 @@ AppendOnlyStorageRead_OpenFile(AppendOnlyStorageRead *storageRead,
 						storageRead->relationName)));
 
 	file = AppendOnlyStorageRead_DoOpenFile(storageRead,
-											filePathName);
+											filePathName,
+											&directIO);
 	if (file < 0)
 	{
 		ereport(ERROR,
@@ -369,7 +395,8 @@ AppendOnlyStorageRead_OpenFile(AppendOnlyStorageRead *storageRead,
 										 file,
 										 filePathName,
 										 version,
-										 logicalEof);
+										 logicalEof,
+										 directIO);
 }
 
 /*
@@ -390,6 +417,7 @@ AppendOnlyStorageRead_TryOpenFile(AppendOnlyStorageRead *storageRead,
 								  int64 logicalEof)
 {
 	File		file;
+	bool		directIO;
 
 	Assert(storageRead != NULL);
 	Assert(storageRead->isActive);
@@ -397,7 +425,8 @@ AppendOnlyStorageRead_TryOpenFile(AppendOnlyStorageRead *storageRead,
 	/* UNDONE: Range check logicalEof */
 
 	file = AppendOnlyStorageRead_DoOpenFile(storageRead,
-											filePathName);
+											filePathName,
+											&directIO);
 	if (file < 0)
 		return false;
 
@@ -405,7 +434,8 @@ AppendOnlyStorageRead_TryOpenFile(AppendOnlyStorageRead *storageRead,
 										 file,
 										 filePathName,
 										 version,
-										 logicalEof);
+										 logicalEof,
+										 directIO);
 
 	return true;
 }
@@ -30,10 +30,21 @@
 #include "cdb/cdbappendonlystorageformat.h"
 #include "cdb/cdbappendonlystoragewrite.h"
 #include "cdb/cdbappendonlyxlog.h"
+#include "cdb/cdbcompresspool.h"
 #include "common/relpath.h"
 #include "utils/faultinjector.h"
 #include "utils/guc.h"
 
+static void AppendOnlyStorageWrite_FinishPendingBuffer(AppendOnlyStorageWrite *storageWrite);
+static void AppendOnlyStorageWrite_MakeCompressedBlock(AppendOnlyStorageWrite *storageWrite,
+										   uint8 *header,
+										   uint8 *sourceData,
+										   int32 sourceLen,
+										   int executorBlockKind,
+										   int itemCount,
+										   int32 *compressedLen,
+										   int32 *bufferLen);
+
 
 /*----------------------------------------------------------------
  * Initialization
@@ -221,6 +232,13 @@ AppendOnlyStorageWrite_FinishSession(AppendOnlyStorageWrite *storageWrite)
 		storageWrite->segmentFileName = NULL;
 	}
 
+	if (storageWrite->compressJob != NULL)
+	{
+		CompressPool_ReleaseJob(storageWrite->compressJob);
+		storageWrite->compressJob = NULL;
+		storageWrite->compressJobPending = false;
+	}
+
 	if (storageWrite->compression_functions != NULL)
 	{
 		callCompressionDestructor(storageWrite->compression_functions[COMPRESSION_DESTRUCTOR], storageWrite->compressionState);
@@ -242,6 +260,60 @@ AppendOnlyStorageWrite_FinishSession(AppendOnlyStorageWrite *storageWrite)
 
 }
 
+/*
+ * Have the blocks of this write session compressed in the background by
+ * the compression pool, so that the caller can go on producing data while
+ * a block is being compressed.
+ *
+ * A finished block is appended to the file when the next block is started
+ * with ~_GetBuffer, or when content is written or the file is flushed, so
+ * the blocks still go to the file in order.  By the time the next block is
+ * started, the file position it will be written at is known, so the block
+ * directory is maintained as usual.
+ *
+ * Returns false if the pool is disabled or cannot do this session's kind of
+ * compression.
+ */
+bool
+AppendOnlyStorageWrite_UseCompressPool(AppendOnlyStorageWrite *storageWrite)
+{
+	CompressPoolAlgorithm algorithm;
+	CompressPoolJob *job;
+
+	Assert(storageWrite != NULL);
+	Assert(storageWrite->isActive);
+
+	if (storageWrite->compressJob != NULL)
+		return true;
+
+	/* Verifying a block needs it compressed before it is finished */
+	if (gp_aocs_compression_workers <= 0 ||
+		!storageWrite->storageAttributes.compress ||
+		gp_appendonly_verify_write_block)
+		return false;
+
+	if (!CompressPool_Supports(storageWrite->storageAttributes.compressType,
+							   &algorithm))
+		return false;
+
+	job = CompressPool_GetJob(storageWrite->maxBufferLen,
+							  storageWrite->maxBufferWithCompressionOverrrunLen);
+	job->algorithm = algorithm;
+	job->level = storageWrite->storageAttributes.compressLevel;
+
+	/* zstd_constructor takes compresslevel 0 to mean 1 */
+	if (algorithm == CompressPoolAlgorithm_Zstd && job->level == 0)
+		job->level = 1;
+
+	storageWrite->compressJob = job;
+
+	elogif(Debug_appendonly_print_insert, LOG,
+		   "Append-Only Storage Write for table '%s' compresses in the background",
+		   storageWrite->relationName);
+
+	return true;
+}
+
 /*----------------------------------------------------------------
  * Open and FlushAndClose
  *----------------------------------------------------------------
@@ -480,6 +552,8 @@ AppendOnlyStorageWrite_FlushAndCloseFile(
 		return;
 	}
 
+	AppendOnlyStorageWrite_FinishPendingBuffer(storageWrite);
+
 	/*
 	 * We pad out append commands to the page boundary.
 	 */
@@ -763,6 +837,12 @@ AppendOnlyStorageWrite_GetBuffer(AppendOnlyStorageWrite *storageWrite,
 		   aoHeaderKind == AoHeaderKind_NonBulkDenseContent ||
 		   aoHeaderKind == AoHeaderKind_BulkDenseContent);
 
+	/*
+	 * The previous block goes to the file before this one is started, which
+	 * also frees the compression job's buffer for it.
+	 */
+	AppendOnlyStorageWrite_FinishPendingBuffer(storageWrite);
+
 	storageWrite->getBufferAoHeaderKind = aoHeaderKind;
 
 	/*
@@ -782,6 +862,9 @@ AppendOnlyStorageWrite_GetBuffer(AppendOnlyStorageWrite *storageWrite,
 	{
 		storageWrite->currentBuffer = NULL;
 
+		if (storageWrite->compressJob != NULL)
+			return storageWrite->compressJob->source;
+
 		return storageWrite->uncompressedBuffer;
 	}
 	else
@@ -823,6 +906,8 @@ AppendOnlyStorageWrite_CurrentPosition(AppendOnlyStorageWrite *storageWrite)
 	Assert(storageWrite != NULL);
 	Assert(storageWrite->isActive);
 
+	AppendOnlyStorageWrite_FinishPendingBuffer(storageWrite);
+
 	return BufferedAppendCurrentBufferPosition(
 											   &storageWrite->bufferedAppend);
 }
@@ -1186,6 +1271,33 @@ AppendOnlyStorageWrite_CompressAppend(AppendOnlyStorageWrite *storageWrite,
 					compressor,
 					storageWrite->compressionState);
 
+	AppendOnlyStorageWrite_MakeCompressedBlock(storageWrite,
+											   header,
+											   sourceData,
+											   sourceLen,
+											   executorBlockKind,
+											   itemCount,
+											   compressedLen,
+											   bufferLen);
+}
+
+/*
+ * Finish a block whose data has been compressed into the BufferedAppend
+ * buffer after its header: store it uncompressed instead if that did not
+ * make it smaller, and make the header.
+ */
+static void
+AppendOnlyStorageWrite_MakeCompressedBlock(AppendOnlyStorageWrite *storageWrite,
+										   uint8 *header,
+										   uint8 *sourceData,
+										   int32 sourceLen,
+										   int executorBlockKind,
+										   int itemCount,
+										   int32 *compressedLen,
+										   int32 *bufferLen)
+{
+	uint8	   *dataBuffer = &header[storageWrite->currentCompleteHeaderLen];
+
 #ifdef FAULT_INJECTOR
 	/* Simulate that compression is not possible if the fault is set. */
 	if (FaultInjector_InjectFaultIfSet(
@@ -1287,6 +1399,84 @@ AppendOnlyStorageWrite_CompressAppend(AppendOnlyStorageWrite *storageWrite,
 	*bufferLen = storageWrite->currentCompleteHeaderLen + dataRoundedUpLen;
 }
 
+/*
+ * Append the block the compression pool was given by ~_FinishBuffer, if it
+ * hasn't been appended yet.
+ */
+static void
+AppendOnlyStorageWrite_FinishPendingBuffer(AppendOnlyStorageWrite *storageWrite)
+{
+	CompressPoolJob *job = storageWrite->compressJob;
+	AoHeaderKind saveAoHeaderKind;
+	bool		saveIsFirstRowNumSet;
+	int64		saveFirstRowNum;
+	int32		saveCompleteHeaderLen;
+	uint8	   *header;
+	int32		compressedLen;
+	int32		bufferLen;
+
+	if (!storageWrite->compressJobPending)
+		return;
+
+	CompressPool_Wait(job);
+	storageWrite->compressJobPending = false;
+
+	if (job->failed)
+		ereport(ERROR,
+				(errmsg("could not compress append-only block for table '%s'",
+						storageWrite->relationName),
+				 errdetail("%s", job->errorDetail),
+				 errcontext_appendonly_write_storage_block(storageWrite)));
+
+	/*
+	 * The header is made from the session's fields, which may already have
+	 * been set for the next block.
+	 */
+	saveAoHeaderKind = storageWrite->getBufferAoHeaderKind;
+	saveIsFirstRowNumSet = storageWrite->isFirstRowNumSet;
+	saveFirstRowNum = storageWrite->firstRowNum;
+	saveCompleteHeaderLen = storageWrite->currentCompleteHeaderLen;
+
+	storageWrite->getBufferAoHeaderKind = storageWrite->pendingAoHeaderKind;
+	storageWrite->isFirstRowNumSet = storageWrite->pendingIsFirstRowNumSet;
+	storageWrite->firstRowNum = storageWrite->pendingFirstRowNum;
+	storageWrite->currentCompleteHeaderLen =
+		AppendOnlyStorageWrite_CompleteHeaderLen(storageWrite,
+												 storageWrite->pendingAoHeaderKind);
+
+	header = BufferedAppendGetMaxBuffer(&storageWrite->bufferedAppend);
+	if (header == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_INTERNAL_ERROR),
+				 errmsg("We do not expect files to be have a maximum length"),
+				 errcontext_appendonly_write_storage_block(storageWrite)));
+
+	compressedLen = job->compressedLen;
+	if (compressedLen < job->sourceLen)
+		memcpy(&header[storageWrite->currentCompleteHeaderLen],
+			   job->dest,
+			   compressedLen);
+
+	AppendOnlyStorageWrite_MakeCompressedBlock(storageWrite,
+											   header,
+											   job->source,
+											   job->sourceLen,
+											   storageWrite->pendingExecutorBlockKind,
+											   storageWrite->pendingRowCount,
+											   &compressedLen,
+											   &bufferLen);
+
+	BufferedAppendFinishBuffer(&storageWrite->bufferedAppend,
+							   bufferLen,
+							   storageWrite->currentCompleteHeaderLen +
+							   AOStorage_RoundUp(job->sourceLen, storageWrite->formatVersion) /* non-compressed size */ );
+
+	storageWrite->getBufferAoHeaderKind = saveAoHeaderKind;
+	storageWrite->isFirstRowNumSet = saveIsFirstRowNumSet;
+	storageWrite->firstRowNum = saveFirstRowNum;
+	storageWrite->currentCompleteHeaderLen = saveCompleteHeaderLen;
+}
+
 /*
  * Mark the current buffer "small" buffer as finished.
  *
@@ -1431,6 +1621,34 @@ AppendOnlyStorageWrite_FinishBuffer(AppendOnlyStorageWrite *storageWrite,
 			   storageWrite->bufferCount);
 
 	}
+	else if (storageWrite->compressJob != NULL)
+	{
+		CompressPoolJob *job = storageWrite->compressJob;
+
+		/*
+		 * The content is already in the job's buffer.  Hand it to the
+		 * compression pool, and remember how to make its header; it will be
+		 * appended when the next block is started.
+		 */
+		Assert(!storageWrite->compressJobPending);
+
+		job->sourceLen = contentLen;
+		job->destLen =
+			storageWrite->maxBufferWithCompressionOverrrunLen
+			- storageWrite->currentCompleteHeaderLen;
+
+		storageWrite->pendingAoHeaderKind = storageWrite->getBufferAoHeaderKind;
+		storageWrite->pendingIsFirstRowNumSet = storageWrite->isFirstRowNumSet;
+		storageWrite->pendingFirstRowNum = storageWrite->firstRowNum;
+		storageWrite->pendingExecutorBlockKind = executorBlockKind;
+		storageWrite->pendingRowCount = rowCount;
+
+		CompressPool_Submit(job);
+		storageWrite->compressJobPending = true;
+
+		/* Declare it finished. */
+		storageWrite->currentCompleteHeaderLen = 0;
+	}
 	else
 	{
 		int32		compressedLen = 0;
@@ -1548,6 +1766,8 @@ AppendOnlyStorageWrite_Content(AppendOnlyStorageWrite *storageWrite,
 	Assert(storageWrite != NULL);
 	Assert(storageWrite->isActive);
 
+	AppendOnlyStorageWrite_FinishPendingBuffer(storageWrite);
+
 	completeHeaderLen =
 		AppendOnlyStorageWrite_CompleteHeaderLen(storageWrite,
 												 AoHeaderKind_SmallContent);
@@ -21,10 +21,14 @@
 
 #include "cdb/cdbappendonlyxlog.h"
 #include "cdb/cdbbufferedappend.h"
+#include "miscadmin.h"
 #include "utils/guc.h"
 
 static void BufferedAppendWrite(
 					BufferedAppend *bufferedAppend);
+static void BufferedAppendDropBehind(
+						 BufferedAppend *bufferedAppend,
+						 int32 bytesWritten);
 
 /*
  * Determines the amount of memory to supply for
@@ -132,6 +136,32 @@ BufferedAppendSetFile(BufferedAppend *bufferedAppend,
 	bufferedAppend->filePathName = filePathName;
 	bufferedAppend->fileLen = eof;
 	bufferedAppend->fileLen_uncompressed = eof_uncompressed;
+
+	bufferedAppend->dropBehind = gp_appendonly_direct_io;
+	bufferedAppend->dropBehindPosition = eof;
+}
+
+/*
+ * Called after a large write of bytesWritten bytes at largeWritePosition.
+ *
+ * AO files are written with exact, unaligned lengths that are also logged
+ * to the XLog, so they are not opened with O_DIRECT.  Instead, start
+ * writing this large write out right away, and drop the earlier ones from
+ * the cache: they have had the time of a large write to be written out,
+ * and the kernel leaves any page that is still dirty alone.
+ */
+static void
+BufferedAppendDropBehind(BufferedAppend *bufferedAppend,
+						 int32 bytesWritten)
+{
+	int64		position = bufferedAppend->largeWritePosition;
+
+	(void) FileWriteback(bufferedAppend->file, position, bytesWritten);
+	(void) FileDropCache(bufferedAppend->file,
+						 bufferedAppend->dropBehindPosition,
+						 position - bufferedAppend->dropBehindPosition);
+
+	bufferedAppend->dropBehindPosition = position;
 }
 
 
@@ -210,6 +240,17 @@ BufferedAppendWrite(BufferedAppend *bufferedAppend)
 		xlog_ao_insert(bufferedAppend->relFileNode.node, bufferedAppend->segmentFileNum,
 					   bufferedAppend->largeWritePosition, largeWriteMemory, bytestotal);
 
+	if (bufferedAppend->dropBehind)
+		BufferedAppendDropBehind(bufferedAppend, bytestotal);
+
+	/*
+	 * Charge a vacuum that writes to the segment file, i.e. the compaction of
+	 * another one, for the pages written, so that vacuum_cost_delay throttles
+	 * the writes as well as the reads of compaction.
+	 */
+	if (VacuumCostActive)
+		VacuumCostBalance += VacuumCostPageDirty * Max(1, bytestotal / BLCKSZ);
+
 	bufferedAppend->largeWritePosition += bufferedAppend->largeWriteLen;
 	bufferedAppend->largeWriteLen = 0;
 }
@@ -413,6 +454,9 @@ BufferedAppendCompleteFile(BufferedAppend *bufferedAppend,
 	bufferedAppend->fileLen_uncompressed = 0;
 	bufferedAppend->file = -1;
 	bufferedAppend->filePathName = NULL;
+
+	bufferedAppend->dropBehind = false;
+	bufferedAppend->dropBehindPosition = 0;
 }
 
 /*
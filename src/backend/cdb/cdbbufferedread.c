@@ -20,8 +20,29 @@
 #include "utils/guc.h"
 #include "miscadmin.h"
 
+/*
+ * Number of large reads beyond the current one that are handed to the kernel
+ * with posix_fadvise(WILLNEED) ahead of time, so that the next read is in
+ * flight while the blocks of the current one are being decompressed.
+ */
+int			gp_appendonly_read_ahead = 1;
+
+/*
+ * Upper limit on the size of the aligned buffer of direct I/O, which holds
+ * gp_appendonly_read_ahead + 1 large reads.  There is one per column of an
+ * AOCS scan.
+ */
+#define BUFFERED_READ_DIRECT_MAX_LEN	(8 * 1024 * 1024)
+
+static int64 BufferedReadInEffectFileLen(
+							BufferedRead *bufferedRead);
+static void BufferedReadPrefetch(
+					 BufferedRead *bufferedRead,
+					 int64 position);
 static void BufferedReadIo(
 			   BufferedRead *bufferedRead);
+static void BufferedReadDirectIo(
+					 BufferedRead *bufferedRead);
 static uint8 *BufferedReadUseBeforeBuffer(
 							BufferedRead *bufferedRead,
 							int32 maxReadAheadLen,
@@ -104,6 +125,7 @@ BufferedReadInit(
 	 */
 	bufferedRead->file = -1;
 	bufferedRead->fileLen = 0;
+	bufferedRead->prefetchEnd = 0;
 
 	/*
 	 * Temporary limit support for random reading.
@@ -120,7 +142,8 @@ BufferedReadSetFile(
 					BufferedRead *bufferedRead,
 					File file,
 					char *filePathName,
-					int64 fileLen)
+					int64 fileLen,
+					bool directIO)
 {
 	Assert(bufferedRead != NULL);
 
@@ -143,21 +166,93 @@ BufferedReadSetFile(
 	bufferedRead->haveTemporaryLimitInEffect = false;
 	bufferedRead->temporaryLimitFileLen = 0;
 
-	if (fileLen > 0)
+	bufferedRead->directIO = directIO;
+	bufferedRead->directBufferPosition = 0;
+	bufferedRead->directBufferLen = 0;
+	if (directIO && bufferedRead->directMemory == NULL)
 	{
+		int64		directLen;
+
+		directLen = (int64) (Max(gp_appendonly_read_ahead, 0) + 1) *
+			bufferedRead->maxLargeReadLen;
+		if (directLen > BUFFERED_READ_DIRECT_MAX_LEN)
+			directLen = Max(BUFFERED_READ_DIRECT_MAX_LEN,
+							bufferedRead->maxLargeReadLen);
+
 		/*
-		 * Do the first read.
+		 * A large read starts anywhere in the first aligned unit, so leave
+		 * room for one more.
 		 */
-		if (fileLen > bufferedRead->maxLargeReadLen)
-			bufferedRead->largeReadLen = bufferedRead->maxLargeReadLen;
-		else
-			bufferedRead->largeReadLen = (int32) fileLen;
-		BufferedReadIo(bufferedRead);
+		bufferedRead->directBufferSize =
+			(int32) TYPEALIGN(BUFFERED_READ_DIRECT_ALIGN, directLen) +
+			BUFFERED_READ_DIRECT_ALIGN;
+		bufferedRead->directMemory =
+			(uint8 *) palloc(bufferedRead->directBufferSize +
+							 BUFFERED_READ_DIRECT_ALIGN);
+		bufferedRead->directBuffer =
+			(uint8 *) TYPEALIGN(BUFFERED_READ_DIRECT_ALIGN,
+								bufferedRead->directMemory);
 	}
+
+	/*
+	 * Only start the first read here; the first BufferedReadGetNextBuffer
+	 * call does it.  A scan of an AOCS table opens the files of all its
+	 * columns before reading from any of them, so this puts the first reads
+	 * of all the columns in flight at once.
+	 */
+	bufferedRead->prefetchEnd = 0;
+	BufferedReadPrefetch(bufferedRead, 0);
+}
+
+static int64
+BufferedReadInEffectFileLen(
+							BufferedRead *bufferedRead)
+{
+	if (bufferedRead->haveTemporaryLimitInEffect)
+		return bufferedRead->temporaryLimitFileLen;
+	else
+		return bufferedRead->fileLen;
+}
+
+/*
+ * Make sure the next gp_appendonly_read_ahead large reads starting at
+ * position are being read by the kernel in the background.
+ *
+ * Each large read of a sequential scan moves the window by one large read,
+ * so only the part not requested before is handed to the kernel.  The
+ * window stops at the end of the file, or of the temporary range.
+ */
+static void
+BufferedReadPrefetch(
+					 BufferedRead *bufferedRead,
+					 int64 position)
+{
+	int64		endPosition;
+
+	/* This would only fill the cache that direct I/O bypasses. */
+	if (gp_appendonly_read_ahead <= 0 || bufferedRead->directIO)
+		return;
+
+	endPosition = position +
+		(int64) gp_appendonly_read_ahead * bufferedRead->maxLargeReadLen;
+	if (endPosition > BufferedReadInEffectFileLen(bufferedRead))
+		endPosition = BufferedReadInEffectFileLen(bufferedRead);
+
+	if (bufferedRead->prefetchEnd > position)
+		position = bufferedRead->prefetchEnd;
+	if (position >= endPosition)
+		return;
+
+	(void) FilePrefetch(bufferedRead->file,
+						position,
+						(int) (endPosition - position));
+	bufferedRead->prefetchEnd = endPosition;
 }
 
 /*
  * Perform a large read i/o.
+ *
+ * Before waiting for it, start the reads that follow it.
  */
 static void
 BufferedReadIo(
@@ -194,6 +289,15 @@ BufferedReadIo(
 	}
 #endif
 
+	if (bufferedRead->directIO)
+	{
+		BufferedReadDirectIo(bufferedRead);
+		return;
+	}
+
+	BufferedReadPrefetch(bufferedRead,
+						 bufferedRead->largeReadPosition + bufferedRead->largeReadLen);
+
 	offset = 0;
 	while (largeReadLen > 0)
 	{
@@ -241,8 +345,117 @@ BufferedReadIo(
 		offset += actualLen;
 	}
 
+	/*
+	 * A large read is many pages worth of I/O, charge a vacuum that reads it
+	 * (e.g. to compact the segment file) for every page.
+	 */
 	if (VacuumCostActive)
-		VacuumCostBalance += VacuumCostPageMiss;
+		VacuumCostBalance += VacuumCostPageMiss *
+			Max(1, bufferedRead->largeReadLen / BLCKSZ);
+}
+
+/*
+ * Perform a large read i/o of a file opened with O_DIRECT.
+ *
+ * O_DIRECT reads must be aligned, and they bypass the kernel's read-ahead,
+ * so read aligned ranges of several large reads into directBuffer and copy
+ * the large reads out of it.  The file position is left after the large
+ * read, as BufferedReadIo does.
+ */
+static void
+BufferedReadDirectIo(
+					 BufferedRead *bufferedRead)
+{
+	int64		largeReadPosition = bufferedRead->largeReadPosition;
+	int32		largeReadLen = bufferedRead->largeReadLen;
+	int64		seekPos;
+
+	if (largeReadPosition < bufferedRead->directBufferPosition ||
+		largeReadPosition + largeReadLen >
+		bufferedRead->directBufferPosition + bufferedRead->directBufferLen)
+	{
+		int64		alignedPosition;
+		int32		neededLen;
+
+		alignedPosition = largeReadPosition -
+			(largeReadPosition % BUFFERED_READ_DIRECT_ALIGN);
+		neededLen = (int32) (largeReadPosition + largeReadLen - alignedPosition);
+		Assert(neededLen <= bufferedRead->directBufferSize);
+
+		seekPos = FileSeek(bufferedRead->file, alignedPosition, SEEK_SET);
+		if (seekPos != alignedPosition)
+			ereport(ERROR, (errcode_for_file_access(),
+							errmsg("unable to seek to position for table \"%s\" in file \"%s\": %m",
+								   bufferedRead->relationName,
+								   bufferedRead->filePathName)));
+
+		bufferedRead->directBufferPosition = alignedPosition;
+		bufferedRead->directBufferLen = 0;
+
+		/*
+		 * Only the last read of the file can come up short, so the reads
+		 * stay aligned.
+		 */
+		while (bufferedRead->directBufferLen < neededLen)
+		{
+			int			actualLen = FileRead(
+											 bufferedRead->file,
+											 (char *) bufferedRead->directBuffer +
+											 bufferedRead->directBufferLen,
+											 bufferedRead->directBufferSize -
+											 bufferedRead->directBufferLen);
+
+			if (actualLen == 0)
+				ereport(ERROR, (errcode_for_file_access(),
+								errmsg("read beyond eof in table \"%s\" file \"%s\", "
+									   "direct read position " INT64_FORMAT ", "
+									   "read length %d (needed length %d)",
+									   bufferedRead->relationName,
+									   bufferedRead->filePathName,
+									   alignedPosition,
+									   bufferedRead->directBufferLen,
+									   neededLen)));
+			else if (actualLen < 0)
+				ereport(ERROR, (errcode_for_file_access(),
+								errmsg("unable to read table \"%s\" file \"%s\", "
+									   "direct read position " INT64_FORMAT ", "
+									   "read length %d (needed length %d): %m",
+									   bufferedRead->relationName,
+									   bufferedRead->filePathName,
+									   alignedPosition,
+									   bufferedRead->directBufferLen,
+									   neededLen)));
+
+			bufferedRead->directBufferLen += actualLen;
+		}
+
+		elogif(Debug_appendonly_print_read_block, LOG,
+			   "Append-Only storage direct read: table \"%s\", segment file \"%s\", read position " INT64_FORMAT ", "
+			   "actual read length %d (needed length %d)",
+			   bufferedRead->relationName,
+			   bufferedRead->filePathName,
+			   alignedPosition,
+			   bufferedRead->directBufferLen,
+			   neededLen);
+
+		if (VacuumCostActive)
+			VacuumCostBalance += VacuumCostPageMiss *
+				Max(1, bufferedRead->directBufferLen / BLCKSZ);
+	}
+
+	memcpy(bufferedRead->largeReadMemory,
+		   &bufferedRead->directBuffer[largeReadPosition -
+									   bufferedRead->directBufferPosition],
+		   largeReadLen);
+
+	seekPos = FileSeek(bufferedRead->file,
+					   largeReadPosition + largeReadLen,
+					   SEEK_SET);
+	if (seekPos != largeReadPosition + largeReadLen)
+		ereport(ERROR, (errcode_for_file_access(),
+						errmsg("unable to seek to position for table \"%s\" in file \"%s\": %m",
+							   bufferedRead->relationName,
+							   bufferedRead->filePathName)));
 }
 
 static uint8 *
@@ -436,6 +649,9 @@ BufferedReadSetTemporaryRange(
 
 		bufferedRead->bufferOffset = 0;
 
+		/* The read-ahead done so far may be behind us. */
+		bufferedRead->prefetchEnd = 0;
+
 		remainingFileLen = afterFileOffset - beginFileOffset;
 		if (remainingFileLen > bufferedRead->maxLargeReadLen)
 			bufferedRead->largeReadLen = bufferedRead->maxLargeReadLen;
@@ -443,14 +659,14 @@ BufferedReadSetTemporaryRange(
 			bufferedRead->largeReadLen = (int32) remainingFileLen;
 
 		bufferedRead->largeReadPosition = beginFileOffset;
-
-		if (bufferedRead->largeReadLen > 0)
-			BufferedReadIo(bufferedRead);
 	}
 
+	/* Set before reading, so the read-ahead stays within the range. */
 	bufferedRead->haveTemporaryLimitInEffect = true;
 	bufferedRead->temporaryLimitFileLen = afterFileOffset;
 
+	if (newReadNeeded && bufferedRead->largeReadLen > 0)
+		BufferedReadIo(bufferedRead);
 }
 
 /*
@@ -699,6 +915,12 @@ BufferedReadCompleteFile(
 
 	bufferedRead->largeReadPosition = 0;
 	bufferedRead->largeReadLen = 0;
+
+	bufferedRead->prefetchEnd = 0;
+
+	bufferedRead->directIO = false;
+	bufferedRead->directBufferPosition = 0;
+	bufferedRead->directBufferLen = 0;
 }
 
 
@@ -723,6 +945,13 @@ BufferedReadFinish(BufferedRead *bufferedRead)
 		bufferedRead->memoryLen = 0;
 	}
 
+	if (bufferedRead->directMemory != NULL)
+	{
+		pfree(bufferedRead->directMemory);
+		bufferedRead->directMemory = NULL;
+		bufferedRead->directBuffer = NULL;
+	}
+
 	if (bufferedRead->relationName != NULL)
 	{
 		pfree(bufferedRead->relationName);
@@ -0,0 +1,393 @@
+/*-------------------------------------------------------------------------
+ *
+ * cdbcompresspool.c
+ *	  Compress Append-Only Storage Blocks in background threads.
+ *
+ * The pool is per backend.  Its threads are started on first use, up to
+ * gp_aocs_compression_workers of them, and live as long as the backend.
+ *
+ * Nothing in the backend is thread-safe, so the threads must not palloc,
+ * elog, or look at any backend state.  A job carries everything its thread
+ * needs, and is allocated with malloc() so that it stays valid even if the
+ * memory context of the code that submitted it is reset by an error.  The
+ * jobs are linked into a list that the end-of-(sub)transaction callbacks
+ * walk, to wait for the jobs of an aborted insert and free them.
+ *
+ * Portions Copyright (c) 2012-Present Pivotal Software, Inc.
+ *
+ *
+ * IDENTIFICATION
+ *	    src/backend/cdb/cdbcompresspool.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include <limits.h>
+#include <pthread.h>
+#include <zlib.h>
+#ifdef HAVE_LIBZSTD
+#include <zstd.h>
+#endif
+
+#include "access/xact.h"
+#include "cdb/cdbcompresspool.h"
+#include "miscadmin.h"
+
+int			gp_aocs_compression_workers = 0;
+
+static struct
+{
+	pthread_mutex_t mutex;
+
+	/* signalled when a job is queued */
+	pthread_cond_t workAvailable;
+
+	/* broadcast when a job is done */
+	pthread_cond_t jobDone;
+
+	/* FIFO of queued jobs, protected by the mutex */
+	CompressPoolJob *queueHead;
+	CompressPoolJob *queueTail;
+
+	/* the rest is only used by the backend */
+	int			nthreads;
+	bool		startFailed;
+	CompressPoolJob *jobs;
+
+	/* for compressing in the backend when there are no threads */
+	void	   *backendZstdContext;
+}			pool = {
+	PTHREAD_MUTEX_INITIALIZER,
+	PTHREAD_COND_INITIALIZER,
+	PTHREAD_COND_INITIALIZER,
+};
+
+/*
+ * Can blocks of this compression type be compressed by the pool?
+ *
+ * Only the compressors whose library is known to be thread-safe qualify;
+ * the block written is the same as the one the compression type's own
+ * compress function would have written.
+ */
+bool
+CompressPool_Supports(const char *compressType,
+					  CompressPoolAlgorithm *algorithm)
+{
+	if (compressType == NULL)
+		return false;
+
+	if (pg_strcasecmp(compressType, "zlib") == 0)
+	{
+		*algorithm = CompressPoolAlgorithm_Zlib;
+		return true;
+	}
+#ifdef HAVE_LIBZSTD
+	if (pg_strcasecmp(compressType, "zstd") == 0)
+	{
+		*algorithm = CompressPoolAlgorithm_Zstd;
+		return true;
+	}
+#endif
+
+	return false;
+}
+
+/*
+ * Compress the source of the job into its dest.  Runs in a worker thread,
+ * or in the backend when no thread could be started.
+ *
+ * *zstdContext is the compression context of the calling thread, created
+ * on first use.
+ */
+static void
+compresspool_compress(CompressPoolJob *job, void **zstdContext)
+{
+	job->failed = false;
+	job->errorDetail = NULL;
+
+	switch (job->algorithm)
+	{
+		case CompressPoolAlgorithm_Zlib:
+			{
+				uLongf		destLen = job->destLen;
+				int			rc;
+
+				rc = compress2(job->dest, &destLen,
+							   job->source, job->sourceLen,
+							   job->level);
+				if (rc == Z_OK)
+					job->compressedLen = (int32) destLen;
+				else if (rc == Z_BUF_ERROR)
+				{
+					/* didn't fit, same as zlib_compress */
+					job->compressedLen = job->sourceLen;
+				}
+				else
+				{
+					job->failed = true;
+					job->errorDetail = (rc == Z_MEM_ERROR) ?
+						"out of memory" : zError(rc);
+				}
+				break;
+			}
+
+		case CompressPoolAlgorithm_Zstd:
+#ifdef HAVE_LIBZSTD
+			{
+				size_t		ret;
+
+				if (*zstdContext == NULL)
+					*zstdContext = ZSTD_createCCtx();
+				if (*zstdContext == NULL)
+				{
+					job->failed = true;
+					job->errorDetail = "out of memory";
+					break;
+				}
+
+				ret = ZSTD_compressCCtx((ZSTD_CCtx *) *zstdContext,
+										job->dest, job->destLen,
+										job->source, job->sourceLen,
+										job->level);
+				if (ZSTD_isError(ret))
+				{
+					job->failed = true;
+					job->errorDetail = ZSTD_getErrorName(ret);
+				}
+				else
+					job->compressedLen = (int32) ret;
+				break;
+			}
+#endif
+		default:
+			job->failed = true;
+			job->errorDetail = "unsupported compression algorithm";
+			break;
+	}
+}
+
+static void *
+compresspool_worker_main(void *arg)
+{
+	void	   *zstdContext = NULL;
+
+	gp_set_thread_sigmasks();
+
+	pthread_mutex_lock(&pool.mutex);
+	for (;;)
+	{
+		CompressPoolJob *job;
+
+		while (pool.queueHead == NULL)
+			pthread_cond_wait(&pool.workAvailable, &pool.mutex);
+
+		job = pool.queueHead;
+		pool.queueHead = job->queueNext;
+		if (pool.queueHead == NULL)
+			pool.queueTail = NULL;
+		job->queueNext = NULL;
+		job->state = CompressPoolJobState_Running;
+
+		pthread_mutex_unlock(&pool.mutex);
+
+		compresspool_compress(job, &zstdContext);
+
+		pthread_mutex_lock(&pool.mutex);
+		job->state = CompressPoolJobState_Done;
+		pthread_cond_broadcast(&pool.jobDone);
+	}
+
+	return NULL;
+}
+
+/*
+ * Start threads until there are as many as gp_aocs_compression_workers.
+ *
+ * A failure to start one is not an error, the jobs are then compressed by
+ * the threads that did start, or by the backend.
+ */
+static void
+compresspool_start_workers(void)
+{
+	while (pool.nthreads < gp_aocs_compression_workers && !pool.startFailed)
+	{
+		pthread_attr_t t_atts;
+		pthread_t	thread;
+		int			pthread_err;
+
+		/* compression state is on the heap, a small stack will do */
+		pthread_attr_init(&t_atts);
+		pthread_attr_setstacksize(&t_atts, Max(PTHREAD_STACK_MIN, (256 * 1024)));
+		pthread_attr_setdetachstate(&t_atts, PTHREAD_CREATE_DETACHED);
+		pthread_err = pthread_create(&thread, &t_atts,
+									 compresspool_worker_main, NULL);
+		pthread_attr_destroy(&t_atts);
+
+		if (pthread_err != 0)
+		{
+			elog(LOG, "could not start compression thread, pthread_create() failed with err %d",
+				 pthread_err);
+			pool.startFailed = true;
+			break;
+		}
+
+		pool.nthreads++;
+	}
+}
+
+/*
+ * Allocate a job with buffers for sourceLen bytes of data to compress into
+ * destLen bytes.
+ *
+ * The job belongs to the current subtransaction; it is freed when that
+ * aborts, and must otherwise be released with CompressPool_ReleaseJob.
+ */
+CompressPoolJob *
+CompressPool_GetJob(int32 sourceLen, int32 destLen)
+{
+	CompressPoolJob *job;
+
+	job = (CompressPoolJob *) malloc(sizeof(CompressPoolJob) + sourceLen + destLen);
+	if (job == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_OUT_OF_MEMORY),
+				 errmsg("out of memory")));
+
+	memset(job, 0, sizeof(CompressPoolJob));
+	job->source = (uint8 *) (job + 1);
+	job->dest = job->source + sourceLen;
+	job->destLen = destLen;
+	job->state = CompressPoolJobState_Idle;
+	job->subid = GetCurrentSubTransactionId();
+
+	job->next = pool.jobs;
+	if (pool.jobs != NULL)
+		pool.jobs->prev = job;
+	pool.jobs = job;
+
+	return job;
+}
+
+/*
+ * Free a job, waiting for it first if it was submitted.
+ */
+void
+CompressPool_ReleaseJob(CompressPoolJob *job)
+{
+	CompressPool_Wait(job);
+
+	if (job->prev != NULL)
+		job->prev->next = job->next;
+	else
+		pool.jobs = job->next;
+	if (job->next != NULL)
+		job->next->prev = job->prev;
+
+	free(job);
+}
+
+/*
+ * Queue the job for compression.  Its source and sourceLen must be set,
+ * and it must not be in flight already.
+ */
+void
+CompressPool_Submit(CompressPoolJob *job)
+{
+	Assert(job->state == CompressPoolJobState_Idle ||
+		   job->state == CompressPoolJobState_Done);
+	Assert(job->sourceLen >= 0);
+
+	compresspool_start_workers();
+
+	if (pool.nthreads == 0)
+	{
+		job->state = CompressPoolJobState_Running;
+		compresspool_compress(job, &pool.backendZstdContext);
+		job->state = CompressPoolJobState_Done;
+		return;
+	}
+
+	pthread_mutex_lock(&pool.mutex);
+	job->state = CompressPoolJobState_Queued;
+	job->queueNext = NULL;
+	if (pool.queueTail != NULL)
+		pool.queueTail->queueNext = job;
+	else
+		pool.queueHead = job;
+	pool.queueTail = job;
+	pthread_cond_signal(&pool.workAvailable);
+	pthread_mutex_unlock(&pool.mutex);
+}
+
+/*
+ * Wait until a submitted job is done.
+ *
+ * Compressing a block takes milliseconds, so the wait is not interruptible.
+ */
+void
+CompressPool_Wait(CompressPoolJob *job)
+{
+	if (job->state == CompressPoolJobState_Idle)
+		return;
+
+	/* take the lock even if it's done, for the worker's writes to be seen */
+	pthread_mutex_lock(&pool.mutex);
+	while (job->state != CompressPoolJobState_Done)
+		pthread_cond_wait(&pool.jobDone, &pool.mutex);
+	pthread_mutex_unlock(&pool.mutex);
+}
+
+/*
+ * Free the jobs left behind by an aborted (sub)transaction.
+ *
+ * The writers that owned them are gone with the memory context they were
+ * in, but a thread may still be reading or writing their buffers.
+ */
+static void
+compresspool_release_jobs(bool all, SubTransactionId subid)
+{
+	CompressPoolJob *job = pool.jobs;
+
+	while (job != NULL)
+	{
+		CompressPoolJob *next = job->next;
+
+		if (all || job->subid == subid)
+			CompressPool_ReleaseJob(job);
+		job = next;
+	}
+}
+
+void
+AtEOXact_CompressPool(bool isCommit)
+{
+	if (pool.jobs == NULL)
+		return;
+
+	/* the writers release their jobs when they finish */
+	if (isCommit)
+		elog(WARNING, "compression pool job leak");
+
+	compresspool_release_jobs(true, InvalidSubTransactionId);
+}
+
+void
+AtEOSubXact_CompressPool(bool isCommit,
+						 SubTransactionId mySubid,
+						 SubTransactionId parentSubid)
+{
+	CompressPoolJob *job;
+
+	if (!isCommit)
+	{
+		compresspool_release_jobs(false, mySubid);
+		return;
+	}
+
+	for (job = pool.jobs; job != NULL; job = job->next)
+	{
+		if (job->subid == mySubid)
+			job->subid = parentSubid;
+	}
+}
@@ -504,6 +504,17 @@ cdb_grouping_planner(PlannerInfo *root,
 	if (is_grpext && agg_costs->numOrderedAggs > 0)
 		return NULL;
 
+	/*
+	 * Partial aggregates pushed below a join by eager aggregation are
+	 * computed where their input rows are, with no motion: their results
+	 * are finalized above the join.
+	 */
+	if (agg_costs->hasPartialAggs)
+	{
+		*(group_context->pcurrent_pathkeys) = NIL;
+		return NULL;
+	}
+
 	/*
 	 * First choose a one-stage plan.  Since there's always a way to do this,
 	 * it serves as our default choice.
@@ -688,6 +699,10 @@ cdb_grouping_planner(PlannerInfo *root,
 		if (agg_costs->hasNonCombine || agg_costs->hasNonSerial)
 			allowed_agg &= ~AGG_MULTIPHASE;
 
+		/* The final stage of eager aggregation is not split again. */
+		if (agg_costs->hasFinalAggs)
+			allowed_agg &= AGG_SINGLEPHASE;
+
 		/*
 		 * Ordered aggregates need to run the transition function on the
 		 * values in sorted order, which in turn translates into single phase
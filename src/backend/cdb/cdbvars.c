@@ -265,6 +265,7 @@ int			gp_max_plan_size = 0;
 bool		gp_disable_tuple_hints = false;
 
 int			gp_workfile_compress_algorithm = 0;
+int			gp_workfile_zstd_level = 1;
 bool		gp_workfile_checksumming = false;
 int			gp_workfile_caching_loglevel = DEBUG1;
 int			gp_sessionstate_loglevel = DEBUG1;
@@ -279,6 +280,10 @@ double		gp_workfile_limit_per_query = 0;
 int			gp_workfile_limit_files_per_query = 0;
 int			gp_workfile_bytes_to_checksum = 16;
 
+/* Blocks of workfile read-ahead and write-behind issued to the kernel */
+int			gp_workfile_prefetch_blocks = 16;
+int			gp_workfile_writeback_blocks = 0;
+
 /* The type of work files that HashJoin should use */
 int			gp_workfile_type_hashjoin = 0;
 
@@ -303,6 +308,8 @@ int			gp_autostats_mode_in_functions;
 char	   *gp_autostats_mode_in_functions_string;
 int			gp_autostats_on_change_threshold = 100000;
 bool		log_autostats = true;
+bool		gp_autostats_async = false;
+int			gp_autostats_async_naptime = 1000;
 
 /* --------------------------------------------------------------------------------------------------
  * Server debugging
@@ -84,6 +84,57 @@ test__BufferedReadUseBeforeBuffer__IsNextReadLenZero(void **state)
 	PG_END_TRY();	
 }
 
+void
+test__BufferedReadSetFile__StartsFirstRead(void **state)
+{
+	BufferedRead *bufferedRead = palloc(sizeof(BufferedRead));
+	int32 maxBufferLen = 128;
+	int32 maxLargeReadLen = 128;
+	int32 memoryLen = BufferedReadMemoryLen(maxBufferLen, maxLargeReadLen);
+	uint8 *memory = palloc(memoryLen);
+	int32 nextBufferLen;
+	uint8 *buffer;
+
+	gp_appendonly_read_ahead = 1;
+	BufferedReadInit(bufferedRead, memory, memoryLen, maxBufferLen, maxLargeReadLen, "test");
+
+	/*
+	 * Setting the file only hands the first large read to the kernel.
+	 */
+	expect_value(FilePrefetch, file, 1);
+	expect_value(FilePrefetch, offset, 0);
+	expect_value(FilePrefetch, amount, 128);
+	will_return(FilePrefetch, 0);
+
+	BufferedReadSetFile(bufferedRead, 1, "test_file", 300, false);
+
+	assert_int_equal(bufferedRead->largeReadLen, 0);
+	assert_int_equal(bufferedRead->prefetchEnd, 128);
+
+	/*
+	 * The first buffer does the first read, after starting the second one.
+	 */
+#ifdef USE_ASSERT_CHECKING
+	expect_value(FileNonVirtualCurSeek, file, 1);
+	will_return(FileNonVirtualCurSeek, 0);
+#endif
+	expect_value(FilePrefetch, file, 1);
+	expect_value(FilePrefetch, offset, 128);
+	expect_value(FilePrefetch, amount, 128);
+	will_return(FilePrefetch, 0);
+	expect_value(FileRead, file, 1);
+	expect_any(FileRead, buffer);
+	expect_value(FileRead, amount, 128);
+	will_return(FileRead, 128);
+
+	buffer = BufferedReadGetNextBuffer(bufferedRead, 64, &nextBufferLen);
+
+	assert_true(buffer == bufferedRead->largeReadMemory);
+	assert_int_equal(nextBufferLen, 64);
+	assert_int_equal(bufferedRead->largeReadLen, 128);
+	assert_int_equal(bufferedRead->prefetchEnd, 256);
+}
+
 int
 main(int argc, char* argv[])
 {
@@ -91,7 +142,8 @@ main(int argc, char* argv[])
 
 	const UnitTest tests[] = {
 		unit_test(test__BufferedReadUseBeforeBuffer__IsNextReadLenZero),
-		unit_test(test__BufferedReadInit__IsConsistent)
+		unit_test(test__BufferedReadInit__IsConsistent),
+		unit_test(test__BufferedReadSetFile__StartsFirstRead)
 	};
 
 	MemoryContextInit();
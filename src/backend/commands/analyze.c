@@ -79,11 +79,14 @@
 #define WIDTH_THRESHOLD  1024
 
 /*
- * For Hyperloglog, we define an error margin of 0.3%. If the number of
- * distinct values estimated by hyperloglog is within an error of 0.3%,
- * we consider everything as distinct.
+ * compute_scalar_stats_by_query() gets a row per column and distinct value
+ * of its sample, with two attributes per column, so it is only used for
+ * tables with at most this many columns to analyze.  Its sample is allowed
+ * to exceed the target size by this factor; a larger one is drawn again,
+ * smaller.
  */
-#define HLL_ERROR_MARGIN  0.003
+#define SUMMARY_MAX_ATTRS			8
+#define SUMMARY_SAMPLE_SLACK		2
 
 /* Data structure for Algorithm S from Knuth 3.4.2 */
 typedef struct
@@ -169,6 +172,11 @@ static void analyzeEstimateIndexpages(Relation onerel, Relation indrel, BlockNum
 static void analyze_rel_internal(Oid relid, VacuumStmt *vacstmt,
 					 BufferAccessStrategy bstrategy);
 static void acquire_hll_by_query(Relation onerel, int nattrs, VacAttrStats **attrstats, int elevel);
+static void compute_scalar_stats_by_query(Relation onerel, int nattrs, VacAttrStats **attrstats,
+							  int targrows, double totalrows, int elevel);
+static bool summarizable_attr(VacAttrStats *stats);
+static void store_leaf_hll(Relation onerel, VacAttrStats *stats,
+			   BlockNumber totalpages, double totalrows, int64 aomodcount);
 
 /*
  *	analyze_rel() -- analyze one relation
@@ -461,6 +469,8 @@ do_analyze_rel(Relation onerel, VacuumStmt *vacstmt,
 	int			save_nestlevel;
 	RowIndexes	**colLargeRowIndexes;
 	bool		sample_needed;
+	int64		aomodcount = 0;
+	int			sampled_cnt;
 
 	if (inh)
 		ereport(elevel,
@@ -625,6 +635,44 @@ do_analyze_rel(Relation onerel, VacuumStmt *vacstmt,
 		}
 	}
 
+	/*
+	 * With gp_analyze_segment_summaries, the columns of an append-optimized
+	 * table that get scalar statistics are not sampled to the master, but
+	 * summarized by the segments; see compute_scalar_stats_by_query().  They
+	 * are moved after the first sampled_cnt entries of vacattrstats.  Index
+	 * expressions are evaluated over the sample rows, so all the columns must
+	 * be sampled if there are any.  Wide tables are sampled too, as their
+	 * summaries would be larger than the sample.
+	 */
+	sampled_cnt = attr_cnt;
+	if (gp_analyze_segment_summaries &&
+		attr_cnt <= SUMMARY_MAX_ATTRS &&
+		RelationIsAppendOptimized(onerel) &&
+		!rel_has_external_partition(RelationGetRelid(onerel)))
+	{
+		bool		has_index_exprs = false;
+
+		for (ind = 0; ind < nindexes; ind++)
+		{
+			if (indexdata[ind].attr_cnt > 0)
+				has_index_exprs = true;
+		}
+
+		if (!has_index_exprs)
+		{
+			sampled_cnt = 0;
+			for (i = 0; i < attr_cnt; i++)
+			{
+				VacAttrStats *stats = vacattrstats[i];
+
+				if (summarizable_attr(stats))
+					continue;
+				vacattrstats[i] = vacattrstats[sampled_cnt];
+				vacattrstats[sampled_cnt++] = stats;
+			}
+		}
+	}
+
 	/*
 	 * Maintain information if the row of a column exceeds WIDTH_THRESHOLD
 	 */
@@ -641,6 +689,15 @@ do_analyze_rel(Relation onerel, VacuumStmt *vacstmt,
 	 */
 	SetUserIdAndSecContext(save_userid, save_sec_context);
 
+	/*
+	 * Note the modification count of an append-optimized leaf partition
+	 * before sampling it, to keep with its HLL counters; see
+	 * leaf_part_stats_current().
+	 */
+	if (RelationIsAppendOptimized(onerel) &&
+		rel_part_status(RelationGetRelid(onerel)) == PART_STATUS_LEAF)
+		aomodcount = get_ao_modcount(onerel);
+
 	if ((vacstmt->options & VACOPT_FULLSCAN) != 0)
 	{
 		if(rel_part_status(RelationGetRelid(onerel)) != PART_STATUS_ROOT)
@@ -651,7 +708,7 @@ do_analyze_rel(Relation onerel, VacuumStmt *vacstmt,
 		}
 	}
 
-	sample_needed = needs_sample(vacattrstats, attr_cnt);
+	sample_needed = needs_sample(vacattrstats, sampled_cnt);
 	if (sample_needed)
 	{
 		/*
@@ -666,11 +723,26 @@ do_analyze_rel(Relation onerel, VacuumStmt *vacstmt,
 	else
 #endif
 		rows = NULL;
-		numrows = (*acquirefunc) (onerel, elevel, attr_cnt, vacattrstats, &rows, targrows,
+		numrows = (*acquirefunc) (onerel, elevel, sampled_cnt, vacattrstats, &rows, targrows,
 								  &totalrows, &totaldeadrows, &totalpages,
 								  (vacstmt->options & VACOPT_ROOTONLY) != 0,
 								  colLargeRowIndexes);
 	}
+	else if (sampled_cnt < attr_cnt)
+	{
+		/* Every column is summarized; only the size of the table is needed */
+		float4		relTuples;
+		float4		relPages;
+
+		analyzeEstimateReltuplesRelpages(RelationGetRelid(onerel), &relTuples, &relPages,
+										 (vacstmt->options & VACOPT_ROOTONLY) != 0,
+										 elevel);
+		totalrows = relTuples;
+		totalpages = relPages;
+		totaldeadrows = 0;
+		numrows = 0;
+		rows = NULL;
+	}
 	else
 	{
 		/* If we're just merging stats from leafs, these are not needed either */
@@ -681,6 +753,11 @@ do_analyze_rel(Relation onerel, VacuumStmt *vacstmt,
 		rows = NULL;
 	}
 
+	if (sampled_cnt < attr_cnt)
+		compute_scalar_stats_by_query(onerel, attr_cnt - sampled_cnt,
+									  vacattrstats + sampled_cnt,
+									  targrows, totalrows, elevel);
+
 	/* change the privilege back to the table owner */
 	SetUserIdAndSecContext(onerel->rd_rel->relowner,
 						   save_sec_context | SECURITY_RESTRICTED_OPERATION);
@@ -698,7 +775,8 @@ do_analyze_rel(Relation onerel, VacuumStmt *vacstmt,
 	 * optimizer_analyze_root_partition or ROOTPARTITION is specified in the
 	 * ANALYZE statement.
 	 */
-	if (numrows > 0 || ((optimizer_analyze_root_partition || (vacstmt->options & VACOPT_ROOTONLY)) && !sample_needed))
+	if (numrows > 0 || sampled_cnt < attr_cnt ||
+		((optimizer_analyze_root_partition || (vacstmt->options & VACOPT_ROOTONLY)) && !sample_needed))
 	{
 		HeapTuple *validRows = (HeapTuple *) palloc(numrows * sizeof(HeapTuple));
 		MemoryContext col_context,
@@ -725,96 +803,71 @@ do_analyze_rel(Relation onerel, VacuumStmt *vacstmt,
 				MemoryContextResetAndDeleteChildren(col_context);
 				continue;
 			}
-			RowIndexes *rowIndexes = colLargeRowIndexes[i];
-			int validRowsLength = numrows - rowIndexes->toowide_cnt;
-
-			/* If there are too wide rows in the sample, remove them
-			 * from the sample being sent for stats collection
-			 */
-			if (rowIndexes->toowide_cnt > 0)
-			{
-				int validRowsIdx = 0;
-				for (int rownum=0; rownum < numrows; rownum++)
-				{
-					if (rowIndexes->rows[rownum]) // if row is too wide, ignore it from the sample
-						continue;
-					validRows[validRowsIdx] = rows[rownum];
-					validRowsIdx++;
-				}
-				stats->rows = validRows;
-				validRowsLength = validRowsIdx;
-			}
-			else
+			if (i < sampled_cnt)
 			{
-				stats->rows = rows;
-				validRowsLength = numrows;
-			}
-			AttributeOpts *aopt =
-			get_attribute_options(onerel->rd_id, stats->attr->attnum);
+				RowIndexes *rowIndexes = colLargeRowIndexes[i];
+				int validRowsLength = numrows - rowIndexes->toowide_cnt;
 
-			stats->tupDesc = onerel->rd_att;
-
-			if (validRowsLength > 0)
-			{
-				(*stats->compute_stats) (stats,
-										 std_fetch_func,
-										 validRowsLength, // numbers of rows in sample excluding toowide if any.
-										 totalrows);
-				/*
-				 * Store HLL/HLL fullscan information for leaf partitions in
-				 * the stats object
+				/* If there are too wide rows in the sample, remove them
+				 * from the sample being sent for stats collection
 				 */
-				if (rel_part_status(stats->attr->attrelid) == PART_STATUS_LEAF)
+				if (rowIndexes->toowide_cnt > 0)
 				{
-					MemoryContext old_context;
-					Datum *hll_values;
-
-					old_context = MemoryContextSwitchTo(stats->anl_context);
-					hll_values = (Datum *) palloc(sizeof(Datum));
-					int16 hll_length = 0;
-					int16 stakind = 0;
-					if(stats->stahll_full != NULL)
+					int validRowsIdx = 0;
+					for (int rownum=0; rownum < numrows; rownum++)
 					{
-						hll_length = datumGetSize(PointerGetDatum(stats->stahll_full), false, -1);
-						hll_values[0] = datumCopy(PointerGetDatum(stats->stahll_full), false, hll_length);
-						stakind = STATISTIC_KIND_FULLHLL;
+						if (rowIndexes->rows[rownum]) // if row is too wide, ignore it from the sample
+							continue;
+						validRows[validRowsIdx] = rows[rownum];
+						validRowsIdx++;
 					}
-					else if(stats->stahll != NULL)
-					{
-						((HLLCounter) (stats->stahll))->relPages = totalpages;
-						((HLLCounter) (stats->stahll))->relTuples = totalrows;
+					stats->rows = validRows;
+					validRowsLength = validRowsIdx;
+				}
+				else
+				{
+					stats->rows = rows;
+					validRowsLength = numrows;
+				}
+				stats->tupDesc = onerel->rd_att;
 
-						hll_length = hyperloglog_len((HLLCounter)stats->stahll);
-						hll_values[0] = datumCopy(PointerGetDatum(stats->stahll), false, hll_length);
-						stakind = STATISTIC_KIND_HLL;
-					}
-					MemoryContextSwitchTo(old_context);
-					if (stakind > 0)
-					{
-						stats->stakind[STATISTIC_NUM_SLOTS-1] = stakind;
-						stats->stavalues[STATISTIC_NUM_SLOTS-1] = hll_values;
-						stats->numvalues[STATISTIC_NUM_SLOTS-1] =  1;
-						stats->statyplen[STATISTIC_NUM_SLOTS-1] = hll_length;
-					}
+				if (validRowsLength > 0)
+				{
+					(*stats->compute_stats) (stats,
+											 std_fetch_func,
+											 validRowsLength, // numbers of rows in sample excluding toowide if any.
+											 totalrows);
+					/*
+					 * Store HLL/HLL fullscan information for leaf partitions in
+					 * the stats object
+					 */
+					store_leaf_hll(onerel, stats, totalpages, totalrows, aomodcount);
+				}
+				else
+				{
+					// All the rows were too wide to be included in the sample. We cannot
+					// do much in that case, but at least we know there were no NULLs, and
+					// that every item was >= WIDTH_THRESHOLD in width.
+					stats->stats_valid = true;
+					stats->stanullfrac = 0.0;
+					stats->stawidth = WIDTH_THRESHOLD;
+					stats->stadistinct = 0.0;		/* "unknown" */
 				}
+				stats->rows = rows; // Reset to original rows
 			}
-			else
+			else if (stats->stats_valid)
 			{
-				// All the rows were too wide to be included in the sample. We cannot
-				// do much in that case, but at least we know there were no NULLs, and
-				// that every item was >= WIDTH_THRESHOLD in width.
-				stats->stats_valid = true;
-				stats->stanullfrac = 0.0;
-				stats->stawidth = WIDTH_THRESHOLD;
-				stats->stadistinct = 0.0;		/* "unknown" */
+				/* Computed from the segments' summaries already */
+				store_leaf_hll(onerel, stats, totalpages, totalrows, aomodcount);
 			}
-			stats->rows = rows; // Reset to original rows
 
 			/*
 			 * If the appropriate flavor of the n_distinct option is
 			 * specified, override with the corresponding value.
 			 */
-			aopt = get_attribute_options(onerel->rd_id, stats->attr->attnum);
+			AttributeOpts *aopt =
+				get_attribute_options(onerel->rd_id, stats->attr->attnum);
+
 			if (aopt != NULL)
 			{
 				float8		n_distinct;
@@ -985,6 +1038,55 @@ do_analyze_rel(Relation onerel, VacuumStmt *vacstmt,
 	anl_context = NULL;
 }
 
+/*
+ * Store the HLL counter of a leaf partition's column, full scan or sampled,
+ * in the last slot of its statistics, for merging the root's.
+ */
+static void
+store_leaf_hll(Relation onerel, VacAttrStats *stats,
+			   BlockNumber totalpages, double totalrows, int64 aomodcount)
+{
+	MemoryContext old_context;
+	Datum	   *hll_values;
+	int16		hll_length = 0;
+	int16		stakind = 0;
+
+	if (rel_part_status(stats->attr->attrelid) != PART_STATUS_LEAF)
+		return;
+
+	old_context = MemoryContextSwitchTo(stats->anl_context);
+	hll_values = (Datum *) palloc(sizeof(Datum));
+	if (stats->stahll_full != NULL)
+	{
+		hll_length = datumGetSize(PointerGetDatum(stats->stahll_full), false, -1);
+		hll_values[0] = datumCopy(PointerGetDatum(stats->stahll_full), false, hll_length);
+		stakind = STATISTIC_KIND_FULLHLL;
+	}
+	else if (stats->stahll != NULL)
+	{
+		((HLLCounter) (stats->stahll))->relPages = totalpages;
+		((HLLCounter) (stats->stahll))->relTuples = totalrows;
+
+		hll_length = hyperloglog_len((HLLCounter) stats->stahll);
+		hll_values[0] = datumCopy(PointerGetDatum(stats->stahll), false, hll_length);
+		stakind = STATISTIC_KIND_HLL;
+	}
+	MemoryContextSwitchTo(old_context);
+
+	if (stakind > 0)
+	{
+		HLLCounter	hll = (HLLCounter) DatumGetPointer(hll_values[0]);
+
+		hll->modcount = (int32) aomodcount;
+		hll->relfilenode = aomodcount != 0 ? onerel->rd_node.relNode : InvalidOid;
+
+		stats->stakind[STATISTIC_NUM_SLOTS-1] = stakind;
+		stats->stavalues[STATISTIC_NUM_SLOTS-1] = hll_values;
+		stats->numvalues[STATISTIC_NUM_SLOTS-1] = 1;
+		stats->statyplen[STATISTIC_NUM_SLOTS-1] = hll_length;
+	}
+}
+
 /*
  * Compute statistics about indexes of a relation
  */
@@ -2116,6 +2218,279 @@ acquire_sample_rows_by_query(Relation onerel, int elevel, int nattrs, VacAttrSta
 	return sampleTuples;
 }
 
+/*
+ * Compute the statistics of the scalar columns 'attrstats' of a table from
+ * summaries of the sample made by the segments.
+ *
+ * acquire_sample_rows_by_query() brings every sampled row to the master,
+ * where compute_scalar_stats() sorts the values of each column, on a single
+ * core.  Here the segments draw the sample, and count it by the value of
+ * each column in turn, with GROUPING SETS, so that a single row per distinct
+ * value and its count comes back.  The counts of a column arrive in order of
+ * the values, and are expanded back into a sample for compute_scalar_stats();
+ * its sort finds them presorted, and takes a single pass.  The sample is
+ * the same for all the columns, as it is drawn once.
+ *
+ * Without the row order, no correlation could be computed; this is only used
+ * for append-optimized tables, which do not get one anyway.
+ *
+ * The query returns up to a row per column and sampled row, of two
+ * attributes per column, so this is only used for narrow tables; see
+ * SUMMARY_MAX_ATTRS.  The sample is drawn with random() on the segments, as
+ * a LIMIT would need all of its rows on the master, so its size is only
+ * known afterwards, and 'totalrows' may be off.  The rows kept are capped,
+ * and a sample found larger than SUMMARY_SAMPLE_SLACK times 'targrows' is
+ * drawn again, with a probability scaled down to fit.
+ */
+static void
+compute_scalar_stats_by_query(Relation onerel, int nattrs, VacAttrStats **attrstats,
+							  int targrows, double totalrows, int elevel)
+{
+	StringInfoData str;
+	StringInfoData columnStr;
+	StringInfoData groupStr;
+	StringInfoData setStr;
+	const char *schemaName;
+	const char *tableName;
+	float4		randomThreshold;
+	int			ret;
+	int			ngroups;
+	int			maxgroups;
+	int			i;
+	MemoryContext col_context;
+	MemoryContext old_context;
+
+	if (totalrows <= 0)
+		return;
+
+	schemaName = get_namespace_name(RelationGetNamespace(onerel));
+	tableName = RelationGetRelationName(onerel);
+
+	/*
+	 * Build the query.  Column i is v<i>, with the values wider than
+	 * WIDTH_THRESHOLD masked as NULL like in acquire_sample_rows_by_query(),
+	 * and w<i>, true for those.  w<i> is not null in exactly the groups of
+	 * column i.  Sorting on the (v<i>, w<i>) pairs in turn brings the groups
+	 * of each column together, in the order of its values.
+	 */
+	initStringInfo(&columnStr);
+	initStringInfo(&groupStr);
+	initStringInfo(&setStr);
+	for (i = 0; i < nattrs; i++)
+	{
+		VacAttrStats *stats = attrstats[i];
+		const char *attname = quote_identifier(NameStr(stats->attr->attname));
+		bool		is_varwidth = (!stats->attr->attbyval &&
+								   stats->attr->attlen < 0);
+
+		if (i > 0)
+		{
+			appendStringInfoString(&columnStr, ", ");
+			appendStringInfoString(&groupStr, ", ");
+			appendStringInfoString(&setStr, ", ");
+		}
+
+		if (is_varwidth)
+			appendStringInfo(&columnStr,
+							 "(case when pg_column_size(Ta.%s) > %d then NULL else Ta.%s end)",
+							 attname, WIDTH_THRESHOLD, attname);
+		else
+			appendStringInfo(&columnStr, "Ta.%s", attname);
+
+		/* compute_scalar_stats() sorts with the default collation */
+		if (OidIsValid(stats->attrtype->typcollation))
+			appendStringInfoString(&columnStr, " collate pg_catalog.\"default\"");
+
+		appendStringInfo(&columnStr,
+						 " as v%d, coalesce(pg_column_size(Ta.%s) > %d, false) as w%d",
+						 i, attname, WIDTH_THRESHOLD, i);
+		appendStringInfo(&groupStr, "v%d, w%d", i, i);
+		appendStringInfo(&setStr, "(v%d, w%d)", i, i);
+	}
+
+	randomThreshold = targrows / totalrows;
+
+	/*
+	 * A column has a group per distinct value of the sample, and one for the
+	 * too wide values, so a sample within the slack has at most this many.
+	 */
+	maxgroups = nattrs * (SUMMARY_SAMPLE_SLACK * targrows + 1);
+
+	if (SPI_OK_CONNECT != SPI_connect())
+		ereport(ERROR, (errcode(ERRCODE_INTERNAL_ERROR),
+						errmsg("Unable to connect to execute internal query.")));
+
+	initStringInfo(&str);
+	for (;;)
+	{
+		int64		sampledrows = 0;
+		int			g;
+
+		resetStringInfo(&str);
+		appendStringInfo(&str, "select %s, count(*) from (select %s from %s.%s as Ta ",
+						 groupStr.data,
+						 columnStr.data,
+						 quote_identifier(schemaName),
+						 quote_identifier(tableName));
+		if (randomThreshold < 1.0)
+			appendStringInfo(&str, "where random() < %.38f", randomThreshold);
+		appendStringInfo(&str, ") as Ts group by grouping sets (%s) order by %s",
+						 setStr.data, groupStr.data);
+
+		elog(elevel, "Executing SQL: %s", str.data);
+
+		/*
+		 * Do the query. We pass readonly==false, to force SPI to take a new
+		 * snapshot. That ensures that we see all changes by our own
+		 * transaction.  One row more than the groups allowed is asked for,
+		 * to find out if there are more.
+		 */
+		ret = SPI_execute(str.data, false, maxgroups + 1);
+		Assert(ret > 0);
+		ngroups = (int) SPI_processed;
+
+		/* The size of the sample, from the groups of the first column */
+		for (g = 0; g < ngroups; g++)
+		{
+			HeapTuple	tup = SPI_tuptable->vals[g];
+			bool		isnull;
+
+			(void) heap_getattr(tup, 2, SPI_tuptable->tupdesc, &isnull);
+			if (isnull)
+				break;
+			sampledrows += DatumGetInt64(heap_getattr(tup, 2 * nattrs + 1,
+													  SPI_tuptable->tupdesc,
+													  &isnull));
+		}
+
+		if (ngroups <= maxgroups &&
+			sampledrows <= (int64) SUMMARY_SAMPLE_SLACK * targrows)
+			break;
+
+		/*
+		 * The table has more rows than 'totalrows'.  If all the groups did
+		 * not come back, the sample size is unknown; halve the probability
+		 * then.
+		 */
+		if (randomThreshold > 1.0)
+			randomThreshold = 1.0;
+		if (ngroups <= maxgroups)
+			randomThreshold *= (float4) targrows / sampledrows;
+		else
+			randomThreshold /= 2;
+
+		elog(elevel, "ANALYZE sample of %s.%s too large, drawing a smaller one",
+			 quote_identifier(schemaName), quote_identifier(tableName));
+		SPI_freetuptable(SPI_tuptable);
+	}
+
+	/* MPP-10723: see acquire_sample_rows_by_query() */
+	if (totalrows > gp_statistics_sampling_threshold && ngroups == 0)
+	{
+		elog(ERROR, "ANALYZE unable to generate accurate statistics on table %s.%s. Try lowering gp_analyze_relative_error",
+			 quote_identifier(schemaName),
+			 quote_identifier(tableName));
+	}
+
+	col_context = AllocSetContextCreate(CurrentMemoryContext,
+										"Analyze Column Summary",
+										ALLOCSET_DEFAULT_MINSIZE,
+										ALLOCSET_DEFAULT_INITSIZE,
+										ALLOCSET_DEFAULT_MAXSIZE);
+	old_context = MemoryContextSwitchTo(col_context);
+
+	for (i = 0; i < nattrs; i++)
+	{
+		VacAttrStats *stats = attrstats[i];
+		TupleDesc	tupdesc = SPI_tuptable->tupdesc;
+		int			valueattno = 2 * i + 1;
+		int			countattno = 2 * nattrs + 1;
+		int			samplerows = 0;
+		int			toowide_cnt = 0;
+		int			g;
+		int			rownum;
+
+		/* Count the rows of the sample, apart from the too wide ones */
+		for (g = 0; g < ngroups; g++)
+		{
+			HeapTuple	tup = SPI_tuptable->vals[g];
+			bool		isnull;
+			bool		toowide;
+			int64		count;
+
+			toowide = DatumGetBool(heap_getattr(tup, valueattno + 1, tupdesc, &isnull));
+			if (isnull)
+				continue;
+			count = DatumGetInt64(heap_getattr(tup, countattno, tupdesc, &isnull));
+			if (toowide)
+				toowide_cnt += (int) count;
+			else
+				samplerows += (int) count;
+		}
+
+		if (samplerows == 0)
+		{
+			if (toowide_cnt > 0)
+			{
+				/* As in do_analyze_rel(), for a sample of too wide rows only */
+				stats->stats_valid = true;
+				stats->stanullfrac = 0.0;
+				stats->stawidth = WIDTH_THRESHOLD;
+				stats->stadistinct = 0.0;	/* "unknown" */
+			}
+			continue;
+		}
+
+		/* Expand the groups into the sample */
+		stats->exprvals = (Datum *) palloc(samplerows * sizeof(Datum));
+		stats->exprnulls = (bool *) palloc(samplerows * sizeof(bool));
+		stats->rowstride = 1;
+		rownum = 0;
+		for (g = 0; g < ngroups; g++)
+		{
+			HeapTuple	tup = SPI_tuptable->vals[g];
+			bool		isnull;
+			bool		toowide;
+			bool		valuenull;
+			Datum		value;
+			int64		count;
+
+			toowide = DatumGetBool(heap_getattr(tup, valueattno + 1, tupdesc, &isnull));
+			if (isnull || toowide)
+				continue;
+			value = heap_getattr(tup, valueattno, tupdesc, &valuenull);
+			count = DatumGetInt64(heap_getattr(tup, countattno, tupdesc, &isnull));
+			while (count-- > 0)
+			{
+				stats->exprvals[rownum] = value;
+				stats->exprnulls[rownum] = valuenull;
+				rownum++;
+			}
+		}
+		Assert(rownum == samplerows);
+
+		(*stats->compute_stats) (stats, ind_fetch_func, samplerows, totalrows);
+
+		/* The HLL counter is stored by do_analyze_rel(), keep it */
+		if (stats->stahll != NULL)
+		{
+			MemoryContextSwitchTo(stats->anl_context);
+			stats->stahll = (bytea *) datumCopy(PointerGetDatum(stats->stahll), false,
+												hyperloglog_len((HLLCounter) stats->stahll));
+			MemoryContextSwitchTo(col_context);
+		}
+
+		stats->exprvals = NULL;
+		stats->exprnulls = NULL;
+		MemoryContextResetAndDeleteChildren(col_context);
+	}
+
+	MemoryContextSwitchTo(old_context);
+	MemoryContextDelete(col_context);
+
+	SPI_finish();
+}
+
 /**
  * This method estimates reltuples/relpages for a relation. To do this, it employs
  * the built-in function 'gp_statistics_estimate_reltuples_relpages'. If the table to be
@@ -2691,6 +3066,8 @@ static void merge_leaf_stats(VacAttrStatsP stats,
 								 AnalyzeAttrFetchFunc fetchfunc,
 								 int samplerows,
 								 double totalrows);
+static void store_merged_hll(VacAttrStatsP stats, HLLCounter hll,
+				 int16 stakind);
 static int	compare_scalars(const void *a, const void *b, void *arg);
 static int	compare_mcvs(const void *a, const void *b);
 
@@ -2778,6 +3155,18 @@ std_typanalyze(VacAttrStats *stats)
 	return true;
 }
 
+/*
+ * Can the statistics of the column be computed from summaries made by the
+ * segments?  See compute_scalar_stats_by_query().
+ */
+static bool
+summarizable_attr(VacAttrStats *stats)
+{
+	return !stats->merge_stats &&
+		stats->compute_stats == compute_scalar_stats &&
+		stats->relstorage != RELSTORAGE_HEAP;
+}
+
 /*
  *	compute_minimal_stats() -- compute minimal column statistics
  *
@@ -4023,6 +4412,25 @@ merge_leaf_stats(VacAttrStatsP stats,
 					(errmsg("ANALYZE cannot merge since not all non-empty leaf partitions have consistent hyperloglog statistics for merge"),
 					 errhint("Re-run ANALYZE or ANALYZE FULLSCAN")));
 		}
+
+		/*
+		 * Keep the merged counter with the root's statistics.  The planner
+		 * uses it for the number of distinct values of the whole table, and
+		 * merges the counters of the leaves only when some of them are
+		 * pruned.  A sampled counter carries what the planner needs to
+		 * scale its estimate up to the table, as a leaf's does.
+		 */
+		if (fullhll_count == totalhll_count)
+			store_merged_hll(stats, finalHLLFull, STATISTIC_KIND_FULLHLL);
+		else
+		{
+			finalHLL->ndistinct = (int32) round(ndistinct);
+			finalHLL->nmultiples = (int32) nmultiple;
+			finalHLL->samplerows = samplerows;
+			finalHLL->relTuples = totalrows;
+			finalHLL->relPages = 0;
+			store_merged_hll(stats, finalHLL, STATISTIC_KIND_HLL);
+		}
 	}
 	pfree(hllcounters);
 	pfree(hllcounters_fullscan);
@@ -4150,6 +4558,30 @@ merge_leaf_stats(VacAttrStatsP stats,
 	pfree(heaptupleStats);
 	pfree(relTuples);
 }
+/*
+ *	store_merged_hll() -- store a merged HLL counter in the last stats slot
+ */
+static void
+store_merged_hll(VacAttrStatsP stats, HLLCounter hll, int16 stakind)
+{
+	MemoryContext old_context;
+	Datum	   *hll_values;
+	int			hll_length;
+
+	if (hll == NULL)
+		return;
+
+	old_context = MemoryContextSwitchTo(stats->anl_context);
+	hll_length = hyperloglog_len(hll);
+	hll_values = (Datum *) palloc(sizeof(Datum));
+	hll_values[0] = datumCopy(PointerGetDatum(hll), false, hll_length);
+	MemoryContextSwitchTo(old_context);
+
+	stats->stakind[STATISTIC_NUM_SLOTS-1] = stakind;
+	stats->stavalues[STATISTIC_NUM_SLOTS-1] = hll_values;
+	stats->numvalues[STATISTIC_NUM_SLOTS-1] = 1;
+}
+
 /*
  * qsort_arg comparator for sorting ScalarItems
  *
@@ -10,6 +10,8 @@
  */
 #include "postgres.h"
 
+#include "access/aocssegfiles.h"
+#include "access/aosegfiles.h"
 #include "access/heapam.h"
 #include "catalog/pg_collation.h"
 #include "catalog/pg_statistic.h"
@@ -25,6 +27,9 @@
 #include "utils/lsyscache.h"
 #include "utils/syscache.h"
 #include "utils/hsearch.h"
+#include "utils/hyperloglog/hyperloglog.h"
+#include "utils/rel.h"
+#include "utils/snapmgr.h"
 
 
 typedef struct MCVFreqEntry
@@ -1150,3 +1155,135 @@ leaf_parts_analyzed(Oid attrelid, Oid relid_exclude, List *va_cols)
 
 	return !all_parts_empty;
 }
+
+/*
+ * get_ao_modcount
+ *
+ * The sum of the modification counts of the segment files of an
+ * append-optimized relation.  Every insert, update and delete adds to the
+ * count of the segment files it writes, so an unchanged sum means unchanged
+ * contents, as long as the relfilenode is unchanged too: TRUNCATE starts the
+ * counts over.
+ */
+int64
+get_ao_modcount(Relation rel)
+{
+	Snapshot	snapshot;
+	FileSegTotals *totals;
+	int64		modcount;
+
+	Assert(RelationIsAppendOptimized(rel));
+
+	snapshot = RegisterSnapshot(GetLatestSnapshot());
+	if (RelationIsAoRows(rel))
+		totals = GetSegFilesTotals(rel, snapshot);
+	else
+		totals = GetAOCSSSegFilesTotals(rel, snapshot);
+	UnregisterSnapshot(snapshot);
+
+	modcount = totals->totalmodcount;
+	pfree(totals);
+
+	return modcount;
+}
+
+/*
+ * leaf_part_stats_current
+ *
+ * Do the statistics of the given columns (all of them, if va_cols is NIL) of
+ * an append-optimized leaf partition still describe its contents, so that
+ * ANALYZE of the root need not sample it again?
+ *
+ * ANALYZE keeps the modification count and relfilenode the leaf had when it
+ * was sampled in the HLL counter of each column.  The counters must also be
+ * of the kind the ANALYZE at hand would build, since the root's statistics
+ * can only be merged from counters of one kind.
+ */
+bool
+leaf_part_stats_current(Oid relid, List *va_cols, bool fullscan)
+{
+	Relation	rel;
+	int64		modcount;
+	bool		result = true;
+	int			stakind = fullscan ? STATISTIC_KIND_FULLHLL : STATISTIC_KIND_HLL;
+	int			i;
+
+	rel = try_relation_open(relid, AccessShareLock, false);
+	if (rel == NULL)
+		return false;
+
+	if (!RelationIsAppendOptimized(rel))
+	{
+		relation_close(rel, AccessShareLock);
+		return false;
+	}
+
+	/* Never written to, so there is nothing to go by. */
+	modcount = get_ao_modcount(rel);
+	if (modcount == 0)
+	{
+		relation_close(rel, AccessShareLock);
+		return false;
+	}
+
+	for (i = 0; i < RelationGetNumberOfAttributes(rel) && result; i++)
+	{
+		Form_pg_attribute attr = rel->rd_att->attrs[i];
+		HeapTuple	statsTuple;
+		AttStatsSlot sslot;
+
+		if (attr->attisdropped || attr->attstattarget == 0)
+			continue;
+
+		if (va_cols != NIL)
+		{
+			ListCell   *lc;
+			bool		found = false;
+
+			foreach(lc, va_cols)
+			{
+				if (strcmp(strVal(lfirst(lc)), NameStr(attr->attname)) == 0)
+				{
+					found = true;
+					break;
+				}
+			}
+			if (!found)
+				continue;
+		}
+
+		statsTuple = SearchSysCache3(STATRELATTINH,
+									 ObjectIdGetDatum(relid),
+									 Int16GetDatum(attr->attnum),
+									 BoolGetDatum(false));
+		if (!HeapTupleIsValid(statsTuple))
+		{
+			result = false;
+			break;
+		}
+
+		if (get_attstatsslot(&sslot, statsTuple, stakind, InvalidOid,
+							 ATTSTATSSLOT_VALUES))
+		{
+			if (sslot.nvalues > 0)
+			{
+				HLLCounter	hll = (HLLCounter) DatumGetByteaP(sslot.values[0]);
+
+				if (hll->modcount != (int32) modcount ||
+					hll->relfilenode != rel->rd_node.relNode)
+					result = false;
+			}
+			else
+				result = false;
+			free_attstatsslot(&sslot);
+		}
+		else
+			result = false;
+
+		ReleaseSysCache(statsTuple);
+	}
+
+	relation_close(rel, AccessShareLock);
+
+	return result;
+}
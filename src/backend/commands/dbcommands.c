@@ -50,6 +50,7 @@
 #include "mb/pg_wchar.h"
 #include "miscadmin.h"
 #include "pgstat.h"
+#include "postmaster/autostats.h"
 #include "postmaster/bgwriter.h"
 #include "replication/slot.h"
 #include "storage/copydir.h"
@@ -896,6 +897,13 @@ dropdb(const char *dbname, bool missing_ok)
 				 errdetail("There are %d slot(s), %d of them active",
 						   nslots, nslots_active)));
 
+	/*
+	 * Forget the tables queued for asynchronous auto-stats in the database,
+	 * and terminate its auto-stats worker, which CountOtherDBBackends waits
+	 * for.
+	 */
+	AutoStatsDropDatabase(db_id);
+
 	/*
 	 * Check for other backends in the target database.  (Because we hold the
 	 * database lock, no new ones can start after this.)
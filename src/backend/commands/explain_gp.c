@@ -107,6 +107,14 @@ typedef struct CdbExplain_StatInst
 	double		workmemused;	/* work_mem actually used (bytes) */
 	double		workmemwanted;	/* work_mem to avoid workfile i/o (bytes) */
 	bool		workfileCreated;	/* workfile created in this node */
+	double		workfileRawBytes;	/* workfile bytes before compression */
+	double		workfileDiskBytes;	/* workfile bytes after compression */
+	double		workfileCodecTime;	/* secs spent (de)compressing workfiles */
+	double		resultCacheHits;	/* results found in result cache */
+	double		resultCacheMisses;	/* results not in result cache */
+	double		resultCacheEvictions;	/* results evicted from cache */
+	double		resultCacheMemUsed; /* peak memory of cache (bytes) */
+	double		zoneMapBlocksSkipped;	/* AO blocks skipped by zone maps */
 	instr_time	firststart;		/* Start time of first iteration of node */
 	double		peakMemBalance; /* Max mem account balance */
 	int			numPartScanned; /* Number of part tables scanned */
@@ -177,6 +185,14 @@ typedef struct CdbExplain_NodeSummary
 	CdbExplain_Agg workmemused;
 	CdbExplain_Agg workmemwanted;
 	CdbExplain_Agg totalWorkfileCreated;
+	CdbExplain_Agg workfileRawBytes;
+	CdbExplain_Agg workfileDiskBytes;
+	CdbExplain_Agg workfileCodecTime;
+	CdbExplain_Agg resultCacheHits;
+	CdbExplain_Agg resultCacheMisses;
+	CdbExplain_Agg resultCacheEvictions;
+	CdbExplain_Agg resultCacheMemUsed;
+	CdbExplain_Agg zoneMapBlocksSkipped;
 	CdbExplain_Agg peakMemBalance;
 	/* Used for DynamicTableScan, DynamicIndexScan and DynamicBitmapTableScan */
 	CdbExplain_Agg totalPartTableScanned;
@@ -981,6 +997,14 @@ cdbexplain_collectStatsFromNode(PlanState *planstate, CdbExplain_SendStatCtx *ct
 	si->workmemused = instr->workmemused;
 	si->workmemwanted = instr->workmemwanted;
 	si->workfileCreated = instr->workfileCreated;
+	si->workfileRawBytes = instr->workfileRawBytes;
+	si->workfileDiskBytes = instr->workfileDiskBytes;
+	si->workfileCodecTime = instr->workfileCodecTime;
+	si->resultCacheHits = instr->resultCacheHits;
+	si->resultCacheMisses = instr->resultCacheMisses;
+	si->resultCacheEvictions = instr->resultCacheEvictions;
+	si->resultCacheMemUsed = instr->resultCacheMemUsed;
+	si->zoneMapBlocksSkipped = instr->zoneMapBlocksSkipped;
 	si->peakMemBalance = MemoryAccounting_GetAccountPeakBalance(planstate->memoryAccountId);
 	si->firststart = instr->firststart;
 	si->numPartScanned = instr->numPartScanned;
@@ -1108,6 +1132,14 @@ cdbexplain_depositStatsToNode(PlanState *planstate, CdbExplain_RecvStatCtx *ctx)
 	CdbExplain_DepStatAcc workmemused;
 	CdbExplain_DepStatAcc workmemwanted;
 	CdbExplain_DepStatAcc totalWorkfileCreated;
+	CdbExplain_DepStatAcc workfileRawBytes;
+	CdbExplain_DepStatAcc workfileDiskBytes;
+	CdbExplain_DepStatAcc workfileCodecTime;
+	CdbExplain_DepStatAcc resultCacheHits;
+	CdbExplain_DepStatAcc resultCacheMisses;
+	CdbExplain_DepStatAcc resultCacheEvictions;
+	CdbExplain_DepStatAcc resultCacheMemUsed;
+	CdbExplain_DepStatAcc zoneMapBlocksSkipped;
 	CdbExplain_DepStatAcc peakmemused;
 	CdbExplain_DepStatAcc vmem_reserved;
 	CdbExplain_DepStatAcc memory_accounting_global_peak;
@@ -1136,6 +1168,14 @@ cdbexplain_depositStatsToNode(PlanState *planstate, CdbExplain_RecvStatCtx *ctx)
 	cdbexplain_depStatAcc_init0(&workmemused);
 	cdbexplain_depStatAcc_init0(&workmemwanted);
 	cdbexplain_depStatAcc_init0(&totalWorkfileCreated);
+	cdbexplain_depStatAcc_init0(&workfileRawBytes);
+	cdbexplain_depStatAcc_init0(&workfileDiskBytes);
+	cdbexplain_depStatAcc_init0(&workfileCodecTime);
+	cdbexplain_depStatAcc_init0(&resultCacheHits);
+	cdbexplain_depStatAcc_init0(&resultCacheMisses);
+	cdbexplain_depStatAcc_init0(&resultCacheEvictions);
+	cdbexplain_depStatAcc_init0(&resultCacheMemUsed);
+	cdbexplain_depStatAcc_init0(&zoneMapBlocksSkipped);
 	cdbexplain_depStatAcc_init0(&peakMemBalance);
 	cdbexplain_depStatAcc_init0(&totalPartTableScanned);
 	for (int idx = 0; idx < NUM_SORT_METHOD; ++idx)
@@ -1187,6 +1227,14 @@ cdbexplain_depositStatsToNode(PlanState *planstate, CdbExplain_RecvStatCtx *ctx)
 		cdbexplain_depStatAcc_upd(&workmemused, rsi->workmemused, rsh, rsi, nsi);
 		cdbexplain_depStatAcc_upd(&workmemwanted, rsi->workmemwanted, rsh, rsi, nsi);
 		cdbexplain_depStatAcc_upd(&totalWorkfileCreated, (rsi->workfileCreated ? 1 : 0), rsh, rsi, nsi);
+		cdbexplain_depStatAcc_upd(&workfileRawBytes, rsi->workfileRawBytes, rsh, rsi, nsi);
+		cdbexplain_depStatAcc_upd(&workfileDiskBytes, rsi->workfileDiskBytes, rsh, rsi, nsi);
+		cdbexplain_depStatAcc_upd(&workfileCodecTime, rsi->workfileCodecTime, rsh, rsi, nsi);
+		cdbexplain_depStatAcc_upd(&resultCacheHits, rsi->resultCacheHits, rsh, rsi, nsi);
+		cdbexplain_depStatAcc_upd(&resultCacheMisses, rsi->resultCacheMisses, rsh, rsi, nsi);
+		cdbexplain_depStatAcc_upd(&resultCacheEvictions, rsi->resultCacheEvictions, rsh, rsi, nsi);
+		cdbexplain_depStatAcc_upd(&resultCacheMemUsed, rsi->resultCacheMemUsed, rsh, rsi, nsi);
+		cdbexplain_depStatAcc_upd(&zoneMapBlocksSkipped, rsi->zoneMapBlocksSkipped, rsh, rsi, nsi);
 		cdbexplain_depStatAcc_upd(&peakMemBalance, rsi->peakMemBalance, rsh, rsi, nsi);
 		cdbexplain_depStatAcc_upd(&totalPartTableScanned, rsi->numPartScanned, rsh, rsi, nsi);
 		if (rsi->sortMethod < NUM_SORT_METHOD && rsi->sortMethod != UNINITIALIZED_SORT && rsi->sortSpaceType != UNINITIALIZED_SORT_SPACE_TYPE)
@@ -1207,6 +1255,14 @@ cdbexplain_depositStatsToNode(PlanState *planstate, CdbExplain_RecvStatCtx *ctx)
 	ns->workmemused = workmemused.agg;
 	ns->workmemwanted = workmemwanted.agg;
 	ns->totalWorkfileCreated = totalWorkfileCreated.agg;
+	ns->workfileRawBytes = workfileRawBytes.agg;
+	ns->workfileDiskBytes = workfileDiskBytes.agg;
+	ns->workfileCodecTime = workfileCodecTime.agg;
+	ns->resultCacheHits = resultCacheHits.agg;
+	ns->resultCacheMisses = resultCacheMisses.agg;
+	ns->resultCacheEvictions = resultCacheEvictions.agg;
+	ns->resultCacheMemUsed = resultCacheMemUsed.agg;
+	ns->zoneMapBlocksSkipped = zoneMapBlocksSkipped.agg;
 	ns->peakMemBalance = peakMemBalance.agg;
 	ns->totalPartTableScanned = totalPartTableScanned.agg;
 	for (int idx = 0; idx < NUM_SORT_METHOD; ++idx)
@@ -1667,6 +1723,97 @@ cdbexplain_showExecStats(struct PlanState *planstate, ExplainState *es)
 		}
 	}
 
+	/*
+	 * Compression of the workfiles written by this node, if they were
+	 * compressed: volume before and after, and the CPU time spent in the
+	 * compressor and decompressor.
+	 */
+	if (es->analyze && ns->workfileCodecTime.vcnt > 0 &&
+		ns->workfileDiskBytes.vsum > 0)
+	{
+		double		ratio = ns->workfileRawBytes.vsum / ns->workfileDiskBytes.vsum;
+
+		if (es->format == EXPLAIN_FORMAT_TEXT)
+		{
+			appendStringInfoSpaces(es->str, es->indent * 2);
+			appendStringInfo(es->str,
+							 "Workfile compression: %ldkB to %ldkB (ratio %.2f)  Codec time: %.3f ms  Max: %.3f ms (segment %d)\n",
+							 (long) kb(ns->workfileRawBytes.vsum),
+							 (long) kb(ns->workfileDiskBytes.vsum),
+							 ratio,
+							 1000.0 * ns->workfileCodecTime.vsum,
+							 1000.0 * ns->workfileCodecTime.vmax,
+							 ns->workfileCodecTime.imax);
+		}
+		else
+		{
+			ExplainOpenGroup("Workfile Compression", "Workfile Compression", true, es);
+			ExplainPropertyLong("Raw Size", (long) kb(ns->workfileRawBytes.vsum), es);
+			ExplainPropertyLong("Compressed Size", (long) kb(ns->workfileDiskBytes.vsum), es);
+			ExplainPropertyFloat("Ratio", ratio, 2, es);
+			ExplainPropertyFloat("Codec Time", 1000.0 * ns->workfileCodecTime.vsum, 3, es);
+			ExplainPropertyFloat("Max Codec Time", 1000.0 * ns->workfileCodecTime.vmax, 3, es);
+			ExplainPropertyInteger("Max Codec Time Segment", ns->workfileCodecTime.imax, es);
+			ExplainCloseGroup("Workfile Compression", "Workfile Compression", true, es);
+		}
+	}
+
+	/*
+	 * Append-only blocks that a scan skipped without reading them, because
+	 * the zone maps showed that none of their rows can satisfy the qual.
+	 */
+	if (es->analyze && ns->zoneMapBlocksSkipped.vsum > 0)
+	{
+		if (es->format == EXPLAIN_FORMAT_TEXT)
+		{
+			appendStringInfoSpaces(es->str, es->indent * 2);
+			appendStringInfo(es->str,
+							 "Zone maps: %.0f blocks skipped  Max: %.0f blocks (segment %d)\n",
+							 ns->zoneMapBlocksSkipped.vsum,
+							 ns->zoneMapBlocksSkipped.vmax,
+							 ns->zoneMapBlocksSkipped.imax);
+		}
+		else
+		{
+			ExplainOpenGroup("Zone Maps", "Zone Maps", true, es);
+			ExplainPropertyFloat("Blocks Skipped", ns->zoneMapBlocksSkipped.vsum, 0, es);
+			ExplainPropertyFloat("Max Blocks Skipped", ns->zoneMapBlocksSkipped.vmax, 0, es);
+			ExplainPropertyInteger("Max Blocks Skipped Segment", ns->zoneMapBlocksSkipped.imax, es);
+			ExplainCloseGroup("Zone Maps", "Zone Maps", true, es);
+		}
+	}
+
+	/*
+	 * Result cache of the correlated subplan this node is the top of, or of
+	 * the inner side of this nested loop, if its results were cached: the
+	 * number of parameter values found in the cache, and not found, and the
+	 * entries evicted to stay within work_mem.
+	 */
+	if (es->analyze && ns->resultCacheMisses.vcnt > 0)
+	{
+		if (es->format == EXPLAIN_FORMAT_TEXT)
+		{
+			appendStringInfoSpaces(es->str, es->indent * 2);
+			appendStringInfo(es->str,
+							 "Result cache: %.0f hits  %.0f misses  %.0f evictions  Max memory: %ldkB (segment %d)\n",
+							 ns->resultCacheHits.vsum,
+							 ns->resultCacheMisses.vsum,
+							 ns->resultCacheEvictions.vsum,
+							 (long) kb(ns->resultCacheMemUsed.vmax),
+							 ns->resultCacheMemUsed.imax);
+		}
+		else
+		{
+			ExplainOpenGroup("Result Cache", "Result Cache", true, es);
+			ExplainPropertyFloat("Hits", ns->resultCacheHits.vsum, 0, es);
+			ExplainPropertyFloat("Misses", ns->resultCacheMisses.vsum, 0, es);
+			ExplainPropertyFloat("Evictions", ns->resultCacheEvictions.vsum, 0, es);
+			ExplainPropertyLong("Max Memory", (long) kb(ns->resultCacheMemUsed.vmax), es);
+			ExplainPropertyInteger("Max Memory Segment", ns->resultCacheMemUsed.imax, es);
+			ExplainCloseGroup("Result Cache", "Result Cache", true, es);
+		}
+	}
+
 	if (es->verbose && EXPLAIN_MEMORY_VERBOSITY_SUPPRESS < explain_memory_verbosity)
 	{
 		/*
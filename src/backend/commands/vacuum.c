@@ -1099,6 +1099,32 @@ get_rel_oids(Oid relid, VacuumStmt *vacstmt, int stmttype)
 				{
 					oid_list = all_leaf_partition_relids(pn); /* all leaves */
 
+					/*
+					 * Leave out the leaves that were not modified since they
+					 * were last analyzed; the root's statistics are merged
+					 * from what they have.
+					 */
+					if (gp_analyze_skip_unchanged_leaves)
+					{
+						List	   *changed = NIL;
+						ListCell   *lc;
+
+						foreach(lc, oid_list)
+						{
+							Oid			leafrelid = lfirst_oid(lc);
+
+							if (leaf_part_stats_current(leafrelid,
+														vacstmt->va_cols,
+														(vacstmt->options & VACOPT_FULLSCAN) != 0))
+								ereport((vacstmt->options & VACOPT_VERBOSE) ? INFO : DEBUG2,
+										(errmsg("skipping \"%s\" --- not modified since last analyzed",
+												get_rel_name(leafrelid))));
+							else
+								changed = lappend_oid(changed, leafrelid);
+						}
+						oid_list = changed;
+					}
+
 					if (optimizer_analyze_midlevel_partition)
 					{
 						oid_list = list_concat(oid_list, all_interior_partition_relids(pn)); /* interior partitions */
@@ -15,6 +15,8 @@
 #include "postgres.h"
 
 #include "utils/snapmgr.h"
+#include "access/aocs_dictfilter.h"
+#include "access/appendonly_zonemap.h"
 #include "executor/executor.h"
 #include "nodes/execnodes.h"
 #include "cdb/cdbaocsam.h"
@@ -110,6 +112,13 @@ BeginScanAOCSRelation(ScanState *scanState)
 					   appendOnlyMetaDataSnapshot,
 					   NULL /* relationTupleDesc */,
 					   node->opaque->proj);
+	node->opaque->scandesc->zoneMap =
+		AppendOnlyZoneMap_BeginScan(node->ss.ss_currentRelation,
+									appendOnlyMetaDataSnapshot,
+									node->ss.ps.qual);
+	aocs_scan_set_dictfilter(node->opaque->scandesc,
+							 AOCSDictFilter_BeginScan(node->ss.ss_currentRelation,
+													  node->ss.ps.qual));
 
 	node->ss.scan_state = SCAN_SCAN;
 }
@@ -125,6 +134,11 @@ EndScanAOCSRelation(ScanState *scanState)
 	Assert(node->opaque != NULL &&
 		   node->opaque->scandesc != NULL);
 
+	/* Report the blocks the zone maps let us skip to EXPLAIN ANALYZE */
+	if (node->opaque->scandesc->zoneMap && node->ss.ps.instrument)
+		node->ss.ps.instrument->zoneMapBlocksSkipped +=
+			node->opaque->scandesc->zoneMap->blocksSkipped;
+
 	aocs_endscan(node->opaque->scandesc);
         
 	FreeAOCSScanOpaque(scanState);
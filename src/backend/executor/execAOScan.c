@@ -16,6 +16,7 @@
 
 #include "executor/executor.h"
 #include "nodes/execnodes.h"
+#include "access/appendonly_zonemap.h"
 #include "cdb/cdbappendonlyam.h"
 #include "utils/snapmgr.h"
 
@@ -76,6 +77,10 @@ BeginScanAppendOnlyRelation(ScanState *scanState)
 			node->ss.ps.state->es_snapshot, 
 			appendOnlyMetaDataSnapshot,
 			0, NULL);
+	node->aos_ScanDesc->zoneMap =
+		AppendOnlyZoneMap_BeginScan(node->ss.ss_currentRelation,
+									appendOnlyMetaDataSnapshot,
+									node->ss.ps.qual);
 	node->ss.scan_state = SCAN_SCAN;
 }
 
@@ -88,6 +93,12 @@ EndScanAppendOnlyRelation(ScanState *scanState)
 	Assert(node->aos_ScanDesc != NULL);
 
 	Assert((node->ss.scan_state & SCAN_SCAN) != 0);
+
+	/* Report the blocks the zone maps let us skip to EXPLAIN ANALYZE */
+	if (node->aos_ScanDesc->zoneMap && node->ss.ps.instrument)
+		node->ss.ps.instrument->zoneMapBlocksSkipped +=
+			node->aos_ScanDesc->zoneMap->blocksSkipped;
+
 	appendonly_endscan(node->aos_ScanDesc);
 
 	node->aos_ScanDesc = NULL;
@@ -0,0 +1,1067 @@
+/*-------------------------------------------------------------------------
+ *
+ * execExprProg.c
+ *	  Compile quals and projections into a flat program of opcodes, and
+ *	  run such programs.
+ *
+ * ExecEvalExpr() evaluates an expression by recursively calling the
+ * evalfunc of every ExprState in the tree.  For the simple expressions that
+ * make up most scan quals and projections (Vars, Consts, comparison
+ * operators, AND/OR/NOT, IS [NOT] NULL) most of that time is spent in the
+ * calls themselves.  Here we flatten such a tree into an array of steps,
+ * where every step writes its result directly into the place where its
+ * parent expects it (typically a FunctionCallInfo argument slot), and run
+ * the steps in a single loop.
+ *
+ * Any node we don't have an opcode for becomes an EPOP_EVAL_EXPRSTATE step,
+ * which evaluates the original ExprState subtree through ExecEvalExpr(), so
+ * compilation never fails.  Set-returning expressions are not compiled at
+ * all; callers keep using the ExprState path for those.
+ *
+ * Portions Copyright (c) 2012-Present Pivotal Software, Inc.
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/executor/execExprProg.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/tupdesc.h"
+#include "catalog/objectaccess.h"
+#include "executor/execExprProg.h"
+#include "executor/executor.h"
+#include "miscadmin.h"
+#include "nodes/nodeFuncs.h"
+#include "pgstat.h"
+#include "utils/acl.h"
+#include "utils/builtins.h"
+#include "utils/fmgroids.h"
+#include "utils/guc.h"
+#include "utils/lsyscache.h"
+#include "utils/memutils.h"
+
+/* Integer comparison functions that get an EPOP_CMP_VAR_CONST step */
+static const struct
+{
+	Oid			funcid;
+	int16		width;
+	ExprProgCmp cmp;
+}	int_cmp_funcs[] =
+{
+	{F_INT2EQ, 2, EPCMP_EQ},
+	{F_INT2NE, 2, EPCMP_NE},
+	{F_INT2LT, 2, EPCMP_LT},
+	{F_INT2LE, 2, EPCMP_LE},
+	{F_INT2GT, 2, EPCMP_GT},
+	{F_INT2GE, 2, EPCMP_GE},
+	{F_INT4EQ, 4, EPCMP_EQ},
+	{F_INT4NE, 4, EPCMP_NE},
+	{F_INT4LT, 4, EPCMP_LT},
+	{F_INT4LE, 4, EPCMP_LE},
+	{F_INT4GT, 4, EPCMP_GT},
+	{F_INT4GE, 4, EPCMP_GE},
+	{F_INT8EQ, 8, EPCMP_EQ},
+	{F_INT8NE, 8, EPCMP_NE},
+	{F_INT8LT, 8, EPCMP_LT},
+	{F_INT8LE, 8, EPCMP_LE},
+	{F_INT8GT, 8, EPCMP_GT},
+	{F_INT8GE, 8, EPCMP_GE},
+	/* date is an int32 day number */
+	{F_DATE_EQ, 4, EPCMP_EQ},
+	{F_DATE_NE, 4, EPCMP_NE},
+	{F_DATE_LT, 4, EPCMP_LT},
+	{F_DATE_LE, 4, EPCMP_LE},
+	{F_DATE_GT, 4, EPCMP_GT},
+	{F_DATE_GE, 4, EPCMP_GE},
+};
+
+static ExprProgram *makeExprProgram(List *source);
+static int	ExprProgAddStep(ExprProgram *prog, int *maxsteps,
+				ExprProgOpcode opcode, Datum *resvalue, bool *resnull);
+static void ExprProgCompile(ExprProgram *prog, int *maxsteps, ExprState *state,
+				Datum *resvalue, bool *resnull);
+static bool ExprProgCompileFunc(ExprProgram *prog, int *maxsteps,
+					FuncExprState *fstate, Oid funcid, Oid inputcollid,
+					Datum *resvalue, bool *resnull);
+static bool ExprProgCompileBool(ExprProgram *prog, int *maxsteps,
+					BoolExprState *bstate, Datum *resvalue, bool *resnull);
+static bool ExprProgCompileNullTest(ExprProgram *prog, int *maxsteps,
+						NullTestState *nstate, Datum *resvalue, bool *resnull);
+static bool ExprProgIsSimpleVar(ExprState *state);
+static int	ExprProgVarSlotOffset(Var *var);
+static void ExprProgValidate(ExprProgram *prog, ExprContext *econtext);
+static void ExprProgCheckVar(ExprContext *econtext, int slotoff, Var *var);
+static bool ExecInterpExprProgram(ExprProgram *prog, ExprContext *econtext,
+					  Datum *values, bool *isnull);
+
+/* Fetch the input slot at the given offset within an ExprContext */
+#define ExprProgSlot(econtext, slotoff) \
+	(*((TupleTableSlot **) (((char *) (econtext)) + (slotoff))))
+
+
+/* ----------------------------------------------------------------
+ *		ExecBuildQualProgram
+ *
+ * Compile an implicitly-ANDed list of qual ExprStates (as produced by
+ * ExecInitExpr) into an ExprProgram.  The program treats a NULL clause
+ * result as FALSE, like ExecQual(qual, econtext, false).
+ *
+ * Returns NULL if the qual is empty or programs are disabled.  The program
+ * is allocated in the same memory context as the qual list, so that it
+ * doesn't outlive the ExprStates it refers to.
+ * ----------------------------------------------------------------
+ */
+ExprProgram *
+ExecBuildQualProgram(List *qual)
+{
+	ExprProgram *prog;
+	MemoryContext oldcontext;
+	int			maxsteps;
+	ListCell   *lc;
+
+	if (!gp_enable_expression_program || qual == NIL)
+		return NULL;
+
+	oldcontext = MemoryContextSwitchTo(GetMemoryChunkContext(qual));
+
+	prog = makeExprProgram(qual);
+	maxsteps = prog->nsteps;
+	prog->nsteps = 0;
+
+	foreach(lc, qual)
+	{
+		ExprState  *clause = (ExprState *) lfirst(lc);
+
+		ExprProgCompile(prog, &maxsteps, clause,
+						&prog->resvalue, &prog->resnull);
+		ExprProgAddStep(prog, &maxsteps, EPOP_QUAL,
+						&prog->resvalue, &prog->resnull);
+	}
+	ExprProgAddStep(prog, &maxsteps, EPOP_DONE, NULL, NULL);
+
+	MemoryContextSwitchTo(oldcontext);
+
+	return prog;
+}
+
+/* ----------------------------------------------------------------
+ *		ExecBuildProjectionProgram
+ *
+ * Compile the generic (non-simple-Var) part of a projection, a list of
+ * GenericExprStates wrapping TargetEntries, into an ExprProgram.
+ *
+ * Returns NULL if the list is empty, programs are disabled, or any of the
+ * expressions can return a set; ExecTargetList() has to deal with those.
+ * ----------------------------------------------------------------
+ */
+ExprProgram *
+ExecBuildProjectionProgram(List *targetlist)
+{
+	ExprProgram *prog;
+	MemoryContext oldcontext;
+	int			maxsteps;
+	ListCell   *lc;
+
+	if (!gp_enable_expression_program || targetlist == NIL)
+		return NULL;
+
+	foreach(lc, targetlist)
+	{
+		GenericExprState *gstate = (GenericExprState *) lfirst(lc);
+
+		if (expression_returns_set((Node *) gstate->arg->expr))
+			return NULL;
+	}
+
+	oldcontext = MemoryContextSwitchTo(GetMemoryChunkContext(targetlist));
+
+	prog = makeExprProgram(targetlist);
+	maxsteps = prog->nsteps;
+	prog->nsteps = 0;
+
+	foreach(lc, targetlist)
+	{
+		GenericExprState *gstate = (GenericExprState *) lfirst(lc);
+		TargetEntry *tle = (TargetEntry *) gstate->xprstate.expr;
+		int			stepno;
+
+		ExprProgCompile(prog, &maxsteps, gstate->arg,
+						&prog->resvalue, &prog->resnull);
+		stepno = ExprProgAddStep(prog, &maxsteps, EPOP_ASSIGN,
+								 &prog->resvalue, &prog->resnull);
+		prog->steps[stepno].d.assign.resultnum = tle->resno - 1;
+	}
+	ExprProgAddStep(prog, &maxsteps, EPOP_DONE, NULL, NULL);
+
+	MemoryContextSwitchTo(oldcontext);
+
+	return prog;
+}
+
+/* ----------------------------------------------------------------
+ *		ExecQualProgram
+ *
+ * Run a program built by ExecBuildQualProgram.  Returns true iff none of
+ * the clauses is false or NULL.
+ * ----------------------------------------------------------------
+ */
+bool
+ExecQualProgram(ExprProgram *prog, ExprContext *econtext)
+{
+	MemoryContext oldcontext;
+	bool		result;
+
+	/* Run in short-lived per-tuple context, like ExecQual */
+	oldcontext = MemoryContextSwitchTo(econtext->ecxt_per_tuple_memory);
+
+	result = ExecInterpExprProgram(prog, econtext, NULL, NULL);
+
+	MemoryContextSwitchTo(oldcontext);
+
+	return result;
+}
+
+/* ----------------------------------------------------------------
+ *		ExecProjectProgram
+ *
+ * Run a program built by ExecBuildProjectionProgram, storing the results
+ * into the given values/isnull arrays.
+ * ----------------------------------------------------------------
+ */
+void
+ExecProjectProgram(ExprProgram *prog, ExprContext *econtext,
+				   Datum *values, bool *isnull)
+{
+	MemoryContext oldcontext;
+
+	oldcontext = MemoryContextSwitchTo(econtext->ecxt_per_tuple_memory);
+
+	(void) ExecInterpExprProgram(prog, econtext, values, isnull);
+
+	MemoryContextSwitchTo(oldcontext);
+}
+
+
+/* ----------------------------------------------------------------
+ *		Program construction
+ * ----------------------------------------------------------------
+ */
+
+static ExprProgram *
+makeExprProgram(List *source)
+{
+	ExprProgram *prog = (ExprProgram *) palloc0(sizeof(ExprProgram));
+
+	/* a reasonable guess; ExprProgAddStep enlarges the array as needed */
+	prog->nsteps = 4 * list_length(source) + 1;
+	prog->steps = (ExprProgStep *) palloc(prog->nsteps * sizeof(ExprProgStep));
+	prog->source = source;
+	prog->validated = false;
+
+	return prog;
+}
+
+/*
+ * Append a step to the program and return its index.  The steps array may
+ * be reallocated, so callers must not keep pointers to steps across calls.
+ */
+static int
+ExprProgAddStep(ExprProgram *prog, int *maxsteps, ExprProgOpcode opcode,
+				Datum *resvalue, bool *resnull)
+{
+	ExprProgStep *step;
+
+	if (prog->nsteps >= *maxsteps)
+	{
+		*maxsteps *= 2;
+		prog->steps = (ExprProgStep *)
+			repalloc(prog->steps, *maxsteps * sizeof(ExprProgStep));
+	}
+
+	step = &prog->steps[prog->nsteps];
+	memset(step, 0, sizeof(ExprProgStep));
+	step->opcode = opcode;
+	step->resvalue = resvalue;
+	step->resnull = resnull;
+
+	return prog->nsteps++;
+}
+
+/*
+ * Compile the expression 'state' so that its result ends up in
+ * *resvalue / *resnull.
+ */
+static void
+ExprProgCompile(ExprProgram *prog, int *maxsteps, ExprState *state,
+				Datum *resvalue, bool *resnull)
+{
+	Expr	   *expr = state->expr;
+	int			stepno;
+
+	/* Guard against stack overflow due to overly complex expressions */
+	check_stack_depth();
+
+	switch (nodeTag(expr))
+	{
+		case T_Var:
+			if (ExprProgIsSimpleVar(state))
+			{
+				Var		   *var = (Var *) expr;
+
+				stepno = ExprProgAddStep(prog, maxsteps, EPOP_VAR,
+										 resvalue, resnull);
+				prog->steps[stepno].d.var.slotoff = ExprProgVarSlotOffset(var);
+				prog->steps[stepno].d.var.attnum = var->varattno;
+				prog->steps[stepno].d.var.var = var;
+				return;
+			}
+			break;
+
+		case T_Const:
+			{
+				Const	   *con = (Const *) expr;
+
+				stepno = ExprProgAddStep(prog, maxsteps, EPOP_CONST,
+										 resvalue, resnull);
+				prog->steps[stepno].d.constval.value = con->constvalue;
+				prog->steps[stepno].d.constval.isnull = con->constisnull;
+				return;
+			}
+
+		case T_FuncExpr:
+			{
+				FuncExpr   *funcexpr = (FuncExpr *) expr;
+
+				if (!funcexpr->funcretset &&
+					ExprProgCompileFunc(prog, maxsteps, (FuncExprState *) state,
+										funcexpr->funcid, funcexpr->inputcollid,
+										resvalue, resnull))
+					return;
+			}
+			break;
+
+		case T_OpExpr:
+			{
+				OpExpr	   *opexpr = (OpExpr *) expr;
+
+				if (!opexpr->opretset && OidIsValid(opexpr->opfuncid) &&
+					ExprProgCompileFunc(prog, maxsteps, (FuncExprState *) state,
+										opexpr->opfuncid, opexpr->inputcollid,
+										resvalue, resnull))
+					return;
+			}
+			break;
+
+		case T_BoolExpr:
+			if (ExprProgCompileBool(prog, maxsteps, (BoolExprState *) state,
+									resvalue, resnull))
+				return;
+			break;
+
+		case T_NullTest:
+			if (ExprProgCompileNullTest(prog, maxsteps, (NullTestState *) state,
+										resvalue, resnull))
+				return;
+			break;
+
+		case T_RelabelType:
+			/* a RelabelType just passes through its argument's value */
+			ExprProgCompile(prog, maxsteps, ((GenericExprState *) state)->arg,
+							resvalue, resnull);
+			return;
+
+		default:
+			break;
+	}
+
+	/* No opcode for this node, evaluate it the old way */
+	stepno = ExprProgAddStep(prog, maxsteps, EPOP_EVAL_EXPRSTATE,
+							 resvalue, resnull);
+	prog->steps[stepno].d.fallback.state = state;
+}
+
+/*
+ * Compile a function or operator call.  Returns false if the call has to
+ * be evaluated through the fallback path instead.
+ *
+ * This does the same one-time work as init_fcache(), except for the
+ * permission check and the function-execute hook.  Those are done by an
+ * EPOP_FUNC_INIT step the first time the call is actually reached, like
+ * init_fcache() does them on the first evaluation, so that a function in a
+ * branch that is never evaluated doesn't raise an error.
+ */
+static bool
+ExprProgCompileFunc(ExprProgram *prog, int *maxsteps, FuncExprState *fstate,
+					Oid funcid, Oid inputcollid,
+					Datum *resvalue, bool *resnull)
+{
+	int			nargs = list_length(fstate->args);
+	FmgrInfo   *finfo;
+	FunctionCallInfo fcinfo;
+	ExprState  *varstate = NULL;
+	ExprState  *conststate = NULL;
+	int			varargno = -1;
+	ListCell   *lc;
+	int			stepno;
+	int			i;
+
+	if (nargs > FUNC_MAX_ARGS)
+		return false;
+
+	/* Is this "Var op Const" or "Const op Var", with a non-null Const? */
+	if (nargs == 2)
+	{
+		ExprState  *arg0 = (ExprState *) linitial(fstate->args);
+		ExprState  *arg1 = (ExprState *) lsecond(fstate->args);
+
+		if (ExprProgIsSimpleVar(arg0) && IsA(arg1->expr, Const) &&
+			!((Const *) arg1->expr)->constisnull)
+		{
+			varstate = arg0;
+			conststate = arg1;
+			varargno = 0;
+		}
+		else if (ExprProgIsSimpleVar(arg1) && IsA(arg0->expr, Const) &&
+				 !((Const *) arg0->expr)->constisnull)
+		{
+			varstate = arg1;
+			conststate = arg0;
+			varargno = 1;
+		}
+	}
+
+	/* Set up the function call, like init_fcache() does */
+	finfo = (FmgrInfo *) palloc0(sizeof(FmgrInfo));
+	fmgr_info(funcid, finfo);
+	fmgr_info_set_expr((Node *) fstate->xprstate.expr, finfo);
+
+	if (finfo->fn_retset)
+	{
+		pfree(finfo);
+		return false;
+	}
+
+	/* Check permission to call the function before evaluating arguments */
+	stepno = ExprProgAddStep(prog, maxsteps, EPOP_FUNC_INIT, NULL, NULL);
+	prog->steps[stepno].d.funcinit.funcid = funcid;
+
+	/*
+	 * Integer comparisons against a constant are done inline, without going
+	 * through the function manager at all.  All these functions are strict
+	 * and can't fail.
+	 */
+	if (varstate != NULL)
+	{
+		for (i = 0; i < lengthof(int_cmp_funcs); i++)
+		{
+			Var		   *var = (Var *) varstate->expr;
+			ExprProgCmp cmp;
+
+			if (int_cmp_funcs[i].funcid != funcid)
+				continue;
+
+			/* "Const op Var" is "Var commuted-op Const" */
+			cmp = int_cmp_funcs[i].cmp;
+			if (varargno == 1)
+			{
+				switch (cmp)
+				{
+					case EPCMP_LT:
+						cmp = EPCMP_GT;
+						break;
+					case EPCMP_LE:
+						cmp = EPCMP_GE;
+						break;
+					case EPCMP_GT:
+						cmp = EPCMP_LT;
+						break;
+					case EPCMP_GE:
+						cmp = EPCMP_LE;
+						break;
+					default:
+						break;
+				}
+			}
+
+			stepno = ExprProgAddStep(prog, maxsteps, EPOP_CMP_VAR_CONST,
+									 resvalue, resnull);
+			prog->steps[stepno].d.varconst.slotoff = ExprProgVarSlotOffset(var);
+			prog->steps[stepno].d.varconst.attnum = var->varattno;
+			prog->steps[stepno].d.varconst.var = var;
+			prog->steps[stepno].d.varconst.varargno = varargno;
+			prog->steps[stepno].d.varconst.constval =
+				((Const *) conststate->expr)->constvalue;
+			prog->steps[stepno].d.varconst.cmp = cmp;
+			prog->steps[stepno].d.varconst.width = int_cmp_funcs[i].width;
+
+			/* no function call needed after all */
+			pfree(finfo);
+			return true;
+		}
+	}
+
+	fcinfo = (FunctionCallInfo) palloc0(sizeof(FunctionCallInfoData));
+	InitFunctionCallInfoData(*fcinfo, finfo, nargs, inputcollid, NULL, NULL);
+
+	/* Usage tracking needs the generic path */
+	if (pgstat_track_functions <= finfo->fn_stats)
+	{
+		if (varstate != NULL && finfo->fn_strict)
+		{
+			Var		   *var = (Var *) varstate->expr;
+			int			constargno = 1 - varargno;
+
+			fcinfo->arg[constargno] = ((Const *) conststate->expr)->constvalue;
+			fcinfo->argnull[constargno] = false;
+
+			stepno = ExprProgAddStep(prog, maxsteps, EPOP_FUNC_VAR_CONST,
+									 resvalue, resnull);
+			prog->steps[stepno].d.varconst.slotoff = ExprProgVarSlotOffset(var);
+			prog->steps[stepno].d.varconst.attnum = var->varattno;
+			prog->steps[stepno].d.varconst.var = var;
+			prog->steps[stepno].d.varconst.varargno = varargno;
+			prog->steps[stepno].d.varconst.fcinfo = fcinfo;
+			return true;
+		}
+	}
+
+	/* Arguments are evaluated directly into the call's argument array */
+	i = 0;
+	foreach(lc, fstate->args)
+	{
+		ExprState  *argstate = (ExprState *) lfirst(lc);
+
+		ExprProgCompile(prog, maxsteps, argstate,
+						&fcinfo->arg[i], &fcinfo->argnull[i]);
+		i++;
+	}
+
+	if (pgstat_track_functions > finfo->fn_stats)
+		stepno = ExprProgAddStep(prog, maxsteps, EPOP_FUNC_FUSAGE,
+								 resvalue, resnull);
+	else if (finfo->fn_strict)
+		stepno = ExprProgAddStep(prog, maxsteps, EPOP_FUNC_STRICT,
+								 resvalue, resnull);
+	else
+		stepno = ExprProgAddStep(prog, maxsteps, EPOP_FUNC,
+								 resvalue, resnull);
+	prog->steps[stepno].d.func.finfo = finfo;
+	prog->steps[stepno].d.func.fcinfo = fcinfo;
+	prog->steps[stepno].d.func.nargs = nargs;
+
+	return true;
+}
+
+/*
+ * Compile AND, OR and NOT.
+ *
+ * For AND and OR, every argument is evaluated into the BoolExpr's own
+ * result location and followed by a STEP opcode that jumps past the DONE
+ * opcode as soon as the result is known.
+ */
+static bool
+ExprProgCompileBool(ExprProgram *prog, int *maxsteps, BoolExprState *bstate,
+					Datum *resvalue, bool *resnull)
+{
+	BoolExpr   *boolexpr = (BoolExpr *) bstate->xprstate.expr;
+	ExprProgOpcode stepop;
+	ExprProgOpcode doneop;
+	bool	   *anynull;
+	List	   *jumps = NIL;
+	ListCell   *lc;
+	int			stepno;
+
+	switch (boolexpr->boolop)
+	{
+		case AND_EXPR:
+			stepop = EPOP_BOOL_AND_STEP;
+			doneop = EPOP_BOOL_AND_DONE;
+			break;
+		case OR_EXPR:
+			stepop = EPOP_BOOL_OR_STEP;
+			doneop = EPOP_BOOL_OR_DONE;
+			break;
+		case NOT_EXPR:
+			ExprProgCompile(prog, maxsteps,
+							(ExprState *) linitial(bstate->args),
+							resvalue, resnull);
+			ExprProgAddStep(prog, maxsteps, EPOP_BOOL_NOT, resvalue, resnull);
+			return true;
+		default:
+			return false;
+	}
+
+	anynull = (bool *) palloc(sizeof(bool));
+
+	stepno = ExprProgAddStep(prog, maxsteps, EPOP_BOOL_INIT, resvalue, resnull);
+	prog->steps[stepno].d.boolexpr.anynull = anynull;
+
+	foreach(lc, bstate->args)
+	{
+		ExprState  *argstate = (ExprState *) lfirst(lc);
+
+		ExprProgCompile(prog, maxsteps, argstate, resvalue, resnull);
+		stepno = ExprProgAddStep(prog, maxsteps, stepop, resvalue, resnull);
+		prog->steps[stepno].d.boolexpr.anynull = anynull;
+		jumps = lappend_int(jumps, stepno);
+	}
+
+	stepno = ExprProgAddStep(prog, maxsteps, doneop, resvalue, resnull);
+	prog->steps[stepno].d.boolexpr.anynull = anynull;
+
+	/* now that we know where the end is, fix up the short-circuit jumps */
+	foreach(lc, jumps)
+		prog->steps[lfirst_int(lc)].d.boolexpr.jumpdone = prog->nsteps;
+	list_free(jumps);
+
+	return true;
+}
+
+/*
+ * Compile a scalar IS [NOT] NULL.  Row-valued tests go through the fallback.
+ */
+static bool
+ExprProgCompileNullTest(ExprProgram *prog, int *maxsteps, NullTestState *nstate,
+						Datum *resvalue, bool *resnull)
+{
+	NullTest   *ntest = (NullTest *) nstate->xprstate.expr;
+	ExprProgOpcode opcode;
+
+	if (ntest->argisrow)
+		return false;
+
+	switch (ntest->nulltesttype)
+	{
+		case IS_NULL:
+			opcode = EPOP_NULLTEST_ISNULL;
+			break;
+		case IS_NOT_NULL:
+			opcode = EPOP_NULLTEST_ISNOTNULL;
+			break;
+		default:
+			return false;
+	}
+
+	ExprProgCompile(prog, maxsteps, nstate->arg, resvalue, resnull);
+	ExprProgAddStep(prog, maxsteps, opcode, resvalue, resnull);
+
+	return true;
+}
+
+/*
+ * Is this the ExprState of a plain user-attribute Var?
+ */
+static bool
+ExprProgIsSimpleVar(ExprState *state)
+{
+	return state != NULL &&
+		IsA(state, ExprState) &&
+		IsA(state->expr, Var) &&
+		((Var *) state->expr)->varattno > 0;
+}
+
+/*
+ * Offset of the slot a Var refers to within ExprContext, as in
+ * ExecBuildProjectionInfo.
+ */
+static int
+ExprProgVarSlotOffset(Var *var)
+{
+	switch (var->varno)
+	{
+		case INNER_VAR:
+			return offsetof(ExprContext, ecxt_innertuple);
+		case OUTER_VAR:
+			return offsetof(ExprContext, ecxt_outertuple);
+		default:
+			/* INDEX_VAR is handled by default case */
+			return offsetof(ExprContext, ecxt_scantuple);
+	}
+}
+
+
+/* ----------------------------------------------------------------
+ *		Program execution
+ * ----------------------------------------------------------------
+ */
+
+/*
+ * Make the same one-time checks of the input slots that ExecEvalScalarVar
+ * makes the first time through.
+ */
+static void
+ExprProgValidate(ExprProgram *prog, ExprContext *econtext)
+{
+	int			i;
+
+	for (i = 0; i < prog->nsteps; i++)
+	{
+		ExprProgStep *op = &prog->steps[i];
+
+		switch (op->opcode)
+		{
+			case EPOP_VAR:
+				ExprProgCheckVar(econtext, op->d.var.slotoff, op->d.var.var);
+				break;
+			case EPOP_FUNC_VAR_CONST:
+			case EPOP_CMP_VAR_CONST:
+				ExprProgCheckVar(econtext, op->d.varconst.slotoff,
+								 op->d.varconst.var);
+				break;
+			default:
+				break;
+		}
+	}
+
+	prog->validated = true;
+}
+
+static void
+ExprProgCheckVar(ExprContext *econtext, int slotoff, Var *var)
+{
+	TupleTableSlot *slot = ExprProgSlot(econtext, slotoff);
+	TupleDesc	slot_tupdesc;
+	Form_pg_attribute attr;
+	AttrNumber	attnum = var->varattno;
+
+	if (slot == NULL)
+		return;
+
+	slot_tupdesc = slot->tts_tupleDescriptor;
+
+	if (attnum > slot_tupdesc->natts)		/* should never happen */
+		elog(ERROR, "attribute number %d exceeds number of columns %d",
+			 attnum, slot_tupdesc->natts);
+
+	attr = slot_tupdesc->attrs[attnum - 1];
+
+	/* can't check type if dropped, since atttypid is probably 0 */
+	if (!attr->attisdropped && var->vartype != attr->atttypid)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATATYPE_MISMATCH),
+				 errmsg("attribute %d has wrong type", attnum),
+				 errdetail("Table has type %s, but query expects %s.",
+						   format_type_be(attr->atttypid),
+						   format_type_be(var->vartype))));
+}
+
+/*
+ * The interpreter loop.
+ *
+ * Returns false if an EPOP_QUAL step found a false or NULL clause, true if
+ * the program ran to completion.  EPOP_ASSIGN steps store into values[] and
+ * isnull[], which may be NULL for qual programs.
+ */
+static bool
+ExecInterpExprProgram(ExprProgram *prog, ExprContext *econtext,
+					  Datum *values, bool *isnull)
+{
+	ExprProgStep *steps = prog->steps;
+	ExprProgStep *op;
+
+	if (!prog->validated)
+		ExprProgValidate(prog, econtext);
+
+	op = steps;
+	for (;;)
+	{
+		switch (op->opcode)
+		{
+			case EPOP_DONE:
+				return true;
+
+			case EPOP_VAR:
+				*op->resvalue = slot_getattr(ExprProgSlot(econtext, op->d.var.slotoff),
+											 op->d.var.attnum,
+											 op->resnull);
+				op++;
+				break;
+
+			case EPOP_CONST:
+				*op->resvalue = op->d.constval.value;
+				*op->resnull = op->d.constval.isnull;
+				op++;
+				break;
+
+			case EPOP_NOOP:
+				op++;
+				break;
+
+			case EPOP_FUNC_INIT:
+				{
+					AclResult	aclresult;
+
+					/* Check permission to call function, as init_fcache does */
+					aclresult = pg_proc_aclcheck(op->d.funcinit.funcid,
+												 GetUserId(), ACL_EXECUTE);
+					if (aclresult != ACLCHECK_OK)
+						aclcheck_error(aclresult, ACL_KIND_PROC,
+									   get_func_name(op->d.funcinit.funcid));
+					InvokeFunctionExecuteHook(op->d.funcinit.funcid);
+
+					/* done once, like the rest of init_fcache */
+					op->opcode = EPOP_NOOP;
+					op++;
+					break;
+				}
+
+			case EPOP_FUNC:
+				{
+					FunctionCallInfo fcinfo = op->d.func.fcinfo;
+
+					fcinfo->isnull = false;
+					*op->resvalue = FunctionCallInvoke(fcinfo);
+					*op->resnull = fcinfo->isnull;
+					op++;
+					break;
+				}
+
+			case EPOP_FUNC_STRICT:
+				{
+					FunctionCallInfo fcinfo = op->d.func.fcinfo;
+					int			i;
+
+					for (i = 0; i < op->d.func.nargs; i++)
+					{
+						if (fcinfo->argnull[i])
+							break;
+					}
+					if (i < op->d.func.nargs)
+					{
+						*op->resvalue = (Datum) 0;
+						*op->resnull = true;
+					}
+					else
+					{
+						fcinfo->isnull = false;
+						*op->resvalue = FunctionCallInvoke(fcinfo);
+						*op->resnull = fcinfo->isnull;
+					}
+					op++;
+					break;
+				}
+
+			case EPOP_FUNC_FUSAGE:
+				{
+					FunctionCallInfo fcinfo = op->d.func.fcinfo;
+					PgStat_FunctionCallUsage fcusage;
+					int			i;
+
+					if (op->d.func.finfo->fn_strict)
+					{
+						for (i = 0; i < op->d.func.nargs; i++)
+						{
+							if (fcinfo->argnull[i])
+								break;
+						}
+						if (i < op->d.func.nargs)
+						{
+							*op->resvalue = (Datum) 0;
+							*op->resnull = true;
+							op++;
+							break;
+						}
+					}
+
+					pgstat_init_function_usage(fcinfo, &fcusage);
+
+					fcinfo->isnull = false;
+					*op->resvalue = FunctionCallInvoke(fcinfo);
+					*op->resnull = fcinfo->isnull;
+
+					pgstat_end_function_usage(&fcusage, true);
+					op++;
+					break;
+				}
+
+			case EPOP_FUNC_VAR_CONST:
+				{
+					FunctionCallInfo fcinfo = op->d.varconst.fcinfo;
+					int			argno = op->d.varconst.varargno;
+					bool		varnull;
+
+					fcinfo->arg[argno] =
+						slot_getattr(ExprProgSlot(econtext, op->d.varconst.slotoff),
+									 op->d.varconst.attnum, &varnull);
+					if (varnull)
+					{
+						*op->resvalue = (Datum) 0;
+						*op->resnull = true;
+					}
+					else
+					{
+						fcinfo->isnull = false;
+						*op->resvalue = FunctionCallInvoke(fcinfo);
+						*op->resnull = fcinfo->isnull;
+					}
+					op++;
+					break;
+				}
+
+			case EPOP_CMP_VAR_CONST:
+				{
+					Datum		d;
+					bool		varnull;
+					int64		a;
+					int64		b;
+					bool		result;
+
+					d = slot_getattr(ExprProgSlot(econtext, op->d.varconst.slotoff),
+									 op->d.varconst.attnum, &varnull);
+					if (varnull)
+					{
+						*op->resvalue = (Datum) 0;
+						*op->resnull = true;
+						op++;
+						break;
+					}
+
+					switch (op->d.varconst.width)
+					{
+						case 2:
+							a = DatumGetInt16(d);
+							b = DatumGetInt16(op->d.varconst.constval);
+							break;
+						case 4:
+							a = DatumGetInt32(d);
+							b = DatumGetInt32(op->d.varconst.constval);
+							break;
+						default:
+							a = DatumGetInt64(d);
+							b = DatumGetInt64(op->d.varconst.constval);
+							break;
+					}
+
+					switch (op->d.varconst.cmp)
+					{
+						case EPCMP_EQ:
+							result = (a == b);
+							break;
+						case EPCMP_NE:
+							result = (a != b);
+							break;
+						case EPCMP_LT:
+							result = (a < b);
+							break;
+						case EPCMP_LE:
+							result = (a <= b);
+							break;
+						case EPCMP_GT:
+							result = (a > b);
+							break;
+						default:
+							result = (a >= b);
+							break;
+					}
+
+					*op->resvalue = BoolGetDatum(result);
+					*op->resnull = false;
+					op++;
+					break;
+				}
+
+			case EPOP_BOOL_INIT:
+				*op->d.boolexpr.anynull = false;
+				op++;
+				break;
+
+			case EPOP_BOOL_AND_STEP:
+				if (*op->resnull)
+					*op->d.boolexpr.anynull = true;
+				else if (!DatumGetBool(*op->resvalue))
+				{
+					/* a non-null false decides the AND */
+					op = &steps[op->d.boolexpr.jumpdone];
+					break;
+				}
+				op++;
+				break;
+
+			case EPOP_BOOL_AND_DONE:
+				/* all arguments were true or null */
+				if (*op->d.boolexpr.anynull)
+				{
+					*op->resvalue = (Datum) 0;
+					*op->resnull = true;
+				}
+				else
+				{
+					*op->resvalue = BoolGetDatum(true);
+					*op->resnull = false;
+				}
+				op++;
+				break;
+
+			case EPOP_BOOL_OR_STEP:
+				if (*op->resnull)
+					*op->d.boolexpr.anynull = true;
+				else if (DatumGetBool(*op->resvalue))
+				{
+					/* a non-null true decides the OR */
+					op = &steps[op->d.boolexpr.jumpdone];
+					break;
+				}
+				op++;
+				break;
+
+			case EPOP_BOOL_OR_DONE:
+				/* all arguments were false or null */
+				if (*op->d.boolexpr.anynull)
+				{
+					*op->resvalue = (Datum) 0;
+					*op->resnull = true;
+				}
+				else
+				{
+					*op->resvalue = BoolGetDatum(false);
+					*op->resnull = false;
+				}
+				op++;
+				break;
+
+			case EPOP_BOOL_NOT:
+				if (!*op->resnull)
+					*op->resvalue = BoolGetDatum(!DatumGetBool(*op->resvalue));
+				op++;
+				break;
+
+			case EPOP_NULLTEST_ISNULL:
+				*op->resvalue = BoolGetDatum(*op->resnull);
+				*op->resnull = false;
+				op++;
+				break;
+
+			case EPOP_NULLTEST_ISNOTNULL:
+				*op->resvalue = BoolGetDatum(!*op->resnull);
+				*op->resnull = false;
+				op++;
+				break;
+
+			case EPOP_QUAL:
+				if (*op->resnull || !DatumGetBool(*op->resvalue))
+					return false;
+				op++;
+				break;
+
+			case EPOP_ASSIGN:
+				Assert(values != NULL && isnull != NULL);
+				values[op->d.assign.resultnum] = *op->resvalue;
+				isnull[op->d.assign.resultnum] = *op->resnull;
+				op++;
+				break;
+
+			case EPOP_EVAL_EXPRSTATE:
+				*op->resvalue = ExecEvalExpr(op->d.fallback.state, econtext,
+											 op->resnull, NULL);
+				op++;
+				break;
+
+			default:
+				elog(ERROR, "unrecognized expression program opcode: %d",
+					 (int) op->opcode);
+				return false;	/* keep compiler quiet */
+		}
+	}
+}
@@ -49,6 +49,7 @@
 #include "cdb/cdbutil.h"
 #include "commands/typecmds.h"
 #include "executor/execdebug.h"
+#include "executor/execExprProg.h"
 #include "executor/nodeAgg.h"
 #include "executor/nodeSubplan.h"
 #include "funcapi.h"
@@ -6590,7 +6591,14 @@ ExecProject(ProjectionInfo *projInfo, ExprDoneCond *isDone)
 	 * we have reached the end of the set, we return the result slot, which we
 	 * already marked empty.
 	 */
-	if (projInfo->pi_targetlist)
+	if (projInfo->pi_program)
+	{
+		ExecProjectProgram(projInfo->pi_program,
+						   econtext,
+						   slot_get_values(slot),
+						   slot_get_isnull(slot));
+	}
+	else if (projInfo->pi_targetlist)
 	{
 		if (!ExecTargetList(projInfo->pi_targetlist,
 							econtext,
@@ -0,0 +1,381 @@
+/*-------------------------------------------------------------------------
+ *
+ * execResultCache.c
+ *	  Caches of the results of rescanned plans, on their parameter values.
+ *
+ * A correlated subplan (see nodeSubplan.c) or the inner side of a nested
+ * loop with parameters (see nodeNestloop.c) is rescanned for each row of its
+ * parent, but what it returns depends only on the values of its parameters.
+ * The results are cached on those values, and when they repeat, the result
+ * of the earlier scan is used instead of rescanning the plan.  The values
+ * are compared in binary, so that values that are equal but that the plan
+ * could tell apart, like 1.0 and 1.00, are not taken for one another.
+ *
+ * The entries are kept in least recently used order, and evicted when the
+ * cache would take more than work_mem.  The result of an entry is one memory
+ * chunk, allocated by the user of the cache in its memory context, and freed
+ * with the entry.
+ *
+ * Portions Copyright (c) 2012-Present Pivotal Software, Inc.
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/executor/execResultCache.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/hash.h"
+#include "cdb/cdbllize.h"
+#include "executor/execResultCache.h"
+#include "miscadmin.h"
+#include "nodes/nodeFuncs.h"
+#include "optimizer/clauses.h"
+#include "optimizer/walkers.h"
+#include "utils/datum.h"
+#include "utils/lsyscache.h"
+#include "utils/memutils.h"
+
+#define CACHE_KEY_SIZE(cache)	((cache)->nkeys * (sizeof(Datum) + sizeof(bool)))
+
+/* Cache the hash and match functions are working on */
+static ResultCache *CurResultCache = NULL;
+
+static void result_cache_evict(ResultCache *cache);
+static void result_cache_free_key(ResultCache *cache, Datum *key);
+static uint32 result_cache_hash(const void *key, Size keysize);
+static int	result_cache_match(const void *key1, const void *key2, Size keysize);
+static bool plan_volatile_walker(Node *node, plan_tree_base_prefix *base);
+static bool nested_subplan_volatile_walker(Node *node, plan_tree_base_prefix *base);
+
+/*
+ * ResultCache_Create: set up a result cache, in the current memory context.
+ *
+ * 'keytypes' are the OIDs of the types of the parameters, and 'entrysize'
+ * the size of the entries, at least sizeof(ResultCacheEntry).
+ */
+ResultCache *
+ResultCache_Create(const char *name, List *keytypes, Size entrysize)
+{
+	ResultCache *cache;
+	ListCell   *l;
+	int			i;
+
+	Assert(entrysize >= sizeof(ResultCacheEntry));
+
+	cache = (ResultCache *) palloc0(sizeof(ResultCache));
+
+	cache->entrysize = entrysize;
+	cache->nkeys = list_length(keytypes);
+	cache->keytyplen = (int16 *) palloc(cache->nkeys * sizeof(int16));
+	cache->keytypbyval = (bool *) palloc(cache->nkeys * sizeof(bool));
+	i = 0;
+	foreach(l, keytypes)
+	{
+		get_typlenbyval(lfirst_oid(l),
+						&cache->keytyplen[i], &cache->keytypbyval[i]);
+		i++;
+	}
+	cache->probe = (Datum *) palloc(CACHE_KEY_SIZE(cache));
+
+	cache->memlimit = work_mem * 1024L;
+	cache->cxt = AllocSetContextCreate(CurrentMemoryContext,
+									   name,
+									   ALLOCSET_DEFAULT_MINSIZE,
+									   ALLOCSET_DEFAULT_INITSIZE,
+									   ALLOCSET_DEFAULT_MAXSIZE);
+	ResultCache_Reset(cache);
+
+	return cache;
+}
+
+/*
+ * ResultCache_Reset: drop all the entries of a result cache.
+ */
+void
+ResultCache_Reset(ResultCache *cache)
+{
+	HASHCTL		ctl;
+
+	/* The hash table lives in a child context of its own */
+	MemoryContextResetAndDeleteChildren(cache->cxt);
+
+	MemSet(&ctl, 0, sizeof(ctl));
+	ctl.keysize = sizeof(Datum *);
+	ctl.entrysize = cache->entrysize;
+	ctl.hash = result_cache_hash;
+	ctl.match = result_cache_match;
+	ctl.hcxt = cache->cxt;
+	cache->table = hash_create("Result Cache", 256, &ctl,
+							   HASH_ELEM | HASH_FUNCTION | HASH_COMPARE | HASH_CONTEXT);
+
+	dlist_init(&cache->lru);
+	cache->memused = 0;
+}
+
+/*
+ * ResultCache_Destroy: free a result cache and all its entries.
+ */
+void
+ResultCache_Destroy(ResultCache *cache)
+{
+	MemoryContextDelete(cache->cxt);
+	pfree(cache->keytyplen);
+	pfree(cache->keytypbyval);
+	pfree(cache->probe);
+	pfree(cache);
+}
+
+/*
+ * ResultCache_Lookup: find the entry for the parameter values in
+ * cache->probe, or NULL.  Their hash value is returned in *hashvalue, for
+ * ResultCache_Insert().
+ */
+ResultCacheEntry *
+ResultCache_Lookup(ResultCache *cache, uint32 *hashvalue)
+{
+	ResultCacheEntry *entry;
+
+	CurResultCache = cache;
+	*hashvalue = get_hash_value(cache->table, &cache->probe);
+	entry = (ResultCacheEntry *) hash_search_with_hash_value(cache->table,
+															 &cache->probe,
+															 *hashvalue,
+															 HASH_FIND,
+															 NULL);
+	if (entry)
+		dlist_move_head(&cache->lru, &entry->lru_node);
+
+	return entry;
+}
+
+/*
+ * ResultCache_Insert: cache a result for the parameter values in
+ * cache->probe, evicting the least recently used entries to make room.
+ *
+ * 'value' is the memory chunk of the result, allocated in cache->cxt, or
+ * NULL if the result takes no memory of its own.  The cache takes it over.
+ * The caller sets the other fields of its result in the returned entry.
+ * NULL is returned, and 'value' freed, if the entry would take more than
+ * the whole cache.
+ */
+ResultCacheEntry *
+ResultCache_Insert(ResultCache *cache, uint32 hashvalue, void *value,
+				   Instrumentation *instr)
+{
+	MemoryContext oldcontext;
+	ResultCacheEntry *entry;
+	Datum	   *key;
+	bool	   *keyisnull;
+	bool	   *probeisnull = RESULT_CACHE_KEY_ISNULL(cache, cache->probe);
+	Size		size = cache->entrysize;
+	bool		found;
+	int			i;
+
+	if (value)
+		size += GetMemoryChunkSpace(value);
+
+	oldcontext = MemoryContextSwitchTo(cache->cxt);
+
+	key = (Datum *) palloc(CACHE_KEY_SIZE(cache));
+	keyisnull = RESULT_CACHE_KEY_ISNULL(cache, key);
+	size += GetMemoryChunkSpace(key);
+	for (i = 0; i < cache->nkeys; i++)
+	{
+		keyisnull[i] = probeisnull[i];
+		if (keyisnull[i])
+			key[i] = (Datum) 0;
+		else
+		{
+			key[i] = datumCopy(cache->probe[i],
+							   cache->keytypbyval[i], cache->keytyplen[i]);
+			if (!cache->keytypbyval[i])
+				size += GetMemoryChunkSpace(DatumGetPointer(key[i]));
+		}
+	}
+
+	MemoryContextSwitchTo(oldcontext);
+
+	/* An entry that does not fit in the whole cache is not kept */
+	if (size > cache->memlimit)
+	{
+		result_cache_free_key(cache, key);
+		if (value)
+			pfree(value);
+		return NULL;
+	}
+
+	while (cache->memused + size > cache->memlimit)
+	{
+		result_cache_evict(cache);
+		if (instr)
+			instr->resultCacheEvictions++;
+	}
+
+	CurResultCache = cache;
+	entry = (ResultCacheEntry *) hash_search_with_hash_value(cache->table,
+															 &key,
+															 hashvalue,
+															 HASH_ENTER,
+															 &found);
+	Assert(!found);
+	entry->value = value;
+	entry->size = size;
+	dlist_push_head(&cache->lru, &entry->lru_node);
+	cache->memused += size;
+
+	if (instr && cache->memused > instr->resultCacheMemUsed)
+		instr->resultCacheMemUsed = cache->memused;
+
+	return entry;
+}
+
+/*
+ * result_cache_evict: evict the least recently used entry.
+ */
+static void
+result_cache_evict(ResultCache *cache)
+{
+	ResultCacheEntry *entry;
+	Datum	   *key;
+
+	entry = dlist_tail_element(ResultCacheEntry, lru_node, &cache->lru);
+	key = entry->key;
+
+	dlist_delete(&entry->lru_node);
+	cache->memused -= entry->size;
+	if (entry->value)
+		pfree(entry->value);
+
+	CurResultCache = cache;
+	if (hash_search(cache->table, &key, HASH_REMOVE, NULL) == NULL)
+		elog(ERROR, "result cache is corrupted");
+
+	result_cache_free_key(cache, key);
+}
+
+static void
+result_cache_free_key(ResultCache *cache, Datum *key)
+{
+	bool	   *keyisnull = RESULT_CACHE_KEY_ISNULL(cache, key);
+	int			i;
+
+	for (i = 0; i < cache->nkeys; i++)
+	{
+		if (!keyisnull[i])
+			datumFree(key[i], cache->keytypbyval[i], cache->keytyplen[i]);
+	}
+	pfree(key);
+}
+
+/*
+ * result_cache_hash: hash function for the result cache.  The values are
+ * hashed in binary, to match result_cache_match().
+ */
+static uint32
+result_cache_hash(const void *key, Size keysize)
+{
+	Datum	   *values = *(Datum *const *) key;
+	bool	   *isnull = RESULT_CACHE_KEY_ISNULL(CurResultCache, values);
+	uint32		hashkey = 0;
+	int			i;
+
+	for (i = 0; i < CurResultCache->nkeys; i++)
+	{
+		/* rotate hashkey left 1 bit at each step */
+		hashkey = (hashkey << 1) | ((hashkey & 0x80000000) ? 1 : 0);
+
+		if (isnull[i])
+			continue;
+
+		if (CurResultCache->keytypbyval[i])
+			hashkey ^= DatumGetUInt32(hash_any((unsigned char *) &values[i],
+											   sizeof(Datum)));
+		else
+			hashkey ^= DatumGetUInt32(hash_any((unsigned char *) DatumGetPointer(values[i]),
+											   datumGetSize(values[i], false,
+															CurResultCache->keytyplen[i])));
+	}
+
+	return hashkey;
+}
+
+/*
+ * result_cache_match: comparison function for the result cache; returns 0
+ * if the keys have the same values, in binary.  NULLs match each other.
+ */
+static int
+result_cache_match(const void *key1, const void *key2, Size keysize)
+{
+	Datum	   *values1 = *(Datum *const *) key1;
+	Datum	   *values2 = *(Datum *const *) key2;
+	bool	   *isnull1 = RESULT_CACHE_KEY_ISNULL(CurResultCache, values1);
+	bool	   *isnull2 = RESULT_CACHE_KEY_ISNULL(CurResultCache, values2);
+	int			i;
+
+	for (i = 0; i < CurResultCache->nkeys; i++)
+	{
+		if (isnull1[i] != isnull2[i])
+			return 1;
+		if (!isnull1[i] &&
+			!datumIsEqual(values1[i], values2[i],
+						  CurResultCache->keytypbyval[i],
+						  CurResultCache->keytyplen[i]))
+			return 1;
+	}
+
+	return 0;
+}
+
+/*
+ * ResultCache_PlanIsVolatile: does a plan call volatile functions, in its own
+ * expressions or in those of the subplans nested in it?  A rescan of such a
+ * plan may return another result for the same parameter values, so it must
+ * not be cached.
+ */
+bool
+ResultCache_PlanIsVolatile(PlannedStmt *stmt, Plan *plan)
+{
+	plan_tree_base_prefix base;
+
+	base.node = (Node *) stmt;
+	return plan_volatile_walker((Node *) plan, &base);
+}
+
+/*
+ * contain_volatile_functions() does not look into the plans of SubPlans, so
+ * each expression is searched for them after it.
+ */
+static bool
+plan_volatile_walker(Node *node, plan_tree_base_prefix *base)
+{
+	if (node == NULL)
+		return false;
+
+	if (is_plan_node(node) || IsA(node, List) || IsA(node, IntList) ||
+		IsA(node, OidList) || IsA(node, Flow))
+		return plan_tree_walker(node, plan_volatile_walker, base);
+
+	if (contain_volatile_functions(node))
+		return true;
+
+	return nested_subplan_volatile_walker(node, base);
+}
+
+static bool
+nested_subplan_volatile_walker(Node *node, plan_tree_base_prefix *base)
+{
+	if (node == NULL)
+		return false;
+
+	if (IsA(node, SubPlan))
+	{
+		Plan	   *plan = plan_tree_base_subplan_get_plan(base, (SubPlan *) node);
+
+		if (plan_volatile_walker((Node *) plan, base))
+			return true;
+	}
+
+	return expression_tree_walker(node, nested_subplan_volatile_walker, base);
+}
@@ -16,6 +16,7 @@
  */
 #include "postgres.h"
 
+#include "executor/execExprProg.h"
 #include "executor/executor.h"
 #include "miscadmin.h"
 #include "utils/memutils.h"
@@ -152,6 +153,7 @@ ExecScan(ScanState *node,
 {
 	ExprContext *econtext;
 	List	   *qual;
+	ExprProgram *qualprog;
 	ProjectionInfo *projInfo;
 
 	/*
@@ -161,6 +163,11 @@ ExecScan(ScanState *node,
 	projInfo = node->ps.ps_ProjInfo;
 	econtext = node->ps.ps_ExprContext;
 
+	/* Use the compiled qual, if it's still the one for the current qual */
+	qualprog = node->ps.qualprog;
+	if (qualprog && qualprog->source != qual)
+		qualprog = NULL;
+
 	/*
 	 * If we have neither a qual to check nor a projection to do, just skip
 	 * all the overhead and return the raw scan tuple.
@@ -218,7 +225,9 @@ ExecScan(ScanState *node,
 		 * when the qual is nil ... saves only a few cycles, but they add up
 		 * ...
 		 */
-		if (!qual || ExecQual(qual, econtext, false))
+		if (!qual ||
+			(qualprog ? ExecQualProgram(qualprog, econtext) :
+			 ExecQual(qual, econtext, false)))
 		{
 			/*
 			 * Found a satisfactory scan tuple.
@@ -260,6 +269,9 @@ ExecScan(ScanState *node,
  * the scan node, because the planner will preferentially generate a matching
  * tlist.
  *
+ * This is also where we compile the scan's qual, which must have been
+ * initialized already, into an ExprProgram.
+ *
  * ExecAssignScanType must have been called already.
  */
 void
@@ -268,6 +280,8 @@ ExecAssignScanProjectionInfo(ScanState *node)
 	Scan	   *scan = (Scan *) node->ps.plan;
 	Index		varno;
 
+	node->ps.qualprog = ExecBuildQualProgram(node->ps.qual);
+
 	/* Vars in an index-only scan's tlist should be INDEX_VAR */
 	if (IsA(scan, IndexOnlyScan))
 		varno = INDEX_VAR;
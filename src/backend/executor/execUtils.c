@@ -51,6 +51,7 @@
 #include "access/transam.h"
 #include "catalog/index.h"
 #include "executor/execdebug.h"
+#include "executor/execExprProg.h"
 #include "executor/execUtils.h"
 #include "nodes/nodeFuncs.h"
 #include "parser/parsetree.h"
@@ -663,6 +664,9 @@ ExecBuildProjectionInfo(List *targetList,
 		projInfo->pi_itemIsDone = (ExprDoneCond *)
 			palloc(len * sizeof(ExprDoneCond));
 
+	/* Compile the generic expressions, if they don't return sets */
+	projInfo->pi_program = ExecBuildProjectionProgram(exprlist);
+
 	return projInfo;
 }
 
@@ -37,6 +37,7 @@ static uint64 temp_file_counter = 0;
 
 static void ExecWorkFile_SetFlags(ExecWorkFile *workfile, bool delOnClose, bool created);
 static void ExecWorkFile_AdjustBFZSize(ExecWorkFile *workfile, int64 file_size);
+static void ExecWorkFile_ReportBFZStats(ExecWorkFile *workfile);
 
 /*
  * ExecWorkFile_Create
@@ -452,6 +453,7 @@ ExecWorkFile_Close(ExecWorkFile *workfile)
 				ExecWorkFile_AdjustBFZSize(workfile, file_size);
 			}
 
+			ExecWorkFile_ReportBFZStats(workfile);
 			bfz_close(bfz_file);
 			break;
 		default:
@@ -561,6 +563,28 @@ ExecWorkFile_Seek(ExecWorkFile *workfile, uint64 offset, int whence)
 	return result;
 }
 
+/*
+ * ExecWorkFile_Prefetch
+ *   Initiate an asynchronous read of the given range of a random-access
+ *   work file, for callers that know which blocks they will need next.
+ *   The current position is unaffected.
+ */
+void
+ExecWorkFile_Prefetch(ExecWorkFile *workfile, uint64 offset, int amount)
+{
+	Assert(workfile != NULL);
+	Assert((workfile->flags & EXEC_WORKFILE_RANDOM_ACCESS) != 0);
+
+	switch(workfile->fileType)
+	{
+	case BUFFILE:
+		BufFilePrefetch((BufFile *) workfile->file, offset, amount);
+		break;
+	default:
+		insist_log(false, "invalid work file type: %d", workfile->fileType);
+	}
+}
+
 void
 ExecWorkFile_Flush(ExecWorkFile *workfile)
 {
@@ -755,4 +779,35 @@ ExecWorkFile_AdjustBFZSize(ExecWorkFile *workfile, int64 file_size)
 		}
 	}
 }
+/*
+ * Add the compression statistics of a bfz file that is being closed to its
+ * workfile set, and to the instrumentation of the spilling operator for
+ * EXPLAIN ANALYZE.
+ */
+static void
+ExecWorkFile_ReportBFZStats(ExecWorkFile *workfile)
+{
+	bfz_t *bfz_file = (bfz_t *) workfile->file;
+	workfile_set *work_set = workfile->work_set;
+	int64 codec_time_us = INSTR_TIME_GET_MICROSEC(bfz_file->codecTime);
+	Instrumentation *instr;
+
+	if (work_set == NULL)
+	{
+		return;
+	}
+
+	work_set->raw_size += bfz_file->rawBytes;
+	work_set->compressed_size += workfile->size;
+	work_set->codec_time_us += codec_time_us;
+
+	instr = workfile_mgr_get_instrument(work_set);
+	if (instr != NULL)
+	{
+		instr->workfileRawBytes += bfz_file->rawBytes;
+		instr->workfileDiskBytes += workfile->size;
+		instr->workfileCodecTime += INSTR_TIME_GET_DOUBLE(bfz_file->codecTime);
+	}
+}
+
 /* EOF */
@@ -27,6 +27,7 @@
  */
 #include "postgres.h"
 
+#include "access/appendonly_prefetch.h"
 #include "access/heapam.h"
 #include "cdb/cdbappendonlyam.h"
 #include "cdb/cdbaocsam.h"
@@ -37,6 +38,7 @@
 #include "nodes/tidbitmap.h"
 #include "parser/parsetree.h"
 #include "pgstat.h"
+#include "storage/bufmgr.h"
 #include "utils/memutils.h"
 #include "utils/snapmgr.h"
 
@@ -72,6 +74,14 @@ initFetchDesc(BitmapAppendOnlyScanState *scanstate)
 									  appendOnlyMetaDataSnapshot);
 			scanstate->baos_currentAOCSFetchDesc = NULL;
 			scanstate->baos_currentAOCSLossyFetchDesc = NULL;
+
+#ifdef USE_PREFETCH
+			if (target_prefetch_pages > 0)
+				scanstate->baos_prefetchDesc =
+					AppendOnlyPrefetch_Init(currentRelation,
+											appendOnlyMetaDataSnapshot,
+											NULL);
+#endif   /* USE_PREFETCH */
 		}
 	}
 	
@@ -126,6 +136,18 @@ initFetchDesc(BitmapAppendOnlyScanState *scanstate)
 			scanstate->baos_currentAOCSFetchDesc =
 				aocs_fetch_init(currentRelation, estate->es_snapshot, appendOnlyMetaDataSnapshot, proj);
 
+#ifdef USE_PREFETCH
+			/*
+			 * Prefetch the columns of the exact pages.  The extra columns of
+			 * the rechecks are left to be read on demand.
+			 */
+			if (target_prefetch_pages > 0)
+				scanstate->baos_prefetchDesc =
+					AppendOnlyPrefetch_Init(currentRelation,
+											appendOnlyMetaDataSnapshot,
+											proj);
+#endif   /* USE_PREFETCH */
+
 			for(colno = 0; colno < currentRelation->rd_att->natts; colno++)
 			{
 				if(projLossy[colno])
@@ -176,6 +198,12 @@ freeFetchDesc(BitmapAppendOnlyScanState *scanstate)
 		pfree(scanstate->baos_currentAOCSLossyFetchDesc);
 		scanstate->baos_currentAOCSLossyFetchDesc = NULL;
 	}
+
+	if (scanstate->baos_prefetchDesc != NULL)
+	{
+		AppendOnlyPrefetch_Finish(scanstate->baos_prefetchDesc);
+		scanstate->baos_prefetchDesc = NULL;
+	}
 }
 
 /*
@@ -191,8 +219,42 @@ freeBitmapState(BitmapAppendOnlyScanState *scanstate)
 		/* baos_tbmres is owned by the iterator and freed during end_iterate. */
 		scanstate->baos_tbmres = NULL;
 	}
+	if (scanstate->baos_prefetch_iterator)
+	{
+		tbm_generic_end_iterate(scanstate->baos_prefetch_iterator);
+		scanstate->baos_prefetch_iterator = NULL;
+	}
 }
 
+#ifdef USE_PREFETCH
+/*
+ * Issue the prefetches for the rows of a psuedo-heap-page, that the main
+ * iterator will return later.
+ */
+static void
+prefetchPage(BitmapAppendOnlyScanState *node, TBMIterateResult *tbmpre)
+{
+	ItemPointerData psudeoHeapTid;
+	AOTupleId	aoTid;
+	bool		lossy = (tbmpre->ntuples < 0);
+	int			ntuples;
+	int			i;
+
+	/* As in BitmapAppendOnlyScanNext, a lossy page covers 2^15 tuples */
+	ntuples = lossy ? INT16_MAX + 1 : tbmpre->ntuples;
+
+	for (i = 0; i < ntuples; i++)
+	{
+		ItemPointerSet(&psudeoHeapTid,
+					   tbmpre->blockno,
+					   lossy ? i : tbmpre->offsets[i]);
+		tbm_convert_appendonly_tid_out(&psudeoHeapTid, &aoTid);
+
+		AppendOnlyPrefetch_Row(node->baos_prefetchDesc, &aoTid);
+	}
+}
+#endif   /* USE_PREFETCH */
+
 /* ----------------------------------------------------------------
  *		BitmapAppendOnlyNext
  *
@@ -209,6 +271,7 @@ BitmapAppendOnlyScanNext(BitmapAppendOnlyScanState *node)
 	AOCSFetchDesc aocsLossyFetchDesc;
 	Index		scanrelid;
 	GenericBMIterator *iterator;
+	GenericBMIterator *prefetch_iterator;
 	OffsetNumber psuedoHeapOffset;
 	ItemPointerData psudeoHeapTid;
 	AOTupleId aoTid;
@@ -228,6 +291,7 @@ BitmapAppendOnlyScanNext(BitmapAppendOnlyScanState *node)
 	aocsLossyFetchDesc = node->baos_currentAOCSLossyFetchDesc;
 	scanrelid = ((BitmapAppendOnlyScan *) node->ss.ps.plan)->scan.scanrelid;
 	iterator = node->baos_iterator;
+	prefetch_iterator = node->baos_prefetch_iterator;
 
 	/*
 	 * If we haven't yet performed the underlying index scan, or
@@ -253,6 +317,23 @@ BitmapAppendOnlyScanNext(BitmapAppendOnlyScanState *node)
 		 * ownership here; just begin iteration.
 		 */
 		node->baos_iterator = iterator = tbm_generic_begin_iterate(tbm);
+
+#ifdef USE_PREFETCH
+		/*
+		 * As in a bitmap heap scan, a second iterator runs ahead of the main
+		 * one, by up to target_prefetch_pages psuedo-heap-pages, to hint the
+		 * blocks of the rows the main one will fetch.  For a stream bitmap
+		 * it also reads the bitmap index pages before the main iterator
+		 * needs them.
+		 */
+		if (node->baos_prefetchDesc != NULL)
+		{
+			node->baos_prefetch_iterator = prefetch_iterator =
+				tbm_generic_begin_iterate(tbm);
+			node->baos_prefetch_pages = 0;
+			node->baos_prefetch_target = -1;
+		}
+#endif   /* USE_PREFETCH */
 	}
 
 	Assert(iterator != NULL);
@@ -283,6 +364,22 @@ BitmapAppendOnlyScanNext(BitmapAppendOnlyScanState *node)
 
 			node->baos_tbmres = tbmres;
 
+#ifdef USE_PREFETCH
+			if (node->baos_prefetch_pages > 0)
+			{
+				/* The main iterator has closed the distance by one page */
+				node->baos_prefetch_pages--;
+			}
+			else if (prefetch_iterator)
+			{
+				/* Do not let the prefetch iterator get behind the main one */
+				TBMIterateResult *tbmpre = tbm_generic_iterate(prefetch_iterator);
+
+				if (tbmpre == NULL || tbmpre->blockno != tbmres->blockno)
+					elog(ERROR, "prefetch and main iterators are out of sync");
+			}
+#endif   /* USE_PREFETCH */
+
 			/* If tbmres contains no tuples, continue. */
 			if (tbmres->ntuples == 0)
 				continue;
@@ -308,6 +405,21 @@ BitmapAppendOnlyScanNext(BitmapAppendOnlyScanState *node)
 				/* Iterate over the first 2^15 tuples [MPP-24326] */
 				node->baos_ntuples = INT16_MAX + 1;
 			}
+
+#ifdef USE_PREFETCH
+			/*
+			 * Increase prefetch target if it's not yet at the max, like
+			 * BitmapHeapNext does.
+			 */
+			if (node->baos_prefetch_target >= target_prefetch_pages)
+				 /* don't increase any further */ ;
+			else if (node->baos_prefetch_target >= target_prefetch_pages / 2)
+				node->baos_prefetch_target = target_prefetch_pages;
+			else if (node->baos_prefetch_target > 0)
+				node->baos_prefetch_target *= 2;
+			else
+				node->baos_prefetch_target++;
+#endif   /* USE_PREFETCH */
 		}
 		else
 		{
@@ -316,6 +428,15 @@ BitmapAppendOnlyScanNext(BitmapAppendOnlyScanState *node)
 			 */
 			Assert(tbmres);
 			node->baos_cindex++;
+
+#ifdef USE_PREFETCH
+			/*
+			 * Try to prefetch at least a few pages even before we get to the
+			 * second page if we don't stop reading after the first tuple.
+			 */
+			if (node->baos_prefetch_target < target_prefetch_pages)
+				node->baos_prefetch_target++;
+#endif   /* USE_PREFETCH */
 		}
 
 		/*
@@ -327,6 +448,30 @@ BitmapAppendOnlyScanNext(BitmapAppendOnlyScanState *node)
 			continue;
 		}
 
+#ifdef USE_PREFETCH
+		/*
+		 * Issue the prefetches only once we know there is a tuple to fetch
+		 * from the current page, as BitmapHeapNext does.
+		 */
+		if (prefetch_iterator)
+		{
+			while (node->baos_prefetch_pages < node->baos_prefetch_target)
+			{
+				TBMIterateResult *tbmpre = tbm_generic_iterate(prefetch_iterator);
+
+				if (tbmpre == NULL)
+				{
+					/* No more pages to prefetch */
+					tbm_generic_end_iterate(prefetch_iterator);
+					node->baos_prefetch_iterator = prefetch_iterator = NULL;
+					break;
+				}
+				node->baos_prefetch_pages++;
+				prefetchPage(node, tbmpre);
+			}
+		}
+#endif   /* USE_PREFETCH */
+
 		if (node->baos_lossy || tbmres->recheck)
 			need_recheck = true;
 
@@ -552,6 +697,10 @@ ExecInitBitmapAppendOnlyScan(BitmapAppendOnlyScan *node, EState *estate, int efl
 	scanstate->baos_lossy = false;
 	scanstate->baos_cindex = 0;
 	scanstate->baos_ntuples = 0;
+	scanstate->baos_prefetch_iterator = NULL;
+	scanstate->baos_prefetch_pages = 0;
+	scanstate->baos_prefetch_target = 0;
+	scanstate->baos_prefetchDesc = NULL;
 
 	/*
 	 * Miscellaneous initialization
@@ -24,6 +24,7 @@
  */
 #include "postgres.h"
 
+#include "access/appendonly_indexonly.h"
 #include "access/relscan.h"
 #include "access/visibilitymap.h"
 #include "executor/execdebug.h"
@@ -80,6 +81,25 @@ IndexOnlyNext(IndexOnlyScanState *node)
 	{
 		HeapTuple	tuple = NULL;
 
+		/*
+		 * GPDB: An append-only table has no visibility map, but the
+		 * visibility of its rows can mostly be told without reading them, see
+		 * appendonly_indexonly.h.
+		 */
+		if (node->ioss_AOIndexOnlyDesc != NULL)
+		{
+			bool		visible;
+			bool		fetched;
+
+			visible = AppendOnlyIndexOnly_IsVisible(node->ioss_AOIndexOnlyDesc,
+													(AOTupleId *) tid,
+													&fetched);
+			if (fetched)
+				node->ioss_HeapFetches++;
+			if (!visible)
+				continue;		/* no visible row, try next index entry */
+		}
+
 		/*
 		 * We can skip the heap fetch if the TID references a heap page on
 		 * which all tuples are known visible to everybody.  In any case,
@@ -114,7 +134,8 @@ IndexOnlyNext(IndexOnlyScanState *node)
 		 * It's worth going through this complexity to avoid needing to lock
 		 * the VM buffer, which could cause significant contention.
 		 */
-		if (!visibilitymap_test(scandesc->heapRelation,
+		if (node->ioss_AOIndexOnlyDesc == NULL &&
+			!visibilitymap_test(scandesc->heapRelation,
 								ItemPointerGetBlockNumber(tid),
 								&node->ioss_VMBuffer))
 		{
@@ -172,7 +193,7 @@ IndexOnlyNext(IndexOnlyScanState *node)
 		 * anyway, then we already have the tuple-level lock and can skip the
 		 * page lock.
 		 */
-		if (tuple == NULL)
+		if (tuple == NULL && node->ioss_AOIndexOnlyDesc == NULL)
 			PredicateLockPage(scandesc->heapRelation,
 							  ItemPointerGetBlockNumber(tid),
 							  estate->es_snapshot);
@@ -309,6 +330,12 @@ ExecEndIndexOnlyScan(IndexOnlyScanState *node)
 	indexScanDesc = node->ioss_ScanDesc;
 	relation = node->ss.ss_currentRelation;
 
+	if (node->ioss_AOIndexOnlyDesc != NULL)
+	{
+		AppendOnlyIndexOnly_Finish(node->ioss_AOIndexOnlyDesc);
+		node->ioss_AOIndexOnlyDesc = NULL;
+	}
+
 	/* Release VM buffer pin, if any. */
 	if (node->ioss_VMBuffer != InvalidBuffer)
 	{
@@ -532,6 +559,10 @@ ExecInitIndexOnlyScan(IndexOnlyScan *node, EState *estate, int eflags)
 	indexstate->ioss_ScanDesc->xs_want_itup = true;
 	indexstate->ioss_VMBuffer = InvalidBuffer;
 
+	if (RelationIsAppendOptimized(currentRelation))
+		indexstate->ioss_AOIndexOnlyDesc =
+			AppendOnlyIndexOnly_Init(currentRelation, estate->es_snapshot);
+
 	/*
 	 * If no run-time keys to calculate, go ahead and pass the scankeys to the
 	 * index AM.
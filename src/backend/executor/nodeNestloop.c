@@ -23,12 +23,32 @@
 
 #include "postgres.h"
 
+#include "cdb/cdbvars.h"
 #include "executor/execdebug.h"
+#include "executor/execResultCache.h"
 #include "executor/nodeNestloop.h"
+#include "nodes/nodeFuncs.h"
 #include "utils/memutils.h"
 
+/*
+ * Entry of the result cache of the inner side of a nested loop (see
+ * execResultCache.c).  The inner tuples are the memtuples in the memory
+ * chunk of the entry, one after the other at MAXALIGN'd offsets.
+ */
+typedef struct NestLoopCacheEntry
+{
+	ResultCacheEntry rc;		/* must be first */
+	Size		len;			/* bytes of inner tuples in rc.value */
+} NestLoopCacheEntry;
+
 static void splitJoinQualExpr(NestLoopState *nlstate);
 static void extractFuncExprArgs(FuncExprState *fstate, List **lclauses, List **rclauses);
+static bool nestloop_cache_usable(NestLoop *node, NestLoopState *nlstate, int eflags);
+static void nestloop_cache_create(NestLoopState *nlstate);
+static void nestloop_cache_lookup(NestLoopState *node);
+static TupleTableSlot *nestloop_cache_next(NestLoopState *node);
+static void nestloop_cache_collect(NestLoopState *node, TupleTableSlot *slot);
+static void nestloop_cache_abandon(NestLoopState *node);
 
 /* ----------------------------------------------------------------
  *		ExecNestLoop(node)
@@ -72,6 +92,7 @@ ExecNestLoop(NestLoopState *node)
 	List	   *otherqual;
 	ExprContext *econtext;
 	ListCell   *lc;
+	int			i;
 
 	/*
 	 * get information from the node
@@ -202,7 +223,9 @@ ExecNestLoop(NestLoopState *node)
 			/*
 			 * fetch the values of any outer Vars that must be passed to the
 			 * inner scan, and store them in the appropriate PARAM_EXEC slots.
+			 * They are the key of the inner tuples in the result cache too.
 			 */
+			i = 0;
 			foreach(lc, nl->nestParams)
 			{
 				NestLoopParam *nlp = (NestLoopParam *) lfirst(lc);
@@ -220,13 +243,30 @@ ExecNestLoop(NestLoopState *node)
 				/* Flag parameter value as changed */
 				innerPlan->chgParam = bms_add_member(innerPlan->chgParam,
 													 paramno);
+
+				if (node->nl_innerCache)
+				{
+					ResultCache *cache = node->nl_innerCache;
+
+					cache->probe[i] = prm->value;
+					RESULT_CACHE_KEY_ISNULL(cache, cache->probe)[i] = prm->isnull;
+				}
+				i++;
 			}
 
+			/*
+			 * If the inner tuples of these parameter values are cached,
+			 * return them instead of rescanning the inner plan.
+			 */
+			if (node->nl_innerCache)
+				nestloop_cache_lookup(node);
+
 			/*
 			 * now rescan the inner plan
 			 */
 			ENL1_printf("rescanning inner plan");
-			if (node->require_inner_reset || node->reset_inner)
+			if (node->nl_cachedInner == NULL &&
+				(node->require_inner_reset || node->reset_inner))
 			{
 				ExecReScan(innerPlan);
 				node->reset_inner = false;
@@ -238,9 +278,16 @@ ExecNestLoop(NestLoopState *node)
 		 */
 		ENL1_printf("getting new inner tuple");
 
-		innerTupleSlot = ExecProcNode(innerPlan);
+		if (node->nl_cachedInner)
+			innerTupleSlot = nestloop_cache_next(node);
+		else
+		{
+			innerTupleSlot = ExecProcNode(innerPlan);
 
-		node->reset_inner = true;
+			node->reset_inner = true;
+			if (node->nl_collectInner)
+				nestloop_cache_collect(node, innerTupleSlot);
+		}
 		econtext->ecxt_innertuple = innerTupleSlot;
 
 		if (TupIsNull(innerTupleSlot))
@@ -515,6 +562,9 @@ ExecInitNestLoop(NestLoop *node, EState *estate, int eflags)
         nlstate->nl_qualResultForNull = false;
     }
 
+	if (gp_enable_nestloop_cache && nestloop_cache_usable(node, nlstate, eflags))
+		nestloop_cache_create(nlstate);
+
 	NL1_printf("ExecInitNestLoop: %s\n",
 			   "node initialized");
 
@@ -550,6 +600,12 @@ ExecEndNestLoop(NestLoopState *node)
 		ExecEndNode(outerPlanState(node));
 	ExecEndNode(innerPlanState(node));
 
+	if (node->nl_innerCache)
+	{
+		ResultCache_Destroy(node->nl_innerCache);
+		node->nl_innerCache = NULL;
+	}
+
 	NL1_printf("ExecEndNestLoop: %s\n",
 			   "node processing ended");
 
@@ -578,6 +634,18 @@ ExecReScanNestLoop(NestLoopState *node)
 	 * outer Vars are used as run-time keys...
 	 */
 
+	/*
+	 * The cached inner tuples stay valid, unless a parameter of an upper
+	 * query level, which the inner plan may depend on too, has changed.
+	 */
+	if (node->nl_innerCache)
+	{
+		nestloop_cache_abandon(node);
+		node->nl_cachedInner = NULL;
+		if (node->js.ps.chgParam != NULL)
+			ResultCache_Reset(node->nl_innerCache);
+	}
+
 	node->nl_NeedNewOuter = true;
 	node->nl_MatchedOuter = false;
 	node->nl_innerSideScanned = false;
@@ -663,3 +731,207 @@ extractFuncExprArgs(FuncExprState *fstate, List **lclauses, List **rclauses)
 	*lclauses = lappend(*lclauses, linitial(fstate->args));
 	*rclauses = lappend(*rclauses, lsecond(fstate->args));
 }
+
+
+/* ----------------------------------------------------------------
+ * nestloop_cache_usable
+ *
+ * Can the inner tuples of a nested loop be cached on the values of the
+ * parameters passed to its inner side?
+ * ----------------------------------------------------------------
+ */
+static bool
+nestloop_cache_usable(NestLoop *node, NestLoopState *nlstate, int eflags)
+{
+	EState	   *estate = nlstate->js.ps.state;
+
+	/* Only a parameterized inner side is rescanned for each outer tuple */
+	if (node->nestParams == NIL || node->singleton_outer)
+		return false;
+
+	/*
+	 * A prefetched inner side is read once and rewound, and the other join
+	 * types may stop reading the inner side before its end.
+	 */
+	if (nlstate->prefetch_inner ||
+		(node->join.jointype != JOIN_INNER && node->join.jointype != JOIN_LEFT))
+		return false;
+
+	if (eflags & EXEC_FLAG_EXPLAIN_ONLY)
+		return false;
+
+	if (estate->es_plannedstmt == NULL)
+		return false;
+
+	/* A scan calling volatile functions may return other tuples */
+	return !ResultCache_PlanIsVolatile(estate->es_plannedstmt, innerPlan(node));
+}
+
+/* ----------------------------------------------------------------
+ * nestloop_cache_create
+ *
+ * Set up the result cache of the inner side of a nested loop.
+ * ----------------------------------------------------------------
+ */
+static void
+nestloop_cache_create(NestLoopState *nlstate)
+{
+	NestLoop   *node = (NestLoop *) nlstate->js.ps.plan;
+	List	   *keytypes = NIL;
+	ListCell   *lc;
+
+	foreach(lc, node->nestParams)
+	{
+		NestLoopParam *nlp = (NestLoopParam *) lfirst(lc);
+
+		keytypes = lappend_oid(keytypes, exprType((Node *) nlp->paramval));
+	}
+
+	nlstate->nl_innerCache = ResultCache_Create("NestLoop Result Cache", keytypes,
+												sizeof(NestLoopCacheEntry));
+	list_free(keytypes);
+
+	nlstate->nl_cachedInnerSlot = ExecInitExtraTupleSlot(nlstate->js.ps.state);
+	ExecSetSlotDescriptor(nlstate->nl_cachedInnerSlot,
+						  ExecGetResultType(innerPlanState(nlstate)));
+}
+
+/* ----------------------------------------------------------------
+ * nestloop_cache_lookup
+ *
+ * Look up the inner tuples of the parameter values in the probe of the
+ * result cache, for a new outer tuple.  If they are cached, they are
+ * returned by nestloop_cache_next(); otherwise the tuples of the inner
+ * scan are collected, to be cached at its end.
+ * ----------------------------------------------------------------
+ */
+static void
+nestloop_cache_lookup(NestLoopState *node)
+{
+	ResultCache *cache = node->nl_innerCache;
+	Instrumentation *instr = node->js.ps.instrument;
+	NestLoopCacheEntry *entry;
+
+	/* The inner scan of the previous outer tuple may not have ended */
+	nestloop_cache_abandon(node);
+
+	entry = (NestLoopCacheEntry *) ResultCache_Lookup(cache,
+													  &node->nl_collectHash);
+	if (instr)
+	{
+		if (entry)
+			instr->resultCacheHits++;
+		else
+			instr->resultCacheMisses++;
+	}
+
+	node->nl_cachedInner = entry;
+	node->nl_cachedInnerPos = 0;
+	node->nl_collectInner = (entry == NULL);
+}
+
+/* ----------------------------------------------------------------
+ * nestloop_cache_next
+ *
+ * Return the next cached inner tuple of the current outer tuple, or NULL
+ * at their end.
+ * ----------------------------------------------------------------
+ */
+static TupleTableSlot *
+nestloop_cache_next(NestLoopState *node)
+{
+	NestLoopCacheEntry *entry = node->nl_cachedInner;
+	MemTuple	mtup;
+
+	if (node->nl_cachedInnerPos >= entry->len)
+		return NULL;
+
+	mtup = (MemTuple) ((char *) entry->rc.value + node->nl_cachedInnerPos);
+	node->nl_cachedInnerPos += MAXALIGN(memtuple_get_size(mtup));
+
+	return ExecStoreMinimalTuple(mtup, node->nl_cachedInnerSlot, false);
+}
+
+/* ----------------------------------------------------------------
+ * nestloop_cache_collect
+ *
+ * Collect a tuple of the inner scan; at its end (slot is NULL), cache the
+ * tuples collected.  The inner tuples of parameter values that would take
+ * more than the whole cache are not kept.
+ * ----------------------------------------------------------------
+ */
+static void
+nestloop_cache_collect(NestLoopState *node, TupleTableSlot *slot)
+{
+	ResultCache *cache = node->nl_innerCache;
+	NestLoopCacheEntry *entry;
+	char	   *value;
+	Size		collectedLen = node->nl_collectedLen;
+	uint32		len;
+
+	if (TupIsNull(slot))
+	{
+		value = node->nl_collected;
+		if (value)
+			value = repalloc(value, collectedLen);
+
+		/* The cache takes over the memory chunk */
+		node->nl_collected = NULL;
+		nestloop_cache_abandon(node);
+
+		entry = (NestLoopCacheEntry *) ResultCache_Insert(cache,
+														  node->nl_collectHash,
+														  value,
+														  node->js.ps.instrument);
+		if (entry)
+			entry->len = collectedLen;
+		return;
+	}
+
+	if (node->nl_collected == NULL)
+	{
+		node->nl_collectedAlloc = 1024;
+		node->nl_collected = MemoryContextAlloc(cache->cxt,
+												node->nl_collectedAlloc);
+	}
+
+	for (;;)
+	{
+		len = node->nl_collectedAlloc - collectedLen;
+		if (ExecCopySlotMemTupleTo(slot, NULL,
+								   node->nl_collected + collectedLen,
+								   &len) != NULL)
+			break;
+
+		/* Not enough room; len is the size of the tuple now */
+		if (collectedLen + MAXALIGN(len) > cache->memlimit)
+		{
+			nestloop_cache_abandon(node);
+			return;
+		}
+
+		node->nl_collectedAlloc = Max(node->nl_collectedAlloc * 2,
+									  collectedLen + MAXALIGN(len));
+		node->nl_collected = repalloc(node->nl_collected,
+									  node->nl_collectedAlloc);
+	}
+
+	node->nl_collectedLen = collectedLen + MAXALIGN(len);
+}
+
+/* ----------------------------------------------------------------
+ * nestloop_cache_abandon
+ *
+ * Stop collecting the tuples of the inner scan, and free them.
+ * ----------------------------------------------------------------
+ */
+static void
+nestloop_cache_abandon(NestLoopState *node)
+{
+	if (node->nl_collected)
+		pfree(node->nl_collected);
+	node->nl_collected = NULL;
+	node->nl_collectedLen = 0;
+	node->nl_collectedAlloc = 0;
+	node->nl_collectInner = false;
+}
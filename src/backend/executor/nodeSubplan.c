@@ -24,11 +24,15 @@
 #include <math.h>
 
 #include "access/htup_details.h"
+#include "catalog/pg_type.h"
 #include "executor/executor.h"
+#include "executor/execResultCache.h"
 #include "executor/nodeSubplan.h"
 #include "nodes/makefuncs.h"
+#include "nodes/nodeFuncs.h"
 #include "optimizer/clauses.h"
 #include "utils/array.h"
+#include "utils/datum.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
 #include "access/heapam.h"
@@ -59,6 +63,22 @@ static bool findPartialMatch(TupleHashTable hashtable, TupleTableSlot *slot,
 static bool slotAllNulls(TupleTableSlot *slot);
 static bool slotNoNulls(TupleTableSlot *slot);
 
+/*
+ * Entry of the result cache of a correlated subplan (see execResultCache.c).
+ * A result passed by reference is in the memory chunk of the entry.
+ */
+typedef struct SubPlanCacheEntry
+{
+	ResultCacheEntry rc;		/* must be first */
+	Datum		result;
+	bool		isnull;
+} SubPlanCacheEntry;
+
+static bool subplan_cache_usable(SubPlan *subplan, EState *estate);
+static void subplan_cache_create(SubPlanState *sstate);
+static void subplan_cache_insert(SubPlanState *sstate, uint32 hashvalue,
+					 Datum result, bool isnull);
+
 
 /* ----------------------------------------------------------------
  *		ExecSubPlan
@@ -238,6 +258,8 @@ ExecScanSubPlan(SubPlanState *node,
 	ListCell   *pvar;
 	ListCell   *l;
 	ArrayBuildState *astate = NULL;
+	ResultCache *cache = node->resultcache;
+	uint32		hashvalue = 0;
 
 	/*
 	 * We are probably in a short-lived expression-evaluation context. Switch
@@ -246,6 +268,13 @@ ExecScanSubPlan(SubPlanState *node,
 	 */
 	oldcontext = MemoryContextSwitchTo(econtext->ecxt_per_query_memory);
 
+	/*
+	 * If the results are cached, a change of a Param of an upper query level,
+	 * flagged in chgParam by the rescan of our parent, makes them stale.
+	 */
+	if (cache && planstate->chgParam != NULL)
+		ResultCache_Reset(cache);
+
 	/*
 	 * Set Params of this plan from parent plan correlation values. (Any
 	 * calculation we have to do is done in the parent econtext, since the
@@ -262,9 +291,47 @@ ExecScanSubPlan(SubPlanState *node,
 											   econtext,
 											   &(prm->isnull),
 											   NULL);
-		planstate->chgParam = bms_add_member(planstate->chgParam, paramid);
 	}
 
+	/*
+	 * If the result for these values is cached, there is no need to rescan
+	 * the subplan.
+	 */
+	if (cache)
+	{
+		SubPlanCacheEntry *entry;
+		int			i = 0;
+
+		foreach(l, subplan->parParam)
+		{
+			ParamExecData *prm = &(econtext->ecxt_param_exec_vals[lfirst_int(l)]);
+
+			cache->probe[i] = prm->value;
+			RESULT_CACHE_KEY_ISNULL(cache, cache->probe)[i] = prm->isnull;
+			i++;
+		}
+
+		entry = (SubPlanCacheEntry *) ResultCache_Lookup(cache, &hashvalue);
+
+		if (planstate->instrument)
+		{
+			if (entry)
+				planstate->instrument->resultCacheHits++;
+			else
+				planstate->instrument->resultCacheMisses++;
+		}
+
+		if (entry)
+		{
+			MemoryContextSwitchTo(oldcontext);
+			*isNull = entry->isnull;
+			return entry->result;
+		}
+	}
+
+	foreach(l, subplan->parParam)
+		planstate->chgParam = bms_add_member(planstate->chgParam, lfirst_int(l));
+
 	/*
 	 * Now that we've set up its parameters, we can reset the subplan.
 	 */
@@ -445,6 +512,9 @@ ExecScanSubPlan(SubPlanState *node,
 		}
 	}
 
+	if (cache)
+		subplan_cache_insert(node, hashvalue, result, *isNull);
+
 	return result;
 }
 
@@ -668,6 +738,104 @@ slotNoNulls(TupleTableSlot *slot)
 	return true;
 }
 
+/*
+ * subplan_cache_usable: can the results of the subplan be cached on the
+ * values of its parameters?
+ */
+static bool
+subplan_cache_usable(SubPlan *subplan, EState *estate)
+{
+	/* Only a correlated subplan is rescanned for each call */
+	if (subplan->parParam == NIL || subplan->useHashTable ||
+		subplan->is_initplan || subplan->setParam != NIL)
+		return false;
+
+	/*
+	 * The result of ANY, ALL and ROWCOMPARE sublinks depends on the lefthand
+	 * values too, which are not parameters of the subplan.
+	 */
+	if (subplan->subLinkType != EXISTS_SUBLINK &&
+		subplan->subLinkType != NOT_EXISTS_SUBLINK &&
+		subplan->subLinkType != EXPR_SUBLINK &&
+		subplan->subLinkType != ARRAY_SUBLINK)
+		return false;
+
+	if (estate->es_plannedstmt == NULL)
+		return false;
+
+	/* A scan calling volatile functions may return another result */
+	return !ResultCache_PlanIsVolatile(estate->es_plannedstmt,
+									   exec_subplan_get_plan(estate->es_plannedstmt,
+															 subplan));
+}
+
+/*
+ * subplan_cache_create: set up the result cache of a subplan.
+ */
+static void
+subplan_cache_create(SubPlanState *sstate)
+{
+	SubPlan    *subplan = (SubPlan *) sstate->xprstate.expr;
+	List	   *keytypes = NIL;
+	ListCell   *l;
+
+	foreach(l, subplan->args)
+		keytypes = lappend_oid(keytypes, exprType((Node *) lfirst(l)));
+
+	switch (subplan->subLinkType)
+	{
+		case EXPR_SUBLINK:
+			get_typlenbyval(subplan->firstColType,
+							&sstate->resultcache_typlen,
+							&sstate->resultcache_typbyval);
+			break;
+		case ARRAY_SUBLINK:
+			sstate->resultcache_typlen = -1;
+			sstate->resultcache_typbyval = false;
+			break;
+		default:
+			/* EXISTS and NOT EXISTS */
+			get_typlenbyval(BOOLOID,
+							&sstate->resultcache_typlen,
+							&sstate->resultcache_typbyval);
+			break;
+	}
+
+	sstate->resultcache = ResultCache_Create("SubPlan Result Cache", keytypes,
+											 sizeof(SubPlanCacheEntry));
+	list_free(keytypes);
+}
+
+/*
+ * subplan_cache_insert: cache the result for the parameter values in the
+ * probe of the result cache.
+ */
+static void
+subplan_cache_insert(SubPlanState *sstate, uint32 hashvalue,
+					 Datum result, bool isnull)
+{
+	ResultCache *cache = sstate->resultcache;
+	SubPlanCacheEntry *entry;
+	void	   *value = NULL;
+
+	if (!isnull && !sstate->resultcache_typbyval)
+	{
+		MemoryContext oldcontext = MemoryContextSwitchTo(cache->cxt);
+
+		value = DatumGetPointer(datumCopy(result, false,
+										  sstate->resultcache_typlen));
+		MemoryContextSwitchTo(oldcontext);
+	}
+
+	entry = (SubPlanCacheEntry *) ResultCache_Insert(cache, hashvalue, value,
+													 sstate->planstate->instrument);
+	if (entry)
+	{
+		entry->result = value ? PointerGetDatum(value) : result;
+		entry->isnull = isnull;
+	}
+}
+
 /* ----------------------------------------------------------------
  *		ExecInitSubPlan
  *
@@ -712,6 +880,7 @@ ExecInitSubPlan(SubPlan *subplan, PlanState *parent)
 	sstate->tab_eq_funcs = NULL;
 	sstate->lhs_hash_funcs = NULL;
 	sstate->cur_eq_funcs = NULL;
+	sstate->resultcache = NULL;
 
 	/*
 	 * If this plan is un-correlated or undirect correlated one and want to
@@ -914,6 +1083,13 @@ ExecInitSubPlan(SubPlan *subplan, PlanState *parent)
 													NULL);
 	}
 
+	/*
+	 * If the subplan is correlated, cache its results on the values of its
+	 * parameters, if enabled.
+	 */
+	if (gp_enable_subplan_cache && subplan_cache_usable(subplan, estate))
+		subplan_cache_create(sstate);
+
 	return sstate;
 }
 
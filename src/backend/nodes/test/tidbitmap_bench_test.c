@@ -0,0 +1,382 @@
+/*
+ * Micro-benchmark of the size of TIDBitmaps and of the time to OR and AND
+ * them, against the HRL-compressed words of bitmap indexes holding the same
+ * tids.  Not run by "make check"; run it with "make bench", and compare the
+ * numbers against a build of another version of tidbitmap.c.
+ *
+ * Each case ORs and ANDs two bitmaps, and extracts the tids of the result:
+ * with tbm_union and tbm_intersect, with a stream over the two bitmaps, as
+ * bitmap index scans combine their predicates, and with _bitmap_union over
+ * HRL batches.  There is no HRL intersection to compare with, bitmap index
+ * scans AND their pages in the streams.
+ */
+#include "postgres.h"
+
+#include "access/bitmap.h"
+#include "executor/instrument.h"
+#include "nodes/tidbitmap.h"
+#include "portability/instr_time.h"
+#include "utils/memutils.h"
+
+#define NUM_LOOPS	20
+
+/* A set of tids, as the positions of their bits in a bitmap index */
+typedef struct TidSet
+{
+	uint64	   *pos;
+	int			npos;
+} TidSet;
+
+static uint32 seed = 1;
+
+static uint32
+next_random(void)
+{
+	seed = seed * 1103515245 + 12345;
+	return (seed >> 8) & 0xFFFFFF;
+}
+
+static int
+pos_cmp(const void *a, const void *b)
+{
+	uint64		pa = *(const uint64 *) a;
+	uint64		pb = *(const uint64 *) b;
+
+	return (pa > pb) ? 1 : (pa < pb) ? -1 : 0;
+}
+
+/*
+ * Make a set of 'nruns' runs of 'runlen' tids at random offsets up to
+ * 'maxoff' on each of 'npages' pages.
+ */
+static TidSet *
+make_tids(int npages, int nruns, int runlen, int maxoff)
+{
+	TidSet	   *set = palloc(sizeof(TidSet));
+	int			page;
+	int			i;
+	int			k;
+	int			n = 0;
+
+	set->pos = palloc(sizeof(uint64) * npages * nruns * runlen);
+	for (page = 0; page < npages; page++)
+	{
+		for (i = 0; i < nruns; i++)
+		{
+			int			first = next_random() % (maxoff - runlen + 1) + 1;
+
+			for (k = 0; k < runlen; k++)
+				set->pos[n++] = (uint64) page * BM_MAX_TUPLES_PER_PAGE +
+					first + k - 1;
+		}
+	}
+
+	/* sort, and remove the duplicates */
+	qsort(set->pos, n, sizeof(uint64), pos_cmp);
+	set->npos = 0;
+	for (i = 0; i < n; i++)
+	{
+		if (set->npos == 0 || set->pos[set->npos - 1] != set->pos[i])
+			set->pos[set->npos++] = set->pos[i];
+	}
+
+	return set;
+}
+
+static TIDBitmap *
+make_tbm(TidSet *set)
+{
+	TIDBitmap  *tbm = tbm_create(1024 * 1024 * 1024L);
+	int			i;
+
+	for (i = 0; i < set->npos; i++)
+	{
+		ItemPointerData tid;
+
+		ItemPointerSet(&tid, set->pos[i] / BM_MAX_TUPLES_PER_PAGE,
+					   set->pos[i] % BM_MAX_TUPLES_PER_PAGE + 1);
+		tbm_add_tuples(tbm, &tid, 1, false);
+	}
+
+	return tbm;
+}
+
+static Size
+tbm_size(TIDBitmap *tbm)
+{
+	Instrumentation instr;
+
+	MemSet(&instr, 0, sizeof(instr));
+	tbm_generic_set_instrument((Node *) tbm, &instr);
+	tbm_generic_upd_instrument((Node *) tbm);
+	tbm_generic_set_instrument((Node *) tbm, NULL);
+
+	return instr.workmemused;
+}
+
+/*
+ * HRL-compress a set of tids into 'batch': runs of empty words become fill
+ * words of zeros, runs of full words fill words of ones.  The batch is
+ * padded to 'nbits' bits, as _bitmap_union stops at the end of the shortest
+ * of its batches.
+ */
+static void
+make_batch(BMBatchWords *batch, TidSet *set, uint64 nbits)
+{
+	uint64		nextword = 0;
+	int			i = 0;
+
+	batch->maxNumOfWords = 2 * set->npos + 2;
+	batch->hwords = palloc0(sizeof(BM_HRL_WORD) *
+							BM_CALC_H_WORDS(batch->maxNumOfWords));
+	batch->cwords = palloc0(sizeof(BM_HRL_WORD) * batch->maxNumOfWords);
+	batch->nwords = 0;
+
+	while (i < set->npos)
+	{
+		uint64		wordno = set->pos[i] / BM_HRL_WORD_SIZE;
+		BM_HRL_WORD word = 0;
+
+		if (wordno > nextword)
+		{
+			batch->hwords[batch->nwords / BM_HRL_WORD_SIZE] |=
+				WORDNO_GET_HEADER_BIT(batch->nwords);
+			batch->cwords[batch->nwords++] =
+				BM_MAKE_FILL_WORD(0, wordno - nextword);
+		}
+		for (; i < set->npos && set->pos[i] / BM_HRL_WORD_SIZE == wordno; i++)
+			word |= (BM_HRL_WORD) 1 << (set->pos[i] % BM_HRL_WORD_SIZE);
+
+		if (word != LITERAL_ALL_ONE)
+			batch->cwords[batch->nwords++] = word;
+		else if (batch->nwords > 0 && nextword == wordno &&
+				 IS_FILL_WORD(batch->hwords, batch->nwords - 1) &&
+				 GET_FILL_BIT(batch->cwords[batch->nwords - 1]) == 1)
+			batch->cwords[batch->nwords - 1]++;
+		else
+		{
+			batch->hwords[batch->nwords / BM_HRL_WORD_SIZE] |=
+				WORDNO_GET_HEADER_BIT(batch->nwords);
+			batch->cwords[batch->nwords++] = BM_MAKE_FILL_WORD(1, 1);
+		}
+		nextword = wordno + 1;
+	}
+
+	if (nbits / BM_HRL_WORD_SIZE > nextword)
+	{
+		batch->hwords[batch->nwords / BM_HRL_WORD_SIZE] |=
+			WORDNO_GET_HEADER_BIT(batch->nwords);
+		batch->cwords[batch->nwords++] =
+			BM_MAKE_FILL_WORD(0, nbits / BM_HRL_WORD_SIZE - nextword);
+	}
+}
+
+/*
+ * Make 'dst' a fresh copy of 'src', positioned at its start.  The union
+ * consumes the words of its input batches.
+ */
+static void
+reset_batch(BMBatchWords *dst, BMBatchWords *src)
+{
+	dst->maxNumOfWords = src->maxNumOfWords;
+	dst->nwords = src->nwords;
+	memcpy(dst->hwords, src->hwords,
+		   sizeof(BM_HRL_WORD) * BM_CALC_H_WORDS(src->maxNumOfWords));
+	memcpy(dst->cwords, src->cwords, sizeof(BM_HRL_WORD) * src->nwords);
+	dst->nwordsread = 0;
+	dst->nextread = 1;
+	dst->firstTid = 1;
+	dst->startNo = 0;
+}
+
+static uint64
+count_tids(Node *bm)
+{
+	GenericBMIterator *iterator = tbm_generic_begin_iterate(bm);
+	TBMIterateResult *result;
+	uint64		ntids = 0;
+
+	while ((result = tbm_generic_iterate(iterator)) != NULL)
+		ntids += result->ntuples;
+	tbm_generic_end_iterate(iterator);
+
+	return ntids;
+}
+
+/* OR or AND two TIDBitmaps, and extract the tids of the result */
+static uint64
+bench_tbm(TIDBitmap *a, TIDBitmap *b, bool isor, instr_time *time)
+{
+	TIDBitmap  *result = tbm_create(1024 * 1024 * 1024L);
+	instr_time	start;
+	instr_time	end;
+	uint64		ntids;
+
+	tbm_union(result, a);
+
+	INSTR_TIME_SET_CURRENT(start);
+	if (isor)
+		tbm_union(result, b);
+	else
+		tbm_intersect(result, b);
+	ntids = count_tids((Node *) result);
+	INSTR_TIME_SET_CURRENT(end);
+	INSTR_TIME_ACCUM_DIFF(*time, end, start);
+
+	tbm_free(result);
+
+	return ntids;
+}
+
+/* likewise, with a stream over the two TIDBitmaps */
+static uint64
+bench_stream(TIDBitmap *a, TIDBitmap *b, bool isor, instr_time *time)
+{
+	StreamBitmap *sbm = makeNode(StreamBitmap);
+	instr_time	start;
+	instr_time	end;
+	uint64		ntids;
+
+	INSTR_TIME_SET_CURRENT(start);
+	stream_add_node(sbm, tbm_create_stream_node(a), BMS_INDEX);
+	stream_add_node(sbm, tbm_create_stream_node(b), isor ? BMS_OR : BMS_AND);
+	ntids = count_tids((Node *) sbm);
+	INSTR_TIME_SET_CURRENT(end);
+	INSTR_TIME_ACCUM_DIFF(*time, end, start);
+
+	tbm_generic_free((Node *) sbm);
+
+	return ntids;
+}
+
+/* OR two HRL batches, and extract the tids of the result */
+static uint64
+bench_hrl(BMBatchWords **pristine, BMBatchWords **batches, instr_time *time)
+{
+	BMBatchWords result;
+	BMIterateResult *iter = palloc0(sizeof(BMIterateResult));
+	instr_time	start;
+	instr_time	end;
+	uint64		nextTid = 0;
+	uint64		ntids = 0;
+
+	result.maxNumOfWords = pristine[0]->maxNumOfWords +
+		pristine[1]->maxNumOfWords;
+	result.hwords = palloc0(sizeof(BM_HRL_WORD) *
+							BM_CALC_H_WORDS(result.maxNumOfWords));
+	result.cwords = palloc0(sizeof(BM_HRL_WORD) * result.maxNumOfWords);
+	reset_batch(batches[0], pristine[0]);
+	reset_batch(batches[1], pristine[1]);
+
+	INSTR_TIME_SET_CURRENT(start);
+	for (;;)
+	{
+		result.nwordsread = 0;
+		result.nextread = 1;
+		result.firstTid = nextTid;
+		_bitmap_reset_batchwords(&result);
+
+		_bitmap_union(batches, 2, &result);
+		if (result.nwords == 0)
+			break;
+
+		_bitmap_begin_iterate(&result, iter);
+		while (result.nwords > 0)
+		{
+			_bitmap_findnexttids(&result, iter, BM_BATCH_TIDS);
+			ntids += iter->numOfTids;
+		}
+		nextTid = iter->nextTid;
+	}
+	INSTR_TIME_SET_CURRENT(end);
+	INSTR_TIME_ACCUM_DIFF(*time, end, start);
+
+	pfree(result.hwords);
+	pfree(result.cwords);
+	pfree(iter);
+
+	return ntids;
+}
+
+static void
+bench_case(const char *name, int npages, int nruns, int runlen, int maxoff)
+{
+	TidSet	   *sets[2];
+	TIDBitmap  *tbms[2];
+	BMBatchWords *pristine[2];
+	BMBatchWords *batches[2];
+	instr_time	orTime;
+	instr_time	andTime;
+	instr_time	streamOrTime;
+	instr_time	streamAndTime;
+	instr_time	hrlOrTime;
+	uint64		nor = 0;
+	uint64		nand = 0;
+	uint64		nstreamor = 0;
+	uint64		nstreamand = 0;
+	uint64		nhrlor = 0;
+	int			loop;
+	int			i;
+
+	for (i = 0; i < 2; i++)
+	{
+		sets[i] = make_tids(npages, nruns, runlen, maxoff);
+		tbms[i] = make_tbm(sets[i]);
+
+		pristine[i] = palloc(sizeof(BMBatchWords));
+		make_batch(pristine[i], sets[i],
+				   (uint64) npages * BM_MAX_TUPLES_PER_PAGE);
+		batches[i] = palloc(sizeof(BMBatchWords));
+		batches[i]->hwords = palloc(sizeof(BM_HRL_WORD) *
+									BM_CALC_H_WORDS(pristine[i]->maxNumOfWords));
+		batches[i]->cwords = palloc(sizeof(BM_HRL_WORD) *
+									pristine[i]->maxNumOfWords);
+	}
+
+	INSTR_TIME_SET_ZERO(orTime);
+	INSTR_TIME_SET_ZERO(andTime);
+	INSTR_TIME_SET_ZERO(streamOrTime);
+	INSTR_TIME_SET_ZERO(streamAndTime);
+	INSTR_TIME_SET_ZERO(hrlOrTime);
+
+	for (loop = 0; loop < NUM_LOOPS; loop++)
+	{
+		nor = bench_tbm(tbms[0], tbms[1], true, &orTime);
+		nand = bench_tbm(tbms[0], tbms[1], false, &andTime);
+		nstreamor = bench_stream(tbms[0], tbms[1], true, &streamOrTime);
+		nstreamand = bench_stream(tbms[0], tbms[1], false, &streamAndTime);
+		nhrlor = bench_hrl(pristine, batches, &hrlOrTime);
+	}
+
+	printf("%s: %d tids\n", name, sets[0]->npos);
+	printf("  size   tidbitmap %8.1f kB  hrl %8.1f kB\n",
+		   tbm_size(tbms[0]) / 1024.0,
+		   (pristine[0]->nwords + BM_CALC_H_WORDS(pristine[0]->nwords)) *
+		   sizeof(BM_HRL_WORD) / 1024.0);
+	printf("  or     tidbitmap %8.1f ms  stream %8.1f ms  hrl %8.1f ms  (" UINT64_FORMAT " tids)\n",
+		   INSTR_TIME_GET_MILLISEC(orTime),
+		   INSTR_TIME_GET_MILLISEC(streamOrTime),
+		   INSTR_TIME_GET_MILLISEC(hrlOrTime), nor);
+	printf("  and    tidbitmap %8.1f ms  stream %8.1f ms                   (" UINT64_FORMAT " tids)\n",
+		   INSTR_TIME_GET_MILLISEC(andTime),
+		   INSTR_TIME_GET_MILLISEC(streamAndTime), nand);
+
+	if (nstreamor != nor || nhrlor != nor || nstreamand != nand)
+		printf("  MISMATCH: stream or " UINT64_FORMAT " and " UINT64_FORMAT
+			   ", hrl or " UINT64_FORMAT "\n", nstreamor, nstreamand, nhrlor);
+}
+
+int
+main(int argc, char *argv[])
+{
+	MemoryContextInit();
+
+	printf("each operation done %d times:\n", NUM_LOOPS);
+	bench_case("append-only, 1 row per segment page", 2000, 1, 1, 32768);
+	bench_case("append-only, 3 runs of 1000 rows per page", 2000, 3, 1000, 32768);
+	bench_case("append-only, 2% of the rows", 100, 655, 1, 32768);
+	bench_case("heap, 10% of 100 rows per page", 20000, 10, 1, 100);
+	bench_case("heap, full pages of 100 rows", 20000, 1, 100, 100);
+
+	return 0;
+}
@@ -0,0 +1,505 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include "cmockery.h"
+
+#include "postgres.h"
+#include "utils/memutils.h"
+
+#include "../tidbitmap.c"
+
+#define TEST_PAGES		64
+#define TEST_OFFSETS	2048
+
+/* the tuples expected in a bitmap, by page and offset */
+typedef bool ExpectedTids[TEST_PAGES][TEST_OFFSETS + 1];
+
+static uint32 seed = 1;
+
+static uint32
+next_random(void)
+{
+	seed = seed * 1103515245 + 12345;
+	return (seed >> 8) & 0xFFFFFF;
+}
+
+/*
+ * Add 'nruns' runs of 'runlen' consecutive tuples with offsets up to 'maxoff'
+ * to each of the first 'npages' pages of 'tbm', remembering them in
+ * 'expected'.
+ */
+static void
+add_random_runs(TIDBitmap *tbm, ExpectedTids expected, int npages,
+				int nruns, int runlen, int maxoff)
+{
+	int			page;
+	int			i;
+	int			k;
+
+	for (page = 0; page < npages; page++)
+	{
+		for (i = 0; i < nruns; i++)
+		{
+			OffsetNumber first = next_random() % (maxoff - runlen + 1) + 1;
+
+			for (k = 0; k < runlen; k++)
+			{
+				ItemPointerData tid;
+
+				ItemPointerSet(&tid, page, first + k);
+				tbm_add_tuples(tbm, &tid, 1, false);
+				expected[page][first + k] = true;
+			}
+		}
+	}
+}
+
+/*
+ * Add 'ntids' tuples with offsets up to 'maxoff' to each of the first
+ * 'npages' pages of 'tbm', remembering them in 'expected'.
+ */
+static void
+add_random_tids(TIDBitmap *tbm, ExpectedTids expected, int npages,
+				int ntids, int maxoff)
+{
+	add_random_runs(tbm, expected, npages, ntids, 1, maxoff);
+}
+
+/*
+ * Check that iterating over 'tbm' returns exactly the tuples in 'expected'.
+ */
+static void
+check_tids(TIDBitmap *tbm, ExpectedTids expected)
+{
+	TBMIterator *iterator = tbm_begin_iterate(tbm);
+	TBMIterateResult *result;
+	int			page;
+	int			off;
+	int			i;
+	int			nexpected = 0;
+	int			nfound = 0;
+
+	for (page = 0; page < TEST_PAGES; page++)
+		for (off = 1; off <= TEST_OFFSETS; off++)
+			nexpected += expected[page][off] ? 1 : 0;
+
+	while ((result = tbm_iterate(iterator)) != NULL)
+	{
+		assert_true(result->ntuples > 0);
+		assert_true(result->blockno < TEST_PAGES);
+		for (i = 0; i < result->ntuples; i++)
+		{
+			if (i > 0)
+				assert_true(result->offsets[i - 1] < result->offsets[i]);
+			assert_true(expected[result->blockno][result->offsets[i]]);
+			nfound++;
+		}
+	}
+	assert_int_equal(nfound, nexpected);
+
+	tbm_end_iterate(iterator);
+}
+
+/*
+ * Sparse pages are kept as arrays inside the entries, dense ones as bitmaps
+ * that are only as long as needed, full ones as runs.
+ */
+void
+test__tbm_add_tuples_containers(void **state)
+{
+	TIDBitmap  *tbm = tbm_create(4 * 1024 * 1024L);
+	ItemPointerData tid;
+	const TBMPage *page;
+	ExpectedTids *expected;
+	int			off;
+
+	/* a few tuples, out of order */
+	ItemPointerSet(&tid, 1, 30000);
+	tbm_add_tuples(tbm, &tid, 1, false);
+	ItemPointerSet(&tid, 1, 7);
+	tbm_add_tuples(tbm, &tid, 1, false);
+	ItemPointerSet(&tid, 1, 7);
+	tbm_add_tuples(tbm, &tid, 1, false);
+
+	page = tbm_find_pageentry(tbm, 1);
+	assert_int_equal(page->container, TBM_ARRAY);
+	assert_int_equal(page->noffsets, 2);
+	assert_int_equal(TBM_PAGE_OFFSETS(page)[0], 7);
+	assert_int_equal(TBM_PAGE_OFFSETS(page)[1], 30000);
+	assert_int_equal(tbm->containerbytes, 0);
+
+	/* every third tuple of a heap page makes a bitmap of 5 words */
+	for (off = 1; off <= 291; off += 3)
+	{
+		ItemPointerSet(&tid, 2, off);
+		tbm_add_tuples(tbm, &tid, 1, false);
+	}
+	page = tbm_find_pageentry(tbm, 2);
+	assert_int_equal(page->container, TBM_BITMAP);
+	assert_int_equal(page->nwords, 5);
+
+	/* and the whole page a single run */
+	for (off = 1; off <= 291; off++)
+	{
+		ItemPointerSet(&tid, 3, off);
+		tbm_add_tuples(tbm, &tid, 1, false);
+	}
+	page = tbm_find_pageentry(tbm, 3);
+	assert_int_equal(page->container, TBM_RUN);
+	assert_int_equal(page->nruns, 1);
+
+	tbm_free(tbm);
+
+	/* and iteration returns them all, also from a bitmap */
+	expected = palloc0(sizeof(ExpectedTids));
+	tbm = tbm_create(4 * 1024 * 1024L);
+	add_random_tids(tbm, *expected, 4, 500, TEST_OFFSETS);
+	check_tids(tbm, *expected);
+	tbm_free(tbm);
+
+	pfree(expected);
+}
+
+/*
+ * Pages whose tuples come in a few runs are kept as runs, whatever the
+ * order the tuples are added in, and as bitmaps once the runs get many.
+ */
+void
+test__tbm_run_containers(void **state)
+{
+	TIDBitmap  *tbm = tbm_create(4 * 1024 * 1024L);
+	ExpectedTids *expected = palloc0(sizeof(ExpectedTids));
+	ItemPointerData tid;
+	const TBMPage *page;
+	int			off;
+
+	/* a pseudo-page of an append-only table whose rows all match */
+	for (off = 1; off <= 32768; off++)
+	{
+		ItemPointerSet(&tid, 1, off);
+		tbm_add_tuples(tbm, &tid, 1, false);
+	}
+	page = tbm_find_pageentry(tbm, 1);
+	assert_int_equal(page->container, TBM_RUN);
+	assert_int_equal(page->nruns, 1);
+	assert_int_equal(TBM_PAGE_RUNS(page)[0].first, 1);
+	assert_int_equal(TBM_PAGE_RUNS(page)[0].last, 32768);
+	assert_int_equal(tbm->containerbytes, 0);
+
+	/* runs added out of order, then joined */
+	for (off = 1000; off <= 2000; off++)
+	{
+		ItemPointerSet(&tid, 2, off);
+		tbm_add_tuples(tbm, &tid, 1, false);
+	}
+	for (off = 3000; off >= 2002; off--)
+	{
+		ItemPointerSet(&tid, 2, off);
+		tbm_add_tuples(tbm, &tid, 1, false);
+	}
+	page = tbm_find_pageentry(tbm, 2);
+	assert_int_equal(page->container, TBM_RUN);
+	assert_int_equal(page->nruns, 2);
+	ItemPointerSet(&tid, 2, 2001);
+	tbm_add_tuples(tbm, &tid, 1, false);
+	assert_int_equal(page->nruns, 1);
+	assert_int_equal(TBM_PAGE_RUNS(page)[0].first, 1000);
+	assert_int_equal(TBM_PAGE_RUNS(page)[0].last, 3000);
+
+	/* every other tuple makes too many runs */
+	for (off = 1; off <= 2000; off += 2)
+	{
+		ItemPointerSet(&tid, 2, off);
+		tbm_add_tuples(tbm, &tid, 1, false);
+	}
+	assert_int_equal(page->container, TBM_BITMAP);
+	assert_int_equal(page->nwords, 47);
+	tbm_free(tbm);
+
+	/* and iteration returns them all */
+	tbm = tbm_create(4 * 1024 * 1024L);
+	add_random_runs(tbm, *expected, TEST_PAGES, 4, 300, TEST_OFFSETS);
+	check_tids(tbm, *expected);
+	tbm_free(tbm);
+
+	pfree(expected);
+}
+
+/*
+ * Many pages with one tuple each fit in a small bitmap without going lossy.
+ */
+void
+test__tbm_sparse_pages_stay_exact(void **state)
+{
+	TIDBitmap  *tbm = tbm_create(1024 * 1024L);
+	BlockNumber blk;
+	TBMIterator *iterator;
+	TBMIterateResult *result;
+	int			npages = 0;
+
+	for (blk = 0; blk < 10000; blk++)
+	{
+		ItemPointerData tid;
+
+		ItemPointerSet(&tid, blk, (blk % 32768) + 1);
+		tbm_add_tuples(tbm, &tid, 1, false);
+	}
+	assert_int_equal(tbm->nchunks, 0);
+	assert_int_equal(tbm->npages, 10000);
+	assert_true(TBM_NBYTES(tbm) <= tbm->maxbytes);
+
+	iterator = tbm_begin_iterate(tbm);
+	while ((result = tbm_iterate(iterator)) != NULL)
+	{
+		assert_int_equal(result->blockno, npages);
+		assert_int_equal(result->ntuples, 1);
+		assert_int_equal(result->offsets[0], (npages % 32768) + 1);
+		npages++;
+	}
+	assert_int_equal(npages, 10000);
+	tbm_end_iterate(iterator);
+
+	tbm_free(tbm);
+}
+
+/*
+ * Union and intersection give the same results for every pair of containers.
+ */
+void
+test__tbm_union_intersect(void **state)
+{
+	/* how the pages of each bitmap are filled, from arrays to bitmaps */
+	static const struct
+	{
+		int			nruns;
+		int			runlen;
+	}			fills[] = {{1, 1}, {10, 1}, {100, 1}, {1500, 1}, {4, 300}, {12, 40}};
+	ExpectedTids *expected_a = palloc(sizeof(ExpectedTids));
+	ExpectedTids *expected_b = palloc(sizeof(ExpectedTids));
+	ExpectedTids *expected = palloc(sizeof(ExpectedTids));
+	int			i;
+	int			j;
+	int			page;
+	int			off;
+
+	for (i = 0; i < lengthof(fills); i++)
+	{
+		for (j = 0; j < lengthof(fills); j++)
+		{
+			TIDBitmap  *a;
+			TIDBitmap  *b;
+
+			/* union */
+			MemSet(expected_a, 0, sizeof(ExpectedTids));
+			MemSet(expected_b, 0, sizeof(ExpectedTids));
+			a = tbm_create(4 * 1024 * 1024L);
+			b = tbm_create(4 * 1024 * 1024L);
+			add_random_runs(a, *expected_a, TEST_PAGES, fills[i].nruns,
+							fills[i].runlen, TEST_OFFSETS);
+			add_random_runs(b, *expected_b, TEST_PAGES / 2, fills[j].nruns,
+							fills[j].runlen, TEST_OFFSETS);
+			for (page = 0; page < TEST_PAGES; page++)
+				for (off = 1; off <= TEST_OFFSETS; off++)
+					(*expected)[page][off] = (*expected_a)[page][off] ||
+						(*expected_b)[page][off];
+			tbm_union(a, b);
+			check_tids(a, *expected);
+
+			/* intersection */
+			tbm_free(a);
+			MemSet(expected_a, 0, sizeof(ExpectedTids));
+			a = tbm_create(4 * 1024 * 1024L);
+			add_random_runs(a, *expected_a, TEST_PAGES, fills[i].nruns,
+							fills[i].runlen, TEST_OFFSETS);
+			for (page = 0; page < TEST_PAGES; page++)
+				for (off = 1; off <= TEST_OFFSETS; off++)
+					(*expected)[page][off] = (*expected_a)[page][off] &&
+						(*expected_b)[page][off];
+			tbm_intersect(a, b);
+			check_tids(a, *expected);
+
+			tbm_free(a);
+			tbm_free(b);
+		}
+	}
+
+	pfree(expected_a);
+	pfree(expected_b);
+	pfree(expected);
+}
+
+/*
+ * A bitmap over its memory limit still turns pages lossy, and gives their
+ * memory back.
+ */
+void
+test__tbm_lossify(void **state)
+{
+	TIDBitmap  *tbm = tbm_create(64 * 1024L);
+	BlockNumber blk;
+	OffsetNumber off;
+	TBMIterator *iterator;
+	TBMIterateResult *result;
+	BlockNumber nextblk = 0;
+
+	for (blk = 0; blk < 1000; blk++)
+	{
+		for (off = 1; off <= 200; off++)
+		{
+			ItemPointerData tid;
+
+			ItemPointerSet(&tid, blk, off);
+			tbm_add_tuples(tbm, &tid, 1, false);
+		}
+	}
+	assert_true(tbm->nchunks > 0);
+	assert_true(TBM_NBYTES(tbm) <= tbm->maxbytes);
+
+	/* every page comes back, exact or lossy */
+	iterator = tbm_begin_iterate(tbm);
+	while ((result = tbm_iterate(iterator)) != NULL)
+	{
+		assert_int_equal(result->blockno, nextblk);
+		if (result->ntuples >= 0)
+			assert_int_equal(result->ntuples, 200);
+		else
+			assert_true(result->recheck);
+		nextblk++;
+	}
+	assert_int_equal(nextblk, 1000);
+	tbm_end_iterate(iterator);
+
+	tbm_free(tbm);
+}
+
+/*
+ * The pages streamed out of a TIDBitmap are the same as those iterated.
+ */
+void
+test__tbm_expand_page(void **state)
+{
+	ExpectedTids *expected = palloc0(sizeof(ExpectedTids));
+	TIDBitmap  *tbm = tbm_create(4 * 1024 * 1024L);
+	TBMIterator *iterator;
+	const TBMPage *page;
+	PagetableEntry *entry = palloc0(sizeof(PagetableEntry));
+	TBMIterateResult *result = palloc(sizeof(TBMIterateResult) +
+									  MAX_TUPLES_PER_PAGE * sizeof(OffsetNumber));
+	bool		more;
+	int			i;
+
+	add_random_tids(tbm, *expected, TEST_PAGES, 3, TEST_OFFSETS);
+	add_random_tids(tbm, *expected, TEST_PAGES / 2, 300, TEST_OFFSETS);
+	add_random_runs(tbm, *expected, TEST_PAGES / 4, 4, 300, TEST_OFFSETS);
+
+	iterator = tbm_begin_iterate(tbm);
+	while ((page = tbm_next_page(iterator, &more)) != NULL)
+	{
+		tbm_expand_page(page, entry);
+		for (i = entry->nwords; i < WORDS_PER_PAGE; i++)
+			assert_true(entry->words[i] == 0);
+		tbm_iterate_page(entry, result);
+		assert_int_equal(result->blockno, page->blockno);
+		for (i = 0; i < result->ntuples; i++)
+			assert_true((*expected)[page->blockno][result->offsets[i]]);
+		tbm_extract_page(page, &iterator->output);
+		assert_int_equal(result->ntuples, iterator->output.ntuples);
+	}
+	tbm_end_iterate(iterator);
+
+	tbm_free(tbm);
+	pfree(expected);
+}
+
+/*
+ * Streams ANDing and ORing TIDBitmaps return the same tuples as tbm_union
+ * and tbm_intersect.
+ */
+void
+test__tbm_stream_and_or(void **state)
+{
+	ExpectedTids *expected_a = palloc0(sizeof(ExpectedTids));
+	ExpectedTids *expected_b = palloc0(sizeof(ExpectedTids));
+	ExpectedTids *expected = palloc(sizeof(ExpectedTids));
+	int			kind;
+
+	for (kind = 0; kind < 2; kind++)
+	{
+		StreamType	op = (kind == 0) ? BMS_OR : BMS_AND;
+		TIDBitmap  *a = tbm_create(4 * 1024 * 1024L);
+		TIDBitmap  *b = tbm_create(4 * 1024 * 1024L);
+		StreamBitmap *sbm = makeNode(StreamBitmap);
+		GenericBMIterator *iterator;
+		TBMIterateResult *result;
+		int			page;
+		int			off;
+		int			i;
+		int			nexpected = 0;
+		int			nfound = 0;
+
+		MemSet(expected_a, 0, sizeof(ExpectedTids));
+		MemSet(expected_b, 0, sizeof(ExpectedTids));
+		add_random_tids(a, *expected_a, TEST_PAGES, 100, TEST_OFFSETS);
+		add_random_runs(a, *expected_a, TEST_PAGES / 2, 4, 300, TEST_OFFSETS);
+		add_random_tids(b, *expected_b, TEST_PAGES, 1500, TEST_OFFSETS);
+		add_random_tids(b, *expected_b, TEST_PAGES / 4, 5, 50);
+		for (page = 0; page < TEST_PAGES; page++)
+		{
+			for (off = 1; off <= TEST_OFFSETS; off++)
+			{
+				if (op == BMS_OR)
+					(*expected)[page][off] = (*expected_a)[page][off] ||
+						(*expected_b)[page][off];
+				else
+					(*expected)[page][off] = (*expected_a)[page][off] &&
+						(*expected_b)[page][off];
+				nexpected += (*expected)[page][off] ? 1 : 0;
+			}
+		}
+
+		stream_add_node(sbm, tbm_create_stream_node(a), BMS_INDEX);
+		stream_add_node(sbm, tbm_create_stream_node(b), op);
+
+		iterator = tbm_generic_begin_iterate((Node *) sbm);
+		while ((result = tbm_generic_iterate(iterator)) != NULL)
+		{
+			assert_true(result->ntuples >= 0);
+			assert_true(result->blockno < TEST_PAGES);
+			for (i = 0; i < result->ntuples; i++)
+			{
+				if (i > 0)
+					assert_true(result->offsets[i - 1] < result->offsets[i]);
+				assert_true((*expected)[result->blockno][result->offsets[i]]);
+				nfound++;
+			}
+		}
+		assert_int_equal(nfound, nexpected);
+		tbm_generic_end_iterate(iterator);
+
+		tbm_generic_free((Node *) sbm);
+	}
+
+	pfree(expected_a);
+	pfree(expected_b);
+	pfree(expected);
+}
+
+int
+main(int argc, char *argv[])
+{
+	cmockery_parse_arguments(argc, argv);
+
+	const		UnitTest tests[] = {
+		unit_test(test__tbm_add_tuples_containers),
+		unit_test(test__tbm_run_containers),
+		unit_test(test__tbm_sparse_pages_stay_exact),
+		unit_test(test__tbm_union_intersect),
+		unit_test(test__tbm_lossify),
+		unit_test(test__tbm_expand_page),
+		unit_test(test__tbm_stream_and_or)
+	};
+
+	MemoryContextInit();
+
+	return run_tests(tests);
+}
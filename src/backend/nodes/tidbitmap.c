@@ -19,6 +19,16 @@
  * of lossiness.  In theory we could fall back to page ranges at some
  * point, but for now that seems useless complexity.
  *
+ * The tuple offsets of an exact page are kept in a container in the manner
+ * of roaring bitmaps: a sorted array of offsets while the page has few
+ * matches, a sorted array of runs of consecutive offsets while they come in
+ * few runs, or else a bitmap only as long as the highest offset needs.
+ * Pages with a single match, common for the 32768-row pseudo-pages of
+ * append-only tables, thus take a few dozen bytes rather than a bitmap of
+ * MAX_TUPLES_PER_PAGE bits, and so do pseudo-pages whose rows all match.
+ * Many more pages fit in the memory limit before the bitmap has to go
+ * lossy.
+ *
  *
  * Copyright (c) 2003-2014, PostgreSQL Global Development Group
  *
@@ -42,8 +52,83 @@
 #define WORDNUM(x)	((x) / TBM_BITS_PER_BITMAPWORD)
 #define BITNUM(x)	((x) % TBM_BITS_PER_BITMAPWORD)
 
+/*
+ * The hashtable entries are represented by this data structure.  As in a
+ * PagetableEntry, blockno of a lossy chunk is the first page in the chunk,
+ * and bit k of its bitmap represents page blockno+k; a chunk always has a
+ * bitmap of WORDS_PER_CHUNK words.
+ *
+ * An exact page starts with an array of offsets, in increasing order.  The
+ * array is converted into a bitmap, where bit k represents tuple offset k+1,
+ * once it would take more room than the bitmap; an intersection that leaves
+ * a bitmap sparse converts it back.  A bitmap that has to grow is converted
+ * into an array of runs instead, if the runs take less than half the room;
+ * the runs are converted back into a bitmap once they would take more room
+ * than it.  The runs are in increasing order, and neither overlap nor touch.
+ * Containers that fit are stored in the entry itself, larger ones are
+ * allocated in the bitmap's memory context and counted in containerbytes.
+ * Words of a bitmap past nwords, up to its capacity, are always zero.
+ */
+typedef enum
+{
+	TBM_ARRAY,					/* sorted array of offsets */
+	TBM_BITMAP,					/* bitmap */
+	TBM_RUN						/* sorted array of runs of offsets */
+} TBMContainer;
+
+/* a run of consecutive tuple offsets, from first to last inclusive */
+typedef struct TBMRun
+{
+	OffsetNumber first;
+	OffsetNumber last;
+} TBMRun;
+
+#define TBM_INLINE_WORDS	4
+#define TBM_INLINE_OFFSETS \
+	((int) (TBM_INLINE_WORDS * sizeof(tbm_bitmapword) / sizeof(OffsetNumber)))
+#define TBM_INLINE_RUNS \
+	((int) (TBM_INLINE_WORDS * sizeof(tbm_bitmapword) / sizeof(TBMRun)))
+
+/* the number of offsets that take as much room as 'nwords' bitmap words */
+#define TBM_MAX_ARRAY(nwords) \
+	((nwords) * (int) (sizeof(tbm_bitmapword) / sizeof(OffsetNumber)))
+
+/* the number of runs that take as much room as 'nwords' bitmap words */
+#define TBM_MAX_RUNS(nwords) \
+	((nwords) * (int) (sizeof(tbm_bitmapword) / sizeof(TBMRun)))
+
+typedef struct TBMPage
+{
+	BlockNumber blockno;		/* page number (hashtable key) */
+	bool		ischunk;		/* T = lossy storage, F = exact */
+	bool		recheck;		/* should the tuples be rechecked? */
+	uint8		container;		/* TBMContainer */
+	bool		external;		/* container allocated outside the entry? */
+	uint16		capacity;		/* words, offsets or runs it can hold */
+	uint16		nwords;			/* TBM_BITMAP: number of words in use */
+	uint16		noffsets;		/* TBM_ARRAY: number of offsets */
+	uint16		nruns;			/* TBM_RUN: number of runs */
+	union
+	{
+		tbm_bitmapword words[TBM_INLINE_WORDS];
+		OffsetNumber offsets[TBM_INLINE_OFFSETS];
+		TBMRun		runs[TBM_INLINE_RUNS];
+		tbm_bitmapword *ext_words;
+		OffsetNumber *ext_offsets;
+		TBMRun	   *ext_runs;
+	}			data;
+} TBMPage;
+
+#define TBM_PAGE_WORDS(page) \
+	((page)->external ? (page)->data.ext_words : (page)->data.words)
+#define TBM_PAGE_OFFSETS(page) \
+	((page)->external ? (page)->data.ext_offsets : (page)->data.offsets)
+#define TBM_PAGE_RUNS(page) \
+	((page)->external ? (page)->data.ext_runs : (page)->data.runs)
+
 static bool tbm_iterate_page(PagetableEntry *page, TBMIterateResult *output);
-static PagetableEntry *tbm_next_page(TBMIterator *iterator, bool *more);
+static void tbm_extract_page(const TBMPage *page, TBMIterateResult *output);
+static const TBMPage *tbm_next_page(TBMIterator *iterator, bool *more);
 static void tbm_upd_instrument(TIDBitmap *tbm);
 
 /*
@@ -72,23 +157,28 @@ struct TIDBitmap
 	NodeTag		type;			/* to make it a valid Node */
 	MemoryContext mcxt;			/* memory context containing me */
 	TBMStatus	status;			/* see codes above */
-	HTAB	   *pagetable;		/* hash table of PagetableEntry's */
+	HTAB	   *pagetable;		/* hash table of TBMPage's */
 	int			nentries;		/* number of entries in pagetable */
-	int			nentries_hwm;	/* high-water mark for number of entries */
-	int			maxentries;		/* limit on same to meet maxbytes */
 	int			npages;			/* number of exact entries in pagetable */
 	int			nchunks;		/* number of lossy entries in pagetable */
 	bool		iterating;		/* tbm_begin_iterate called? */
-	PagetableEntry entry1;		/* used when status == TBM_ONE_PAGE */
+	TBMPage		entry1;			/* used when status == TBM_ONE_PAGE */
 	/* these are valid when iterating is true: */
-	PagetableEntry **spages;	/* sorted exact-page list, or NULL */
-	PagetableEntry **schunks;	/* sorted lossy-chunk list, or NULL */
+	TBMPage   **spages;			/* sorted exact-page list, or NULL */
+	TBMPage   **schunks;		/* sorted lossy-chunk list, or NULL */
 
 	/* CDB: Statistics for EXPLAIN ANALYZE */
 	struct Instrumentation *instrument;
-	Size		bytesperentry;
+	Size		bytesperentry;	/* memory per entry, without containers */
+	Size		containerbytes; /* memory of containers outside entries */
+	Size		maxbytes;		/* limit on the memory used */
+	Size		nbytes_hwm;		/* high-water mark for the memory used */
 };
 
+/* approximate memory used by the page table */
+#define TBM_NBYTES(tbm) \
+	((Size) (tbm)->nentries * (tbm)->bytesperentry + (tbm)->containerbytes)
+
 /*
  * When iterating over a bitmap in sorted order, a TBMIterator is used to
  * track our progress.  There can be several iterators scanning the same
@@ -101,6 +191,7 @@ struct TBMIterator
 	int			spageptr;		/* next spages index */
 	int			schunkptr;		/* next schunks index */
 	int			schunkbit;		/* next bit to check in current schunk */
+	TBMPage		lossypage;		/* lossy page returned by tbm_next_page */
 	TBMIterateResult output;	/* MUST BE LAST (because variable-size) */
 };
 
@@ -115,12 +206,20 @@ struct GenericBMIterator
 };
 
 /* Local function prototypes */
-static void tbm_union_page(TIDBitmap *a, const PagetableEntry *bpage);
-static bool tbm_intersect_page(TIDBitmap *a, PagetableEntry *apage,
+static void tbm_init_page(TIDBitmap *tbm, TBMPage *page, BlockNumber pageno,
+			  bool ischunk);
+static void tbm_free_container(TIDBitmap *tbm, TBMPage *page);
+static void tbm_add_offset(TIDBitmap *tbm, TBMPage *page, OffsetNumber off);
+static void tbm_union_page(TIDBitmap *a, const TBMPage *bpage);
+static void tbm_union_exact(TIDBitmap *a, TBMPage *apage,
+				const TBMPage *bpage);
+static bool tbm_intersect_page(TIDBitmap *a, TBMPage *apage,
 				   const TIDBitmap *b);
-static const PagetableEntry *tbm_find_pageentry(const TIDBitmap *tbm,
+static bool tbm_intersect_exact(TIDBitmap *a, TBMPage *apage,
+					const TBMPage *bpage);
+static const TBMPage *tbm_find_pageentry(const TIDBitmap *tbm,
 				   BlockNumber pageno);
-static PagetableEntry *tbm_get_pageentry(TIDBitmap *tbm, BlockNumber pageno);
+static TBMPage *tbm_get_pageentry(TIDBitmap *tbm, BlockNumber pageno);
 static bool tbm_page_is_lossy(const TIDBitmap *tbm, BlockNumber pageno);
 static void tbm_mark_page_lossy(TIDBitmap *tbm, BlockNumber pageno);
 static void tbm_lossify(TIDBitmap *tbm);
@@ -154,7 +253,6 @@ TIDBitmap *
 tbm_create(long maxbytes)
 {
 	TIDBitmap  *tbm;
-	long		nbuckets;
 
 	/*
 	 * Ensure that we don't have heap tuple offsets going beyond (INT16_MAX +
@@ -171,19 +269,17 @@ tbm_create(long maxbytes)
 	tbm->instrument = NULL;
 
 	/*
-	 * Estimate number of hashtable entries we can have within maxbytes. This
-	 * estimates the hash overhead at MAXALIGN(sizeof(HASHELEMENT)) plus a
-	 * pointer per hash entry, which is crude but good enough for our purpose.
-	 * Also count an extra Pointer per entry for the arrays created during
-	 * iteration readout.
+	 * Estimate the memory taken by a hashtable entry, not counting its
+	 * container if that is allocated separately. This estimates the hash
+	 * overhead at MAXALIGN(sizeof(HASHELEMENT)) plus a pointer per hash
+	 * entry, which is crude but good enough for our purpose. Also count an
+	 * extra Pointer per entry for the arrays created during iteration
+	 * readout.
 	 */
 	tbm->bytesperentry =
-		(MAXALIGN(sizeof(HASHELEMENT)) + MAXALIGN(sizeof(PagetableEntry))
+		(MAXALIGN(sizeof(HASHELEMENT)) + MAXALIGN(sizeof(TBMPage))
 		 + sizeof(Pointer) + sizeof(Pointer));
-	nbuckets = maxbytes / tbm->bytesperentry;
-	nbuckets = Min(nbuckets, INT_MAX - 1);		/* safety limit */
-	nbuckets = Max(nbuckets, 16);		/* sanity limit */
-	tbm->maxentries = (int) nbuckets;
+	tbm->maxbytes = Max((Size) maxbytes, 16 * tbm->bytesperentry);	/* sanity limit */
 
 	return tbm;
 }
@@ -203,7 +299,7 @@ tbm_create_pagetable(TIDBitmap *tbm)
 	/* Create the hashtable proper */
 	MemSet(&hash_ctl, 0, sizeof(hash_ctl));
 	hash_ctl.keysize = sizeof(BlockNumber);
-	hash_ctl.entrysize = sizeof(PagetableEntry);
+	hash_ctl.entrysize = sizeof(TBMPage);
 	hash_ctl.hash = tag_hash;
 	hash_ctl.hcxt = tbm->mcxt;
 	tbm->pagetable = hash_create("TIDBitmap",
@@ -214,14 +310,14 @@ tbm_create_pagetable(TIDBitmap *tbm)
 	/* If entry1 is valid, push it into the hashtable */
 	if (tbm->status == TBM_ONE_PAGE)
 	{
-		PagetableEntry *page;
+		TBMPage    *page;
 		bool		found;
 
-		page = (PagetableEntry *) hash_search(tbm->pagetable,
-											  (void *) &tbm->entry1.blockno,
-											  HASH_ENTER, &found);
+		page = (TBMPage *) hash_search(tbm->pagetable,
+									   (void *) &tbm->entry1.blockno,
+									   HASH_ENTER, &found);
 		Assert(!found);
-		memcpy(page, &tbm->entry1, sizeof(PagetableEntry));
+		memcpy(page, &tbm->entry1, sizeof(TBMPage));
 	}
 
 	tbm->status = TBM_HASH;
@@ -235,6 +331,17 @@ tbm_free(TIDBitmap *tbm)
 {
 	if (tbm->instrument)
 		tbm_upd_instrument(tbm);
+	if (tbm->status == TBM_ONE_PAGE)
+		tbm_free_container(tbm, &tbm->entry1);
+	else if (tbm->status == TBM_HASH && tbm->containerbytes > 0)
+	{
+		HASH_SEQ_STATUS status;
+		TBMPage    *page;
+
+		hash_seq_init(&status, tbm->pagetable);
+		while ((page = (TBMPage *) hash_seq_search(&status)) != NULL)
+			tbm_free_container(tbm, page);
+	}
 	if (tbm->pagetable)
 		hash_destroy(tbm->pagetable);
 	if (tbm->spages)
@@ -258,10 +365,10 @@ tbm_upd_instrument(TIDBitmap *tbm)
 		return;
 
 	/* Update page table high-water mark. */
-	tbm->nentries_hwm = Max(tbm->nentries_hwm, tbm->nentries);
+	tbm->nbytes_hwm = Max(tbm->nbytes_hwm, TBM_NBYTES(tbm));
 
 	/* How much of our work_mem quota was actually used? */
-	workmemused = tbm->nentries_hwm * tbm->bytesperentry;
+	workmemused = tbm->nbytes_hwm;
 	instr->workmemused = Max(instr->workmemused, workmemused);
 }	/* tbm_upd_instrument */
 
@@ -285,6 +392,701 @@ tbm_set_instrument(TIDBitmap *tbm, struct Instrumentation *instr)
 }	/* tbm_set_instrument */
 
 
+/*
+ * tbm_init_page - set up a new hashtable entry for pageno
+ *
+ * An exact page starts with an empty array, a lossy chunk with an empty
+ * bitmap.  Any container the entry had must have been freed.
+ */
+static void
+tbm_init_page(TIDBitmap *tbm, TBMPage *page, BlockNumber pageno, bool ischunk)
+{
+	MemSet(page, 0, sizeof(TBMPage));
+	page->blockno = pageno;
+	page->ischunk = ischunk;
+	if (ischunk)
+	{
+		page->container = TBM_BITMAP;
+		page->capacity = page->nwords = WORDS_PER_CHUNK;
+		if (WORDS_PER_CHUNK > TBM_INLINE_WORDS)
+		{
+			page->data.ext_words = (tbm_bitmapword *)
+				MemoryContextAllocZero(tbm->mcxt,
+									   WORDS_PER_CHUNK * sizeof(tbm_bitmapword));
+			page->external = true;
+			tbm->containerbytes += WORDS_PER_CHUNK * sizeof(tbm_bitmapword);
+		}
+	}
+	else
+	{
+		page->container = TBM_ARRAY;
+		page->capacity = TBM_INLINE_OFFSETS;
+	}
+}
+
+/*
+ * tbm_alloc_container - allocate a container of 'size' bytes for a page
+ */
+static void *
+tbm_alloc_container(TIDBitmap *tbm, Size size)
+{
+	tbm->containerbytes += size;
+	return MemoryContextAllocZero(tbm->mcxt, size);
+}
+
+/*
+ * tbm_free_container - release the container of a page
+ *
+ * The page is left with an empty inline container of the same kind.
+ */
+static void
+tbm_free_container(TIDBitmap *tbm, TBMPage *page)
+{
+	if (page->external)
+	{
+		if (page->container == TBM_BITMAP)
+			tbm->containerbytes -= page->capacity * sizeof(tbm_bitmapword);
+		else if (page->container == TBM_RUN)
+			tbm->containerbytes -= page->capacity * sizeof(TBMRun);
+		else
+			tbm->containerbytes -= page->capacity * sizeof(OffsetNumber);
+		pfree(page->data.ext_words);
+		page->external = false;
+	}
+	MemSet(&page->data, 0, sizeof(page->data));
+	if (page->container == TBM_BITMAP)
+		page->capacity = TBM_INLINE_WORDS;
+	else if (page->container == TBM_RUN)
+		page->capacity = TBM_INLINE_RUNS;
+	else
+		page->capacity = TBM_INLINE_OFFSETS;
+	page->nwords = 0;
+	page->noffsets = 0;
+	page->nruns = 0;
+}
+
+/*
+ * tbm_extend_bitmap - make the bitmap of an exact page 'nwords' words long
+ */
+static void
+tbm_extend_bitmap(TIDBitmap *tbm, TBMPage *page, int nwords)
+{
+	Assert(!page->ischunk && page->container == TBM_BITMAP);
+	Assert(nwords <= WORDS_PER_PAGE);
+
+	if (nwords <= page->nwords)
+		return;
+
+	if (nwords > page->capacity)
+	{
+		int			capacity = Min(Max(nwords, page->capacity * 2),
+								   WORDS_PER_PAGE);
+		int			oldnwords = page->nwords;
+		tbm_bitmapword *words;
+
+		words = (tbm_bitmapword *)
+			tbm_alloc_container(tbm, capacity * sizeof(tbm_bitmapword));
+		memcpy(words, TBM_PAGE_WORDS(page), oldnwords * sizeof(tbm_bitmapword));
+		tbm_free_container(tbm, page);
+		page->data.ext_words = words;
+		page->external = true;
+		page->capacity = capacity;
+	}
+	/* the words past nwords are already zero */
+	page->nwords = nwords;
+}
+
+/*
+ * tbm_array_to_bitmap - convert the array of an exact page to a bitmap
+ *
+ * The bitmap is made at least 'nwords' words long.
+ */
+static void
+tbm_array_to_bitmap(TIDBitmap *tbm, TBMPage *page, int nwords)
+{
+	OffsetNumber copy[TBM_INLINE_OFFSETS];
+	OffsetNumber *offsets = TBM_PAGE_OFFSETS(page);
+	int			noffsets = page->noffsets;
+	Size		oldsize = 0;
+	tbm_bitmapword *words;
+	int			i;
+
+	Assert(!page->ischunk && page->container == TBM_ARRAY);
+
+	/* Detach the array, so that the bitmap can take its place */
+	if (page->external)
+		oldsize = page->capacity * sizeof(OffsetNumber);
+	else
+	{
+		memcpy(copy, offsets, noffsets * sizeof(OffsetNumber));
+		offsets = copy;
+	}
+	page->external = false;
+	page->container = TBM_BITMAP;
+	tbm_free_container(tbm, page);
+
+	if (noffsets > 0)
+		nwords = Max(nwords, WORDNUM(offsets[noffsets - 1] - 1) + 1);
+	tbm_extend_bitmap(tbm, page, nwords);
+
+	words = TBM_PAGE_WORDS(page);
+	for (i = 0; i < noffsets; i++)
+		words[WORDNUM(offsets[i] - 1)] |=
+			((tbm_bitmapword) 1 << BITNUM(offsets[i] - 1));
+
+	if (oldsize > 0)
+	{
+		tbm->containerbytes -= oldsize;
+		pfree(offsets);
+	}
+}
+
+/*
+ * tbm_set_array - make the container of an exact page the given array
+ *
+ * 'offsets' must be in increasing order, and not point into the page's
+ * current container.
+ */
+static void
+tbm_set_array(TIDBitmap *tbm, TBMPage *page, const OffsetNumber *offsets,
+			  int noffsets)
+{
+	Assert(!page->ischunk);
+
+	tbm_free_container(tbm, page);
+	page->container = TBM_ARRAY;
+	page->capacity = TBM_INLINE_OFFSETS;
+	if (noffsets > TBM_INLINE_OFFSETS)
+	{
+		page->data.ext_offsets = (OffsetNumber *)
+			tbm_alloc_container(tbm, noffsets * sizeof(OffsetNumber));
+		page->external = true;
+		page->capacity = noffsets;
+	}
+	memcpy(TBM_PAGE_OFFSETS(page), offsets, noffsets * sizeof(OffsetNumber));
+	page->noffsets = noffsets;
+}
+
+/*
+ * tbm_set_range - set the bits of tuple offsets first to last in a bitmap
+ *
+ * The bitmap must be long enough to hold 'last'.
+ */
+static void
+tbm_set_range(tbm_bitmapword *words, int first, int last)
+{
+	int			wordnum = WORDNUM(first - 1);
+	int			lastword = WORDNUM(last - 1);
+	tbm_bitmapword lowmask = ~(tbm_bitmapword) 0 << BITNUM(first - 1);
+	tbm_bitmapword highmask = ~(tbm_bitmapword) 0 >>
+		(TBM_BITS_PER_BITMAPWORD - 1 - BITNUM(last - 1));
+
+	if (wordnum == lastword)
+	{
+		words[wordnum] |= lowmask & highmask;
+		return;
+	}
+	words[wordnum++] |= lowmask;
+	for (; wordnum < lastword; wordnum++)
+		words[wordnum] = ~(tbm_bitmapword) 0;
+	words[lastword] |= highmask;
+}
+
+/*
+ * tbm_clear_range - clear the bits of tuple offsets first to last in a bitmap
+ */
+static void
+tbm_clear_range(tbm_bitmapword *words, int first, int last)
+{
+	int			wordnum = WORDNUM(first - 1);
+	int			lastword = WORDNUM(last - 1);
+	tbm_bitmapword lowmask = ~(tbm_bitmapword) 0 << BITNUM(first - 1);
+	tbm_bitmapword highmask = ~(tbm_bitmapword) 0 >>
+		(TBM_BITS_PER_BITMAPWORD - 1 - BITNUM(last - 1));
+
+	if (wordnum == lastword)
+	{
+		words[wordnum] &= ~(lowmask & highmask);
+		return;
+	}
+	words[wordnum++] &= ~lowmask;
+	for (; wordnum < lastword; wordnum++)
+		words[wordnum] = 0;
+	words[lastword] &= ~highmask;
+}
+
+/*
+ * tbm_count_runs - count the runs of consecutive bits set in a bitmap
+ */
+static int
+tbm_count_runs(const tbm_bitmapword *words, int nwords)
+{
+	int			nruns = 0;
+	tbm_bitmapword carry = 0;	/* the last bit of the previous word */
+	int			wordnum;
+
+	for (wordnum = 0; wordnum < nwords; wordnum++)
+	{
+		tbm_bitmapword w = words[wordnum];
+		tbm_bitmapword starts = w & ~((w << 1) | carry);
+
+		for (; starts != 0; starts &= starts - 1)
+			nruns++;
+		carry = w >> (TBM_BITS_PER_BITMAPWORD - 1);
+	}
+
+	return nruns;
+}
+
+/*
+ * tbm_extract_runs - list the runs of consecutive bits set in a bitmap
+ *
+ * Returns the number of runs stored in 'runs'.
+ */
+static int
+tbm_extract_runs(const tbm_bitmapword *words, int nwords, TBMRun *runs)
+{
+	int			nruns = 0;
+	bool		inrun = false;
+	int			wordnum;
+
+	for (wordnum = 0; wordnum < nwords; wordnum++)
+	{
+		tbm_bitmapword w = words[wordnum];
+		int			bit;
+
+		/* skip the words that neither start nor end a run */
+		if (w == (inrun ? ~(tbm_bitmapword) 0 : 0))
+			continue;
+
+		for (bit = 0; bit < TBM_BITS_PER_BITMAPWORD; bit++)
+		{
+			int			off = wordnum * TBM_BITS_PER_BITMAPWORD + bit + 1;
+
+			if (((w >> bit) & 1) != inrun)
+			{
+				if (inrun)
+					runs[nruns++].last = (OffsetNumber) (off - 1);
+				else
+					runs[nruns].first = (OffsetNumber) off;
+				inrun = !inrun;
+			}
+		}
+	}
+	if (inrun)
+		runs[nruns++].last = (OffsetNumber) (nwords * TBM_BITS_PER_BITMAPWORD);
+
+	return nruns;
+}
+
+/*
+ * tbm_runs_to_bitmap - convert the runs of an exact page to a bitmap
+ *
+ * The bitmap is made at least 'nwords' words long.
+ */
+static void
+tbm_runs_to_bitmap(TIDBitmap *tbm, TBMPage *page, int nwords)
+{
+	TBMRun		copy[TBM_INLINE_RUNS];
+	TBMRun	   *runs = TBM_PAGE_RUNS(page);
+	int			nruns = page->nruns;
+	Size		oldsize = 0;
+	tbm_bitmapword *words;
+	int			i;
+
+	Assert(!page->ischunk && page->container == TBM_RUN);
+
+	/* Detach the runs, so that the bitmap can take their place */
+	if (page->external)
+		oldsize = page->capacity * sizeof(TBMRun);
+	else
+	{
+		memcpy(copy, runs, nruns * sizeof(TBMRun));
+		runs = copy;
+	}
+	page->external = false;
+	page->container = TBM_BITMAP;
+	tbm_free_container(tbm, page);
+
+	if (nruns > 0)
+		nwords = Max(nwords, WORDNUM(runs[nruns - 1].last - 1) + 1);
+	tbm_extend_bitmap(tbm, page, nwords);
+
+	words = TBM_PAGE_WORDS(page);
+	for (i = 0; i < nruns; i++)
+		tbm_set_range(words, runs[i].first, runs[i].last);
+
+	if (oldsize > 0)
+	{
+		tbm->containerbytes -= oldsize;
+		pfree(runs);
+	}
+}
+
+/*
+ * tbm_set_runs - make the container of an exact page the given runs
+ *
+ * 'runs' must be in increasing order, and not point into the page's current
+ * container.
+ */
+static void
+tbm_set_runs(TIDBitmap *tbm, TBMPage *page, const TBMRun *runs, int nruns)
+{
+	Assert(!page->ischunk);
+
+	tbm_free_container(tbm, page);
+	page->container = TBM_RUN;
+	page->capacity = TBM_INLINE_RUNS;
+	if (nruns > TBM_INLINE_RUNS)
+	{
+		page->data.ext_runs = (TBMRun *)
+			tbm_alloc_container(tbm, nruns * sizeof(TBMRun));
+		page->external = true;
+		page->capacity = nruns;
+	}
+	memcpy(TBM_PAGE_RUNS(page), runs, nruns * sizeof(TBMRun));
+	page->nruns = nruns;
+}
+
+/*
+ * tbm_store_runs - make the container of an exact page hold the given runs
+ *
+ * The runs are kept as such, unless an array or a bitmap of them takes less
+ * room.  'runs' must be in increasing order, and not point into the page's
+ * current container.
+ */
+static void
+tbm_store_runs(TIDBitmap *tbm, TBMPage *page, const TBMRun *runs, int nruns)
+{
+	int			noffsets = 0;
+	int			nwords;
+	int			i;
+
+	for (i = 0; i < nruns; i++)
+		noffsets += runs[i].last - runs[i].first + 1;
+	nwords = (nruns > 0) ? WORDNUM(runs[nruns - 1].last - 1) + 1 : 0;
+
+	if (noffsets <= TBM_MAX_ARRAY(nwords) &&
+		noffsets * sizeof(OffsetNumber) <= nruns * sizeof(TBMRun))
+	{
+		OffsetNumber *offsets;
+		int			n = 0;
+
+		offsets = (OffsetNumber *) palloc(Max(noffsets, 1) * sizeof(OffsetNumber));
+		for (i = 0; i < nruns; i++)
+		{
+			int			off;
+
+			for (off = runs[i].first; off <= runs[i].last; off++)
+				offsets[n++] = (OffsetNumber) off;
+		}
+		tbm_set_array(tbm, page, offsets, n);
+		pfree(offsets);
+	}
+	else if (nruns <= TBM_MAX_RUNS(nwords))
+		tbm_set_runs(tbm, page, runs, nruns);
+	else
+	{
+		tbm_free_container(tbm, page);
+		page->container = TBM_BITMAP;
+		page->capacity = TBM_INLINE_WORDS;
+		tbm_extend_bitmap(tbm, page, nwords);
+		for (i = 0; i < nruns; i++)
+			tbm_set_range(TBM_PAGE_WORDS(page), runs[i].first, runs[i].last);
+	}
+}
+
+/*
+ * tbm_bitmap_to_runs - convert the bitmap of an exact page to runs, if the
+ * runs take less than half the room of a bitmap 'nwords' words long
+ *
+ * One run is allowed for an offset about to be added.  Returns true if the
+ * page was converted.
+ */
+static bool
+tbm_bitmap_to_runs(TIDBitmap *tbm, TBMPage *page, int nwords)
+{
+	const tbm_bitmapword *words = TBM_PAGE_WORDS(page);
+	TBMRun	   *runs;
+	int			nruns;
+
+	Assert(!page->ischunk && page->container == TBM_BITMAP);
+
+	nruns = tbm_count_runs(words, page->nwords);
+	if (nruns + 1 > TBM_MAX_RUNS(nwords) / 2)
+		return false;
+
+	runs = (TBMRun *) palloc(Max(nruns, 1) * sizeof(TBMRun));
+	nruns = tbm_extract_runs(words, page->nwords, runs);
+	tbm_set_runs(tbm, page, runs, nruns);
+	pfree(runs);
+
+	return true;
+}
+
+/*
+ * tbm_add_run_offset - add one tuple offset to the runs of an exact page
+ *
+ * Returns false, leaving the page alone, if the runs would then take more
+ * room than a bitmap.
+ */
+static bool
+tbm_add_run_offset(TIDBitmap *tbm, TBMPage *page, OffsetNumber off)
+{
+	TBMRun	   *runs = TBM_PAGE_RUNS(page);
+	int			nruns = page->nruns;
+	int			pos;
+	OffsetNumber maxoff;
+
+	Assert(page->container == TBM_RUN);
+
+	/* Find the first run that ends at off - 1 or later, mostly none */
+	if (nruns == 0 || runs[nruns - 1].last + 1 < off)
+		pos = nruns;
+	else
+	{
+		int			high = nruns - 1;
+
+		pos = 0;
+		while (pos < high)
+		{
+			int			mid = pos + (high - pos) / 2;
+
+			if (runs[mid].last + 1 < off)
+				pos = mid + 1;
+			else
+				high = mid;
+		}
+	}
+
+	if (pos < nruns && runs[pos].first <= off)
+	{
+		/* in the run, or just past its end */
+		if (off > runs[pos].last)
+		{
+			runs[pos].last = off;
+			if (pos + 1 < nruns && runs[pos + 1].first == off + 1)
+			{
+				/* the run now touches the next one, merge them */
+				runs[pos].last = runs[pos + 1].last;
+				memmove(runs + pos + 1, runs + pos + 2,
+						(nruns - pos - 2) * sizeof(TBMRun));
+				page->nruns = nruns - 1;
+			}
+		}
+		return true;
+	}
+	if (pos < nruns && runs[pos].first == off + 1)
+	{
+		runs[pos].first = off;
+		return true;
+	}
+
+	/* A run of its own */
+	maxoff = (pos == nruns) ? off : runs[nruns - 1].last;
+	if (nruns + 1 > TBM_MAX_RUNS(WORDNUM(maxoff - 1) + 1))
+		return false;
+
+	if (nruns == page->capacity)
+	{
+		int			capacity = Min(page->capacity * 2,
+								   TBM_MAX_RUNS(WORDS_PER_PAGE));
+		TBMRun	   *newruns;
+
+		newruns = (TBMRun *)
+			tbm_alloc_container(tbm, capacity * sizeof(TBMRun));
+		memcpy(newruns, runs, nruns * sizeof(TBMRun));
+		tbm_free_container(tbm, page);
+		page->data.ext_runs = newruns;
+		page->external = true;
+		page->capacity = capacity;
+		runs = newruns;
+	}
+	memmove(runs + pos + 1, runs + pos, (nruns - pos) * sizeof(TBMRun));
+	runs[pos].first = runs[pos].last = off;
+	page->nruns = nruns + 1;
+
+	return true;
+}
+
+/*
+ * tbm_append_run - append the run of offsets first to last to a sorted list
+ * of runs, merging it with the last run if they overlap or touch
+ *
+ * Returns the new number of runs.
+ */
+static inline int
+tbm_append_run(TBMRun *runs, int nruns, int first, int last)
+{
+	if (nruns > 0 && runs[nruns - 1].last + 1 >= first)
+	{
+		if (last > runs[nruns - 1].last)
+			runs[nruns - 1].last = (OffsetNumber) last;
+		return nruns;
+	}
+	runs[nruns].first = (OffsetNumber) first;
+	runs[nruns].last = (OffsetNumber) last;
+	return nruns + 1;
+}
+
+/*
+ * tbm_filter_runs - keep the offsets of a sorted array that fall in runs
+ *
+ * Returns the number of offsets stored in 'out', which may be 'in'.
+ */
+static int
+tbm_filter_runs(const TBMRun *runs, int nruns, const OffsetNumber *in,
+				int nin, OffsetNumber *out)
+{
+	int			n = 0;
+	int			i;
+	int			j = 0;
+
+	for (i = 0; i < nin && j < nruns; i++)
+	{
+		while (j < nruns && runs[j].last < in[i])
+			j++;
+		if (j < nruns && runs[j].first <= in[i])
+			out[n++] = in[i];
+	}
+
+	return n;
+}
+
+/*
+ * tbm_bitmap_contains - is tuple offset 'off' set in the bitmap of a page?
+ */
+static inline bool
+tbm_bitmap_contains(const TBMPage *page, OffsetNumber off)
+{
+	int			wordnum = WORDNUM(off - 1);
+
+	Assert(page->container == TBM_BITMAP);
+
+	return wordnum < page->nwords &&
+		(TBM_PAGE_WORDS(page)[wordnum] &
+		 ((tbm_bitmapword) 1 << BITNUM(off - 1))) != 0;
+}
+
+/*
+ * tbm_extract_offsets - list the tuple offsets set in a bitmap
+ *
+ * Returns the number of offsets stored in 'offsets'.
+ */
+static int
+tbm_extract_offsets(const tbm_bitmapword *words, int nwords,
+					OffsetNumber *offsets)
+{
+	int			noffsets = 0;
+	int			wordnum;
+
+	for (wordnum = 0; wordnum < nwords; wordnum++)
+	{
+		tbm_bitmapword w = words[wordnum];
+
+		if (w != 0)
+		{
+			int			off = wordnum * TBM_BITS_PER_BITMAPWORD + 1;
+
+			while (w != 0)
+			{
+				if (w & 1)
+					offsets[noffsets++] = (OffsetNumber) off;
+				off++;
+				w >>= 1;
+			}
+		}
+	}
+
+	return noffsets;
+}
+
+/*
+ * tbm_add_offset - add one tuple offset to an exact page
+ */
+static void
+tbm_add_offset(TIDBitmap *tbm, TBMPage *page, OffsetNumber off)
+{
+	Assert(!page->ischunk);
+	Assert(off >= 1);
+
+	if (page->container == TBM_ARRAY)
+	{
+		OffsetNumber *offsets = TBM_PAGE_OFFSETS(page);
+		int			noffsets = page->noffsets;
+		int			pos;
+		OffsetNumber maxoff;
+
+		/* Tuples mostly come in order, so try the end of the array first */
+		if (noffsets == 0 || offsets[noffsets - 1] < off)
+			pos = noffsets;
+		else
+		{
+			int			high = noffsets - 1;
+
+			pos = 0;
+			while (pos < high)
+			{
+				int			mid = pos + (high - pos) / 2;
+
+				if (offsets[mid] < off)
+					pos = mid + 1;
+				else
+					high = mid;
+			}
+			if (offsets[pos] == off)
+				return;
+		}
+
+		maxoff = (pos == noffsets) ? off : offsets[noffsets - 1];
+		if (noffsets + 1 <= TBM_MAX_ARRAY(WORDNUM(maxoff - 1) + 1))
+		{
+			if (noffsets == page->capacity)
+			{
+				int			capacity = Min(page->capacity * 2,
+										   TBM_MAX_ARRAY(WORDS_PER_PAGE));
+				OffsetNumber *newoffsets;
+
+				newoffsets = (OffsetNumber *)
+					tbm_alloc_container(tbm, capacity * sizeof(OffsetNumber));
+				memcpy(newoffsets, offsets, noffsets * sizeof(OffsetNumber));
+				tbm_free_container(tbm, page);
+				page->data.ext_offsets = newoffsets;
+				page->external = true;
+				page->capacity = capacity;
+				offsets = newoffsets;
+			}
+			memmove(offsets + pos + 1, offsets + pos,
+					(noffsets - pos) * sizeof(OffsetNumber));
+			offsets[pos] = off;
+			page->noffsets = noffsets + 1;
+			return;
+		}
+
+		/* The array would be larger than a bitmap, switch over */
+		tbm_array_to_bitmap(tbm, page, WORDNUM(maxoff - 1) + 1);
+	}
+	else if (page->container == TBM_BITMAP &&
+			 WORDNUM(off - 1) + 1 > page->capacity)
+	{
+		/* Rather than growing the bitmap, switch to runs if they are small */
+		tbm_bitmap_to_runs(tbm, page, WORDNUM(off - 1) + 1);
+	}
+
+	if (page->container == TBM_RUN)
+	{
+		if (tbm_add_run_offset(tbm, page, off))
+			return;
+
+		/* The runs would be larger than a bitmap, switch over */
+		tbm_runs_to_bitmap(tbm, page, WORDNUM(off - 1) + 1);
+	}
+
+	tbm_extend_bitmap(tbm, page, WORDNUM(off - 1) + 1);
+	TBM_PAGE_WORDS(page)[WORDNUM(off - 1)] |=
+		((tbm_bitmapword) 1 << BITNUM(off - 1));
+}
+
 /*
  * tbm_add_tuples - add some tuple IDs to a TIDBitmap
  */
@@ -299,9 +1101,7 @@ tbm_add_tuples(TIDBitmap *tbm, const ItemPointer tids, int ntids,
 	{
 		BlockNumber blk = ItemPointerGetBlockNumber(tids + i);
 		OffsetNumber off = ItemPointerGetOffsetNumber(tids + i);
-		PagetableEntry *page;
-		int			wordnum,
-					bitnum;
+		TBMPage    *page;
 
 		/* safety check to ensure we don't overrun bit array bounds */
 
@@ -319,18 +1119,16 @@ tbm_add_tuples(TIDBitmap *tbm, const ItemPointer tids, int ntids,
 		if (page->ischunk)
 		{
 			/* The page is a lossy chunk header, set bit for itself */
-			wordnum = bitnum = 0;
+			TBM_PAGE_WORDS(page)[0] |= ((tbm_bitmapword) 1 << 0);
 		}
 		else
 		{
-			/* Page is exact, so set bit for individual tuple */
-			wordnum = WORDNUM(off - 1);
-			bitnum = BITNUM(off - 1);
+			/* Page is exact, so add the individual tuple */
+			tbm_add_offset(tbm, page, off);
 		}
-		page->words[wordnum] |= ((tbm_bitmapword) 1 << bitnum);
 		page->recheck |= recheck;
 
-		if (tbm->nentries > tbm->maxentries)
+		if (TBM_NBYTES(tbm) > tbm->maxbytes)
 			tbm_lossify(tbm);
 	}
 }
@@ -347,7 +1145,7 @@ tbm_add_page(TIDBitmap *tbm, BlockNumber pageno)
 	/* Enter the page in the bitmap, or mark it lossy if already present */
 	tbm_mark_page_lossy(tbm, pageno);
 	/* If we went over the memory limit, lossify some more pages */
-	if (tbm->nentries > tbm->maxentries)
+	if (TBM_NBYTES(tbm) > tbm->maxbytes)
 		tbm_lossify(tbm);
 }
 
@@ -369,28 +1167,30 @@ tbm_union(TIDBitmap *a, const TIDBitmap *b)
 	else
 	{
 		HASH_SEQ_STATUS status;
-		PagetableEntry *bpage;
+		TBMPage    *bpage;
 
 		Assert(b->status == TBM_HASH);
 		hash_seq_init(&status, b->pagetable);
-		while ((bpage = (PagetableEntry *) hash_seq_search(&status)) != NULL)
+		while ((bpage = (TBMPage *) hash_seq_search(&status)) != NULL)
 			tbm_union_page(a, bpage);
 	}
 }
 
 /* Process one page of b during a union op */
 static void
-tbm_union_page(TIDBitmap *a, const PagetableEntry *bpage)
+tbm_union_page(TIDBitmap *a, const TBMPage *bpage)
 {
-	PagetableEntry *apage;
+	TBMPage    *apage;
 	int			wordnum;
 
 	if (bpage->ischunk)
 	{
+		const tbm_bitmapword *bwords = TBM_PAGE_WORDS(bpage);
+
 		/* Scan b's chunk, mark each indicated page lossy in a */
 		for (wordnum = 0; wordnum < WORDS_PER_CHUNK; wordnum++)
 		{
-			tbm_bitmapword w = bpage->words[wordnum];
+			tbm_bitmapword w = bwords[wordnum];
 
 			if (w != 0)
 			{
@@ -418,21 +1218,142 @@ tbm_union_page(TIDBitmap *a, const PagetableEntry *bpage)
 		if (apage->ischunk)
 		{
 			/* The page is a lossy chunk header, set bit for itself */
-			apage->words[0] |= ((tbm_bitmapword) 1 << 0);
+			TBM_PAGE_WORDS(apage)[0] |= ((tbm_bitmapword) 1 << 0);
 		}
 		else
 		{
-			/* Both pages are exact, merge at the bit level */
-			for (wordnum = 0; wordnum < WORDS_PER_PAGE; wordnum++)
-				apage->words[wordnum] |= bpage->words[wordnum];
-			apage->recheck |= bpage->recheck;
+			/* Both pages are exact, merge their containers */
+			tbm_union_exact(a, apage, bpage);
 		}
 	}
 
-	if (a->nentries > a->maxentries)
+	if (TBM_NBYTES(a) > a->maxbytes)
 		tbm_lossify(a);
 }
 
+/*
+ * Merge the tuples of exact page bpage into exact page apage of a
+ */
+static void
+tbm_union_exact(TIDBitmap *a, TBMPage *apage, const TBMPage *bpage)
+{
+	int			wordnum;
+
+	if (bpage->container == TBM_BITMAP)
+	{
+		const tbm_bitmapword *bwords = TBM_PAGE_WORDS(bpage);
+		tbm_bitmapword *awords;
+
+		if (apage->container == TBM_ARRAY)
+			tbm_array_to_bitmap(a, apage, bpage->nwords);
+		else if (apage->container == TBM_RUN)
+			tbm_runs_to_bitmap(a, apage, bpage->nwords);
+		else
+			tbm_extend_bitmap(a, apage, bpage->nwords);
+		awords = TBM_PAGE_WORDS(apage);
+		for (wordnum = 0; wordnum < bpage->nwords; wordnum++)
+			awords[wordnum] |= bwords[wordnum];
+	}
+	else if (bpage->container == TBM_RUN && apage->container == TBM_BITMAP)
+	{
+		const TBMRun *bruns = TBM_PAGE_RUNS(bpage);
+		int			j;
+
+		if (bpage->nruns > 0)
+			tbm_extend_bitmap(a, apage,
+							  WORDNUM(bruns[bpage->nruns - 1].last - 1) + 1);
+		for (j = 0; j < bpage->nruns; j++)
+			tbm_set_range(TBM_PAGE_WORDS(apage), bruns[j].first, bruns[j].last);
+		if (apage->external)
+			tbm_bitmap_to_runs(a, apage, apage->nwords);
+	}
+	else if (bpage->container == TBM_RUN)
+	{
+		/* Merge a's offsets or runs with b's runs */
+		const TBMRun *bruns = TBM_PAGE_RUNS(bpage);
+		int			nb = bpage->nruns;
+		int			na;
+		TBMRun	   *merged;
+		int			n = 0;
+		int			i = 0;
+		int			j = 0;
+
+		na = (apage->container == TBM_RUN) ? apage->nruns : apage->noffsets;
+		merged = (TBMRun *) palloc(Max(na + nb, 1) * sizeof(TBMRun));
+		while (i < na || j < nb)
+		{
+			int			first;
+			int			last;
+
+			if (apage->container == TBM_RUN)
+			{
+				first = (i < na) ? TBM_PAGE_RUNS(apage)[i].first : INT_MAX;
+				last = (i < na) ? TBM_PAGE_RUNS(apage)[i].last : INT_MAX;
+			}
+			else
+				first = last = (i < na) ? TBM_PAGE_OFFSETS(apage)[i] : INT_MAX;
+
+			if (j < nb && bruns[j].first < first)
+			{
+				first = bruns[j].first;
+				last = bruns[j].last;
+				j++;
+			}
+			else
+				i++;
+			n = tbm_append_run(merged, n, first, last);
+		}
+		tbm_store_runs(a, apage, merged, n);
+		pfree(merged);
+	}
+	else if (apage->container == TBM_ARRAY && bpage->noffsets > 0)
+	{
+		/* Merge the two arrays */
+		const OffsetNumber *aoffsets = TBM_PAGE_OFFSETS(apage);
+		const OffsetNumber *boffsets = TBM_PAGE_OFFSETS(bpage);
+		int			na = apage->noffsets;
+		int			nb = bpage->noffsets;
+		OffsetNumber *merged;
+		int			n = 0;
+		int			i = 0;
+		int			j = 0;
+		int			nwords;
+
+		merged = (OffsetNumber *) palloc((na + nb) * sizeof(OffsetNumber));
+		while (i < na && j < nb)
+		{
+			if (aoffsets[i] < boffsets[j])
+				merged[n++] = aoffsets[i++];
+			else if (aoffsets[i] > boffsets[j])
+				merged[n++] = boffsets[j++];
+			else
+			{
+				merged[n++] = aoffsets[i++];
+				j++;
+			}
+		}
+		while (i < na)
+			merged[n++] = aoffsets[i++];
+		while (j < nb)
+			merged[n++] = boffsets[j++];
+
+		tbm_set_array(a, apage, merged, n);
+		nwords = WORDNUM(merged[n - 1] - 1) + 1;
+		if (n > TBM_MAX_ARRAY(nwords))
+			tbm_array_to_bitmap(a, apage, nwords);
+		pfree(merged);
+	}
+	else
+	{
+		const OffsetNumber *boffsets = TBM_PAGE_OFFSETS(bpage);
+		int			j;
+
+		for (j = 0; j < bpage->noffsets; j++)
+			tbm_add_offset(a, apage, boffsets[j]);
+	}
+	apage->recheck |= bpage->recheck;
+}
+
 /*
  * tbm_intersect - set intersection
  *
@@ -446,7 +1367,7 @@ tbm_intersect(TIDBitmap *a, const TIDBitmap *b)
 	if (a->nentries == 0)
 		return;
 
-	a->nentries_hwm = Max(a->nentries_hwm, a->nentries);
+	a->nbytes_hwm = Max(a->nbytes_hwm, TBM_NBYTES(a));
 
 	/* Scan through chunks and pages in a, try to match to b */
 	if (a->status == TBM_ONE_PAGE)
@@ -455,6 +1376,7 @@ tbm_intersect(TIDBitmap *a, const TIDBitmap *b)
 		{
 			/* Page is now empty, remove it from a */
 			Assert(!a->entry1.ischunk);
+			tbm_free_container(a, &a->entry1);
 			a->npages--;
 			a->nentries--;
 			Assert(a->nentries == 0);
@@ -464,11 +1386,11 @@ tbm_intersect(TIDBitmap *a, const TIDBitmap *b)
 	else
 	{
 		HASH_SEQ_STATUS status;
-		PagetableEntry *apage;
+		TBMPage    *apage;
 
 		Assert(a->status == TBM_HASH);
 		hash_seq_init(&status, a->pagetable);
-		while ((apage = (PagetableEntry *) hash_seq_search(&status)) != NULL)
+		while ((apage = (TBMPage *) hash_seq_search(&status)) != NULL)
 		{
 			if (tbm_intersect_page(a, apage, b))
 			{
@@ -478,6 +1400,7 @@ tbm_intersect(TIDBitmap *a, const TIDBitmap *b)
 				else
 					a->npages--;
 				a->nentries--;
+				tbm_free_container(a, apage);
 				if (hash_search(a->pagetable,
 								(void *) &apage->blockno,
 								HASH_REMOVE, NULL) == NULL)
@@ -493,19 +1416,20 @@ tbm_intersect(TIDBitmap *a, const TIDBitmap *b)
  * Returns TRUE if apage is now empty and should be deleted from a
  */
 static bool
-tbm_intersect_page(TIDBitmap *a, PagetableEntry *apage, const TIDBitmap *b)
+tbm_intersect_page(TIDBitmap *a, TBMPage *apage, const TIDBitmap *b)
 {
-	const PagetableEntry *bpage;
+	const TBMPage *bpage;
 	int			wordnum;
 
 	if (apage->ischunk)
 	{
 		/* Scan each bit in chunk, try to clear */
+		tbm_bitmapword *awords = TBM_PAGE_WORDS(apage);
 		bool		candelete = true;
 
 		for (wordnum = 0; wordnum < WORDS_PER_CHUNK; wordnum++)
 		{
-			tbm_bitmapword w = apage->words[wordnum];
+			tbm_bitmapword w = awords[wordnum];
 
 			if (w != 0)
 			{
@@ -530,7 +1454,7 @@ tbm_intersect_page(TIDBitmap *a, PagetableEntry *apage, const TIDBitmap *b)
 					bitnum++;
 					w >>= 1;
 				}
-				apage->words[wordnum] = neww;
+				awords[wordnum] = neww;
 				if (neww != 0)
 					candelete = false;
 			}
@@ -550,24 +1474,185 @@ tbm_intersect_page(TIDBitmap *a, PagetableEntry *apage, const TIDBitmap *b)
 	}
 	else
 	{
-		bool		candelete = true;
-
 		bpage = tbm_find_pageentry(b, apage->blockno);
 		if (bpage != NULL)
 		{
-			/* Both pages are exact, merge at the bit level */
+			/* Both pages are exact, intersect their containers */
 			Assert(!bpage->ischunk);
-			for (wordnum = 0; wordnum < WORDS_PER_PAGE; wordnum++)
+			return tbm_intersect_exact(a, apage, bpage);
+		}
+		/* If there is no matching b page, we can just delete the a page */
+		return true;
+	}
+}
+
+/*
+ * Keep only the tuples of exact page apage of a that are also in exact page
+ * bpage
+ *
+ * Returns TRUE if apage is now empty
+ */
+static bool
+tbm_intersect_exact(TIDBitmap *a, TBMPage *apage, const TBMPage *bpage)
+{
+	int			i;
+	int			j;
+	int			n = 0;
+
+	apage->recheck |= bpage->recheck;
+
+	if (apage->container == TBM_ARRAY)
+	{
+		/* The result is a subset of a's array, filter it in place */
+		OffsetNumber *aoffsets = TBM_PAGE_OFFSETS(apage);
+		int			na = apage->noffsets;
+
+		if (bpage->container == TBM_ARRAY)
+		{
+			const OffsetNumber *boffsets = TBM_PAGE_OFFSETS(bpage);
+			int			nb = bpage->noffsets;
+
+			i = j = 0;
+			while (i < na && j < nb)
 			{
-				apage->words[wordnum] &= bpage->words[wordnum];
-				if (apage->words[wordnum] != 0)
-					candelete = false;
+				if (aoffsets[i] < boffsets[j])
+					i++;
+				else if (aoffsets[i] > boffsets[j])
+					j++;
+				else
+				{
+					aoffsets[n++] = aoffsets[i++];
+					j++;
+				}
 			}
-			apage->recheck |= bpage->recheck;
 		}
-		/* If there is no matching b page, we can just delete the a page */
-		return candelete;
+		else if (bpage->container == TBM_RUN)
+			n = tbm_filter_runs(TBM_PAGE_RUNS(bpage), bpage->nruns,
+								aoffsets, na, aoffsets);
+		else
+		{
+			for (i = 0; i < na; i++)
+			{
+				if (tbm_bitmap_contains(bpage, aoffsets[i]))
+					aoffsets[n++] = aoffsets[i];
+			}
+		}
+		apage->noffsets = n;
+	}
+	else if (bpage->container == TBM_ARRAY)
+	{
+		/* The result is a subset of b's array, so make it an array too */
+		const OffsetNumber *boffsets = TBM_PAGE_OFFSETS(bpage);
+		OffsetNumber *result;
+
+		result = (OffsetNumber *)
+			palloc(Max(bpage->noffsets, 1) * sizeof(OffsetNumber));
+		if (apage->container == TBM_RUN)
+			n = tbm_filter_runs(TBM_PAGE_RUNS(apage), apage->nruns,
+								boffsets, bpage->noffsets, result);
+		else
+		{
+			for (j = 0; j < bpage->noffsets; j++)
+			{
+				if (tbm_bitmap_contains(apage, boffsets[j]))
+					result[n++] = boffsets[j];
+			}
+		}
+		tbm_set_array(a, apage, result, n);
+		pfree(result);
+	}
+	else if (apage->container == TBM_RUN && bpage->container == TBM_RUN)
+	{
+		/* Both are runs, intersect them pairwise */
+		const TBMRun *aruns = TBM_PAGE_RUNS(apage);
+		const TBMRun *bruns = TBM_PAGE_RUNS(bpage);
+		int			na = apage->nruns;
+		int			nb = bpage->nruns;
+		TBMRun	   *result;
+
+		result = (TBMRun *) palloc(Max(na + nb, 1) * sizeof(TBMRun));
+		i = j = 0;
+		while (i < na && j < nb)
+		{
+			int			first = Max(aruns[i].first, bruns[j].first);
+			int			last = Min(aruns[i].last, bruns[j].last);
+
+			if (first <= last)
+				n = tbm_append_run(result, n, first, last);
+			if (aruns[i].last < bruns[j].last)
+				i++;
+			else
+				j++;
+		}
+		tbm_store_runs(a, apage, result, n);
+		pfree(result);
+	}
+	else
+	{
+		/* The result is a subset of a's bitmap, merge at the bit level */
+		tbm_bitmapword *awords;
+		int			nwords = 0;
+
+		if (apage->container == TBM_RUN)
+			tbm_runs_to_bitmap(a, apage, 0);
+		awords = TBM_PAGE_WORDS(apage);
+
+		if (bpage->container == TBM_BITMAP)
+		{
+			const tbm_bitmapword *bwords = TBM_PAGE_WORDS(bpage);
+
+			for (i = 0; i < apage->nwords; i++)
+				awords[i] &= (i < bpage->nwords) ? bwords[i] : 0;
+		}
+		else
+		{
+			/* Clear the gaps between b's runs */
+			const TBMRun *bruns = TBM_PAGE_RUNS(bpage);
+			int			limit = apage->nwords * TBM_BITS_PER_BITMAPWORD;
+			int			next = 1;
+
+			for (j = 0; j < bpage->nruns && next <= limit; j++)
+			{
+				if (bruns[j].first > next)
+					tbm_clear_range(awords, next, Min(bruns[j].first - 1, limit));
+				next = bruns[j].last + 1;
+			}
+			if (next <= limit)
+				tbm_clear_range(awords, next, limit);
+		}
+
+		for (i = 0; i < apage->nwords; i++)
+		{
+			tbm_bitmapword w = awords[i];
+
+			if (w != 0)
+			{
+				nwords = i + 1;
+				for (; w != 0; w &= w - 1)
+					n++;
+			}
+		}
+		apage->nwords = nwords;
+
+		/*
+		 * Switch back to an array if it takes less than half the room of the
+		 * bitmap, so that a page does not go back and forth; likewise to runs
+		 * for a bitmap outside the entry.
+		 */
+		if (n > 0 && n <= TBM_MAX_ARRAY(nwords) / 2)
+		{
+			OffsetNumber *result;
+
+			result = (OffsetNumber *) palloc(n * sizeof(OffsetNumber));
+			tbm_extract_offsets(awords, nwords, result);
+			tbm_set_array(a, apage, result, n);
+			pfree(result);
+		}
+		else if (n > 0 && apage->external)
+			tbm_bitmap_to_runs(a, apage, nwords);
 	}
+
+	return n == 0;
 }
 
 /*
@@ -611,6 +1696,7 @@ tbm_begin_iterate(TIDBitmap *tbm)
 	iterator->spageptr = 0;
 	iterator->schunkptr = 0;
 	iterator->schunkbit = 0;
+	MemSet(&iterator->lossypage, 0, sizeof(TBMPage));
 
 	/*
 	 * If we have a hashtable, create and fill the sorted page lists, unless
@@ -621,22 +1707,22 @@ tbm_begin_iterate(TIDBitmap *tbm)
 	if (tbm->status == TBM_HASH && !tbm->iterating)
 	{
 		HASH_SEQ_STATUS status;
-		PagetableEntry *page;
+		TBMPage    *page;
 		int			npages;
 		int			nchunks;
 
 		if (!tbm->spages && tbm->npages > 0)
-			tbm->spages = (PagetableEntry **)
+			tbm->spages = (TBMPage **)
 				MemoryContextAlloc(tbm->mcxt,
-								   tbm->npages * sizeof(PagetableEntry *));
+								   tbm->npages * sizeof(TBMPage *));
 		if (!tbm->schunks && tbm->nchunks > 0)
-			tbm->schunks = (PagetableEntry **)
+			tbm->schunks = (TBMPage **)
 				MemoryContextAlloc(tbm->mcxt,
-								   tbm->nchunks * sizeof(PagetableEntry *));
+								   tbm->nchunks * sizeof(TBMPage *));
 
 		hash_seq_init(&status, tbm->pagetable);
 		npages = nchunks = 0;
-		while ((page = (PagetableEntry *) hash_seq_search(&status)) != NULL)
+		while ((page = (TBMPage *) hash_seq_search(&status)) != NULL)
 		{
 			if (page->ischunk)
 				tbm->schunks[nchunks++] = page;
@@ -646,10 +1732,10 @@ tbm_begin_iterate(TIDBitmap *tbm)
 		Assert(npages == tbm->npages);
 		Assert(nchunks == tbm->nchunks);
 		if (npages > 1)
-			qsort(tbm->spages, npages, sizeof(PagetableEntry *),
+			qsort(tbm->spages, npages, sizeof(TBMPage *),
 				  tbm_comparator);
 		if (nchunks > 1)
-			qsort(tbm->schunks, nchunks, sizeof(PagetableEntry *),
+			qsort(tbm->schunks, nchunks, sizeof(TBMPage *),
 				  tbm_comparator);
 	}
 
@@ -751,7 +1837,7 @@ tbm_generic_iterate(GenericBMIterator *iterator)
 				StreamBMIterator *streamIterator = iterator->impl.stream;
 				TBMIterateResult *output = NULL;
 
-				MemSet(&streamIterator->entry, 0, sizeof(PagetableEntry));
+				tbm_reset_entry(&streamIterator->entry);
 				if (streamIterator->pull(streamIterator, &streamIterator->entry))
 				{
 					output = &streamIterator->output;
@@ -774,7 +1860,6 @@ static bool
 tbm_iterate_page(PagetableEntry *page, TBMIterateResult *output)
 {
 	int			ntuples;
-	int			wordnum;
 
 	if (page->ischunk)
 	{
@@ -784,31 +1869,132 @@ tbm_iterate_page(PagetableEntry *page, TBMIterateResult *output)
 	else
 	{
 		/* scan bitmap to extract individual offset numbers */
-		ntuples = 0;
-		for (wordnum = 0; wordnum < WORDS_PER_PAGE; wordnum++)
+		ntuples = tbm_extract_offsets(page->words, page->nwords,
+									  output->offsets);
+		output->recheck = page->recheck;
+	}
+
+	output->blockno = page->blockno;
+	output->ntuples = ntuples;
+
+	return true;
+}
+
+/*
+ * tbm_extract_page - get a TBMIterateResult from a page of a TIDBitmap.
+ */
+static void
+tbm_extract_page(const TBMPage *page, TBMIterateResult *output)
+{
+	int			ntuples;
+
+	if (page->ischunk)
+	{
+		ntuples = -1;
+		output->recheck = true;
+	}
+	else
+	{
+		if (page->container == TBM_ARRAY)
 		{
-			tbm_bitmapword w = page->words[wordnum];
+			ntuples = page->noffsets;
+			memcpy(output->offsets, TBM_PAGE_OFFSETS(page),
+				   ntuples * sizeof(OffsetNumber));
+		}
+		else if (page->container == TBM_RUN)
+		{
+			const TBMRun *runs = TBM_PAGE_RUNS(page);
+			int			i;
 
-			if (w != 0)
+			ntuples = 0;
+			for (i = 0; i < page->nruns; i++)
 			{
-				int			off = wordnum * TBM_BITS_PER_BITMAPWORD + 1;
+				int			off;
 
-				while (w != 0)
-				{
-					if (w & 1)
-						output->offsets[ntuples++] = (OffsetNumber) off;
-					off++;
-					w >>= 1;
-				}
+				for (off = runs[i].first; off <= runs[i].last; off++)
+					output->offsets[ntuples++] = (OffsetNumber) off;
 			}
 		}
+		else
+			ntuples = tbm_extract_offsets(TBM_PAGE_WORDS(page), page->nwords,
+										  output->offsets);
 		output->recheck = page->recheck;
 	}
 
 	output->blockno = page->blockno;
 	output->ntuples = ntuples;
+}
 
-	return true;
+/*
+ * tbm_expand_page - make a PagetableEntry out of a page of a TIDBitmap.
+ *
+ * The words of a lossy chunk are not streamed, only its first page.
+ */
+static void
+tbm_expand_page(const TBMPage *page, PagetableEntry *e)
+{
+	tbm_reset_entry(e);
+	e->blockno = page->blockno;
+	e->ischunk = page->ischunk;
+	e->recheck = page->recheck;
+
+	if (page->ischunk)
+		return;
+
+	if (page->container == TBM_ARRAY)
+	{
+		const OffsetNumber *offsets = TBM_PAGE_OFFSETS(page);
+		int			i;
+
+		for (i = 0; i < page->noffsets; i++)
+			e->words[WORDNUM(offsets[i] - 1)] |=
+				((tbm_bitmapword) 1 << BITNUM(offsets[i] - 1));
+		if (page->noffsets > 0)
+			e->nwords = WORDNUM(offsets[page->noffsets - 1] - 1) + 1;
+	}
+	else if (page->container == TBM_RUN)
+	{
+		const TBMRun *runs = TBM_PAGE_RUNS(page);
+		int			i;
+
+		for (i = 0; i < page->nruns; i++)
+			tbm_set_range(e->words, runs[i].first, runs[i].last);
+		if (page->nruns > 0)
+			e->nwords = WORDNUM(runs[page->nruns - 1].last - 1) + 1;
+	}
+	else
+	{
+		memcpy(e->words, TBM_PAGE_WORDS(page),
+			   page->nwords * sizeof(tbm_bitmapword));
+		e->nwords = page->nwords;
+	}
+}
+
+/*
+ * tbm_reset_entry - empty a PagetableEntry
+ */
+void
+tbm_reset_entry(PagetableEntry *e)
+{
+	MemSet(e->words, 0, e->nwords * sizeof(tbm_bitmapword));
+	e->blockno = InvalidBlockNumber;
+	e->ischunk = false;
+	e->recheck = false;
+	e->nwords = 0;
+}
+
+/*
+ * tbm_copy_entry - copy a PagetableEntry over another
+ */
+void
+tbm_copy_entry(PagetableEntry *dst, const PagetableEntry *src)
+{
+	if (dst->nwords > src->nwords)
+		MemSet(dst->words + src->nwords, 0,
+			   (dst->nwords - src->nwords) * sizeof(tbm_bitmapword));
+	memcpy(dst, src,
+		   offsetof(PagetableEntry, words) +
+		   src->nwords * sizeof(tbm_bitmapword));
 }
 
 /*
@@ -824,14 +2010,14 @@ tbm_iterate_page(PagetableEntry *page, TBMIterateResult *output)
 TBMIterateResult *
 tbm_iterate(TBMIterator *iterator)
 {
-	PagetableEntry *e;
+	const TBMPage *page;
 	bool		more;
 	TBMIterateResult *output = &(iterator->output);
 
-	e = tbm_next_page(iterator, &more);
-	if (more && e)
+	page = tbm_next_page(iterator, &more);
+	if (more && page)
 	{
-		tbm_iterate_page(e, output);
+		tbm_extract_page(page, output);
 		return output;
 	}
 	return NULL;
@@ -840,10 +2026,11 @@ tbm_iterate(TBMIterator *iterator)
 /*
  * tbm_next_page - actually traverse the TIDBitmap
  *
- * Store the next block of matches in nextpage.
+ * Returns the page with the next block of matches.  A lossy page is
+ * returned in the iterator, and is valid until the next call.
  */
 
-static PagetableEntry *
+static const TBMPage *
 tbm_next_page(TBMIterator *iterator, bool *more)
 {
 	TIDBitmap  *tbm = iterator->tbm;
@@ -857,7 +2044,8 @@ tbm_next_page(TBMIterator *iterator, bool *more)
 	 */
 	while (iterator->schunkptr < tbm->nchunks)
 	{
-		PagetableEntry *chunk = tbm->schunks[iterator->schunkptr];
+		TBMPage    *chunk = tbm->schunks[iterator->schunkptr];
+		const tbm_bitmapword *words = TBM_PAGE_WORDS(chunk);
 		int			schunkbit = iterator->schunkbit;
 
 		while (schunkbit < PAGES_PER_CHUNK)
@@ -865,7 +2053,7 @@ tbm_next_page(TBMIterator *iterator, bool *more)
 			int			wordnum = WORDNUM(schunkbit);
 			int			bitnum = BITNUM(schunkbit);
 
-			if ((chunk->words[wordnum] & ((tbm_bitmapword) 1 << bitnum)) != 0)
+			if ((words[wordnum] & ((tbm_bitmapword) 1 << bitnum)) != 0)
 				break;
 			schunkbit++;
 		}
@@ -885,8 +2073,8 @@ tbm_next_page(TBMIterator *iterator, bool *more)
 	 */
 	if (iterator->schunkptr < tbm->nchunks)
 	{
-		PagetableEntry *chunk = tbm->schunks[iterator->schunkptr];
-		PagetableEntry *nextpage;
+		TBMPage    *chunk = tbm->schunks[iterator->schunkptr];
+		TBMPage    *nextpage = &iterator->lossypage;
 		BlockNumber chunk_blockno;
 
 		chunk_blockno = chunk->blockno + iterator->schunkbit;
@@ -894,8 +2082,8 @@ tbm_next_page(TBMIterator *iterator, bool *more)
 			chunk_blockno < tbm->spages[iterator->spageptr]->blockno)
 		{
 			/* Return a lossy page indicator from the chunk */
-			nextpage = (PagetableEntry *) palloc(sizeof(PagetableEntry));
 			nextpage->ischunk = true;
+			nextpage->recheck = true;
 			nextpage->blockno = chunk_blockno;
 			iterator->schunkbit++;
 			return nextpage;
@@ -904,7 +2092,7 @@ tbm_next_page(TBMIterator *iterator, bool *more)
 
 	if (iterator->spageptr < tbm->npages)
 	{
-		PagetableEntry *e;
+		TBMPage    *e;
 
 		/* In ONE_PAGE state, we don't allocate an spages[] array */
 		if (tbm->status == TBM_ONE_PAGE)
@@ -975,14 +2163,14 @@ tbm_generic_end_iterate(GenericBMIterator *iterator)
 }
 
 /*
- * tbm_find_pageentry - find a PagetableEntry for the pageno
+ * tbm_find_pageentry - find a TBMPage for the pageno
  *
  * Returns NULL if there is no non-lossy entry for the pageno.
  */
-static const PagetableEntry *
+static const TBMPage *
 tbm_find_pageentry(const TIDBitmap *tbm, BlockNumber pageno)
 {
-	const PagetableEntry *page;
+	const TBMPage *page;
 
 	if (tbm->nentries == 0)		/* in case pagetable doesn't exist */
 		return NULL;
@@ -996,9 +2184,9 @@ tbm_find_pageentry(const TIDBitmap *tbm, BlockNumber pageno)
 		return page;
 	}
 
-	page = (PagetableEntry *) hash_search(tbm->pagetable,
-										  (void *) &pageno,
-										  HASH_FIND, NULL);
+	page = (TBMPage *) hash_search(tbm->pagetable,
+								   (void *) &pageno,
+								   HASH_FIND, NULL);
 	if (page == NULL)
 		return NULL;
 	if (page->ischunk)
@@ -1007,17 +2195,17 @@ tbm_find_pageentry(const TIDBitmap *tbm, BlockNumber pageno)
 }
 
 /*
- * tbm_get_pageentry - find or create a PagetableEntry for the pageno
+ * tbm_get_pageentry - find or create a TBMPage for the pageno
  *
  * If new, the entry is marked as an exact (non-chunk) entry.
  *
  * This may cause the table to exceed the desired memory size.  It is
  * up to the caller to call tbm_lossify() at the next safe point if so.
  */
-static PagetableEntry *
+static TBMPage *
 tbm_get_pageentry(TIDBitmap *tbm, BlockNumber pageno)
 {
-	PagetableEntry *page;
+	TBMPage    *page;
 	bool		found;
 
 	if (tbm->status == TBM_EMPTY)
@@ -1039,16 +2227,15 @@ tbm_get_pageentry(TIDBitmap *tbm, BlockNumber pageno)
 		}
 
 		/* Look up or create an entry */
-		page = (PagetableEntry *) hash_search(tbm->pagetable,
-											  (void *) &pageno,
-											  HASH_ENTER, &found);
+		page = (TBMPage *) hash_search(tbm->pagetable,
+									   (void *) &pageno,
+									   HASH_ENTER, &found);
 	}
 
 	/* Initialize it if not present before */
 	if (!found)
 	{
-		MemSet(page, 0, sizeof(PagetableEntry));
-		page->blockno = pageno;
+		tbm_init_page(tbm, page, pageno, false);
 		/* must count it too */
 		tbm->nentries++;
 		tbm->npages++;
@@ -1063,7 +2250,7 @@ tbm_get_pageentry(TIDBitmap *tbm, BlockNumber pageno)
 static bool
 tbm_page_is_lossy(const TIDBitmap *tbm, BlockNumber pageno)
 {
-	PagetableEntry *page;
+	TBMPage    *page;
 	BlockNumber chunk_pageno;
 	int			bitno;
 
@@ -1074,15 +2261,15 @@ tbm_page_is_lossy(const TIDBitmap *tbm, BlockNumber pageno)
 
 	bitno = pageno % PAGES_PER_CHUNK;
 	chunk_pageno = pageno - bitno;
-	page = (PagetableEntry *) hash_search(tbm->pagetable,
-										  (void *) &chunk_pageno,
-										  HASH_FIND, NULL);
+	page = (TBMPage *) hash_search(tbm->pagetable,
+								   (void *) &chunk_pageno,
+								   HASH_FIND, NULL);
 	if (page != NULL && page->ischunk)
 	{
 		int			wordnum = WORDNUM(bitno);
 		int			bitnum = BITNUM(bitno);
 
-		if ((page->words[wordnum] & ((tbm_bitmapword) 1 << bitnum)) != 0)
+		if ((TBM_PAGE_WORDS(page)[wordnum] & ((tbm_bitmapword) 1 << bitnum)) != 0)
 			return true;
 	}
 	return false;
@@ -1097,7 +2284,7 @@ tbm_page_is_lossy(const TIDBitmap *tbm, BlockNumber pageno)
 static void
 tbm_mark_page_lossy(TIDBitmap *tbm, BlockNumber pageno)
 {
-	PagetableEntry *page;
+	TBMPage    *page;
 	bool		found;
 	BlockNumber chunk_pageno;
 	int			bitno;
@@ -1117,28 +2304,29 @@ tbm_mark_page_lossy(TIDBitmap *tbm, BlockNumber pageno)
 	 */
 	if (bitno != 0)
 	{
-		if (hash_search(tbm->pagetable,
-						(void *) &pageno,
-						HASH_REMOVE, NULL) != NULL)
+		/* the removed entry stays valid until the next insertion */
+		page = (TBMPage *) hash_search(tbm->pagetable,
+									   (void *) &pageno,
+									   HASH_REMOVE, NULL);
+		if (page != NULL)
 		{
 			/* It was present, so adjust counts */
-			tbm->nentries_hwm = Max(tbm->nentries_hwm, tbm->nentries);
+			tbm->nbytes_hwm = Max(tbm->nbytes_hwm, TBM_NBYTES(tbm));
+			tbm_free_container(tbm, page);
 			tbm->nentries--;
 			tbm->npages--;		/* assume it must have been non-lossy */
 		}
 	}
 
 	/* Look up or create entry for chunk-header page */
-	page = (PagetableEntry *) hash_search(tbm->pagetable,
-										  (void *) &chunk_pageno,
-										  HASH_ENTER, &found);
+	page = (TBMPage *) hash_search(tbm->pagetable,
+								   (void *) &chunk_pageno,
+								   HASH_ENTER, &found);
 
 	/* Initialize it if not present before */
 	if (!found)
 	{
-		MemSet(page, 0, sizeof(PagetableEntry));
-		page->blockno = chunk_pageno;
-		page->ischunk = true;
+		tbm_init_page(tbm, page, chunk_pageno, true);
 		/* must count it too */
 		tbm->nentries++;
 		tbm->nchunks++;
@@ -1146,11 +2334,10 @@ tbm_mark_page_lossy(TIDBitmap *tbm, BlockNumber pageno)
 	else if (!page->ischunk)
 	{
 		/* chunk header page was formerly non-lossy, make it lossy */
-		MemSet(page, 0, sizeof(PagetableEntry));
-		page->blockno = chunk_pageno;
-		page->ischunk = true;
+		tbm_free_container(tbm, page);
+		tbm_init_page(tbm, page, chunk_pageno, true);
 		/* we assume it had some tuple bit(s) set, so mark it lossy */
-		page->words[0] = ((tbm_bitmapword) 1 << 0);
+		TBM_PAGE_WORDS(page)[0] = ((tbm_bitmapword) 1 << 0);
 		/* adjust counts */
 		tbm->nchunks++;
 		tbm->npages--;
@@ -1159,7 +2346,7 @@ tbm_mark_page_lossy(TIDBitmap *tbm, BlockNumber pageno)
 	/* Now set the original target page's bit */
 	wordnum = WORDNUM(bitno);
 	bitnum = BITNUM(bitno);
-	page->words[wordnum] |= ((tbm_bitmapword) 1 << bitnum);
+	TBM_PAGE_WORDS(page)[wordnum] |= ((tbm_bitmapword) 1 << bitnum);
 }
 
 /*
@@ -1169,22 +2356,22 @@ static void
 tbm_lossify(TIDBitmap *tbm)
 {
 	HASH_SEQ_STATUS status;
-	PagetableEntry *page;
+	TBMPage    *page;
 
 	/*
 	 * XXX Really stupid implementation: this just lossifies pages in
 	 * essentially random order.  We should be paying some attention to the
 	 * number of bits set in each page, instead.
 	 *
-	 * Since we are called as soon as nentries exceeds maxentries, we should
-	 * push nentries down to significantly less than maxentries, or else we'll
-	 * just end up doing this again very soon.  We shoot for maxentries/2.
+	 * Since we are called as soon as the memory used exceeds maxbytes, we
+	 * should push it down to significantly less than maxbytes, or else we'll
+	 * just end up doing this again very soon.  We shoot for maxbytes/2.
 	 */
 	Assert(!tbm->iterating);
 	Assert(tbm->status == TBM_HASH);
 
 	hash_seq_init(&status, tbm->pagetable);
-	while ((page = (PagetableEntry *) hash_seq_search(&status)) != NULL)
+	while ((page = (TBMPage *) hash_seq_search(&status)) != NULL)
 	{
 		if (page->ischunk)
 			continue;			/* already a chunk header */
@@ -1199,7 +2386,7 @@ tbm_lossify(TIDBitmap *tbm)
 		/* This does the dirty work ... */
 		tbm_mark_page_lossy(tbm, page->blockno);
 
-		if (tbm->nentries <= tbm->maxentries / 2)
+		if (TBM_NBYTES(tbm) <= tbm->maxbytes / 2)
 		{
 			/* we have done enough */
 			hash_seq_term(&status);
@@ -1215,26 +2402,26 @@ tbm_lossify(TIDBitmap *tbm)
 
 	/*
 	 * With a big bitmap and small work_mem, it's possible that we cannot get
-	 * under maxentries.  Again, if that happens, we'd end up uselessly
-	 * calling tbm_lossify over and over.  To prevent this from becoming a
-	 * performance sink, force maxentries up to at least double the current
-	 * number of entries.  (In essence, we're admitting inability to fit
-	 * within work_mem when we do this.)  Note that this test will not fire if
-	 * we broke out of the loop early; and if we didn't, the current number of
-	 * entries is simply not reducible any further.
+	 * under maxbytes.  Again, if that happens, we'd end up uselessly calling
+	 * tbm_lossify over and over.  To prevent this from becoming a
+	 * performance sink, force maxbytes up to at least double the memory
+	 * currently used.  (In essence, we're admitting inability to fit within
+	 * work_mem when we do this.)  Note that this test will not fire if we
+	 * broke out of the loop early; and if we didn't, the memory used is
+	 * simply not reducible any further.
 	 */
-	if (tbm->nentries > tbm->maxentries / 2)
-		tbm->maxentries = Min(tbm->nentries, (INT_MAX - 1) / 2) * 2;
+	if (TBM_NBYTES(tbm) > tbm->maxbytes / 2)
+		tbm->maxbytes = TBM_NBYTES(tbm) * 2;
 }
 
 /*
- * qsort comparator to handle PagetableEntry pointers.
+ * qsort comparator to handle TBMPage pointers.
  */
 static int
 tbm_comparator(const void *left, const void *right)
 {
-	BlockNumber l = (*((PagetableEntry *const *) left))->blockno;
-	BlockNumber r = (*((PagetableEntry *const *) right))->blockno;
+	BlockNumber l = (*((TBMPage *const *) left))->blockno;
+	BlockNumber r = (*((TBMPage *const *) right))->blockno;
 
 	if (l < r)
 		return -1;
@@ -1427,7 +2614,7 @@ static bool
 tbm_stream_block(StreamBMIterator *iterator, PagetableEntry *e)
 {
 	TBMIterator *hashIterator = iterator->input.hash;
-	PagetableEntry *next = iterator->nextentry;
+	const TBMPage *next = iterator->nextentry;
 	bool		more;
 
 	Assert(iterator->node->type == BMS_INDEX);
@@ -1435,7 +2622,7 @@ tbm_stream_block(StreamBMIterator *iterator, PagetableEntry *e)
 	/* have we already got an entry? */
 	if (next && iterator->nextblock <= next->blockno)
 	{
-		memcpy(e, next, sizeof(PagetableEntry));
+		tbm_expand_page(next, e);
 		return true;
 	}
 
@@ -1444,7 +2631,7 @@ tbm_stream_block(StreamBMIterator *iterator, PagetableEntry *e)
 	if (more)
 	{
 		Assert(iterator->nextentry);
-		memcpy(e, iterator->nextentry, sizeof(PagetableEntry));
+		tbm_expand_page(iterator->nextentry, e);
 	}
 	iterator->nextblock++;
 	return more;
@@ -1575,10 +2762,10 @@ restart:
 	foreach(map, iterator->input.stream)
 	{
 		StreamBMIterator *inIter = lfirst(map);
-		PagetableEntry *new;
+		PagetableEntry *new = &inIter->entry;
 		bool		r;
 
-		new = (PagetableEntry *) palloc0(sizeof(PagetableEntry));
+		tbm_reset_entry(new);
 
 		/* set the desired block */
 		inIter->nextblock = iterator->nextblock;
@@ -1604,8 +2791,6 @@ restart:
 		}
 		else
 		{
-			pfree(new);
-
 			if (n->type == BMS_AND)
 			{
 				/*
@@ -1633,7 +2818,7 @@ restart:
 		{
 			if (e->blockno == InvalidBlockNumber)
 			{
-				memcpy(e, tmp, sizeof(PagetableEntry));
+				tbm_copy_entry(e, tmp);
 				continue;
 			}
 
@@ -1646,17 +2831,30 @@ restart:
 				e->ischunk = true;
 				/* XXX: we can just return now... I think :) */
 				iterator->nextblock = minblockno + 1;
-				list_free_deep(matches);
+				list_free(matches);
 				return res;
 			}
 
-			/* union/intersect existing output and new matches */
-			for (wordnum = 0; wordnum < WORDS_PER_PAGE; wordnum++)
+			/*
+			 * union/intersect existing output and new matches, over the
+			 * words in use only
+			 */
+			if (n->type == BMS_OR)
 			{
-				if (n->type == BMS_OR)
+				for (wordnum = 0; wordnum < tmp->nwords; wordnum++)
 					e->words[wordnum] |= tmp->words[wordnum];
-				else
-					e->words[wordnum] &= tmp->words[wordnum];
+				e->nwords = Max(e->nwords, tmp->nwords);
+			}
+			else
+			{
+				for (wordnum = 0; wordnum < e->nwords; wordnum++)
+				{
+					if (wordnum < tmp->nwords)
+						e->words[wordnum] &= tmp->words[wordnum];
+					else
+						e->words[wordnum] = 0;
+				}
+				e->nwords = Min(e->nwords, tmp->nwords);
 			}
 			e->recheck |= tmp->recheck;
 		}
@@ -1680,12 +2878,12 @@ restart:
 	{
 		/* start again */
 		empty = false;
-		MemSet(e->words, 0, sizeof(tbm_bitmapword) * WORDS_PER_PAGE);
-		list_free_deep(matches);
+		tbm_reset_entry(e);
+		list_free(matches);
 		goto restart;
 	}
 	else
-		list_free_deep(matches);
+		list_free(matches);
 	if (res)
 		iterator->nextblock = minblockno + 1;
 
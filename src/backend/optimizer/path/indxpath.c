@@ -807,10 +807,13 @@ get_index_paths(PlannerInfo *root, RelOptInfo *rel,
 		 * pool and we want to avoid decompressing blocks multiple times.  So,
 		 * only consider bitmap paths because they are processed in TID order.
 		 * The appendonlyam.c module will optimize fetches in TID order by keeping
-		 * the last decompressed block between fetch calls.
+		 * the last decompressed block between fetch calls.  Index-only scans
+		 * are fine though, they tell the visibility of the rows without
+		 * reading them, see appendonly_indexonly.h.
 		 */
 		if (index->amhasgettuple &&
-			rel->relstorage == RELSTORAGE_HEAP)
+			(rel->relstorage == RELSTORAGE_HEAP ||
+			 ipath->path.pathtype == T_IndexOnlyScan))
 			add_path(rel, (Path *) ipath);
 
 		if (index->amhasgetbitmap &&
@@ -346,6 +346,10 @@ find_minmax_aggs_walker(Node *node, List **context)
 			return true;
 		/* note: we do not care if DISTINCT is mentioned ... */
 
+		/* CDB: nor the stages of an aggregate split by eager aggregation. */
+		if (aggref->aggstage != AGGSTAGE_NORMAL)
+			return true;
+
 		/*
 		 * We might implement the optimization when a FILTER clause is present
 		 * by adding the filter to the quals of the generated subquery.  For
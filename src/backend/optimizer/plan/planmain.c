@@ -362,6 +362,7 @@ PlannerConfig *DefaultPlannerConfig(void)
 
 	c1->gp_enable_minmax_optimization = gp_enable_minmax_optimization;
 	c1->gp_enable_multiphase_agg = gp_enable_multiphase_agg;
+	c1->gp_enable_eager_agg = gp_enable_eager_agg;
 	c1->gp_enable_preunique = gp_enable_preunique;
 	c1->gp_eager_preunique = gp_eager_preunique;
 	c1->gp_hashagg_streambottom = gp_hashagg_streambottom;
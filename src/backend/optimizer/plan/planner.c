@@ -664,6 +664,14 @@ subquery_planner(PlannerGlobal *glob, Query *parse,
 			root->hasLateralRTEs = true;
 	}
 
+	/*
+	 * CDB: Aggregate the rows of a table partially before joining it, if
+	 * that pays.  The table becomes a subquery, which must be in place
+	 * before inheritance expansion and expression preprocessing.
+	 */
+	if (!hasOuterJoins)
+		push_down_eager_aggregation(root);
+
 	/*
 	 * Preprocess RowMark information.  We need to do this after subquery
 	 * pullup (so that all non-inherited RTEs are present) and before
@@ -0,0 +1,901 @@
+/*-------------------------------------------------------------------------
+ *
+ * prepeageragg.c
+ *	  Push partial aggregation below the joins of a query.
+ *
+ * In a query like
+ *
+ *		SELECT d.name, sum(f.amount)
+ *		FROM fact f JOIN dim d ON f.dim_id = d.id
+ *		GROUP BY d.name;
+ *
+ * the aggregate only needs the columns of 'fact', but is computed above the
+ * join, so that every row of 'fact' is redistributed and joined before it
+ * is aggregated.  cdbgroup.c can split the aggregation in two stages, but
+ * both stages are above the join.  When there are many fact rows per join
+ * key, it is cheaper to aggregate the fact rows partially, grouped by the
+ * join key, in the segment the rows are stored in, and to join and finalize
+ * the partial results:
+ *
+ *		SELECT d.name, sum_final(f.sum)
+ *		FROM (SELECT dim_id, sum_partial(amount) AS sum
+ *			  FROM fact GROUP BY dim_id) f
+ *			 JOIN dim d ON f.dim_id = d.id
+ *		GROUP BY d.name;
+ *
+ * A joined row of the original query is a pair of a fact row and a row of
+ * the other tables.  The partial aggregate of a group of fact rows stands
+ * for all of them: they join to the same rows, as they agree on the join
+ * keys, and the combine function of the aggregate adds up partial results
+ * as if their rows were aggregated together.  A group joining to several
+ * rows is counted once per row, just as its fact rows would have been.
+ *
+ * The partial aggregation is expressed as a subquery, which takes the place
+ * of the fact table in the range table.  Its aggregates are in
+ * AGGSTAGE_PARTIAL, and those of the outer query are turned into their
+ * AGGSTAGE_FINAL counterparts; cdb_grouping_planner() plans both without
+ * splitting them again.
+ *
+ * This must be done before expression preprocessing and inheritance
+ * expansion, so that the subquery is planned like any other: a partitioned
+ * fact table is expanded within it.
+ *
+ * Portions Copyright (c) 2012-Present Pivotal Software, Inc.
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/optimizer/prep/prepeageragg.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/htup_details.h"
+#include "catalog/pg_aggregate.h"
+#include "catalog/pg_type.h"
+#include "cdb/cdbvars.h"
+#include "nodes/makefuncs.h"
+#include "nodes/nodeFuncs.h"
+#include "optimizer/clauses.h"
+#include "optimizer/cost.h"
+#include "optimizer/pathnode.h"
+#include "optimizer/prep.h"
+#include "optimizer/tlist.h"
+#include "optimizer/var.h"
+#include "parser/parse_oper.h"
+#include "parser/parsetree.h"
+#include "rewrite/rewriteManip.h"
+#include "utils/lsyscache.h"
+#include "utils/selfuncs.h"
+#include "utils/syscache.h"
+
+/*
+ * What is known of the query, once it is found to qualify.
+ */
+typedef struct EagerAggInfo
+{
+	Index		factRelid;		/* rt index of the aggregated table */
+
+	List	   *groupVars;		/* Vars of the table the query groups by */
+	List	   *keyVars;		/* Vars the partial aggregate groups by */
+	List	   *keyClauses;		/* SortGroupClause of each of keyVars */
+
+	List	   *factQuals;		/* conjuncts on the table alone */
+	int			numJoinClauses; /* equality conjuncts joining the table */
+
+	List	   *aggrefs;		/* distinct Aggrefs of the query */
+} EagerAggInfo;
+
+typedef struct
+{
+	EagerAggInfo *info;
+	int			numKeys;
+} eager_agg_replace_context;
+
+static bool collect_inner_joins(Node *jtnode, Relids *relids, List **quals);
+static void flatten_jointree_quals(PlannerInfo *root, Node *jtnode);
+static List *flatten_conjuncts(Node *qual, List *conjuncts);
+static bool aggref_is_pushable(Aggref *aggref);
+static Oid	partial_agg_type(Aggref *aggref);
+static bool var_in_list(Var *var, List *vars);
+static bool add_key_var(EagerAggInfo *info, Var *var, Oid eqop);
+static bool classify_fact_uses(EagerAggInfo *info, Node *node);
+static bool classify_conjunct(EagerAggInfo *info, Node *clause);
+static bool eager_agg_is_cheaper(PlannerInfo *root, EagerAggInfo *info);
+static void push_down_partial_agg(PlannerInfo *root, EagerAggInfo *info);
+static Node *rewrite_jointree_quals(Node *jtnode, EagerAggInfo *info,
+					   eager_agg_replace_context *context);
+static Node *eager_agg_replace_mutator(Node *node,
+						  eager_agg_replace_context *context);
+
+
+/*
+ * push_down_eager_aggregation
+ *	  Aggregate the rows of a table partially before they are joined, if the
+ *	  query allows it and the estimates say it pays.
+ *
+ * The query must be an inner join of base relations, with aggregates that
+ * all read the same table, the fact table, and can be computed in two
+ * stages.  The columns of the fact table may be used elsewhere only as the
+ * grouping columns of the query, or as a side of an equality join clause.
+ * Those are the columns the partial aggregate groups by.
+ */
+void
+push_down_eager_aggregation(PlannerInfo *root)
+{
+	Query	   *parse = root->parse;
+	EagerAggInfo info;
+	Relids		relids = NULL;
+	Relids		aggrelids = NULL;
+	List	   *conjuncts = NIL;
+	List	   *items;
+	RangeTblEntry *rte;
+	ListCell   *lc;
+
+	if (Gp_role != GP_ROLE_DISPATCH ||
+		!root->config->gp_enable_eager_agg ||
+		!root->config->gp_enable_multiphase_agg)
+		return;
+
+	if (parse->commandType != CMD_SELECT ||
+		parse->utilityStmt != NULL ||
+		!parse->hasAggs ||
+		parse->hasSubLinks ||
+		parse->hasWindowFuncs ||
+		parse->setOperations != NULL ||
+		parse->rowMarks != NIL ||
+		parse->scatterClause != NIL ||
+		root->hasLateralRTEs ||
+		root->append_rel_list != NIL ||
+		root->placeholder_list != NIL)
+		return;
+
+	/* Grouping extensions need all of their rows in one place. */
+	foreach(lc, parse->groupClause)
+	{
+		if (!IsA(lfirst(lc), SortGroupClause))
+			return;
+	}
+
+	/* Correlated references would have to be adjusted for the subquery. */
+	if (root->query_level > 1 &&
+		contain_vars_of_level_or_above((Node *) parse, 1))
+		return;
+
+	if (!collect_inner_joins((Node *) parse->jointree, &relids, &conjuncts) ||
+		bms_num_members(relids) < 2)
+	{
+		bms_free(relids);
+		return;
+	}
+
+	/*
+	 * We look at the columns the query really reads, not at the outputs of
+	 * the joins.  Expression preprocessing would flatten the join alias
+	 * Vars anyway.
+	 */
+	if (root->hasJoinRTEs)
+	{
+		parse->targetList = (List *)
+			flatten_join_alias_vars(root, (Node *) parse->targetList);
+		parse->havingQual = flatten_join_alias_vars(root, parse->havingQual);
+		flatten_jointree_quals(root, (Node *) parse->jointree);
+
+		list_free(conjuncts);
+		conjuncts = NIL;
+		(void) collect_inner_joins((Node *) parse->jointree, &relids, &conjuncts);
+	}
+
+	memset(&info, 0, sizeof(info));
+
+	/*
+	 * The aggregates must all be pushable, and read a single table.
+	 */
+	items = pull_var_clause((Node *) parse->targetList,
+							PVC_INCLUDE_AGGREGATES,
+							PVC_INCLUDE_PLACEHOLDERS);
+	items = list_concat(items,
+						pull_var_clause(parse->havingQual,
+										PVC_INCLUDE_AGGREGATES,
+										PVC_INCLUDE_PLACEHOLDERS));
+	foreach(lc, items)
+	{
+		Node	   *item = (Node *) lfirst(lc);
+
+		if (!IsA(item, Aggref))
+			continue;
+
+		if (!aggref_is_pushable((Aggref *) item))
+			return;
+
+		aggrelids = bms_join(aggrelids, pull_varnos(item));
+		if (!list_member(info.aggrefs, item))
+			info.aggrefs = lappend(info.aggrefs, item);
+	}
+
+	if (bms_membership(aggrelids) != BMS_SINGLETON)
+		return;
+	info.factRelid = bms_singleton_member(aggrelids);
+	if (!bms_is_member(info.factRelid, relids))
+		return;
+
+	rte = rt_fetch(info.factRelid, parse->rtable);
+	if (rte->rtekind != RTE_RELATION ||
+		rte->securityQuals != NIL ||
+		rte->pseudocols != NIL)
+		return;
+
+	/* The grouping columns of the fact table can be used freely. */
+	foreach(lc, parse->groupClause)
+	{
+		SortGroupClause *sgc = (SortGroupClause *) lfirst(lc);
+		TargetEntry *tle = get_sortgroupclause_tle(sgc, parse->targetList);
+		Var		   *var = (Var *) tle->expr;
+
+		if (!IsA(var, Var) ||
+			var->varno != info.factRelid ||
+			var->varlevelsup != 0 ||
+			var->varattno <= 0)
+			continue;
+
+		if (!var_in_list(var, info.groupVars))
+		{
+			info.groupVars = lappend(info.groupVars, var);
+			info.keyVars = lappend(info.keyVars, var);
+			info.keyClauses = lappend(info.keyClauses, copyObject(sgc));
+		}
+	}
+
+	/* Check the other uses of the fact table. */
+	foreach(lc, items)
+	{
+		Node	   *item = (Node *) lfirst(lc);
+
+		if (IsA(item, Aggref))
+			continue;
+		if (!classify_fact_uses(&info, item))
+			return;
+	}
+
+	foreach(lc, conjuncts)
+	{
+		if (!classify_conjunct(&info, (Node *) lfirst(lc)))
+			return;
+	}
+
+	if (info.numJoinClauses == 0)
+		return;
+
+	if (!eager_agg_is_cheaper(root, &info))
+		return;
+
+	push_down_partial_agg(root, &info);
+}
+
+/*
+ * Collect the relids and the conjuncts of a join tree made of inner joins
+ * of base relations.  Returns false if there is anything else in it.
+ */
+static bool
+collect_inner_joins(Node *jtnode, Relids *relids, List **quals)
+{
+	if (jtnode == NULL)
+		return true;
+
+	if (IsA(jtnode, RangeTblRef))
+	{
+		*relids = bms_add_member(*relids, ((RangeTblRef *) jtnode)->rtindex);
+		return true;
+	}
+	else if (IsA(jtnode, FromExpr))
+	{
+		FromExpr   *f = (FromExpr *) jtnode;
+		ListCell   *lc;
+
+		foreach(lc, f->fromlist)
+		{
+			if (!collect_inner_joins((Node *) lfirst(lc), relids, quals))
+				return false;
+		}
+		*quals = flatten_conjuncts(f->quals, *quals);
+		return true;
+	}
+	else if (IsA(jtnode, JoinExpr))
+	{
+		JoinExpr   *j = (JoinExpr *) jtnode;
+
+		if (j->jointype != JOIN_INNER)
+			return false;
+		if (!collect_inner_joins(j->larg, relids, quals) ||
+			!collect_inner_joins(j->rarg, relids, quals))
+			return false;
+		*quals = flatten_conjuncts(j->quals, *quals);
+		return true;
+	}
+
+	return false;
+}
+
+static void
+flatten_jointree_quals(PlannerInfo *root, Node *jtnode)
+{
+	if (jtnode == NULL || IsA(jtnode, RangeTblRef))
+		return;
+
+	if (IsA(jtnode, FromExpr))
+	{
+		FromExpr   *f = (FromExpr *) jtnode;
+		ListCell   *lc;
+
+		foreach(lc, f->fromlist)
+			flatten_jointree_quals(root, (Node *) lfirst(lc));
+		f->quals = flatten_join_alias_vars(root, f->quals);
+	}
+	else if (IsA(jtnode, JoinExpr))
+	{
+		JoinExpr   *j = (JoinExpr *) jtnode;
+
+		flatten_jointree_quals(root, j->larg);
+		flatten_jointree_quals(root, j->rarg);
+		j->quals = flatten_join_alias_vars(root, j->quals);
+	}
+}
+
+/*
+ * Append the conjuncts of a qual, whether an AND clause or an implicit-AND
+ * list, to 'conjuncts'.
+ */
+static List *
+flatten_conjuncts(Node *qual, List *conjuncts)
+{
+	ListCell   *lc;
+
+	if (qual == NULL)
+		return conjuncts;
+
+	if (IsA(qual, List))
+	{
+		foreach(lc, (List *) qual)
+			conjuncts = flatten_conjuncts((Node *) lfirst(lc), conjuncts);
+	}
+	else if (and_clause(qual))
+	{
+		foreach(lc, ((BoolExpr *) qual)->args)
+			conjuncts = flatten_conjuncts((Node *) lfirst(lc), conjuncts);
+	}
+	else
+		conjuncts = lappend(conjuncts, qual);
+
+	return conjuncts;
+}
+
+/*
+ * Can the aggregate be split into a partial aggregate computed below the
+ * joins, and a final one above them?
+ */
+static bool
+aggref_is_pushable(Aggref *aggref)
+{
+	HeapTuple	aggTuple;
+	Form_pg_aggregate aggform;
+	bool		result;
+
+	if (aggref->agglevelsup != 0 ||
+		aggref->aggstage != AGGSTAGE_NORMAL ||
+		aggref->aggkind != AGGKIND_NORMAL ||
+		aggref->aggdistinct != NIL ||
+		aggref->aggorder != NIL ||
+		aggref->aggdirectargs != NIL)
+		return false;
+
+	if (contain_volatile_functions((Node *) aggref))
+		return false;
+
+	aggTuple = SearchSysCache1(AGGFNOID, ObjectIdGetDatum(aggref->aggfnoid));
+	if (!HeapTupleIsValid(aggTuple))
+		elog(ERROR, "cache lookup failed for aggregate %u",
+			 aggref->aggfnoid);
+	aggform = (Form_pg_aggregate) GETSTRUCT(aggTuple);
+
+	/*
+	 * The final stage takes the transition value as its argument, and
+	 * resolves the transition type from it; a polymorphic one would not
+	 * resolve to the same type.
+	 */
+	result = OidIsValid(aggform->aggcombinefn) &&
+		!IsPolymorphicType(aggform->aggtranstype) &&
+		(aggform->aggtranstype != INTERNALOID ||
+		 (OidIsValid(aggform->aggserialfn) &&
+		  OidIsValid(aggform->aggdeserialfn)));
+
+	ReleaseSysCache(aggTuple);
+
+	return result;
+}
+
+/*
+ * The type of the partial results of the aggregate, as they leave the
+ * partial stage: its transition type, serialized if it is INTERNAL.
+ */
+static Oid
+partial_agg_type(Aggref *aggref)
+{
+	HeapTuple	aggTuple;
+	Oid			transtype;
+
+	aggTuple = SearchSysCache1(AGGFNOID, ObjectIdGetDatum(aggref->aggfnoid));
+	if (!HeapTupleIsValid(aggTuple))
+		elog(ERROR, "cache lookup failed for aggregate %u",
+			 aggref->aggfnoid);
+	transtype = ((Form_pg_aggregate) GETSTRUCT(aggTuple))->aggtranstype;
+	ReleaseSysCache(aggTuple);
+
+	return transtype == INTERNALOID ? BYTEAOID : transtype;
+}
+
+/*
+ * Is 'var' a column in 'vars'?
+ */
+static bool
+var_in_list(Var *var, List *vars)
+{
+	ListCell   *lc;
+
+	foreach(lc, vars)
+	{
+		Var		   *other = (Var *) lfirst(lc);
+
+		if (other->varno == var->varno &&
+			other->varattno == var->varattno &&
+			other->varlevelsup == var->varlevelsup)
+			return true;
+	}
+	return false;
+}
+
+/*
+ * Make the partial aggregate group by 'var', with equality operator 'eqop'.
+ * Returns false if the type of the column cannot be grouped by.
+ */
+static bool
+add_key_var(EagerAggInfo *info, Var *var, Oid eqop)
+{
+	SortGroupClause *sgc;
+	Oid			sortop;
+	Oid			typeeqop;
+	bool		hashable;
+	if (var_in_list(var, info->keyVars))
+		return true;
+
+	/*
+	 * Rows the partial aggregate puts in the same group must join to the
+	 * same rows, so its equality must be the one of the join clause.
+	 */
+	get_sort_group_operators(var->vartype, false, false, false,
+							 &sortop, &typeeqop, NULL, &hashable);
+	if (!OidIsValid(typeeqop) ||
+		!equality_ops_are_compatible(eqop, typeeqop))
+		return false;
+	if (!OidIsValid(sortop) && !hashable)
+		return false;
+
+	sgc = makeNode(SortGroupClause);
+	sgc->eqop = typeeqop;
+	sgc->sortop = sortop;
+	sgc->nulls_first = false;
+	sgc->hashable = hashable;
+
+	info->keyVars = lappend(info->keyVars, var);
+	info->keyClauses = lappend(info->keyClauses, sgc);
+
+	return true;
+}
+
+/*
+ * Check that the fact table columns in 'node', found outside of an
+ * aggregate, are grouping columns of the query.
+ */
+static bool
+classify_fact_uses(EagerAggInfo *info, Node *node)
+{
+	List	   *vars;
+	ListCell   *lc;
+	bool		result = true;
+
+	vars = pull_var_clause(node, PVC_RECURSE_AGGREGATES,
+						   PVC_INCLUDE_PLACEHOLDERS);
+	foreach(lc, vars)
+	{
+		Var		   *var = (Var *) lfirst(lc);
+
+		if (!IsA(var, Var))
+		{
+			result = false;
+			break;
+		}
+		if (var->varno == info->factRelid &&
+			!var_in_list(var, info->groupVars))
+		{
+			result = false;
+			break;
+		}
+	}
+	list_free(vars);
+
+	return result;
+}
+
+/*
+ * Sort out a conjunct of the join tree: a qual on the fact table alone is
+ * evaluated below the partial aggregate, an equality joining a column of
+ * the fact table to other tables adds a grouping column to it.
+ */
+static bool
+classify_conjunct(EagerAggInfo *info, Node *clause)
+{
+	Relids		varnos = pull_varnos(clause);
+
+	if (!bms_is_member(info->factRelid, varnos))
+		return classify_fact_uses(info, clause);
+
+	if (bms_membership(varnos) == BMS_SINGLETON)
+	{
+		info->factQuals = lappend(info->factQuals, clause);
+		return true;
+	}
+
+	if (is_opclause(clause) && list_length(((OpExpr *) clause)->args) == 2)
+	{
+		OpExpr	   *opexpr = (OpExpr *) clause;
+		Node	   *leftop = get_leftop((Expr *) clause);
+		Node	   *rightop = get_rightop((Expr *) clause);
+		Var		   *keyvar = NULL;
+		Node	   *other = NULL;
+
+		if (IsA(leftop, Var) &&
+			((Var *) leftop)->varno == info->factRelid)
+		{
+			keyvar = (Var *) leftop;
+			other = rightop;
+		}
+		else if (IsA(rightop, Var) &&
+				 ((Var *) rightop)->varno == info->factRelid)
+		{
+			keyvar = (Var *) rightop;
+			other = leftop;
+		}
+
+		if (keyvar != NULL &&
+			keyvar->varattno > 0 &&
+			keyvar->varlevelsup == 0 &&
+			!bms_is_member(info->factRelid, pull_varnos(other)) &&
+			(op_mergejoinable(opexpr->opno, exprType(leftop)) ||
+			 op_hashjoinable(opexpr->opno, exprType(leftop))))
+		{
+			if (!add_key_var(info, keyvar, opexpr->opno))
+				return false;
+			info->numJoinClauses++;
+			return classify_fact_uses(info, other);
+		}
+	}
+
+	return classify_fact_uses(info, clause);
+}
+
+/*
+ * Does the partial aggregation cost less than it saves?
+ *
+ * The fact table is sized in a scratch copy of the planner state, as the
+ * rels are not built yet.  Each row the partial aggregate removes is one
+ * row less to move and to join; aggregating costs a hash probe and the
+ * transitions of the aggregates per row.
+ */
+static bool
+eager_agg_is_cheaper(PlannerInfo *root, EagerAggInfo *info)
+{
+	PlannerInfo scratch;
+	RelOptInfo *rel;
+	double		motion_cost_per_row;
+	double		rows;
+	double		groups;
+	double		partial_rows;
+	Cost		agg_cost;
+	Cost		saved_cost;
+
+	memcpy(&scratch, root, sizeof(PlannerInfo));
+	setup_simple_rel_arrays(&scratch);
+	rel = build_simple_rel(&scratch, info->factRelid, RELOPT_BASEREL);
+
+	if (!GpPolicyIsPartitioned(rel->cdbpolicy))
+		return false;
+
+	rows = rel->tuples;
+	if (info->factQuals != NIL)
+		rows *= clauselist_selectivity(&scratch, info->factQuals, 0,
+									   JOIN_INNER, NULL,
+									   gp_selectivity_damping_for_scans);
+	rows = clamp_row_est(rows);
+
+	/* Each segment yields a row per group it has rows of. */
+	groups = estimate_num_groups(&scratch, info->keyVars, rows);
+	partial_rows = Min(rows, groups * planner_segment_count(rel->cdbpolicy));
+
+	motion_cost_per_row = (gp_motion_cost_per_row > 0.0) ?
+		gp_motion_cost_per_row :
+		2.0 * cpu_tuple_cost;
+
+	agg_cost = rows * cpu_operator_cost *
+		(list_length(info->keyVars) + list_length(info->aggrefs)) +
+		partial_rows * cpu_tuple_cost;
+
+	saved_cost = (rows - partial_rows) *
+		(cpu_tuple_cost +
+		 cpu_operator_cost * info->numJoinClauses +
+		 motion_cost_per_row);
+
+	return saved_cost > agg_cost;
+}
+
+/*
+ * Turn the fact table into a subquery computing the partial aggregates, and
+ * the aggregates of the query into their final stage.
+ */
+static void
+push_down_partial_agg(PlannerInfo *root, EagerAggInfo *info)
+{
+	Query	   *parse = root->parse;
+	RangeTblEntry *rte = rt_fetch(info->factRelid, parse->rtable);
+	Query	   *subquery;
+	RangeTblEntry *subrte;
+	RangeTblRef *subrtr;
+	List	   *colnames = NIL;
+	eager_agg_replace_context context;
+	ListCell   *lc;
+	ListCell   *lc2;
+	Node	   *quals;
+
+	subquery = makeNode(Query);
+	subquery->commandType = CMD_SELECT;
+	subquery->querySource = QSRC_PLANNER;
+	subquery->canSetTag = true;
+	subquery->hasAggs = true;
+
+	subrte = copyObject(rte);
+	subrte->inFromCl = true;
+	subquery->rtable = list_make1(subrte);
+
+	/* The grouping columns come first ... */
+	forboth(lc, info->keyVars, lc2, info->keyClauses)
+	{
+		Var		   *var = (Var *) copyObject(lfirst(lc));
+		SortGroupClause *sgc = (SortGroupClause *) copyObject(lfirst(lc2));
+		char	   *colname = get_rte_attribute_name(rte, var->varattno);
+		TargetEntry *tle;
+		AttrNumber	resno = list_length(subquery->targetList) + 1;
+
+		ChangeVarNodes((Node *) var, info->factRelid, 1, 0);
+		tle = makeTargetEntry((Expr *) var, resno, pstrdup(colname), false);
+		tle->ressortgroupref = resno;
+		sgc->tleSortGroupRef = resno;
+
+		subquery->targetList = lappend(subquery->targetList, tle);
+		subquery->groupClause = lappend(subquery->groupClause, sgc);
+		colnames = lappend(colnames, makeString(pstrdup(colname)));
+	}
+
+	/* ... followed by the partial aggregates. */
+	foreach(lc, info->aggrefs)
+	{
+		Aggref	   *pref = (Aggref *) copyObject(lfirst(lc));
+		char	   *colname = get_func_name(pref->aggfnoid);
+
+		pref->aggtype = partial_agg_type(pref);
+		pref->aggstage = AGGSTAGE_PARTIAL;
+		ChangeVarNodes((Node *) pref, info->factRelid, 1, 0);
+
+		subquery->targetList = lappend(subquery->targetList,
+									   makeTargetEntry((Expr *) pref,
+													   list_length(subquery->targetList) + 1,
+													   colname,
+													   false));
+		colnames = lappend(colnames, makeString(pstrdup(colname)));
+	}
+
+	quals = NULL;
+	if (info->factQuals != NIL)
+	{
+		quals = (Node *) make_ands_explicit(copyObject(info->factQuals));
+		ChangeVarNodes(quals, info->factRelid, 1, 0);
+	}
+	subrtr = makeNode(RangeTblRef);
+	subrtr->rtindex = 1;
+	subquery->jointree = makeFromExpr(list_make1(subrtr), quals);
+
+	/*
+	 * Now make the fact table's RTE the subquery.  The permissions checks
+	 * move down with the relation.
+	 */
+	rte->rtekind = RTE_SUBQUERY;
+	rte->relid = InvalidOid;
+	rte->subquery = subquery;
+	rte->security_barrier = false;
+	rte->inh = false;			/* must not be set for a subquery */
+	rte->requiredPerms = 0;
+	rte->checkAsUser = InvalidOid;
+	rte->selectedCols = NULL;
+	rte->modifiedCols = NULL;
+	rte->eref = makeAlias(rte->eref->aliasname, colnames);
+	/* Keep the user's alias name, but not its column names of the table */
+	if (rte->alias != NULL)
+		rte->alias = makeAlias(rte->alias->aliasname, copyObject(colnames));
+
+	/* Make the rest of the query read the subquery. */
+	context.info = info;
+	context.numKeys = list_length(info->keyVars);
+
+	parse->targetList = (List *)
+		eager_agg_replace_mutator((Node *) parse->targetList, &context);
+	parse->havingQual =
+		eager_agg_replace_mutator(parse->havingQual, &context);
+	(void) rewrite_jointree_quals((Node *) parse->jointree, info, &context);
+
+	/*
+	 * The other columns of the table are gone; no one reads them through
+	 * the joins either, as the join alias Vars are flattened.
+	 */
+	foreach(lc, parse->rtable)
+	{
+		RangeTblEntry *joinrte = (RangeTblEntry *) lfirst(lc);
+
+		if (joinrte->rtekind != RTE_JOIN)
+			continue;
+
+		foreach(lc2, joinrte->joinaliasvars)
+		{
+			Node	   *aliasvar = (Node *) lfirst(lc2);
+
+			if (aliasvar == NULL ||
+				!bms_is_member(info->factRelid, pull_varnos(aliasvar)))
+				continue;
+
+			if (classify_fact_uses(info, aliasvar) ||
+				(IsA(aliasvar, Var) &&
+				 var_in_list((Var *) aliasvar, info->keyVars)))
+				lfirst(lc2) = eager_agg_replace_mutator(aliasvar, &context);
+			else
+				lfirst(lc2) = NULL;
+		}
+	}
+}
+
+/*
+ * Take the quals on the fact table alone out of the join tree, and make the
+ * rest read the subquery.
+ */
+static Node *
+rewrite_jointree_quals(Node *jtnode, EagerAggInfo *info,
+					   eager_agg_replace_context *context)
+{
+	List	   *conjuncts;
+	List	   *kept = NIL;
+	Node	  **qualp;
+	ListCell   *lc;
+
+	if (jtnode == NULL || IsA(jtnode, RangeTblRef))
+		return jtnode;
+
+	if (IsA(jtnode, FromExpr))
+	{
+		FromExpr   *f = (FromExpr *) jtnode;
+
+		foreach(lc, f->fromlist)
+			(void) rewrite_jointree_quals((Node *) lfirst(lc), info, context);
+		qualp = &f->quals;
+	}
+	else
+	{
+		JoinExpr   *j = (JoinExpr *) jtnode;
+
+		Assert(IsA(j, JoinExpr));
+		(void) rewrite_jointree_quals(j->larg, info, context);
+		(void) rewrite_jointree_quals(j->rarg, info, context);
+		qualp = &j->quals;
+	}
+
+	conjuncts = flatten_conjuncts(*qualp, NIL);
+	foreach(lc, conjuncts)
+	{
+		Node	   *clause = (Node *) lfirst(lc);
+
+		if (list_member_ptr(info->factQuals, clause))
+			continue;
+		kept = lappend(kept, eager_agg_replace_mutator(clause, context));
+	}
+
+	if (kept == NIL)
+		*qualp = NULL;
+	else if (list_length(kept) == 1)
+		*qualp = (Node *) linitial(kept);
+	else
+		*qualp = (Node *) make_andclause(kept);
+
+	return jtnode;
+}
+
+/*
+ * Replace the grouping columns of the fact table with the columns of the
+ * subquery, and the aggregates with their final stage, reading the partial
+ * results of the subquery.
+ */
+static Node *
+eager_agg_replace_mutator(Node *node, eager_agg_replace_context *context)
+{
+	EagerAggInfo *info = context->info;
+
+	if (node == NULL)
+		return NULL;
+
+	if (IsA(node, Var))
+	{
+		Var		   *var = (Var *) node;
+		AttrNumber	attno = 1;
+		ListCell   *lc;
+
+		if (var->varno != info->factRelid || var->varlevelsup != 0)
+			return (Node *) copyObject(var);
+
+		foreach(lc, info->keyVars)
+		{
+			Var		   *keyvar = (Var *) lfirst(lc);
+
+			if (keyvar->varattno == var->varattno)
+				return (Node *) makeVar(info->factRelid, attno,
+										var->vartype, var->vartypmod,
+										var->varcollid, 0);
+			attno++;
+		}
+		elog(ERROR, "column %d of relation %u is not a grouping column of the partial aggregate",
+			 var->varattno, info->factRelid);
+	}
+
+	if (IsA(node, Aggref))
+	{
+		Aggref	   *aggref = (Aggref *) node;
+		AttrNumber	attno = context->numKeys + 1;
+		ListCell   *lc;
+
+		foreach(lc, info->aggrefs)
+		{
+			if (equal(aggref, lfirst(lc)))
+			{
+				Aggref	   *fref;
+				Var		   *arg;
+
+				arg = makeVar(info->factRelid, attno, partial_agg_type(aggref),
+							  -1, aggref->aggcollid, 0);
+
+				fref = makeNode(Aggref);
+				fref->aggfnoid = aggref->aggfnoid;
+				fref->aggtype = aggref->aggtype;
+				fref->aggcollid = aggref->aggcollid;
+				fref->inputcollid = aggref->inputcollid;
+				fref->args = list_make1(makeTargetEntry((Expr *) arg, 1, NULL, false));
+				/* FILTER is evaluated at the PARTIAL stage. */
+				fref->agglevelsup = 0;
+				fref->aggstar = false;
+				fref->aggkind = aggref->aggkind;
+				fref->aggdistinct = NIL;
+				fref->aggstage = AGGSTAGE_FINAL;
+				fref->location = -1;
+
+				return (Node *) fref;
+			}
+			attno++;
+		}
+		elog(ERROR, "aggregate %u was not pushed below the joins",
+			 aggref->aggfnoid);
+	}
+
+	return expression_tree_mutator(node, eager_agg_replace_mutator,
+								   (void *) context);
+}
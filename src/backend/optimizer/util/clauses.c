@@ -592,6 +592,15 @@ count_agg_clauses_walker(Node *node, count_agg_clauses_context *context)
 				 (!OidIsValid(aggserialfn) || !OidIsValid(aggdeserialfn)))
 			costs->hasNonSerial = true;
 
+		/*
+		 * Aggregates split in two stages by eager aggregation
+		 * (prepeageragg.c) must not be split again.
+		 */
+		if (aggref->aggstage == AGGSTAGE_PARTIAL)
+			costs->hasPartialAggs = true;
+		else if (aggref->aggstage == AGGSTAGE_FINAL)
+			costs->hasFinalAggs = true;
+
 		/* add component function execution costs to appropriate totals */
 		costs->transCost.per_tuple += get_func_cost(aggtransfn) * cpu_operator_cost;
 		if (OidIsValid(aggfinalfn))
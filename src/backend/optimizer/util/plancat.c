@@ -83,9 +83,10 @@ static void get_external_relation_info(Relation relation, RelOptInfo *rel);
  *	pages		number of pages
  *	tuples		number of tuples
  *
- * Also, initialize the attr_needed[] and attr_widths[] arrays.  In most
- * cases these are left as zeroes, but sometimes we need to compute attr
- * widths here, and we may as well cache the results for costsize.c.
+ * Also, initialize the attr_needed[], attr_widths[] and attr_ndistinct[]
+ * arrays.  In most cases these are left as zeroes, but sometimes we need to
+ * compute attr widths here, and we may as well cache the results for
+ * costsize.c.
  *
  * If inhparent is true, all we need to do is set up the attr arrays:
  * the RelOptInfo actually represents the appendrel formed by an inheritance
@@ -125,6 +126,8 @@ get_relation_info(PlannerInfo *root, Oid relationObjectId, bool inhparent,
 		palloc0((rel->max_attr - rel->min_attr + 1) * sizeof(Relids));
 	rel->attr_widths = (int32 *)
 		palloc0((rel->max_attr - rel->min_attr + 1) * sizeof(int32));
+	rel->attr_ndistinct = (double *)
+		palloc0((rel->max_attr - rel->min_attr + 1) * sizeof(double));
 
     /*
      * CDB: Get partitioning key info for distributed relation.
@@ -413,6 +413,7 @@ build_join_rel(PlannerInfo *root,
 	joinrel->max_attr = 0;
 	joinrel->attr_needed = NULL;
 	joinrel->attr_widths = NULL;
+	joinrel->attr_ndistinct = NULL;
 	joinrel->lateral_vars = NIL;
 	joinrel->lateral_relids = NULL;
 	joinrel->lateral_referencers = NULL;
@@ -18,9 +18,13 @@
  */
 #include "postgres.h"
 
+#include <signal.h>
+
+#include "access/xact.h"
 #include "catalog/catalog.h"
 #include "cdb/cdbvars.h"
 #include "cdb/cdbpartition.h"
+#include "commands/dbcommands.h"
 #include "commands/vacuum.h"
 #include "executor/execdesc.h"
 #include "executor/executor.h"
@@ -28,41 +32,125 @@
 #include "nodes/makefuncs.h"
 #include "nodes/plannodes.h"
 #include "parser/parsetree.h"
+#include "pgstat.h"
 #include "postmaster/autostats.h"
+#include "postmaster/bgworker.h"
+#include "storage/ipc.h"
+#include "storage/latch.h"
+#include "storage/lwlock.h"
+#include "storage/proc.h"
+#include "storage/shmem.h"
 #include "utils/acl.h"
+#include "utils/builtins.h"
 #include "utils/guc.h"
 #include "utils/lsyscache.h"
+#include "utils/memutils.h"
+#include "utils/snapmgr.h"
 #include "utils/syscache.h"
 #include "utils/timestamp.h"
 
+/*
+ * Asynchronous auto-stats.
+ *
+ * With gp_autostats_async, a statement that qualifies for auto-stats does
+ * not analyze the table itself.  The table is remembered until the end of
+ * the transaction, and on commit, put in a queue in shared memory.  A
+ * background worker of the database takes the tables out of the queue in
+ * the order they were queued, and analyzes them one at a time, waiting
+ * gp_autostats_async_naptime in between.  A table already in the queue is
+ * not queued again, so the loads into a table done while it waits cause a
+ * single ANALYZE.
+ *
+ * A worker serves a single database.  It is started by the first commit
+ * queueing a table of the database, and exits when the queue holds no more
+ * tables of it, handing its slot over to another database waiting for one,
+ * if any.  When the queue is full, tables are not queued, and left for the
+ * next load to queue.
+ *
+ * A slot is claimed before its worker is registered, and the worker records
+ * its pid in it once started.  A slot whose worker has not started within
+ * AUTOSTATS_WORKER_START_TIMEOUT, e.g. because it died before getting that
+ * far, is taken back, and a worker starting after that exits at once.
+ */
+#define AUTOSTATS_QUEUE_SIZE	1024
+#define AUTOSTATS_MAX_WORKERS	4
+#define AUTOSTATS_WORKER_START_TIMEOUT	60000	/* ms */
+
+typedef struct AutoStatsQueueEntry
+{
+	Oid			dbid;			/* InvalidOid if the entry is free */
+	Oid			relid;
+	TimestampTz queuetime;
+	NameData	dbname;
+} AutoStatsQueueEntry;
+
+typedef struct AutoStatsWorkerSlot
+{
+	Oid			dbid;			/* database served, InvalidOid if free */
+	NameData	dbname;
+	pid_t		pid;			/* 0 until the worker has started */
+	TimestampTz claimtime;		/* when the slot was claimed */
+} AutoStatsWorkerSlot;
+
+/* Protected by AutoStatsLock */
+typedef struct AutoStatsShmemStruct
+{
+	AutoStatsWorkerSlot workers[AUTOSTATS_MAX_WORKERS];
+	AutoStatsQueueEntry queue[AUTOSTATS_QUEUE_SIZE];
+} AutoStatsShmemStruct;
+
+static AutoStatsShmemStruct *AutoStatsShmem = NULL;
+
+/* Tables to queue at commit of the current transaction, and their database */
+static List *pendingAutoStats = NIL;
+static NameData pendingAutoStatsDbName;
+
+static volatile sig_atomic_t got_SIGHUP = false;
+
 /*
  * Forward declarations.
  */
 static void autostats_issue_analyze(Oid relationOid);
+static bool autostats_owner_check(Oid relationOid);
+static void autostats_queue_analyze(Oid relationOid);
+static void autostats_claim_slot(AutoStatsWorkerSlot *slot, Oid dbid,
+					 NameData *dbname, TimestampTz now);
+static void autostats_reclaim_slots(TimestampTz now);
+static void autostats_start_worker(int slotno);
+static Oid	autostats_next_table(int slotno, bool *handover);
+static void autostats_worker_exit(int code, Datum arg);
 static bool autostats_on_change_check(AutoStatsCmdType cmdType, uint64 ntuples);
 static bool autostats_on_no_stats_check(AutoStatsCmdType cmdType, Oid relationOid);
 
 /*
- * Auto-stats employs this sub-routine to issue an analyze on a specific relation.
+ * If this user does not own the table, then auto-stats will not issue the
+ * analyze.
  */
-static void
-autostats_issue_analyze(Oid relationOid)
+static bool
+autostats_owner_check(Oid relationOid)
 {
-	VacuumStmt *analyzeStmt = NULL;
-	RangeVar   *relation = NULL;
-
-	/*
-	 * If this user does not own the table, then auto-stats will not issue the
-	 * analyze.
-	 */
 	if (!(pg_class_ownercheck(relationOid, GetUserId()) ||
 		  (pg_database_ownercheck(MyDatabaseId, GetUserId()) && !IsSharedRelation(relationOid))))
 	{
 		elog(DEBUG3, "Auto-stats did not issue ANALYZE on tableoid %d since the user does not have table-owner level permissions.",
 			 relationOid);
 
-		return;
+		return false;
 	}
+	return true;
+}
+
+/*
+ * Auto-stats employs this sub-routine to issue an analyze on a specific relation.
+ */
+static void
+autostats_issue_analyze(Oid relationOid)
+{
+	VacuumStmt *analyzeStmt = NULL;
+	RangeVar   *relation = NULL;
+
+	if (!autostats_owner_check(relationOid))
+		return;
 
 	relation = makeRangeVar(get_namespace_name(get_rel_namespace(relationOid)), get_rel_name(relationOid), -1);
 	analyzeStmt = makeNode(VacuumStmt);
@@ -321,6 +409,13 @@ auto_stats(AutoStatsCmdType cmdType, Oid relationOid, uint64 ntuples, bool inFun
 			 ntuples);
 	}
 
+	if (gp_autostats_async)
+	{
+		if (autostats_owner_check(relationOid))
+			autostats_queue_analyze(relationOid);
+		return;
+	}
+
 	autostats_issue_analyze(relationOid);
 
 	if (log_duration)
@@ -334,3 +429,448 @@ auto_stats(AutoStatsCmdType cmdType, Oid relationOid, uint64 ntuples, bool inFun
 		elog(LOG, "duration: %ld.%03d ms Auto-ANALYZE", secs * 1000 + msecs, usecs % 1000);
 	}
 }
+
+/*
+ * Remember to queue the table for a worker, at commit.
+ */
+static void
+autostats_queue_analyze(Oid relationOid)
+{
+	MemoryContext oldcontext;
+
+	if (pendingAutoStats == NIL)
+	{
+		char	   *dbname = get_database_name(MyDatabaseId);
+
+		if (dbname == NULL)
+			return;
+		namestrcpy(&pendingAutoStatsDbName, dbname);
+	}
+
+	oldcontext = MemoryContextSwitchTo(TopTransactionContext);
+	pendingAutoStats = list_append_unique_oid(pendingAutoStats, relationOid);
+	MemoryContextSwitchTo(oldcontext);
+}
+
+Size
+AutoStatsShmemSize(void)
+{
+	return MAXALIGN(sizeof(AutoStatsShmemStruct));
+}
+
+void
+AutoStatsShmemInit(void)
+{
+	bool		found;
+
+	AutoStatsShmem = (AutoStatsShmemStruct *)
+		ShmemInitStruct("AutoStats Data", AutoStatsShmemSize(), &found);
+
+	if (!found)
+		MemSet(AutoStatsShmem, 0, AutoStatsShmemSize());
+}
+
+/*
+ * AtEOXact_AutoStats
+ *
+ * On commit, queue the tables the transaction qualified for auto-stats, and
+ * make sure a worker serves the database.  This runs after the commit, so
+ * it must not fail.
+ */
+void
+AtEOXact_AutoStats(bool isCommit)
+{
+	TimestampTz now;
+	ListCell   *lc;
+	int			startslot = -1;
+	int			i;
+
+	if (pendingAutoStats == NIL)
+		return;
+
+	if (!isCommit)
+	{
+		/* The list is in TopTransactionContext, and goes away with it */
+		pendingAutoStats = NIL;
+		return;
+	}
+
+	now = GetCurrentTimestamp();
+
+	LWLockAcquire(AutoStatsLock, LW_EXCLUSIVE);
+
+	foreach(lc, pendingAutoStats)
+	{
+		Oid			relid = lfirst_oid(lc);
+		AutoStatsQueueEntry *freeentry = NULL;
+		bool		queued = false;
+
+		for (i = 0; i < AUTOSTATS_QUEUE_SIZE; i++)
+		{
+			AutoStatsQueueEntry *entry = &AutoStatsShmem->queue[i];
+
+			if (!OidIsValid(entry->dbid))
+			{
+				if (freeentry == NULL)
+					freeentry = entry;
+			}
+			else if (entry->dbid == MyDatabaseId && entry->relid == relid)
+			{
+				queued = true;
+				break;
+			}
+		}
+
+		if (queued)
+			continue;
+
+		if (freeentry == NULL)
+		{
+			elog(LOG, "Auto-stats queue is full, ANALYZE of (dboid,tableoid)=(%d,%d) skipped.",
+				 MyDatabaseId, relid);
+			continue;
+		}
+
+		freeentry->dbid = MyDatabaseId;
+		freeentry->relid = relid;
+		freeentry->queuetime = now;
+		freeentry->dbname = pendingAutoStatsDbName;
+	}
+
+	/*
+	 * Claim a worker slot for the database, unless one serves it already.  If
+	 * all the slots are taken, the tables wait for one to be handed over.
+	 */
+	autostats_reclaim_slots(now);
+	for (i = 0; i < AUTOSTATS_MAX_WORKERS; i++)
+	{
+		AutoStatsWorkerSlot *slot = &AutoStatsShmem->workers[i];
+
+		if (slot->dbid == MyDatabaseId)
+		{
+			startslot = -1;
+			break;
+		}
+		if (!OidIsValid(slot->dbid) && startslot < 0)
+			startslot = i;
+	}
+	if (startslot >= 0)
+		autostats_claim_slot(&AutoStatsShmem->workers[startslot],
+							 MyDatabaseId, &pendingAutoStatsDbName, now);
+
+	LWLockRelease(AutoStatsLock);
+
+	pendingAutoStats = NIL;
+
+	if (startslot >= 0)
+		autostats_start_worker(startslot);
+}
+
+/*
+ * Claim 'slot' for database 'dbid'.  The caller holds AutoStatsLock, and is
+ * to start the worker.
+ */
+static void
+autostats_claim_slot(AutoStatsWorkerSlot *slot, Oid dbid, NameData *dbname,
+					 TimestampTz now)
+{
+	slot->dbid = dbid;
+	slot->dbname = *dbname;
+	slot->pid = 0;
+	slot->claimtime = now;
+}
+
+/*
+ * Take back the slots whose worker has not started in time.  The caller
+ * holds AutoStatsLock.
+ */
+static void
+autostats_reclaim_slots(TimestampTz now)
+{
+	int			i;
+
+	for (i = 0; i < AUTOSTATS_MAX_WORKERS; i++)
+	{
+		AutoStatsWorkerSlot *slot = &AutoStatsShmem->workers[i];
+
+		if (OidIsValid(slot->dbid) && slot->pid == 0 &&
+			TimestampDifferenceExceeds(slot->claimtime, now,
+									   AUTOSTATS_WORKER_START_TIMEOUT))
+		{
+			elog(LOG, "auto-stats worker for database \"%s\" did not start, releasing its slot",
+				 NameStr(slot->dbname));
+			slot->dbid = InvalidOid;
+		}
+	}
+}
+
+/*
+ * Start a worker for the database of the claimed slot 'slotno'.  If it
+ * cannot be started, the slot is released, and the tables stay queued.
+ */
+static void
+autostats_start_worker(int slotno)
+{
+	BackgroundWorker worker;
+
+	MemSet(&worker, 0, sizeof(worker));
+	snprintf(worker.bgw_name, BGW_MAXLEN, "autostats worker");
+	worker.bgw_flags = BGWORKER_SHMEM_ACCESS | BGWORKER_BACKEND_DATABASE_CONNECTION;
+	worker.bgw_start_time = BgWorkerStart_RecoveryFinished;
+	worker.bgw_restart_time = BGW_NEVER_RESTART;
+	worker.bgw_main = AutoStatsWorkerMain;
+	worker.bgw_main_arg = Int32GetDatum(slotno);
+	worker.bgw_notify_pid = 0;
+
+	if (!RegisterDynamicBackgroundWorker(&worker, NULL))
+	{
+		AutoStatsWorkerSlot *slot = &AutoStatsShmem->workers[slotno];
+
+		ereport(LOG,
+				(errmsg("could not start auto-stats worker for database \"%s\"",
+						NameStr(slot->dbname)),
+				 errhint("You might need to increase max_worker_processes.")));
+
+		LWLockAcquire(AutoStatsLock, LW_EXCLUSIVE);
+		slot->dbid = InvalidOid;
+		slot->pid = 0;
+		LWLockRelease(AutoStatsLock);
+	}
+}
+
+/*
+ * Take the table queued first for the database of slot 'slotno' out of the
+ * queue.  If there is none, the slot is released, or handed over to another
+ * database with tables queued and no worker, in which case *handover is set
+ * and the caller is to start its worker.
+ */
+static Oid
+autostats_next_table(int slotno, bool *handover)
+{
+	AutoStatsWorkerSlot *slot = &AutoStatsShmem->workers[slotno];
+	AutoStatsQueueEntry *first = NULL;
+	Oid			relid = InvalidOid;
+	int			i;
+
+	*handover = false;
+
+	LWLockAcquire(AutoStatsLock, LW_EXCLUSIVE);
+
+	for (i = 0; i < AUTOSTATS_QUEUE_SIZE; i++)
+	{
+		AutoStatsQueueEntry *entry = &AutoStatsShmem->queue[i];
+
+		if (entry->dbid == slot->dbid &&
+			(first == NULL || entry->queuetime < first->queuetime))
+			first = entry;
+	}
+
+	if (first != NULL)
+	{
+		relid = first->relid;
+		first->dbid = InvalidOid;
+	}
+	else
+	{
+		slot->dbid = InvalidOid;
+		slot->pid = 0;
+
+		autostats_reclaim_slots(GetCurrentTimestamp());
+		for (i = 0; i < AUTOSTATS_QUEUE_SIZE && !*handover; i++)
+		{
+			AutoStatsQueueEntry *entry = &AutoStatsShmem->queue[i];
+			bool		served = false;
+			int			j;
+
+			if (!OidIsValid(entry->dbid))
+				continue;
+
+			for (j = 0; j < AUTOSTATS_MAX_WORKERS; j++)
+			{
+				if (AutoStatsShmem->workers[j].dbid == entry->dbid)
+					served = true;
+			}
+			if (!served)
+			{
+				autostats_claim_slot(slot, entry->dbid, &entry->dbname,
+									 GetCurrentTimestamp());
+				*handover = true;
+			}
+		}
+	}
+
+	LWLockRelease(AutoStatsLock);
+
+	return relid;
+}
+
+/*
+ * AutoStatsDropDatabase
+ *
+ * Forget the tables queued for database 'dbid', about to be dropped, and
+ * terminate its worker, so that it does not keep the database in use.
+ */
+void
+AutoStatsDropDatabase(Oid dbid)
+{
+	int			i;
+
+	LWLockAcquire(AutoStatsLock, LW_EXCLUSIVE);
+
+	for (i = 0; i < AUTOSTATS_QUEUE_SIZE; i++)
+	{
+		AutoStatsQueueEntry *entry = &AutoStatsShmem->queue[i];
+
+		if (entry->dbid == dbid)
+			entry->dbid = InvalidOid;
+	}
+
+	for (i = 0; i < AUTOSTATS_MAX_WORKERS; i++)
+	{
+		AutoStatsWorkerSlot *slot = &AutoStatsShmem->workers[i];
+
+		if (slot->dbid != dbid)
+			continue;
+
+		/* A worker not started yet finds its slot free, and exits */
+		if (slot->pid == 0)
+			slot->dbid = InvalidOid;
+		else
+			(void) kill(slot->pid, SIGTERM);
+	}
+
+	LWLockRelease(AutoStatsLock);
+}
+
+/*
+ * Release the slot of a worker exiting before it is done, on FATAL.
+ */
+static void
+autostats_worker_exit(int code, Datum arg)
+{
+	AutoStatsWorkerSlot *slot = &AutoStatsShmem->workers[DatumGetInt32(arg)];
+
+	LWLockAcquire(AutoStatsLock, LW_EXCLUSIVE);
+	if (slot->pid == MyProcPid)
+	{
+		slot->dbid = InvalidOid;
+		slot->pid = 0;
+	}
+	LWLockRelease(AutoStatsLock);
+}
+
+static void
+autostats_sighup(SIGNAL_ARGS)
+{
+	int			save_errno = errno;
+
+	got_SIGHUP = true;
+	if (MyProc)
+		SetLatch(&MyProc->procLatch);
+
+	errno = save_errno;
+}
+
+/*
+ * AutoStatsWorkerMain
+ *
+ * Main entry point of an auto-stats worker.  'main_arg' is its slot.
+ */
+void
+AutoStatsWorkerMain(Datum main_arg)
+{
+	int			slotno = DatumGetInt32(main_arg);
+	AutoStatsWorkerSlot *slot = &AutoStatsShmem->workers[slotno];
+	NameData	dbname;
+	bool		handover;
+	Oid			relid;
+
+	pqsignal(SIGHUP, autostats_sighup);
+	BackgroundWorkerUnblockSignals();
+
+	/* Registered first, so that no exit leaves the slot taken */
+	before_shmem_exit(autostats_worker_exit, Int32GetDatum(slotno));
+
+	/*
+	 * The slot may have been taken back while the worker was starting, or be
+	 * served already by a worker started after its claim was taken back.
+	 */
+	LWLockAcquire(AutoStatsLock, LW_EXCLUSIVE);
+	if (!OidIsValid(slot->dbid) || slot->pid != 0)
+	{
+		LWLockRelease(AutoStatsLock);
+		proc_exit(0);
+	}
+	slot->pid = MyProcPid;
+	dbname = slot->dbname;
+	LWLockRelease(AutoStatsLock);
+
+	BackgroundWorkerInitializeConnection(NameStr(dbname), NULL);
+
+	/* vacuum() works in a child of PortalContext */
+	PortalContext = AllocSetContextCreate(TopMemoryContext,
+										  "Auto-stats Portal",
+										  ALLOCSET_DEFAULT_MINSIZE,
+										  ALLOCSET_DEFAULT_INITSIZE,
+										  ALLOCSET_DEFAULT_MAXSIZE);
+
+	while (OidIsValid(relid = autostats_next_table(slotno, &handover)))
+	{
+		int			rc;
+
+		if (got_SIGHUP)
+		{
+			got_SIGHUP = false;
+			ProcessConfigFile(PGC_SIGHUP);
+		}
+
+		/*
+		 * An error in ANALYZE of a table, e.g. dropped meanwhile, is reported
+		 * and does not stop the worker.
+		 */
+		PG_TRY();
+		{
+			StartTransactionCommand();
+			PushActiveSnapshot(GetTransactionSnapshot());
+
+			if (SearchSysCacheExists1(RELOID, ObjectIdGetDatum(relid)))
+			{
+				if (log_autostats)
+					elog(LOG, "Auto-stats worker analyzing (dboid,tableoid)=(%d,%d).",
+						 MyDatabaseId, relid);
+
+				pgstat_report_activity(STATE_RUNNING, "auto-stats ANALYZE");
+				autostats_issue_analyze(relid);
+			}
+
+			PopActiveSnapshot();
+			CommitTransactionCommand();
+		}
+		PG_CATCH();
+		{
+			HOLD_INTERRUPTS();
+			EmitErrorReport();
+			AbortOutOfAnyTransaction();
+			FlushErrorState();
+			RESUME_INTERRUPTS();
+		}
+		PG_END_TRY();
+
+		pgstat_report_activity(STATE_IDLE, NULL);
+		MemoryContextResetAndDeleteChildren(PortalContext);
+
+		/* Rate limit */
+		rc = WaitLatch(&MyProc->procLatch,
+					   WL_LATCH_SET | WL_TIMEOUT | WL_POSTMASTER_DEATH,
+					   gp_autostats_async_naptime);
+		ResetLatch(&MyProc->procLatch);
+
+		if (rc & WL_POSTMASTER_DEATH)
+			proc_exit(1);
+	}
+
+	if (handover)
+		autostats_start_worker(slotno);
+
+	proc_exit(0);
+}
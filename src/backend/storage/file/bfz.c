@@ -36,10 +36,15 @@ static const struct{
 {
     {{"none", "false", "no", "off", "0", 0}, bfz_nothing_init},
     {{"zlib", 0}, bfz_zlib_init},
+#ifdef HAVE_LIBZSTD
+    {{"zstd", 0}, bfz_zstd_init},
+#endif
     {{0}}
 };
 
 static bfz_t *bfz_create_internal(const char *fileName, bool open_existing, bool delOnClose, int compress);
+static void bfz_readahead(bfz_t *bfz);
+static void bfz_writebehind(bfz_t *bfz);
 
 int
 bfz_string_to_compression(const char *string)
@@ -144,6 +149,62 @@ write_bfz_buffer(bfz_t *bfz, bool isLast)
 	PG_END_TRY();
 
 	bfz->numBlocks ++;
+
+	bfz_writebehind(bfz);
+}
+
+/*
+ * Once gp_workfile_writeback_blocks blocks have been appended to the
+ * underlying file since the last call, ask the kernel to start writing
+ * them out in the background.
+ */
+static void
+bfz_writebehind(bfz_t *bfz)
+{
+	int64		pos;
+
+	if (gp_workfile_writeback_blocks == 0)
+		return;
+
+	pos = FileSeek(bfz->file, 0, SEEK_CUR);
+	if (pos < 0)
+		return;
+
+	if (pos - bfz->writebackStart >= (int64) gp_workfile_writeback_blocks * BLCKSZ)
+	{
+		(void) FileWriteback(bfz->file, bfz->writebackStart,
+							 pos - bfz->writebackStart);
+		bfz->writebackStart = pos;
+	}
+}
+
+/*
+ * A bfz file is always scanned from start to end, so keep
+ * gp_workfile_prefetch_blocks blocks of read-ahead outstanding beyond the
+ * current physical position, topping it up once half has been consumed.
+ */
+static void
+bfz_readahead(bfz_t *bfz)
+{
+	int64		window = (int64) gp_workfile_prefetch_blocks * BLCKSZ;
+	int64		pos;
+
+	if (window == 0)
+		return;
+
+	pos = FileSeek(bfz->file, 0, SEEK_CUR);
+	if (pos < 0)
+		return;
+
+	if (bfz->readaheadEnd < pos)
+		bfz->readaheadEnd = pos;
+
+	if (bfz->readaheadEnd - pos > window / 2)
+		return;
+
+	(void) FilePrefetch(bfz->file, bfz->readaheadEnd,
+						(int) (pos + window - bfz->readaheadEnd));
+	bfz->readaheadEnd = pos + window;
 }
 
 /*
@@ -164,7 +225,9 @@ read_bfz_buffer(bfz_t *bfz, char *buffer)
 	int bytesRead = 0;
 	struct bfz_freeable_stuff *fs = bfz->freeable_stuff;
 	int dataSize = 0;
-	
+
+	bfz_readahead(bfz);
+
 	bytesRead = fs->read_ex(bfz, buffer, sizeof(fs->buffer));
 	Assert(bytesRead <= sizeof(fs->buffer));
 
@@ -249,6 +312,7 @@ bfz_create_internal(const char *fileName, bool open_existing,
 
 	bfz_handle = palloc0(sizeof(bfz_t));
 	bfz_handle->filename = pstrdup(fileName);
+	bfz_handle->context = CurrentMemoryContext;
 
 	bfz_handle->file = OpenNamedTemporaryFile(bfz_handle->filename,
 											  !open_existing,
@@ -359,6 +423,7 @@ bfz_append_end(bfz_t * thiz)
 	}
 
 	tot_bytes = fs->tot_bytes;
+	thiz->rawBytes += tot_bytes;
 
 	/*
 	 * Close the compressor. But we keep the underlying file open for reading
@@ -394,6 +459,7 @@ bfz_scan_begin(bfz_t * thiz)
 				errmsg("could not seek in temporary file: %m")));
 
 	thiz->mode = BFZ_MODE_SCAN;
+	thiz->readaheadEnd = 0;
 
 	/*
 	 * Allocating in the TopMemoryContext since this memory context
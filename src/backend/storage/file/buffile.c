@@ -74,11 +74,25 @@ struct BufFile
 	int			nbytes;			/* total # of valid bytes in buffer */
 	int64		maxoffset;		/* maximum offset that this file has reached, for disk usage */
 
+	/*
+	 * Asynchronous read-ahead and write-behind state.  Reads that continue
+	 * where the previous one stopped keep up to gp_workfile_prefetch_blocks
+	 * blocks of read-ahead outstanding; written ranges are handed to the
+	 * kernel for writeback every gp_workfile_writeback_blocks blocks.
+	 */
+	int64		lastreadend;	/* end offset of the previous read */
+	int64		readaheadend;	/* end of the range already prefetched */
+	int64		writebackstart;	/* range written since the last writeback */
+	int64		writebackend;
+	int64		writebackpending;	/* # of bytes written in that range */
+
 	char	   *buffer;			/* CDB: -> buffer */
 };
 
 static BufFile *makeBufFile(File firstfile);
 static void BufFileUpdateSize(BufFile *buffile);
+static void BufFileReadAhead(BufFile *file, int64 offset, int nbytes);
+static void BufFileWriteBehind(BufFile *file, int64 start, int64 end);
 
 
 /*
@@ -104,6 +118,11 @@ makeBufFile(File firstfile)
 	file->pos = 0;
 	file->nbytes = 0;
 	file->maxoffset = 0L;
+	file->lastreadend = 0L;
+	file->readaheadend = 0L;
+	file->writebackstart = 0L;
+	file->writebackend = 0L;
+	file->writebackpending = 0L;
 	file->buffer = palloc(BLCKSZ);
 
 	return file;
@@ -261,9 +280,83 @@ BufFileLoadBuffer(BufFile *file, void* buffer, size_t bufsize)
 
 	pgBufferUsage.temp_blks_read++;
 
+	BufFileReadAhead(file, file->offset, nb);
+
 	return nb;
 }
 
+/*
+ * BufFileReadAhead
+ *
+ * Called after nbytes have been read at offset.  If this read continued
+ * where the previous one stopped, make sure the kernel is reading the
+ * next gp_workfile_prefetch_blocks blocks in the background.  The window
+ * is topped up once half of it has been consumed, so a sequential scan
+ * issues one posix_fadvise() per half window rather than one per block.
+ * Random access (e.g. logical tape block reuse) is left alone.
+ */
+static void
+BufFileReadAhead(BufFile *file, int64 offset, int nbytes)
+{
+	int64		window = (int64) gp_workfile_prefetch_blocks * BLCKSZ;
+	int64		next = offset + nbytes;
+	bool		sequential = (offset == file->lastreadend);
+
+	file->lastreadend = next;
+
+	if (window == 0 || nbytes <= 0 || !sequential)
+	{
+		file->readaheadend = next;
+		return;
+	}
+
+	if (file->readaheadend < next)
+		file->readaheadend = next;
+
+	if (file->readaheadend - next > window / 2)
+		return;
+
+	(void) FilePrefetch(file->file, file->readaheadend,
+						(int) (next + window - file->readaheadend));
+	file->readaheadend = next + window;
+}
+
+/*
+ * BufFileWriteBehind
+ *
+ * Called after the range [start, end) has been written.  Once
+ * gp_workfile_writeback_blocks blocks have been written, ask the kernel
+ * to start writing out the range covering them, so that the dirty pages
+ * of a large spill are written steadily instead of all at once when the
+ * kernel's dirty limit is hit.  This only initiates the I/O; it does not
+ * wait for it.
+ */
+static void
+BufFileWriteBehind(BufFile *file, int64 start, int64 end)
+{
+	if (gp_workfile_writeback_blocks == 0)
+		return;
+
+	if (file->writebackpending == 0)
+	{
+		file->writebackstart = start;
+		file->writebackend = end;
+	}
+	else
+	{
+		file->writebackstart = Min(file->writebackstart, start);
+		file->writebackend = Max(file->writebackend, end);
+	}
+	file->writebackpending += end - start;
+
+	if (file->writebackpending >= (int64) gp_workfile_writeback_blocks * BLCKSZ)
+	{
+		(void) FileWriteback(file->file, file->writebackstart,
+							 file->writebackend - file->writebackstart);
+		file->writebackpending = 0;
+	}
+}
+
 /*
  * BufFileDumpBuffer
  *
@@ -277,6 +370,7 @@ BufFileDumpBuffer(BufFile *file, const void* buffer, Size nbytes)
 	size_t wpos = 0;
 	size_t bytestowrite;
 	int wrote = 0;
+	int64 start = file->offset;
 
 	/*
 	 * Unlike BufFileLoadBuffer, we must dump the whole buffer.
@@ -311,6 +405,8 @@ BufFileDumpBuffer(BufFile *file, const void* buffer, Size nbytes)
 	}
 	file->dirty = false;
 
+	BufFileWriteBehind(file, start, file->offset);
+
 	/*
 	 * Now we can set the buffer empty without changing the logical position
 	 */
@@ -585,6 +681,19 @@ BufFileSeekBlock(BufFile *file, int64 blknum)
 	return BufFileSeek(file, 0 /* fileno */, blknum * BLCKSZ, SEEK_SET);
 }
 
+/*
+ * BufFilePrefetch --- initiate an asynchronous read of a range of the file
+ *
+ * For callers that know which blocks they will read next even though their
+ * access pattern is not sequential.  The logical position is unaffected.
+ */
+void
+BufFilePrefetch(BufFile *file, int64 offset, int amount)
+{
+	if (amount > 0)
+		(void) FilePrefetch(file->file, offset, amount);
+}
+
 /*
  * BufFileUpdateSize
  *
@@ -44,13 +44,18 @@ bfz_zlib_close_ex(bfz_t *thiz)
 			{
 				int			have;
 				int			written;
+				instr_time	starttime;
+				instr_time	endtime;
 
 				/* Flush all remaining output to the underlying file */
 				fs->s.avail_in = 0;
 				fs->s.avail_out = COMPRESSION_BUFFER_SIZE;
 				fs->s.next_out = fs->buf;
 
+				INSTR_TIME_SET_CURRENT(starttime);
 				ret1 = deflate(&fs->s, Z_FINISH);
+				INSTR_TIME_SET_CURRENT(endtime);
+				INSTR_TIME_ACCUM_DIFF(thiz->codecTime, endtime, starttime);
 				if (ret1 < 0)
 					ereport(ERROR,
 							(errmsg("zlib deflate failed"),
@@ -111,11 +116,16 @@ bfz_zlib_write_ex(bfz_t *thiz, const char *buffer, int size)
 	{
 		int			have;
 		int			written;
+		instr_time	starttime;
+		instr_time	endtime;
 
 		fs->s.avail_out = COMPRESSION_BUFFER_SIZE;
 		fs->s.next_out = fs->buf;
 
+		INSTR_TIME_SET_CURRENT(starttime);
 		ret1 = deflate(&fs->s, Z_NO_FLUSH);
+		INSTR_TIME_SET_CURRENT(endtime);
+		INSTR_TIME_ACCUM_DIFF(thiz->codecTime, endtime, starttime);
 		if (ret1 == Z_STREAM_ERROR)
 			ereport(ERROR,
 					(errmsg("zlib deflate failed"),
@@ -159,6 +169,8 @@ bfz_zlib_read_ex(bfz_t *thiz, char *buffer, int size)
 	while (fs->s.avail_out > 0)
 	{
 		int			e;
+		instr_time	starttime;
+		instr_time	endtime;
 
 		/*
 		 * Fill up our input buffer from the input file.
@@ -199,7 +211,10 @@ bfz_zlib_read_ex(bfz_t *thiz, char *buffer, int size)
 		}
 
 		/* decompress */
+		INSTR_TIME_SET_CURRENT(starttime);
 		e = inflate(&fs->s, Z_SYNC_FLUSH);
+		INSTR_TIME_SET_CURRENT(endtime);
+		INSTR_TIME_ACCUM_DIFF(thiz->codecTime, endtime, starttime);
 
 		fs->eof_out = false;
 		if (e == Z_STREAM_END)
@@ -0,0 +1,302 @@
+/* compress_zstd.c */
+#include "postgres.h"
+
+#ifdef HAVE_LIBZSTD
+
+/* for ZSTD_customMem and the *_advanced constructors */
+#define ZSTD_STATIC_LINKING_ONLY
+#include <zstd.h>
+
+#include "cdb/cdbvars.h"
+#include "storage/bfz.h"
+#include "utils/memutils.h"
+
+#define COMPRESSION_BUFFER_SIZE		(1<<14)
+
+struct bfz_zstd_freeable_stuff
+{
+	struct bfz_freeable_stuff super;
+
+	/* true if compressing, false if decompressing */
+	bool		compressing;
+
+	/*
+	 * streams; libzstd allocates them, and its work areas, through
+	 * zstd_alloc() in the memory context of the bfz file, so they go away
+	 * with it if we error out before close_ex.
+	 */
+	ZSTD_CStream *cstream;
+	ZSTD_DStream *dstream;
+
+	/* decompression input, pointing into buf */
+	ZSTD_inBuffer in;
+	bool		eof_in;
+
+	/* true if the last frame read from the file is complete */
+	bool		frame_done;
+
+	char		buf[COMPRESSION_BUFFER_SIZE];
+};
+
+/*
+ * This file implements bfz compression algorithm "zstd", using the streaming
+ * interface of libzstd.  Workfiles are written once and read back soon after,
+ * so the default level (gp_workfile_zstd_level) is one of the fast ones; the
+ * negative "fast" levels trade ratio for LZ4-like speed.
+ */
+
+static void *
+zstd_alloc(void *opaque, size_t size)
+{
+	/*
+	 * zstd's work areas stay well below this even at the highest levels,
+	 * but better safe than sorry.  zstd reports NULL as an allocation error.
+	 */
+	if (size > MaxAllocSize)
+		return NULL;
+
+	return MemoryContextAlloc((MemoryContext) opaque, size);
+}
+
+static void
+zstd_free(void *opaque, void *address)
+{
+	if (address != NULL)
+		pfree(address);
+}
+
+static void
+bfz_zstd_write_out(bfz_t *thiz, const char *buf, size_t have)
+{
+	while (have > 0)
+	{
+		int			n = FileWrite(thiz->file, (char *) buf, have);
+
+		if (n < 0)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not write to temporary file: %m")));
+		buf += n;
+		have -= n;
+	}
+}
+
+/*
+ * bfz_zstd_close_ex
+ *	Close buffers etc. Does not close the underlying file!
+ */
+static void
+bfz_zstd_close_ex(bfz_t *thiz)
+{
+	struct bfz_zstd_freeable_stuff *fs = (void *) thiz->freeable_stuff;
+
+	if (NULL != fs)
+	{
+		if (fs->compressing && fs->cstream != NULL)
+		{
+			size_t		remaining;
+
+			/* Flush all remaining output to the underlying file */
+			do
+			{
+				ZSTD_outBuffer out = {fs->buf, COMPRESSION_BUFFER_SIZE, 0};
+				instr_time	starttime;
+				instr_time	endtime;
+
+				INSTR_TIME_SET_CURRENT(starttime);
+				remaining = ZSTD_endStream(fs->cstream, &out);
+				INSTR_TIME_SET_CURRENT(endtime);
+				INSTR_TIME_ACCUM_DIFF(thiz->codecTime, endtime, starttime);
+
+				if (ZSTD_isError(remaining))
+					ereport(ERROR,
+							(errmsg("zstd compression failed"),
+							 errdetail("%s", ZSTD_getErrorName(remaining))));
+
+				bfz_zstd_write_out(thiz, fs->buf, out.pos);
+			} while (remaining > 0);
+		}
+
+		if (fs->cstream != NULL)
+			ZSTD_freeCStream(fs->cstream);
+		if (fs->dstream != NULL)
+			ZSTD_freeDStream(fs->dstream);
+
+		pfree(fs);
+		thiz->freeable_stuff = NULL;
+	}
+}
+
+/*
+ * bfz_zstd_write_ex
+ *	 Write data to an opened compressed file.
+ *	 An exception is thrown if the data cannot be written for any reason.
+ */
+static void
+bfz_zstd_write_ex(bfz_t *thiz, const char *buffer, int size)
+{
+	struct bfz_zstd_freeable_stuff *fs = (void *) thiz->freeable_stuff;
+	ZSTD_inBuffer in = {buffer, size, 0};
+
+	/* Compress until the input buffer is empty */
+	while (in.pos < in.size)
+	{
+		ZSTD_outBuffer out = {fs->buf, COMPRESSION_BUFFER_SIZE, 0};
+		instr_time	starttime;
+		instr_time	endtime;
+		size_t		ret;
+
+		INSTR_TIME_SET_CURRENT(starttime);
+		ret = ZSTD_compressStream(fs->cstream, &out, &in);
+		INSTR_TIME_SET_CURRENT(endtime);
+		INSTR_TIME_ACCUM_DIFF(thiz->codecTime, endtime, starttime);
+
+		if (ZSTD_isError(ret))
+			ereport(ERROR,
+					(errmsg("zstd compression failed"),
+					 errdetail("%s", ZSTD_getErrorName(ret))));
+
+		bfz_zstd_write_out(thiz, fs->buf, out.pos);
+	}
+}
+
+/*
+ * bfz_zstd_read_ex
+ *	Read data from an already opened compressed file.
+ *
+ *	The buffer pointer must be valid and have at least size bytes.
+ *	An exception is thrown if the data cannot be read for any reason.
+ *
+ * The buffer is filled completely, unless the end of the file is reached.
+ */
+static int
+bfz_zstd_read_ex(bfz_t *thiz, char *buffer, int size)
+{
+	struct bfz_zstd_freeable_stuff *fs = (void *) thiz->freeable_stuff;
+	ZSTD_outBuffer out = {buffer, size, 0};
+
+	while (out.pos < out.size)
+	{
+		instr_time	starttime;
+		instr_time	endtime;
+		size_t		ret;
+
+		/*
+		 * Fill up our input buffer from the input file.
+		 */
+		if (fs->in.pos == fs->in.size && !fs->eof_in)
+		{
+			int			s = FileRead(thiz->file, fs->buf, COMPRESSION_BUFFER_SIZE);
+
+			if (s < 0)
+				ereport(ERROR,
+						(errcode_for_file_access(),
+						 errmsg("could not read from temporary file: %m")));
+			if (s == 0)
+				fs->eof_in = true;
+
+			fs->in.src = fs->buf;
+			fs->in.size = s;
+			fs->in.pos = 0;
+		}
+
+		if (fs->eof_in && fs->in.pos == fs->in.size)
+		{
+			/* No more input, but zstd is in the middle of a frame */
+			if (!fs->frame_done)
+				ereport(ERROR,
+						(errcode_for_file_access(),
+						 errmsg("unexpected end of temporary file")));
+			break;
+		}
+
+		INSTR_TIME_SET_CURRENT(starttime);
+		ret = ZSTD_decompressStream(fs->dstream, &out, &fs->in);
+		INSTR_TIME_SET_CURRENT(endtime);
+		INSTR_TIME_ACCUM_DIFF(thiz->codecTime, endtime, starttime);
+
+		if (ZSTD_isError(ret))
+			ereport(ERROR,
+					(errmsg("could not uncompress data from temporary file"),
+					 errdetail("%s", ZSTD_getErrorName(ret))));
+
+		/* zero means a frame was completely decoded and flushed */
+		fs->frame_done = (ret == 0);
+	}
+
+	return out.pos;
+}
+
+/*
+ * bfz_zstd_init
+ *	Initialize the zstd subsystem for a file.
+ *
+ *	The underlying file descriptor fd should already be opened
+ *	and valid. Memory is allocated in the current memory context,
+ *	except the zstd streams, which are allocated in the memory context of
+ *	the file: bfz_scan_begin() calls this in TopMemoryContext.
+ */
+void
+bfz_zstd_init(bfz_t *thiz)
+{
+	struct bfz_zstd_freeable_stuff *fs = palloc(sizeof *fs);
+	ZSTD_customMem zmem;
+	size_t		ret;
+
+	zmem.customAlloc = zstd_alloc;
+	zmem.customFree = zstd_free;
+	zmem.opaque = thiz->context;
+
+	fs->compressing = (thiz->mode == BFZ_MODE_APPEND);
+	fs->cstream = NULL;
+	fs->dstream = NULL;
+	fs->in.src = fs->buf;
+	fs->in.size = 0;
+	fs->in.pos = 0;
+	fs->eof_in = false;
+	fs->frame_done = true;
+
+	thiz->freeable_stuff = &fs->super;
+	fs->super.read_ex = bfz_zstd_read_ex;
+	fs->super.write_ex = bfz_zstd_write_ex;
+	fs->super.close_ex = bfz_zstd_close_ex;
+
+	if (fs->compressing)
+	{
+		/*
+		 * writing a compressed file
+		 */
+		fs->cstream = ZSTD_createCStream_advanced(zmem);
+		if (fs->cstream == NULL)
+			ereport(ERROR,
+					(errcode(ERRCODE_OUT_OF_MEMORY),
+					 errmsg("out of memory"),
+					 errdetail("Failed to allocate a zstd compression stream.")));
+
+		ret = ZSTD_initCStream(fs->cstream, gp_workfile_zstd_level);
+		if (ZSTD_isError(ret))
+			ereport(ERROR,
+					(errmsg("zstd ZSTD_initCStream failed"),
+					 errdetail("%s", ZSTD_getErrorName(ret))));
+	}
+	else
+	{
+		/*
+		 * reading a compressed file
+		 */
+		fs->dstream = ZSTD_createDStream_advanced(zmem);
+		if (fs->dstream == NULL)
+			ereport(ERROR,
+					(errcode(ERRCODE_OUT_OF_MEMORY),
+					 errmsg("out of memory"),
+					 errdetail("Failed to allocate a zstd decompression stream.")));
+
+		ret = ZSTD_initDStream(fs->dstream);
+		if (ZSTD_isError(ret))
+			ereport(ERROR,
+					(errmsg("zstd ZSTD_initDStream failed"),
+					 errdetail("%s", ZSTD_getErrorName(ret))));
+	}
+}
+
+#endif   /* HAVE_LIBZSTD */
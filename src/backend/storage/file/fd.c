@@ -1456,6 +1456,76 @@ FilePrefetch(File file, off_t offset, int amount)
 #endif
 }
 
+/*
+ * FileWriteback - initiate asynchronous writeback of a given range of the
+ * file.  The logical seek position is unaffected.
+ *
+ * Unlike pg_flush_data(), this is not suppressed when fsync is disabled:
+ * it is meant for temporary files and append-only segment files, where the
+ * point is to keep the kernel writing out dirty pages steadily rather than
+ * stalling the writer once the dirty page limit is reached.
+ */
+int
+FileWriteback(File file, off_t offset, off_t amount)
+{
+#if defined(HAVE_SYNC_FILE_RANGE)
+	int			returnCode;
+
+	Assert(FileIsValid(file));
+
+	DO_DB(elog(LOG, "FileWriteback: %d (%s) " INT64_FORMAT " " INT64_FORMAT,
+			   file, VfdCache[file].fileName,
+			   (int64) offset, (int64) amount));
+
+	if (amount <= 0)
+		return 0;
+
+	returnCode = FileAccess(file);
+	if (returnCode < 0)
+		return returnCode;
+
+	return sync_file_range(VfdCache[file].fd, offset, amount,
+						   SYNC_FILE_RANGE_WRITE);
+#else
+	Assert(FileIsValid(file));
+	return 0;
+#endif
+}
+
+/*
+ * FileDropCache - ask the kernel to drop the cached pages of a given range
+ * of the file.  The logical seek position is unaffected.
+ *
+ * Only clean pages are dropped, so this is normally preceded by a
+ * FileWriteback() of the range, some time earlier.
+ */
+int
+FileDropCache(File file, off_t offset, off_t amount)
+{
+#if defined(USE_POSIX_FADVISE) && defined(POSIX_FADV_DONTNEED)
+	int			returnCode;
+
+	Assert(FileIsValid(file));
+
+	DO_DB(elog(LOG, "FileDropCache: %d (%s) " INT64_FORMAT " " INT64_FORMAT,
+			   file, VfdCache[file].fileName,
+			   (int64) offset, (int64) amount));
+
+	if (amount <= 0)
+		return 0;
+
+	returnCode = FileAccess(file);
+	if (returnCode < 0)
+		return returnCode;
+
+	return posix_fadvise(VfdCache[file].fd, offset, amount,
+						 POSIX_FADV_DONTNEED);
+#else
+	Assert(FileIsValid(file));
+	return 0;
+#endif
+}
+
 int
 FileRead(File file, char *buffer, int amount)
 {
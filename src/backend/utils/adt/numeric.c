@@ -5967,6 +5967,62 @@ numericvar_to_double_no_overflow(NumericVar *var)
 	return val;
 }
 
+/*
+ * Compute an order-preserving 64-bit abbreviation of a numeric, for sorting.
+ *
+ * Numerics whose abbreviations differ compare the same way as the
+ * abbreviations do as unsigned integers; equal abbreviations say nothing.
+ * The magnitude is encoded as 7 bits of weight followed by the first four
+ * NBASE digits at 14 bits each.  Negative values are negated, and NaN sorts
+ * above everything else, as in cmp_numerics().
+ */
+uint64
+numeric_abbrev_key(Numeric num)
+{
+	NumericDigit *digits;
+	int			ndigits;
+	int			weight;
+	int64		result;
+
+	if (NUMERIC_IS_NAN(num))
+		return ~UINT64CONST(0);
+
+	ndigits = NUMERIC_NDIGITS(num);
+	weight = NUMERIC_WEIGHT(num);
+	digits = NUMERIC_DIGITS(num);
+
+	if (ndigits == 0 || weight < -44)
+		result = 0;
+	else if (weight > 83)
+		result = INT64CONST(0x7FFFFFFFFFFFFFFE);
+	else
+	{
+		result = ((int64) (weight + 44) << 56);
+
+		switch (ndigits)
+		{
+			default:
+				result |= ((int64) digits[3]);
+				/* FALLTHROUGH */
+			case 3:
+				result |= ((int64) digits[2]) << 14;
+				/* FALLTHROUGH */
+			case 2:
+				result |= ((int64) digits[1]) << 28;
+				/* FALLTHROUGH */
+			case 1:
+				result |= ((int64) digits[0]) << 42;
+				break;
+		}
+	}
+
+	if (NUMERIC_SIGN(num) == NUMERIC_NEG)
+		result = -result;
+
+	/* flip the sign bit, so that the result orders as an unsigned integer */
+	return ((uint64) result) ^ (UINT64CONST(1) << 63);
+}
+
 
 /*
  * cmp_var() -
@@ -107,6 +107,7 @@
 #include "access/sysattr.h"
 #include "catalog/index.h"
 #include "catalog/pg_collation.h"
+#include "catalog/pg_inherits_fn.h"
 #include "catalog/pg_opfamily.h"
 #include "catalog/pg_statistic.h"
 #include "catalog/pg_type.h"
@@ -131,6 +132,7 @@
 #include "utils/date.h"
 #include "utils/datum.h"
 #include "utils/fmgroids.h"
+#include "utils/hyperloglog/hyperloglog.h"
 #include "utils/lsyscache.h"
 #include "utils/nabstime.h"
 #include "utils/pg_locale.h"
@@ -142,6 +144,7 @@
 #include "utils/tqual.h"
 #include "utils/typcache.h"
 
+#include "cdb/cdbpartition.h"
 #include "cdb/cdbutil.h"
 #include "cdb/cdbvars.h"
 
@@ -4314,6 +4317,231 @@ static void inline adjust_partition_table_statistic_for_parent(HeapTuple statsTu
 	}
 }
 
+/*
+ * Collect the relations scanned by the Append path of an inherited or
+ * partitioned table, delving into nested Appends like
+ * largest_child_relation() does.  Children excluded by constraints have no
+ * subpath, so these are the partitions that survived pruning.
+ */
+static List *
+scanned_child_relations(AppendPath *append_path)
+{
+	List	   *result = NIL;
+	ListCell   *lc;
+
+	foreach(lc, append_path->subpaths)
+	{
+		Path	   *subpath = (Path *) lfirst(lc);
+
+		if (IsA(subpath, AppendPath))
+			result = list_concat(result,
+								 scanned_child_relations((AppendPath *) subpath));
+		else
+			result = lappend(result, subpath->parent);
+	}
+
+	return result;
+}
+
+/*
+ * Merge the HLL counter ANALYZE kept in a pg_statistic tuple into *merged.
+ * Returns false if the tuple has none, or one of another kind than those
+ * merged so far: counters of full scans and of samples do not mix.
+ */
+static bool
+merge_statistic_hll(HeapTuple statsTuple, HLLCounter *merged, int *stakind,
+					double *samplerows, double *nmultiples)
+{
+	AttStatsSlot sslot;
+	HLLCounter	counter;
+	int			kind;
+
+	if (get_attstatsslot(&sslot, statsTuple, STATISTIC_KIND_FULLHLL,
+						 InvalidOid, ATTSTATSSLOT_VALUES))
+		kind = STATISTIC_KIND_FULLHLL;
+	else if (get_attstatsslot(&sslot, statsTuple, STATISTIC_KIND_HLL,
+							  InvalidOid, ATTSTATSSLOT_VALUES))
+		kind = STATISTIC_KIND_HLL;
+	else
+		return false;
+
+	if (sslot.nvalues < 1 || (*stakind != 0 && *stakind != kind))
+	{
+		free_attstatsslot(&sslot);
+		return false;
+	}
+
+	counter = (HLLCounter) DatumGetByteaP(sslot.values[0]);
+	if (kind == STATISTIC_KIND_HLL)
+	{
+		*samplerows += counter->samplerows;
+		*nmultiples += counter->nmultiples;
+	}
+	*merged = hyperloglog_merge_counters(*merged, counter);
+	*stakind = kind;
+
+	free_attstatsslot(&sslot);
+	return true;
+}
+
+/*
+ * Estimate the number of distinct values of a column of a partitioned table
+ * by merging the HLL counters ANALYZE kept for its leaf partitions.
+ *
+ * Only the partitions that survived pruning are merged, so the estimate is
+ * that of the rows actually scanned; if none was pruned, the counter ANALYZE
+ * merged for the root is used instead.  A counter of a full scan gives the
+ * estimate directly.  A counter of a sample gives the number of distinct
+ * values in the merged sample, which is scaled up to the partitions with the
+ * Haas and Stokes estimator, as ANALYZE does.  The values seen more than
+ * once are approximated by adding up those of the partitions, which counts
+ * a value repeated in several partitions more than once, and errs towards
+ * fewer distinct values.
+ *
+ * Returns -1 if a nonempty partition has no counter, or if the counters are
+ * not all of the same kind.
+ */
+static double
+hll_numdistinct_for_parent(PlannerInfo *root, RelOptInfo *rel,
+						   RangeTblEntry *rte, AttrNumber attno)
+{
+	PartStatus	ps = rel_part_status(rte->relid);
+	const char *attname;
+	List	   *children;
+	List	   *leaves = NIL;
+	ListCell   *lc;
+	HLLCounter	merged = NULL;
+	int			stakind = 0;
+	int			nappinfos = 0;
+	double		totaltuples = 0.0;
+	double		samplerows = 0.0;
+	double		nmultiples = 0.0;
+	double		ndistinct;
+
+	if (ps != PART_STATUS_ROOT && ps != PART_STATUS_INTERIOR)
+		return -1.0;
+	if (!IsA(rel->cheapest_total_path, AppendPath))
+		return -1.0;
+
+	/*
+	 * The root and the interior partitions hold no rows, nor statistics of
+	 * their own, so only the nonempty leaves count.
+	 */
+	children = scanned_child_relations((AppendPath *) rel->cheapest_total_path);
+	foreach(lc, children)
+	{
+		RelOptInfo *childrel = (RelOptInfo *) lfirst(lc);
+		RangeTblEntry *child_rte = planner_rt_fetch(childrel->relid, root);
+
+		if (child_rte->rtekind != RTE_RELATION ||
+			child_rte->relid == rte->relid ||
+			has_subclass(child_rte->relid) ||
+			childrel->tuples <= 0.0)
+			continue;
+
+		leaves = lappend(leaves, child_rte);
+		totaltuples += childrel->tuples;
+	}
+	if (leaves == NIL)
+		return -1.0;
+
+	foreach(lc, root->append_rel_list)
+	{
+		AppendRelInfo *appinfo = (AppendRelInfo *) lfirst(lc);
+
+		if (appinfo->parent_relid == rel->relid)
+			nappinfos++;
+	}
+
+	/* Nothing pruned?  Then the counter of the root will do. */
+	if (nappinfos == list_length(children))
+	{
+		HeapTuple	statsTuple;
+
+		statsTuple = SearchSysCache3(STATRELATTINH,
+									 ObjectIdGetDatum(rte->relid),
+									 Int16GetDatum(attno),
+									 BoolGetDatum(true));
+		if (HeapTupleIsValid(statsTuple))
+		{
+			if (!merge_statistic_hll(statsTuple, &merged, &stakind,
+									 &samplerows, &nmultiples))
+			{
+				merged = NULL;
+				stakind = 0;
+				samplerows = 0.0;
+				nmultiples = 0.0;
+			}
+			ReleaseSysCache(statsTuple);
+		}
+	}
+
+	if (merged == NULL)
+	{
+		attname = get_relid_attribute_name(rte->relid, attno);
+
+		foreach(lc, leaves)
+		{
+			RangeTblEntry *child_rte = (RangeTblEntry *) lfirst(lc);
+			AttrNumber	child_attno = get_attnum(child_rte->relid, attname);
+			HeapTuple	statsTuple;
+			bool		merged_ok;
+
+			if (child_attno == InvalidAttrNumber)
+				return -1.0;
+
+			statsTuple = SearchSysCache3(STATRELATTINH,
+										 ObjectIdGetDatum(child_rte->relid),
+										 Int16GetDatum(child_attno),
+										 BoolGetDatum(false));
+			if (!HeapTupleIsValid(statsTuple))
+				return -1.0;
+
+			merged_ok = merge_statistic_hll(statsTuple, &merged, &stakind,
+											&samplerows, &nmultiples);
+			ReleaseSysCache(statsTuple);
+			if (!merged_ok)
+				return -1.0;
+		}
+	}
+
+	ndistinct = hyperloglog_estimate(merged);
+
+	if (stakind == STATISTIC_KIND_HLL)
+	{
+		double		d = ndistinct;
+		double		f1;
+
+		if (samplerows <= 0.0)
+			return -1.0;
+
+		if (fabs(samplerows - d) / samplerows < HLL_ERROR_MARGIN)
+		{
+			/* no value repeated in the sample: assume the column is unique */
+			ndistinct = totaltuples;
+		}
+		else
+		{
+			/* Haas and Stokes' Duj1: n*d / (n - f1 + f1*n/N) */
+			f1 = d - nmultiples;
+			if (f1 < 0.0)
+				f1 = 0.0;
+
+			ndistinct = (samplerows * d) /
+				((samplerows - f1) + f1 * samplerows / totaltuples);
+			if (ndistinct < d)
+				ndistinct = d;
+		}
+	}
+
+	if (ndistinct > totaltuples)
+		ndistinct = totaltuples;
+	if (ndistinct < 1.0)
+		ndistinct = 1.0;
+
+	return floor(ndistinct + 0.5);
+}
+
 /*
  * examine_variable
  *		Try to look up statistical data about an expression.
@@ -4361,6 +4589,7 @@ examine_variable(PlannerInfo *root, Node *node, int varRelid,
 	vardata->vartype = exprType(node);
 
 	vardata->numdistinctFromPrimaryKey = -1.0; /* ignore by default*/
+	vardata->numdistinctFromHLL = -1.0; /* ignore by default*/
 
 	/* Look inside any binary-compatible relabeling */
 
@@ -4587,6 +4816,31 @@ examine_simple_variable(PlannerInfo *root, Var *var,
 	}
 	else if (rte->inh)
 	{
+		/*
+		 * If gp_statistics_use_hll is set, estimate the number of distinct
+		 * values of a partitioned table from the HLL counters of the
+		 * partitions that survived pruning.  That is done once per column,
+		 * after the paths of the table are built.
+		 */
+		if (gp_statistics_use_hll &&
+			rte->rtekind == RTE_RELATION &&
+			var->varattno > 0)
+		{
+			RelOptInfo *rel = find_base_rel(root, var->varno);
+
+			if (rel->attr_ndistinct != NULL &&
+				rel->cheapest_total_path != NULL)
+			{
+				double	   *ndistinct;
+
+				ndistinct = &rel->attr_ndistinct[var->varattno - rel->min_attr];
+				if (*ndistinct == 0.0)
+					*ndistinct = hll_numdistinct_for_parent(root, rel, rte,
+															var->varattno);
+				vardata->numdistinctFromHLL = *ndistinct;
+			}
+		}
+
 		/*
 		 * If gp_statistics_pullup_from_child_partition is set, we attempt to pull up statistics from
 		 * the largest child partition in an inherited or a partitioned table.
@@ -4778,6 +5032,17 @@ get_variable_numdistinct(VariableStatData *vardata, bool *isdefault)
 		return vardata->numdistinctFromPrimaryKey;
 	}
 
+	/*
+	 * Next best is the estimate merged from the HLL counters of the
+	 * partitions scanned, unless the variable is known to be unique.
+	 */
+	if (gp_statistics_use_hll &&
+		vardata->numdistinctFromHLL > 0.0 &&
+		!vardata->isunique)
+	{
+		return vardata->numdistinctFromHLL;
+	}
+
 	/*
 	 * Determine the stadistinct value to use.  There are cases where we can
 	 * get an estimate even without a pg_statistic entry, or can get a better
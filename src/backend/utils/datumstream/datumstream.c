@@ -614,6 +614,7 @@ create_datumstreamwrite(
 							   acc->datumStreamVersion,
 							   acc->rle_want_compression,
 							   acc->delta_want_compression,
+							   gp_aocs_dictionary_encoding,
 							   initialMaxDatumPerBlock,
 							   maxDatumPerBlock,
 							   acc->maxAoBlockSize - acc->maxAoHeaderSize,
@@ -1282,11 +1283,50 @@ datumstreamread_block_content(DatumStreamRead * acc)
 	datumstreamread_block_get_ready(acc);
 }
 
+/*
+ * Make the content of a block kept by the caller the current block, in place
+ * of reading it from the segment file.
+ *
+ * The content must be that of a block of this column that is not a large
+ * object, as it was in the stream's buffer after datumstreamread_block_content,
+ * and it must stay valid for as long as the block is current.
+ */
+void
+datumstreamread_block_from_cache(DatumStreamRead * acc,
+								 int64 firstRowNum,
+								 int32 rowCount,
+								 uint8 *content,
+								 int32 contentLen)
+{
+	Assert(acc);
+
+	DatumStreamBlockRead_Reset(&acc->blockRead);
+
+	acc->largeObjectState = DatumStreamLargeObjectState_None;
+
+	acc->getBlockInfo.contentLen = contentLen;
+	acc->getBlockInfo.execBlockKind = AOCSBK_BLOCK;
+	acc->getBlockInfo.firstRow = firstRowNum;
+	acc->getBlockInfo.rowCnt = rowCount;
+	acc->getBlockInfo.isLarge = false;
+	acc->getBlockInfo.isCompressed = false;
+
+	acc->blockFirstRowNum = firstRowNum;
+	acc->blockRowCount = rowCount;
+	acc->buffer_beginp = content;
+
+	datumstreamread_block_get_ready(acc);
+}
 
+
+/*
+ * Read the header of the next block, without reading its content.
+ *
+ * Returns -1 at the end of the segment file.  The caller must follow up
+ * with either datumstreamread_block_content or datumstreamread_skip_block.
+ */
 int
-datumstreamread_block(DatumStreamRead * acc,
-					  AppendOnlyBlockDirectory *blockDirectory,
-					  int colGroupNo)
+datumstreamread_block_header(DatumStreamRead * acc)
 {
 	bool		readOK = false;
 
@@ -1344,6 +1384,17 @@ datumstreamread_block(DatumStreamRead * acc,
 			 acc->blockFileOffset,
 			 acc->blockRowCount);
 
+	return 0;
+}
+
+int
+datumstreamread_block(DatumStreamRead * acc,
+					  AppendOnlyBlockDirectory *blockDirectory,
+					  int colGroupNo)
+{
+	if (datumstreamread_block_header(acc) < 0)
+		return -1;
+
 	datumstreamread_block_content(acc);
 
 	if (blockDirectory)
@@ -1359,6 +1410,60 @@ datumstreamread_block(DatumStreamRead * acc,
 	return 0;
 }
 
+/*
+ * Skip the block whose header datumstreamread_block_header just read,
+ * without reading or decompressing its content.
+ */
+void
+datumstreamread_skip_block(DatumStreamRead * acc)
+{
+	AppendOnlyStorageRead_SkipCurrentBlock(&acc->ao_read);
+}
+
+/*
+ * Position the stream so that the next datumstreamread_advance returns
+ * the first row after rowNum, skipping the blocks in between without
+ * reading their content.
+ *
+ * Used to keep the other columns of a scan in step with a column that has
+ * skipped rows.
+ */
+void
+datumstreamread_skip_past_row(DatumStreamRead * acc, int64 rowNum)
+{
+	int64		lastRowNum = acc->blockFirstRowNum + acc->blockRowCount - 1;
+
+	if (lastRowNum > rowNum)
+	{
+		/* The row is in the current block, or was never stored */
+		if (rowNum >= acc->blockFirstRowNum &&
+			rowNum - acc->blockFirstRowNum > datumstreamread_nth(acc))
+			datumstreamread_find(acc, rowNum - acc->blockFirstRowNum);
+		return;
+	}
+
+	/* Consume the rest of the current block */
+	while (datumstreamread_advance(acc) > 0)
+		;
+
+	for (;;)
+	{
+		if (datumstreamread_block_header(acc) < 0)
+			return;
+
+		if (acc->blockFirstRowNum + acc->blockRowCount - 1 <= rowNum)
+		{
+			datumstreamread_skip_block(acc);
+			continue;
+		}
+
+		datumstreamread_block_content(acc);
+		if (rowNum >= acc->blockFirstRowNum)
+			datumstreamread_find(acc, rowNum - acc->blockFirstRowNum);
+		return;
+	}
+}
+
 void
 datumstreamread_rewind_block(DatumStreamRead * datumStream)
 {
@@ -13,6 +13,7 @@
  */
 
 #include "postgres.h"
+#include "access/hash.h"
 #include "access/tupmacs.h"
 #include "access/tuptoaster.h"
 #include "utils/datumstreamblock.h"
@@ -112,6 +113,75 @@ errcontext_datumstreamblockread_callback(
 	return errcontext_datumstreamblockread(dsr);
 }
 
+/*
+ * Set up reading the codes of a block with a dictionary, which start at
+ * datum_beginp.  Pointers to the distinct values are kept in dict_entries
+ * so each code can be turned into its value in constant time.
+ */
+static void
+DatumStreamBlockRead_GetReadyDict(DatumStreamBlockRead * dsr)
+{
+	DatumStreamBlock_Dict_Extension *dictExtension;
+	uint8	   *p;
+	uint8	   *dict_afterp;
+	int32		i;
+
+	dictExtension = (DatumStreamBlock_Dict_Extension *) dsr->datum_beginp;
+	if (dictExtension->dict_count <= 0 ||
+		dictExtension->dict_count > DATUMSTREAM_DICT_MAX_COUNT ||
+		dictExtension->dict_size < 0 ||
+		(dictExtension->code_width != 1 && dictExtension->code_width != 2) ||
+		sizeof(DatumStreamBlock_Dict_Extension) + dictExtension->dict_size +
+		(int64) dictExtension->codes_count * dictExtension->code_width > dsr->physical_data_size)
+	{
+		ereport(ERROR,
+				(errmsg("Bad datum stream block dictionary "
+						"(dictionary count %d, dictionary size %d, codes count %d, code width %d, physical data size %d)",
+						dictExtension->dict_count,
+						dictExtension->dict_size,
+						dictExtension->codes_count,
+						dictExtension->code_width,
+						dsr->physical_data_size),
+				 errdetail_datumstreamblockread(dsr),
+				 errcontext_datumstreamblockread(dsr)));
+	}
+
+	if (dsr->dict_entries == NULL)
+		dsr->dict_entries = MemoryContextAlloc(dsr->memctxt,
+								DATUMSTREAM_DICT_MAX_COUNT * sizeof(uint8 *));
+
+	/*
+	 * The distinct values are laid out like the datums of a block without a
+	 * dictionary: 4 byte header values are aligned with zero padding.
+	 */
+	p = dsr->datum_beginp + sizeof(DatumStreamBlock_Dict_Extension);
+	dict_afterp = p + dictExtension->dict_size;
+	for (i = 0; i < dictExtension->dict_count; i++)
+	{
+		if (p < dict_afterp && *p == 0)
+			p = (uint8 *) att_align_nominal(p, dsr->typeInfo.align);
+		if (p >= dict_afterp)
+		{
+			ereport(ERROR,
+					(errmsg("Bad datum stream block dictionary entry %d "
+							"(dictionary count %d, dictionary size %d)",
+							i,
+							dictExtension->dict_count,
+							dictExtension->dict_size),
+					 errdetail_datumstreamblockread(dsr),
+					 errcontext_datumstreamblockread(dsr)));
+		}
+		dsr->dict_entries[i] = p;
+		p += VARSIZE_ANY(p);
+	}
+
+	dsr->dict_block_was_compressed = true;
+	dsr->dict_count = dictExtension->dict_count;
+	dsr->dict_code_width = dictExtension->code_width;
+	dsr->dict_codesp = dict_afterp;
+	dsr->dict_code = -1;
+}
+
 void
 DatumStreamBlockRead_ResetOrig(DatumStreamBlockRead * dsr)
 {
@@ -144,6 +214,8 @@ DatumStreamBlockRead_ResetOrig(DatumStreamBlockRead * dsr)
 
 	dsr->buffer_beginp = NULL;
 	dsr->datump = NULL;
+
+	dsr->dict_block_was_compressed = false;
 }
 
 void
@@ -338,6 +410,9 @@ DatumStreamBlockRead_GetReadyOrig(
 #endif
 
 	dsr->datump = dsr->datum_beginp;
+
+	if ((blockOrig->flags & DSB_HAS_DICT_COMPRESSION) != 0)
+		DatumStreamBlockRead_GetReadyDict(dsr);
 }
 
 void
@@ -402,7 +477,11 @@ void
 DatumStreamBlockRead_Finish(
 							DatumStreamBlockRead * dsr)
 {
-	/* Place holder. */
+	if (dsr->dict_entries != NULL)
+	{
+		pfree(dsr->dict_entries);
+		dsr->dict_entries = NULL;
+	}
 }
 
 /*
@@ -607,6 +686,8 @@ DatumStreamBlockRead_ResetDense(DatumStreamBlockRead * dsr)
 
 	dsr->delta_block_was_compressed = false;
 	dsr->delta_item = false;
+
+	dsr->dict_block_was_compressed = false;
 }
 
 void
@@ -941,6 +1022,9 @@ DatumStreamBlockRead_GetReadyDense(
 		}
 	}
 	dsr->datump = dsr->datum_beginp;
+
+	if ((blockDense->orig_4_bytes.flags & DSB_HAS_DICT_COMPRESSION) != 0)
+		DatumStreamBlockRead_GetReadyDict(dsr);
 }
 
 static int
@@ -3638,6 +3722,170 @@ DatumStreamBlockWrite_GetReady(
 	}
 }
 
+/*
+ * Look up a variable-length value in the dictionary hash table.  Returns the
+ * hash table slot, which holds the value's index + 1, or 0 when the slot is
+ * free.
+ */
+static int32
+DatumStreamBlockWrite_DictLookup(
+								 DatumStreamBlockWrite * dsw,
+								 uint8 * item,
+								 int32 itemLen)
+{
+	uint32		slot;
+
+	slot = DatumGetUInt32(hash_any((unsigned char *) item, itemLen)) & (DATUMSTREAM_DICT_HASH_SIZE - 1);
+	for (;;)
+	{
+		int32		entry = dsw->dict_hash[slot];
+		uint8	   *value;
+
+		if (entry == 0)
+			return slot;
+
+		value = dsw->dict_values[entry - 1];
+		if (VARSIZE_ANY(value) == itemLen && memcmp(value, item, itemLen) == 0)
+			return slot;
+
+		slot = (slot + 1) & (DATUMSTREAM_DICT_HASH_SIZE - 1);
+	}
+}
+
+/*
+ * Build the data area of a block with a dictionary from the physical datums
+ * in datum_buffer, into dict_buffer.
+ *
+ * Returns false, and leaves dict_buffer unused, when the block has too many
+ * distinct values or the dictionary would not make the data area smaller.
+ */
+static bool
+DatumStreamBlockWrite_DictEncode(
+								 DatumStreamBlockWrite * dsw,
+								 int32 * dictDataSize)
+{
+	DatumStreamBlock_Dict_Extension dict_extension;
+	uint8	   *datum_afterp = dsw->datump;
+	int32		plainSize = dsw->datump - dsw->datum_buffer;
+	uint8	   *p;
+	uint8	   *q;
+	int32		dictCount;
+	int32		codesCount;
+	int32		codeWidth;
+	int32		dictSize;
+
+	Assert(dsw->typeInfo->datumlen == -1);
+
+	if (plainSize == 0)
+		return false;
+
+	if (dsw->dict_buffer == NULL)
+	{
+		MemoryContext oldCtxt = MemoryContextSwitchTo(dsw->memctxt);
+
+		dsw->dict_buffer = palloc(dsw->datum_buffer_size);
+		dsw->dict_hash = palloc(DATUMSTREAM_DICT_HASH_SIZE * sizeof(int32));
+		dsw->dict_values = palloc(DATUMSTREAM_DICT_MAX_COUNT * sizeof(uint8 *));
+
+		MemoryContextSwitchTo(oldCtxt);
+	}
+	memset(dsw->dict_hash, 0, DATUMSTREAM_DICT_HASH_SIZE * sizeof(int32));
+
+	/*
+	 * First pass: collect the distinct values, giving up as soon as they
+	 * alone are as large as the datums.
+	 */
+	dictCount = 0;
+	codesCount = 0;
+	q = dsw->dict_buffer + sizeof(DatumStreamBlock_Dict_Extension);
+	p = dsw->datum_buffer;
+	while (p < datum_afterp)
+	{
+		int32		itemLen;
+		int32		slot;
+
+		/*
+		 * A Put that did not fit may have left zero padding at the end.
+		 */
+		if (*p == 0)
+		{
+			p = (uint8 *) att_align_nominal(p, dsw->typeInfo->align);
+			if (p >= datum_afterp)
+				break;
+		}
+		itemLen = VARSIZE_ANY(p);
+
+		slot = DatumStreamBlockWrite_DictLookup(dsw, p, itemLen);
+		if (dsw->dict_hash[slot] == 0)
+		{
+			if (dictCount >= DATUMSTREAM_DICT_MAX_COUNT)
+				return false;
+
+			if (!VARATT_IS_SHORT(p))
+				q = (uint8 *) att_align_zero((char *) q, dsw->typeInfo->align);
+			if ((q - dsw->dict_buffer) + itemLen + codesCount + 1 >= plainSize)
+				return false;
+
+			memcpy(q, p, itemLen);
+			dsw->dict_values[dictCount] = q;
+			dsw->dict_hash[slot] = ++dictCount;
+			q += itemLen;
+		}
+
+		codesCount++;
+		p += itemLen;
+	}
+	Assert(dsw->datumStreamVersion == DatumStreamVersion_Original ||
+		   codesCount == dsw->physical_datum_count);
+
+	dictSize = (q - dsw->dict_buffer) - sizeof(DatumStreamBlock_Dict_Extension);
+	codeWidth = (dictCount <= 256 ? 1 : 2);
+	if (sizeof(DatumStreamBlock_Dict_Extension) + dictSize +
+		codesCount * codeWidth >= plainSize)
+		return false;
+
+	/*
+	 * Second pass: write the codes.
+	 */
+	p = dsw->datum_buffer;
+	while (p < datum_afterp)
+	{
+		int32		itemLen;
+		int32		code;
+
+		if (*p == 0)
+		{
+			p = (uint8 *) att_align_nominal(p, dsw->typeInfo->align);
+			if (p >= datum_afterp)
+				break;
+		}
+		itemLen = VARSIZE_ANY(p);
+
+		code = dsw->dict_hash[DatumStreamBlockWrite_DictLookup(dsw, p, itemLen)] - 1;
+		Assert(code >= 0);
+		*(q++) = code & 0xFF;
+		if (codeWidth == 2)
+			*(q++) = (code >> 8) & 0xFF;
+
+		p += itemLen;
+	}
+
+	dict_extension.dict_count = dictCount;
+	dict_extension.dict_size = dictSize;
+	dict_extension.codes_count = codesCount;
+	dict_extension.code_width = codeWidth;
+	memcpy(dsw->dict_buffer, &dict_extension, sizeof(DatumStreamBlock_Dict_Extension));
+
+	*dictDataSize = q - dsw->dict_buffer;
+
+	/*
+	 * We charge the dictionary and codes against the datums they replace.
+	 */
+	dsw->savings += plainSize - *dictDataSize;
+
+	return true;
+}
+
 static int64
 DatumStreamBlockWrite_BlockOrig(
 								DatumStreamBlockWrite * dsw,
@@ -3645,6 +3893,7 @@ DatumStreamBlockWrite_BlockOrig(
 {
 	uint8	   *p;
 	DatumStreamBlock_Orig block;
+	uint8	   *datum_data;
 	int32		unalignedNullSize;
 	int32		rowCount;
 	int64		writesz;
@@ -3676,6 +3925,16 @@ DatumStreamBlockWrite_BlockOrig(
 
 	block.sz = dsw->datump - dsw->datum_buffer;
 
+	datum_data = dsw->datum_buffer;
+	dsw->dict_has_compression =
+		(dsw->dict_want_compression &&
+		 DatumStreamBlockWrite_DictEncode(dsw, &block.sz));
+	if (dsw->dict_has_compression)
+	{
+		block.flags |= DSB_HAS_DICT_COMPRESSION;
+		datum_data = dsw->dict_buffer;
+	}
+
 	/*
 	 * Serialize the different data in to the write buffer.
 	 */
@@ -3702,7 +3961,7 @@ DatumStreamBlockWrite_BlockOrig(
 	}
 
 	/* Next write data */
-	memcpy(p, dsw->datum_buffer, block.sz);
+	memcpy(p, datum_data, block.sz);
 	p += block.sz;
 
 	/* Calculate write size. */
@@ -3769,6 +4028,7 @@ DatumStreamBlockWrite_BlockDense(
 	int64		writesz = 0;
 	uint8	   *p = NULL;
 	DatumStreamBlock_Dense dense;
+	uint8	   *datum_data;
 	DatumStreamBlock_Rle_Extension rle_extension;
 	DatumStreamBlock_Delta_Extension delta_extension;
 	int32		headerSize;
@@ -3816,6 +4076,16 @@ DatumStreamBlockWrite_BlockDense(
 	dense.physical_datum_count = dsw->physical_datum_count;
 	dense.physical_data_size = dsw->datump - dsw->datum_buffer;
 
+	datum_data = dsw->datum_buffer;
+	dsw->dict_has_compression =
+		(dsw->dict_want_compression &&
+		 DatumStreamBlockWrite_DictEncode(dsw, &dense.physical_data_size));
+	if (dsw->dict_has_compression)
+	{
+		dense.orig_4_bytes.flags |= DSB_HAS_DICT_COMPRESSION;
+		datum_data = dsw->dict_buffer;
+	}
+
 	headerSize = sizeof(DatumStreamBlock_Dense);
 
 	/*
@@ -4038,7 +4308,7 @@ DatumStreamBlockWrite_BlockDense(
 				 errcontext_datumstreamblockwrite(dsw)));
 	}
 
-	memcpy(p, dsw->datum_buffer, dense.physical_data_size);
+	memcpy(p, datum_data, dense.physical_data_size);
 	p += dense.physical_data_size;
 
 	/* Calculate write size. */
@@ -4232,6 +4502,7 @@ DatumStreamBlockWrite_Init(
 						   DatumStreamVersion datumStreamVersion,
 						   bool rle_want_compression,
 						   bool delta_want_compression,
+						   bool dict_want_compression,
 						   int32 initialMaxDatumPerBlock,
 						   int32 maxDatumPerBlock,
 						   int32 maxDataBlockSize,
@@ -4249,6 +4520,10 @@ DatumStreamBlockWrite_Init(
 	dsw->rle_want_compression = rle_want_compression;
 	dsw->delta_want_compression = delta_want_compression;
 
+	/* Only variable-length items are put in a dictionary. */
+	dsw->dict_want_compression =
+		(dict_want_compression && typeInfo->datumlen == -1);
+
 	dsw->initialMaxDatumPerBlock = initialMaxDatumPerBlock;
 	dsw->maxDatumPerBlock = maxDatumPerBlock;
 
@@ -4458,6 +4733,15 @@ DatumStreamBlockWrite_Finish(
 	if (dsw->delta_sign != NULL)
 		pfree(dsw->delta_sign);
 
+	if (dsw->dict_buffer != NULL)
+		pfree(dsw->dict_buffer);
+
+	if (dsw->dict_hash != NULL)
+		pfree(dsw->dict_hash);
+
+	if (dsw->dict_values != NULL)
+		pfree(dsw->dict_values);
+
 	MemoryContextSwitchTo(oldCtxt);
 }
 
@@ -4654,18 +4938,118 @@ DatumStreamBlock_IntegrityCheckVarlena(
 		p += varLen;
 		currentOffset += varLen;
 
+		count++;
+
 		if (currentOffset >= physicalDataSize)
 		{
 			Assert(currentOffset == physicalDataSize);
 			break;
 		}
-
-		count++;
 	}
 
 	return count;
 }
 
+/*
+ * Check the data area of a block with a dictionary: the extension, the
+ * distinct values and the codes.  Returns the number of codes.
+ */
+static int32
+DatumStreamBlock_IntegrityCheckDict(
+									uint8 * physicalData,
+									int32 physicalDataSize,
+									DatumStreamVersion datumStreamVersion,
+									DatumStreamTypeInfo * typeInfo,
+							   int (*errdetailCallback) (void *errdetailArg),
+									void *errdetailArg,
+							 int (*errcontextCallback) (void *errcontextArg),
+									void *errcontextArg)
+{
+	DatumStreamBlock_Dict_Extension *dictExtension;
+	int32		dictCount;
+	uint8	   *codesp;
+	int32		i;
+
+	if (typeInfo->datumlen != -1 ||
+		physicalDataSize < sizeof(DatumStreamBlock_Dict_Extension))
+	{
+		ereport(ERROR,
+				(errmsg("Bad datum stream %s dictionary block (datum length %d, physical data size %d)",
+						DatumStreamVersion_String(datumStreamVersion),
+						typeInfo->datumlen,
+						physicalDataSize),
+				 errdetailCallback(errdetailArg),
+				 errcontextCallback(errcontextArg)));
+	}
+
+	dictExtension = (DatumStreamBlock_Dict_Extension *) physicalData;
+	if (dictExtension->dict_count <= 0 ||
+		dictExtension->dict_count > DATUMSTREAM_DICT_MAX_COUNT ||
+		dictExtension->dict_size < 0 ||
+		dictExtension->codes_count < 0 ||
+		(dictExtension->code_width != 1 && dictExtension->code_width != 2) ||
+		sizeof(DatumStreamBlock_Dict_Extension) + dictExtension->dict_size +
+		(int64) dictExtension->codes_count * dictExtension->code_width != physicalDataSize)
+	{
+		ereport(ERROR,
+				(errmsg("Bad datum stream %s dictionary "
+						"(dictionary count %d, dictionary size %d, codes count %d, code width %d, physical data size %d)",
+						DatumStreamVersion_String(datumStreamVersion),
+						dictExtension->dict_count,
+						dictExtension->dict_size,
+						dictExtension->codes_count,
+						dictExtension->code_width,
+						physicalDataSize),
+				 errdetailCallback(errdetailArg),
+				 errcontextCallback(errcontextArg)));
+	}
+
+	dictCount = DatumStreamBlock_IntegrityCheckVarlena(
+									physicalData + sizeof(DatumStreamBlock_Dict_Extension),
+													   dictExtension->dict_size,
+													   datumStreamVersion,
+													   typeInfo,
+													   errdetailCallback,
+													   errdetailArg,
+													   errcontextCallback,
+													   errcontextArg);
+	if (dictCount != dictExtension->dict_count)
+	{
+		ereport(ERROR,
+				(errmsg("Bad datum stream %s dictionary count.  Found %d values and expected %d",
+						DatumStreamVersion_String(datumStreamVersion),
+						dictCount,
+						dictExtension->dict_count),
+				 errdetailCallback(errdetailArg),
+				 errcontextCallback(errcontextArg)));
+	}
+
+	codesp = physicalData + sizeof(DatumStreamBlock_Dict_Extension) + dictExtension->dict_size;
+	for (i = 0; i < dictExtension->codes_count; i++)
+	{
+		int32		code;
+
+		if (dictExtension->code_width == 1)
+			code = codesp[i];
+		else
+			code = codesp[2 * i] | (codesp[2 * i + 1] << 8);
+
+		if (code >= dictCount)
+		{
+			ereport(ERROR,
+					(errmsg("Bad datum stream %s dictionary code %d at physical item index #%d (dictionary count %d)",
+							DatumStreamVersion_String(datumStreamVersion),
+							code,
+							i,
+							dictCount),
+					 errdetailCallback(errdetailArg),
+					 errcontextCallback(errcontextArg)));
+		}
+	}
+
+	return dictExtension->codes_count;
+}
+
 static void
 DatumStreamBlock_IntegrityCheckOrig(
 									uint8 * buffer,
@@ -4730,7 +5114,19 @@ DatumStreamBlock_IntegrityCheckOrig(
 		p += blockOrig->nullsz;
 	}
 
-	if (typeInfo->datumlen == -1)
+	if ((blockOrig->flags & DSB_HAS_DICT_COMPRESSION) != 0)
+	{
+		DatumStreamBlock_IntegrityCheckDict(
+											p,
+											blockOrig->sz,
+											DatumStreamVersion_Original,
+											typeInfo,
+											errdetailCallback,
+											errdetailArg,
+											errcontextCallback,
+											errcontextArg);
+	}
+	else if (typeInfo->datumlen == -1)
 	{
 		/*
 		 * Variable length items (i.e. varlena).
@@ -5430,7 +5826,19 @@ DatumStreamBlock_IntegrityCheckDense(
 												  errcontextArg);
 	}
 
-	if (typeInfo->datumlen == -1)
+	if ((blockDense->orig_4_bytes.flags & DSB_HAS_DICT_COMPRESSION) != 0)
+	{
+		DatumStreamBlock_IntegrityCheckDict(
+											buffer + alignedHeaderSize,
+											blockDense->physical_data_size,
+										blockDense->orig_4_bytes.version,
+											typeInfo,
+											errdetailCallback,
+											errdetailArg,
+											errcontextCallback,
+											errcontextArg);
+	}
+	else if (typeInfo->datumlen == -1)
 	{
 		/*
 		 * Variable-length items.
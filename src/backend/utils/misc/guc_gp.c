@@ -18,11 +18,14 @@
 
 #include <sys/stat.h>
 
+#include "access/appendonly_blockcache.h"
+#include "access/appendonly_visimap_cache.h"
 #include "access/reloptions.h"
 #include "access/transam.h"
 #include "access/url.h"
 #include "access/xlog_internal.h"
 #include "cdb/cdbappendonlyam.h"
+#include "cdb/cdbcompresspool.h"
 #include "cdb/cdbdisp.h"
 #include "cdb/cdbsreh.h"
 #include "cdb/cdbvars.h"
@@ -133,6 +136,7 @@ bool		Debug_appendonly_print_compaction = false;
 bool		Debug_resource_group = false;
 bool		gp_crash_recovery_abort_suppress_fatal = false;
 bool		Debug_bitmap_print_insert = false;
+bool		gp_enable_bitmap_sort_build = true;
 bool		Test_appendonly_override = false;
 bool		Test_print_direct_dispatch_info = false;
 bool		gp_test_orientation_override = false;
@@ -156,6 +160,8 @@ bool		Debug_datumstream_block_read_check_integrity = false;
 bool		Debug_datumstream_block_write_check_integrity = false;
 bool		Debug_datumstream_read_print_varlena_info = false;
 bool		Debug_datumstream_write_use_small_initial_buffers = false;
+bool		gp_aocs_dictionary_encoding = false;
+bool		gp_appendonly_direct_io = false;
 bool		gp_create_table_random_default_distribution = true;
 bool		gp_allow_non_uniform_partitioning_ddl = true;
 bool		gp_enable_exchange_default_partition = false;
@@ -322,6 +328,9 @@ bool		gp_enable_hashjoin_size_heuristic = false;
 bool		gp_enable_predicate_propagation = false;
 bool		gp_enable_minmax_optimization = true;
 bool		gp_enable_multiphase_agg = true;
+bool		gp_enable_eager_agg = false;
+bool		gp_enable_subplan_cache = false;
+bool		gp_enable_nestloop_cache = false;
 bool		gp_enable_preunique = TRUE;
 bool		gp_eager_preunique = FALSE;
 bool		gp_hashagg_streambottom = true;
@@ -336,6 +345,7 @@ bool		gp_dynamic_partition_pruning = true;
 bool		gp_log_dynamic_partition_pruning = false;
 bool		gp_cte_sharing = false;
 bool		gp_enable_relsize_collection = false;
+bool		gp_enable_expression_program = false;
 
 /* Optimizer related gucs */
 bool		optimizer;
@@ -481,6 +491,7 @@ bool		gp_external_enable_filter_pushdown = true;
 /* Executor */
 bool		gp_enable_mk_sort = true;
 bool		gp_enable_motion_mk_sort = true;
+bool		gp_enable_mk_sort_radix = true;
 
 static const struct config_enum_entry gp_log_format_options[] = {
 	{"text", 0},
@@ -783,6 +794,39 @@ struct config_bool ConfigureNamesBool_gp[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"gp_enable_eager_agg", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables the planner's use of partial aggregation below joins."),
+			gettext_noop("Allows the rows of a table to be partially aggregated on "
+						 "their join and grouping keys before they are joined.")
+		},
+		&gp_enable_eager_agg,
+		false,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"gp_enable_subplan_cache", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables the caching of the results of correlated subplans."),
+			gettext_noop("A correlated subplan is not rescanned for parameter "
+						 "values it was already run with; up to work_mem of results are kept.")
+		},
+		&gp_enable_subplan_cache,
+		false,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"gp_enable_nestloop_cache", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables the caching of the inner rows of parameterized nested loops."),
+			gettext_noop("The inner side of a nested loop is not rescanned for parameter "
+						 "values it was already run with; up to work_mem of rows are kept.")
+		},
+		&gp_enable_nestloop_cache,
+		false,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"gp_enable_preunique", PGC_USERSET, QUERY_TUNING_METHOD,
 			gettext_noop("Enable 2-phase duplicate removal."),
@@ -927,6 +971,17 @@ struct config_bool ConfigureNamesBool_gp[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"gp_enable_mk_sort_radix", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enable radix sorting of integer and abbreviated keys in multi-key sort."),
+			NULL,
+			GUC_NO_SHOW_ALL | GUC_NOT_IN_SAMPLE | GUC_GPDB_ADDOPT
+		},
+		&gp_enable_mk_sort_radix,
+		true,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"gp_enable_motion_mk_sort", PGC_USERSET, QUERY_TUNING_METHOD,
 			gettext_noop("Enable multi-key sort in sorted motion recv."),
@@ -1107,6 +1162,39 @@ struct config_bool ConfigureNamesBool_gp[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"gp_appendonly_zone_maps", PGC_USERSET, APPENDONLY_TABLES,
+			gettext_noop("Use the block min/max summaries of append-only tables to skip blocks in scans."),
+			gettext_noop("The summaries are kept in the block directory, so only tables with an index have them."),
+			GUC_GPDB_ADDOPT
+		},
+		&gp_appendonly_zone_maps,
+		false,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"gp_aocs_dictionary_encoding", PGC_USERSET, APPENDONLY_TABLES,
+			gettext_noop("Store the variable-length columns of append-only column-oriented tables with a per-block dictionary."),
+			gettext_noop("Only blocks with few enough distinct values that the dictionary makes them smaller are encoded."),
+			GUC_GPDB_ADDOPT
+		},
+		&gp_aocs_dictionary_encoding,
+		false,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"gp_appendonly_direct_io", PGC_USERSET, APPENDONLY_TABLES,
+			gettext_noop("Keep the segment files of append-only tables out of the operating system's page cache."),
+			gettext_noop("Scans read the files with O_DIRECT, and inserts drop the pages they wrote from the cache once they have been written out."),
+			GUC_GPDB_ADDOPT
+		},
+		&gp_appendonly_direct_io,
+		false,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"gp_heap_require_relhasoids_match", PGC_USERSET, DEVELOPER_OPTIONS,
 			gettext_noop("Issue an error on discovery of a mismatch between relhasoids and a tuple header."),
@@ -1649,6 +1737,18 @@ struct config_bool ConfigureNamesBool_gp[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"gp_enable_bitmap_sort_build", PGC_USERSET, DEVELOPER_OPTIONS,
+			gettext_noop("Build bitmap indexes by sorting the indexed values and tids."),
+			gettext_noop("The bitmap vector of each distinct value is then written in one pass, "
+						 "instead of adding each tid to its vector as the table is scanned."),
+			GUC_NOT_IN_SAMPLE
+		},
+		&gp_enable_bitmap_sort_build,
+		true,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"debug_bitmap_print_insert", PGC_SUSET, DEVELOPER_OPTIONS,
 			gettext_noop("Print log messages for bitmap index insert routines (caution-- generate a lot of logs!)"),
@@ -1763,6 +1863,15 @@ struct config_bool ConfigureNamesBool_gp[] =
 		true,
 		NULL, NULL, NULL
 	},
+	{
+		{"gp_autostats_async", PGC_USERSET, DEVELOPER_OPTIONS,
+			gettext_noop("Auto-stats ANALYZEs are queued at commit, and issued by a background worker."),
+			NULL
+		},
+		&gp_autostats_async,
+		false,
+		NULL, NULL, NULL
+	},
 	{
 		{"gp_statistics_pullup_from_child_partition", PGC_USERSET, QUERY_TUNING_METHOD,
 			gettext_noop("This guc enables the planner to utilize statistics from partitions in planning queries on the parent."),
@@ -1781,6 +1890,33 @@ struct config_bool ConfigureNamesBool_gp[] =
 		true,
 		NULL, NULL, NULL
 	},
+	{
+		{"gp_statistics_use_hll", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("This guc enables the planner to estimate the number of distinct values of a partitioned table by merging the hyperloglog counters of its unpruned partitions."),
+			NULL
+		},
+		&gp_statistics_use_hll,
+		false,
+		NULL, NULL, NULL
+	},
+	{
+		{"gp_analyze_skip_unchanged_leaves", PGC_USERSET, STATS_ANALYZE,
+			gettext_noop("ANALYZE of a partitioned table does not sample again the append-optimized leaf partitions not modified since they were last analyzed."),
+			NULL
+		},
+		&gp_analyze_skip_unchanged_leaves,
+		false,
+		NULL, NULL, NULL
+	},
+	{
+		{"gp_analyze_segment_summaries", PGC_USERSET, STATS_ANALYZE,
+			gettext_noop("ANALYZE of an append-optimized table has the segments summarize the sample of each scalar column, instead of sending the sample to the master."),
+			NULL
+		},
+		&gp_analyze_segment_summaries,
+		false,
+		NULL, NULL, NULL
+	},
 	{
 		{"gp_resqueue_priority", PGC_POSTMASTER, RESOURCES_MGM,
 			gettext_noop("Enables priority scheduling."),
@@ -2058,6 +2194,16 @@ struct config_bool ConfigureNamesBool_gp[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"gp_enable_expression_program", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Evaluate scan quals and projections with the flat expression interpreter."),
+			gettext_noop("When off, expressions are evaluated by walking the expression state tree.")
+		},
+		&gp_enable_expression_program,
+		false,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"gp_log_dynamic_partition_pruning", PGC_USERSET, LOGGING_WHAT,
 			gettext_noop("This guc enables debug messages related to dynamic partition pruning."),
@@ -3208,6 +3354,54 @@ struct config_int ConfigureNamesInt_gp[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"gp_appendonly_read_ahead", PGC_USERSET, APPENDONLY_TABLES,
+			gettext_noop("Sets the number of large reads of an append-only segment file to start ahead of the current one."),
+			gettext_noop("The reads are handed to the kernel with posix_fadvise, so that they overlap with the decompression of the current one. "
+						 "Zero disables read-ahead."),
+			GUC_GPDB_ADDOPT
+		},
+		&gp_appendonly_read_ahead,
+		1, 0, 64,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"gp_aocs_compression_workers", PGC_USERSET, APPENDONLY_TABLES,
+			gettext_noop("Sets the number of threads that compress the blocks of column-oriented append-only tables during inserts."),
+			gettext_noop("Each full block of a column is compressed in the background while the blocks of the other columns are filled. "
+						 "Only zlib and zstd compression can be done in the background. Zero compresses the blocks in the backend itself."),
+			GUC_GPDB_ADDOPT
+		},
+		&gp_aocs_compression_workers,
+		0, 0, 32,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"gp_appendonly_fetch_cache_size", PGC_USERSET, APPENDONLY_TABLES,
+			gettext_noop("Sets the size of the cache of decompressed blocks kept by each fetch from an append-only table."),
+			gettext_noop("Bitmap scans fetching rows of a block they visited recently take the rows from the cache, "
+						 "without reading and decompressing the block again. Zero disables the cache."),
+			GUC_UNIT_KB | GUC_GPDB_ADDOPT
+		},
+		&gp_appendonly_fetch_cache_size,
+		4096, 0, MAX_KILOBYTES,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"gp_appendonly_visimap_cache_size", PGC_USERSET, APPENDONLY_TABLES,
+			gettext_noop("Sets the size of the visibility map cache of each scan of an append-only table."),
+			gettext_noop("Scans load the visibility map of a segment file at once when it fits in the cache, "
+						 "instead of looking up each range of rows in the visibility map relation. Zero disables the cache."),
+			GUC_UNIT_KB | GUC_GPDB_ADDOPT
+		},
+		&gp_appendonly_visimap_cache_size,
+		16384, 0, MAX_KILOBYTES,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"gp_workfile_max_entries", PGC_POSTMASTER, RESOURCES,
 			gettext_noop("Sets the maximum number of entries that can be stored in the workfile directory"),
@@ -3230,6 +3424,39 @@ struct config_int ConfigureNamesInt_gp[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"gp_workfile_zstd_level", PGC_USERSET, DEVELOPER_OPTIONS,
+			gettext_noop("Sets the Zstandard compression level used for work files."),
+			gettext_noop("Negative levels are the fastest ones. Only used if gp_workfile_compress_algorithm is \"zstd\"."),
+			GUC_GPDB_ADDOPT
+		},
+		&gp_workfile_zstd_level,
+		1, -7, 19,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"gp_workfile_prefetch_blocks", PGC_USERSET, RESOURCES,
+			gettext_noop("Number of blocks to read ahead when scanning workfiles sequentially."),
+			gettext_noop("Read-ahead is issued to the kernel asynchronously. 0 disables it."),
+			GUC_GPDB_ADDOPT
+		},
+		&gp_workfile_prefetch_blocks,
+		16, 0, 1024,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"gp_workfile_writeback_blocks", PGC_USERSET, RESOURCES,
+			gettext_noop("Number of written workfile blocks after which the kernel is asked to start writing them out."),
+			gettext_noop("Write-behind keeps spilling operators from stalling on the dirty page limit. 0 disables it."),
+			GUC_GPDB_ADDOPT
+		},
+		&gp_workfile_writeback_blocks,
+		0, 0, 1024,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"gp_vmem_idle_resource_timeout", PGC_USERSET, CLIENT_CONN_OTHER,
 			gettext_noop("Sets the time a session can be idle (in milliseconds) before we release gangs on the segment DBs to free resources."),
@@ -3912,6 +4139,17 @@ struct config_int ConfigureNamesInt_gp[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"gp_autostats_async_naptime", PGC_SIGHUP, DEVELOPER_OPTIONS,
+			gettext_noop("Time an auto-stats worker waits between two ANALYZEs. See gp_autostats_async."),
+			NULL,
+			GUC_UNIT_MS
+		},
+		&gp_autostats_async_naptime,
+		1000, 0, INT_MAX,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"gp_distinct_grouping_sets_threshold", PGC_USERSET, QUERY_TUNING_METHOD,
 			gettext_noop("Threshold for the number of grouping sets whose distinct-qualified "
@@ -4505,7 +4743,7 @@ struct config_string ConfigureNamesString_gp[] =
 	{
 		{"gp_workfile_compress_algorithm", PGC_USERSET, DEVELOPER_OPTIONS,
 			gettext_noop("Specify the compression algorithm that work files in the query executor use."),
-			gettext_noop("Valid values are \"NONE\", \"ZLIB\"."),
+			gettext_noop("Valid values are \"NONE\", \"ZLIB\" and, if built with Zstandard support, \"ZSTD\"."),
 			GUC_GPDB_ADDOPT
 		},
 		&gp_workfile_compress_algorithm_str,
@@ -5142,7 +5380,16 @@ check_gp_workfile_compress_algorithm(char **newval, void **extra, GucSource sour
 	int			i = bfz_string_to_compression(*newval);
 
 	if (i == -1)
+	{
+#ifndef HAVE_LIBZSTD
+		if (pg_strcasecmp(*newval, "zstd") == 0)
+		{
+			GUC_check_errdetail("Zstandard library is not supported by this build.");
+			GUC_check_errhint("Compile with --with-zstd to use Zstandard compression.");
+		}
+#endif
 		return false;			/* fail */
+	}
 	else
 		return true;				/* OK */
 }
@@ -252,10 +252,18 @@ ltsWriteBlock(LogicalTapeSet *lts, int64 blocknum, void *buffer)
  *
  * No need for an error return convention; we ereport() on any error.   This
  * module should never attempt to read a block it doesn't know is there.
+ *
+ * The blocks of a tape are chained through next_blk and are generally not
+ * contiguous in the file, so sequential read-ahead in the file layer does
+ * not help a merge.  Instead, as soon as a block has been read we ask for
+ * the tape's next block in the background, so that it is usually in the
+ * OS cache by the time the merge has consumed the current one.
  */
 static void
 ltsReadBlock(LogicalTapeSet *lts, int64 blocknum, void *buffer)
 {
+	LogicalTapeBlock *blk = (LogicalTapeBlock *) buffer;
+
 	Assert(lts != NULL);
 	if (ExecWorkFile_Seek(lts->pfile, blocknum * BLCKSZ, SEEK_SET) != 0 ||
 			ExecWorkFile_Read(lts->pfile, buffer, BLCKSZ) != BLCKSZ)
@@ -266,6 +274,9 @@ ltsReadBlock(LogicalTapeSet *lts, int64 blocknum, void *buffer)
 				 errmsg("could not read block " INT64_FORMAT  " of temporary file: %m",
 						blocknum)));
 	}
+
+	if (gp_workfile_prefetch_blocks > 0 && blk->next_blk != -1L)
+		ExecWorkFile_Prefetch(lts->pfile, blk->next_blk * BLCKSZ, BLCKSZ);
 }
 
 /*
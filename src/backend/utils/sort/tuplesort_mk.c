@@ -122,6 +122,9 @@
 #include "utils/tuplesort.h"
 #include "utils/pg_locale.h"
 #include "utils/builtins.h"
+#include "utils/date.h"
+#include "utils/numeric.h"
+#include "utils/timestamp.h"
 #include "utils/tuplesort_mk.h"
 #include "utils/tuplesort_mk_details.h"
 #include "utils/string_wrapper.h"
@@ -506,6 +509,7 @@ static void readtup_datum(Tuplesortstate_mk *state, TuplesortPos_mk *pos, MKEntr
 			  LogicalTape *lt, uint32 len);
 
 static void tupsort_prepare_char(MKEntry *a, bool isChar);
+static void tupsort_prepare_abbrev(MKEntry *a, MKLvContext *lvctxt);
 static int	tupsort_compare_char(MKEntry *v1, MKEntry *v2, MKLvContext *lvctxt, MKContext *mkContext);
 
 static Datum tupsort_fetch_datum_mtup(MKEntry *a, MKContext *mkctxt, MKLvContext *lvctxt, bool *isNullOut);
@@ -740,8 +744,21 @@ create_mksort_context(MKContext *mkctxt,
 			sinfo->typByVal = tupdesc->attrs[sinfo->attno - 1]->attbyval;
 			sinfo->typLen = tupdesc->attrs[sinfo->attno - 1]->attlen;
 
-			if (sinfo->scanKey.sk_func.fn_addr == btint4cmp)
+			if (sinfo->scanKey.sk_func.fn_addr == btint4cmp ||
+				sinfo->scanKey.sk_func.fn_addr == btint2cmp ||
+				sinfo->scanKey.sk_func.fn_addr == date_cmp)
 				sinfo->lvtype = MKLV_TYPE_INT32;
+			else if (sinfo->scanKey.sk_func.fn_addr == btint8cmp
+#ifdef HAVE_INT64_TIMESTAMP
+					 || sinfo->scanKey.sk_func.fn_addr == timestamp_cmp
+#endif
+				)
+				sinfo->lvtype = MKLV_TYPE_INT64;
+			else if (sinfo->scanKey.sk_func.fn_addr == numeric_cmp)
+				sinfo->lvtype = MKLV_TYPE_NUMERIC;
+			else if (sinfo->scanKey.sk_func.fn_addr == bttextcmp &&
+					 lc_collate_is_c(sinfo->scanKey.sk_collation))
+				sinfo->lvtype = MKLV_TYPE_TEXT_C;
 
 			/* GPDB_91_MERGE_FIXME: these MKLV_TYPE_CHAR and MKLV_TYPE_TEXT
 			 * fastpaths only work with the default collation of the database.
@@ -3167,10 +3184,33 @@ tupsort_compare_datum(MKEntry *v1, MKEntry *v2, MKLvContext *lvctxt, MKContext *
 				int32		i2 = DatumGetInt32(v2->d);
 				int			result = (i1 < i2) ? -1 : ((i1 == i2) ? 0 : 1);
 
+				return ((lvctxt->scanKey.sk_flags & SK_BT_DESC) != 0) ? -result : result;
+			}
+		case MKLV_TYPE_INT64:
+			{
+				int64		i1 = DatumGetInt64(v1->d);
+				int64		i2 = DatumGetInt64(v2->d);
+				int			result = (i1 < i2) ? -1 : ((i1 == i2) ? 0 : 1);
+
 				return ((lvctxt->scanKey.sk_flags & SK_BT_DESC) != 0) ? -result : result;
 			}
 		default:
-			return tupsort_compare_char(v1, v2, lvctxt, context);
+			/* Entries with different abbreviated keys need no full comparison */
+			if (v1->abbrev != v2->abbrev)
+			{
+				int			result = (v1->abbrev < v2->abbrev) ? -1 : 1;
+
+				return ((lvctxt->scanKey.sk_flags & SK_BT_DESC) != 0) ? -result : result;
+			}
+
+			if (lvctxt->lvtype == MKLV_TYPE_CHAR || lvctxt->lvtype == MKLV_TYPE_TEXT)
+				return tupsort_compare_char(v1, v2, lvctxt, context);
+
+			return inlineApplySortFunction(&lvctxt->scanKey.sk_func,
+										   lvctxt->scanKey.sk_flags,
+										   lvctxt->scanKey.sk_collation,
+										   v1->d, false,
+										   v2->d, false);
 	}
 
 	Assert(!"Never reach here");
@@ -3396,6 +3436,80 @@ tupsort_prepare(MKEntry *a, MKContext *mkctxt, int lv)
 		tupsort_prepare_char(a, true);
 	else if (lvctxt->lvtype == MKLV_TYPE_TEXT)
 		tupsort_prepare_char(a, false);
+
+	if (mklv_has_abbrev(lvctxt->lvtype))
+		tupsort_prepare_abbrev(a, lvctxt);
+}
+
+/*
+ * Abbreviated key of a string: its first 8 bytes, big-endian, zero padded.
+ * None of the strings we abbreviate contain zero bytes, so the padding sorts
+ * before any character just like the end of the string does.
+ */
+static inline uint64
+tupsort_abbrev_string(const char *p, int len)
+{
+	uint64		result = 0;
+	int			i;
+
+	for (i = 0; i < (int) sizeof(uint64); i++)
+	{
+		result <<= 8;
+		if (i < len)
+			result |= (unsigned char) p[i];
+	}
+
+	return result;
+}
+
+/*
+ * Compute the abbreviated key of an entry that has been prepared for a level
+ * of a type with abbreviations.
+ */
+static void
+tupsort_prepare_abbrev(MKEntry *a, MKLvContext *lvctxt)
+{
+	a->abbrev = 0;
+
+	if (mke_is_null(a))
+		return;
+
+	switch (lvctxt->lvtype)
+	{
+		case MKLV_TYPE_CHAR:
+		case MKLV_TYPE_TEXT:
+			{
+				/* the strxfrm()ed string, as compared by tupsort_compare_char */
+				refcnt_locale_str *p = (refcnt_locale_str *) DatumGetPointer(a->d);
+				char	   *xfrm = p->data + p->xfrm_pos;
+
+				a->abbrev = tupsort_abbrev_string(xfrm, strnlen(xfrm, sizeof(uint64)));
+				break;
+			}
+		case MKLV_TYPE_TEXT_C:
+			{
+				char	   *p;
+				int			len;
+				void	   *tofree;
+
+				varattrib_untoast_ptr_len(a->d, &p, &len, &tofree);
+				a->abbrev = tupsort_abbrev_string(p, len);
+				if (tofree)
+					pfree(tofree);
+				break;
+			}
+		case MKLV_TYPE_NUMERIC:
+			{
+				Numeric		num = DatumGetNumeric(a->d);
+
+				a->abbrev = numeric_abbrev_key(num);
+				if ((Pointer) num != DatumGetPointer(a->d))
+					pfree(num);
+				break;
+			}
+		default:
+			Assert(!"unexpected level type for abbreviated key");
+	}
 }
 
 /* "True" length (not counting trailing blanks) of a BpChar */
@@ -20,11 +20,19 @@
 
 #include "postgres.h"
 #include "access/genam.h"
+#include "access/nbtree.h"
 #include "utils/tuplesort.h"
 #include "utils/tuplesort_mk.h"
 #include "utils/tuplesort_mk_details.h"
 
 #include "miscadmin.h"
+#include "cdb/cdbvars.h"
+
+/*
+ * Ranges smaller than this are quick sorted even if the level could be radix
+ * sorted: the histogram passes do not pay off for them.
+ */
+#define MKQS_RADIX_THRESHOLD 256
 
 #ifdef MKQSORT_VERIFY 
 extern void mkqsort_verify(MKEntry *a, int l, int r, MKContext *mkctxt);
@@ -261,14 +269,66 @@ static void mk_qsort_part3(MKEntry *a, int left, int right, int lv, MKContext *m
 	*firstInHighOut = rightIndex;
 }
 
-void mk_qsort_impl(MKEntry *a, int left, int right, int lv, bool lvdown, MKContext *ctxt, bool seenNull)
+/*
+ * Handle a range [first, last] of entries that are all equal up to level lv:
+ * sort it on the next level, or, if lv is the last level, enforce or apply
+ * uniqueness as requested.
+ */
+static void mk_qsort_equal_run(MKEntry *a, int first, int last, int lv, MKContext *ctxt, bool seenNull)
+{
+	if(lv < ctxt->total_lv-1)
+	{
+		mk_qsort_impl(a, first, last, lv+1, true, ctxt, seenNull || mke_is_null(a+first));
+		return;
+	}
+
+	/* values are all equal to the deepest level...no need for more compares, but check uniqueness if requested */
+	if(last > first &&
+			!seenNull &&
+			!mke_is_null(a+first))
+	{
+		if ( ctxt->enforceUnique )
+		{
+			Datum	values[INDEX_MAX_KEYS];
+			bool	isnull[INDEX_MAX_KEYS];
+	
+			index_deform_tuple((IndexTuple)(a+first)->ptr, ctxt->tupdesc, values, isnull);
+			ereport(ERROR,
+					(errcode(ERRCODE_UNIQUE_VIOLATION),
+					 errmsg("could not create unique index \"%s\"",
+							RelationGetRelationName(ctxt->indexRel)),
+					 errdetail("Key %s is duplicated.",
+							   BuildIndexValueDescription(ctxt->indexRel,
+														  values, isnull)),
+					 errtableconstraint(ctxt->heapRel,
+										RelationGetRelationName(ctxt->indexRel))));
+		}
+		else if ( ctxt->unique)
+		{
+			int toFreeIndex;
+
+			/* Keep the first entry of the run, free the others */
+			for ( toFreeIndex = first + 1; toFreeIndex <= last; toFreeIndex++)
+			{
+				MKEntry *toFree = a + toFreeIndex;
+				if ( ctxt->cpfr)
+					ctxt->cpfr(toFree, NULL, ctxt->lvctxt + lv);
+				ctxt->freeTup(toFree);
+				mke_set_empty(toFree);
+			}
+		}
+	}
+}
+
+/*
+ * Quick sort entries [left, right], already prepared at level lv, by
+ * comparisons.
+ */
+static void mk_qsort_cmp(MKEntry *a, int left, int right, int lv, MKContext *ctxt, bool seenNull)
 {
 	int lastInLow;
 	int firstInHigh;
 
-	Assert(ctxt);
-	Assert(lv < ctxt->total_lv);
-
 	CHECK_FOR_INTERRUPTS();
 
 	if (QueryFinishPending)
@@ -276,10 +336,6 @@ void mk_qsort_impl(MKEntry *a, int left, int right, int lv, bool lvdown, MKConte
 
 	if(right <= left)
 		return;
-	
-	/* Prepare at level lv */
-	if(lvdown)
-        mk_prepare_array(a, left, right, lv, ctxt);
 
 	/* 
 	 * According to Bentley & McIlroy [1] (1993), using insert sort for case 
@@ -293,56 +349,189 @@ void mk_qsort_impl(MKEntry *a, int left, int right, int lv, bool lvdown, MKConte
 	mk_qsort_part3(a, left, right, lv, ctxt, &lastInLow, &firstInHigh);
 
 	/* recurse to left chunk */
-	mk_qsort_impl(a, left, lastInLow, lv, false, ctxt, seenNull);
+	mk_qsort_cmp(a, left, lastInLow, lv, ctxt, seenNull);
 
-	/* recurse to middle (equal) chunk */
-	if(lv < ctxt->total_lv-1)
+	/*
+	 * recurse to middle (equal) chunk: [lastInLow+1,firstInHigh-1] defines
+	 * the pivot region which was all equal at level lv.
+	 */
+	mk_qsort_equal_run(a, lastInLow+1, firstInHigh-1, lv, ctxt, seenNull);
+
+	/* recurse to right chunk */
+	mk_qsort_cmp(a, firstInHigh, right, lv, ctxt, seenNull);
+}
+
+/*
+ * Radix sort.
+ *
+ * Levels of integer type, and levels with an abbreviated key, can be sorted
+ * by an in-place MSD radix sort (American flag sort) instead of comparisons.
+ * The radix key of an entry is its compflags (4 bytes, carrying the null
+ * ordering) followed by the 8 byte normalized key: the integer value with
+ * its sign bit flipped, or the abbreviated key.  For DESC the normalized
+ * key is complemented.
+ *
+ * Once all digits of a range are equal, integer levels are equal and move
+ * on to the next level; abbreviated keys are only prefixes, so the range is
+ * quick sorted on the same level to finish it.
+ */
+static inline bool mkqs_radix_applicable(MKLvContext *lvctxt)
+{
+	return mklv_is_integer(lvctxt->lvtype) || mklv_has_abbrev(lvctxt->lvtype);
+}
+
+static inline int mkqs_radix_ndigits(MKLvContext *lvctxt)
+{
+	return lvctxt->lvtype == MKLV_TYPE_INT32 ? 4 + 4 : 4 + 8;
+}
+
+static inline uint64 mkqs_radix_key(MKEntry *e, MKLvContext *lvctxt)
+{
+	uint64 key;
+
+	if (mke_is_null(e))
+		return 0;
+
+	switch (lvctxt->lvtype)
 	{
-		/*
-		 * [lastInLow+1,firstInHigh-1] defines the pivot region which was all equal at level lv.  So increase the level and compare that region!
-		 */
-		mk_qsort_impl(a, lastInLow+1, firstInHigh-1, lv+1, true, ctxt, seenNull || mke_is_null(a+lastInLow+1)); /* a + lastInLow + 1 points to the pivot */
+		case MKLV_TYPE_INT32:
+			key = ((uint64) ((uint32) DatumGetInt32(e->d) ^ 0x80000000)) << 32;
+			break;
+		case MKLV_TYPE_INT64:
+			key = ((uint64) DatumGetInt64(e->d)) ^ (UINT64CONST(1) << 63);
+			break;
+		default:
+			key = e->abbrev;
+			break;
 	}
-	else
+
+	if ((lvctxt->scanKey.sk_flags & SK_BT_DESC) != 0)
+		key = ~key;
+
+	return key;
+}
+
+static inline int mkqs_radix_digit(MKEntry *e, MKLvContext *lvctxt, int digit)
+{
+	if (digit < 4)
+		return ((uint32) e->compflags >> (24 - 8 * digit)) & 0xFF;
+
+	return (int) ((mkqs_radix_key(e, lvctxt) >> (56 - 8 * (digit - 4))) & 0xFF);
+}
+
+static void mk_radix_sort(MKEntry *a, int left, int right, int lv, int digit, MKContext *ctxt, bool seenNull)
+{
+	MKLvContext *lvctxt = ctxt->lvctxt + lv;
+	int ndigits = mkqs_radix_ndigits(lvctxt);
+	int count[256];
+	int next[256];
+	int end[256];
+	int n = right - left + 1;
+	int b;
+	int i;
+
+	CHECK_FOR_INTERRUPTS();
+
+	if (QueryFinishPending)
+		return;
+
+	/* Entries at one level usually share their compflags; skip those digits in one pass */
+	if (digit == 0)
+	{
+		for (i = left + 1; i <= right && a[i].compflags == a[left].compflags; ++i)
+			;
+		if (i > right)
+			digit = 4;
+	}
+
+	/* Find the next digit on which the range differs */
+	for (;;)
 	{
-		/* values are all equal to the deepest level...no need for more compares, but check uniqueness if requested */
-		if(firstInHigh-1 > lastInLow+1 &&
-				!seenNull &&
-				!mke_is_null(a+lastInLow+1)) /* a + lastInLow + 1 points to the pivot */
+		if (n < MKQS_RADIX_THRESHOLD)
 		{
-			if ( ctxt->enforceUnique )
-			{
-				Datum	values[INDEX_MAX_KEYS];
-				bool	isnull[INDEX_MAX_KEYS];
-		
-				index_deform_tuple((IndexTuple)(a+lastInLow+1)->ptr, ctxt->tupdesc, values, isnull);
-				ereport(ERROR,
-						(errcode(ERRCODE_UNIQUE_VIOLATION),
-						 errmsg("could not create unique index \"%s\"",
-								RelationGetRelationName(ctxt->indexRel)),
-						 errdetail("Key %s is duplicated.",
-								   BuildIndexValueDescription(ctxt->indexRel,
-															  values, isnull)),
-						 errtableconstraint(ctxt->heapRel,
-											RelationGetRelationName(ctxt->indexRel))));
-			}
-			else if ( ctxt->unique)
+			mk_qsort_cmp(a, left, right, lv, ctxt, seenNull);
+			return;
+		}
+
+		if (digit == ndigits)
+		{
+			if (mklv_is_integer(lvctxt->lvtype))
+				mk_qsort_equal_run(a, left, right, lv, ctxt, seenNull);
+			else
+				mk_qsort_cmp(a, left, right, lv, ctxt, seenNull);
+			return;
+		}
+
+		memset(count, 0, sizeof(count));
+		for (i = left; i <= right; ++i)
+			++count[mkqs_radix_digit(a + i, lvctxt, digit)];
+
+		if (count[mkqs_radix_digit(a + left, lvctxt, digit)] != n)
+			break;
+
+		++digit;
+	}
+
+	/* Distribute the entries into their buckets in place */
+	next[0] = left;
+	for (b = 0; b < 256; ++b)
+	{
+		if (b > 0)
+			next[b] = end[b - 1];
+		end[b] = next[b] + count[b];
+	}
+
+	for (b = 0; b < 256; ++b)
+	{
+		while (next[b] < end[b])
+		{
+			MKEntry tmp = a[next[b]];
+			int d = mkqs_radix_digit(&tmp, lvctxt, digit);
+
+			while (d != b)
 			{
-				int toFreeIndex;
-				for ( toFreeIndex = lastInLow + 2; toFreeIndex < firstInHigh; toFreeIndex++) /* +2 because we want to keep one around! */
-				{
-					MKEntry *toFree = a + toFreeIndex;
-					if ( ctxt->cpfr)
-						ctxt->cpfr(toFree, NULL, ctxt->lvctxt + lv); // todo: verify off-by-one
-					ctxt->freeTup(toFree);
-					mke_set_empty(toFree);
-				}
+				MKEntry swp = a[next[d]];
+
+				a[next[d]++] = tmp;
+				tmp = swp;
+				d = mkqs_radix_digit(&tmp, lvctxt, digit);
 			}
+
+			a[next[b]++] = tmp;
 		}
 	}
 
-	/* recurse to right chunk */
-	mk_qsort_impl(a, firstInHigh, right, lv, false, ctxt, seenNull);
+	/* Sort each bucket on the following digits */
+	for (b = 0, i = left; b < 256; i += count[b], ++b)
+	{
+		if (count[b] > 1)
+			mk_radix_sort(a, i, i + count[b] - 1, lv, digit + 1, ctxt, seenNull);
+	}
+}
+
+void mk_qsort_impl(MKEntry *a, int left, int right, int lv, bool lvdown, MKContext *ctxt, bool seenNull)
+{
+	Assert(ctxt);
+	Assert(lv < ctxt->total_lv);
+
+	CHECK_FOR_INTERRUPTS();
+
+	if (QueryFinishPending)
+		return;
+
+	if(right <= left)
+		return;
+	
+	/* Prepare at level lv */
+	if(lvdown)
+        mk_prepare_array(a, left, right, lv, ctxt);
+
+	if (gp_enable_mk_sort_radix &&
+		right - left + 1 >= MKQS_RADIX_THRESHOLD &&
+		mkqs_radix_applicable(ctxt->lvctxt + lv))
+		mk_radix_sort(a, left, right, lv, 0, ctxt, seenNull);
+	else
+		mk_qsort_cmp(a, left, right, lv, ctxt, seenNull);
 
 #ifdef MKQSORT_VERIFY 
 	if(lv == 0)
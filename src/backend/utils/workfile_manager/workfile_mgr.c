@@ -41,6 +41,19 @@ typedef struct workset_info
 	char *dir_path;
 } workset_info;
 
+/*
+ * Instrumentation of the spilling operator of an open workfile set.  The
+ * workfile_set lives in shared memory, so the backend-local pointer is kept
+ * here instead, for as long as the set is open.
+ */
+typedef struct workset_instrument
+{
+	workfile_set *work_set;
+	Instrumentation *instrument;
+} workset_instrument;
+
+static List *open_workset_instruments = NIL;
+
 /* Counter to keep track of workfile segspace used without a workfile set. */
 static int64 used_segspace_not_in_workfile_set;
 
@@ -52,6 +65,7 @@ static void workfile_mgr_unlink_directory(const char *dirpath);
 static const char *get_name_from_nodeType(const NodeTag node_type);
 static uint64 get_operator_work_mem(PlanState *ps);
 static char *create_workset_directory(NodeTag node_type, int slice_id);
+static void forget_workset_instrument(workfile_set *work_set);
 
 static workfile_set *open_workfile_sets = NULL;
 static bool workfile_sets_resowner_callback_registered = false;
@@ -241,6 +255,17 @@ workfile_mgr_create_set(enum ExecWorkFileType type, bool can_be_reused, PlanStat
 	workfile_set *work_set = CACHE_ENTRY_PAYLOAD(newEntry);
 	Assert(work_set != NULL);
 
+	if (ps != NULL && ps->instrument != NULL)
+	{
+		MemoryContext oldcxt = MemoryContextSwitchTo(TopMemoryContext);
+		workset_instrument *wi = palloc(sizeof(workset_instrument));
+
+		wi->work_set = work_set;
+		wi->instrument = ps->instrument;
+		open_workset_instruments = lcons(wi, open_workset_instruments);
+		MemoryContextSwitchTo(oldcxt);
+	}
+
 	elog(gp_workfile_caching_loglevel, "new spill file set. key=0x%x prefix=%s opMemKB=" INT64_FORMAT,
 			work_set->key, work_set->path, work_set->metadata.operator_work_mem);
 
@@ -315,6 +340,9 @@ workfile_mgr_populate_set(const void *resource, const void *param)
 	work_set->no_files = 0;
 	work_set->size = 0L;
 	work_set->in_progress_size = 0L;
+	work_set->raw_size = 0L;
+	work_set->compressed_size = 0L;
+	work_set->codec_time_us = 0L;
 	work_set->node_type = set_info->nodeType;
 	work_set->metadata.type = set_info->file_type;
 	work_set->metadata.bfz_compress_type = gp_workfile_compress_algorithm;
@@ -433,6 +461,46 @@ workfile_mgr_cleanup_set(const void *resource)
 	WorkfileDiskspace_Commit(0, size_to_delete, update_query_space);
 }
 
+/*
+ * Returns the instrumentation of the operator spilling into an open
+ * workfile set, or NULL if it has none.
+ */
+Instrumentation *
+workfile_mgr_get_instrument(workfile_set *work_set)
+{
+	ListCell   *lc;
+
+	foreach(lc, open_workset_instruments)
+	{
+		workset_instrument *wi = (workset_instrument *) lfirst(lc);
+
+		if (wi->work_set == work_set)
+			return wi->instrument;
+	}
+	return NULL;
+}
+
+static void
+forget_workset_instrument(workfile_set *work_set)
+{
+	ListCell   *lc;
+	ListCell   *prev = NULL;
+
+	foreach(lc, open_workset_instruments)
+	{
+		workset_instrument *wi = (workset_instrument *) lfirst(lc);
+
+		if (wi->work_set == work_set)
+		{
+			open_workset_instruments =
+				list_delete_cell(open_workset_instruments, lc, prev);
+			pfree(wi);
+			return;
+		}
+		prev = lc;
+	}
+}
+
 /*
  * Close a spill file set. If we're planning to re-use it, insert it in the
  * cache. If not, let the cleanup routine delete the files and free up memory.
@@ -449,6 +517,8 @@ workfile_mgr_close_set(workfile_set *work_set)
 	if (work_set->next)
 		work_set->next->prev = work_set->prev;
 
+	forget_workset_instrument(work_set);
+
 	elog(gp_workfile_caching_loglevel, "closing workfile set: location: %s, size=" INT64_FORMAT
 			" in_progress_size=" INT64_FORMAT,
 		 work_set->path,
@@ -0,0 +1,79 @@
+/*------------------------------------------------------------------------------
+ *
+ * aocs_dictfilter
+ *   evaluate the qual of an AOCS scan on the dictionary codes of a column.
+ *
+ * The blocks of a variable-length column written with a dictionary (see
+ * DSB_HAS_DICT_COMPRESSION) store each distinct value once, and a code per
+ * row.  A scan turns the "column op constant" and "column op ANY (array)"
+ * clauses of its qual on one such column into dictionary filter keys.  The
+ * keys are evaluated once per distinct value of a block, and the rows are
+ * then filtered by looking up their code, without comparing their values.
+ *
+ * Copyright (c) 2013-Present Pivotal Software, Inc.
+ *
+ *
+ * IDENTIFICATION
+ *	    src/include/access/aocs_dictfilter.h
+ *
+ *------------------------------------------------------------------------------
+*/
+#ifndef AOCS_DICTFILTER_H
+#define AOCS_DICTFILTER_H
+
+#include "fmgr.h"
+#include "nodes/pg_list.h"
+#include "utils/rel.h"
+
+struct DatumStreamRead;
+
+/*
+ * A qual clause "column op value", or "column op ANY (values)".
+ */
+typedef struct AOCSDictFilterKey
+{
+	FmgrInfo	fn;
+	Oid			collation;
+
+	/* false for "value op column" */
+	bool		varOnLeft;
+
+	int			nvalues;
+	Datum	   *values;
+} AOCSDictFilterKey;
+
+typedef struct AOCSDictFilter
+{
+	Relation	aoRel;
+
+	/* column number (starting from 0) of the column the keys are on */
+	int			attno;
+
+	int			nkeys;
+	AOCSDictFilterKey *keys;
+
+	/*
+	 * Whether the rows with each code of the current block can satisfy the
+	 * keys.  The block is identified by its first row number, which is -1
+	 * before the first block of a segment file.
+	 */
+	int64		blockFirstRowNum;
+	bool		blockHasDict;
+	bool		blockAnyMatch;
+	bool	   *codeMatches;
+
+	/* for evaluating the keys */
+	MemoryContext evalContext;
+
+	int64		rowsSkipped;
+	int64		blocksSkipped;
+} AOCSDictFilter;
+
+extern AOCSDictFilter *AOCSDictFilter_BeginScan(Relation aoRel, List *qual);
+extern void AOCSDictFilter_Reset(AOCSDictFilter *filter);
+extern bool AOCSDictFilter_RowMatches(AOCSDictFilter *filter,
+						  struct DatumStreamRead *ds,
+						  bool *skipBlock);
+extern void AOCSDictFilter_EndScan(AOCSDictFilter *filter);
+
+#endif							/* AOCS_DICTFILTER_H */
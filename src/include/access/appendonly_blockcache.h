@@ -0,0 +1,111 @@
+/*------------------------------------------------------------------------------
+ *
+ * appendonly_blockcache
+ *   keep the decompressed content of recently fetched append-only blocks.
+ *
+ * The fetch descriptor of a bitmap scan of an append-only table lives as
+ * long as the scan node, and the rows it fetches jump back and forth between
+ * the blocks: every rescan, e.g. for each outer row of a nested loop, starts
+ * over from the first block with rows for the new key, and the fetches of
+ * unique checks follow index order.  Without a cache, every jump to a block
+ * that is not the current one costs a block directory lookup, a read of the
+ * block and its decompression.  The fetch descriptors keep a bounded number
+ * of decompressed blocks, per column for a column-oriented table, and serve
+ * the rows of a block found here straight from its copy.
+ *
+ * The cache belongs to one fetch descriptor, and so to one snapshot of the
+ * table: the blocks of a segment file are never changed while it is visible
+ * to the snapshot, so the entries never need to be invalidated.
+ *
+ * Copyright (c) 2013-Present Pivotal Software, Inc.
+ *
+ *
+ * IDENTIFICATION
+ *	    src/include/access/appendonly_blockcache.h
+ *
+ *------------------------------------------------------------------------------
+*/
+#ifndef APPENDONLY_BLOCKCACHE_H
+#define APPENDONLY_BLOCKCACHE_H
+
+#include "utils/relcache.h"
+
+/*
+ * A cached block.  The data is the content of the block as the executor
+ * reads it, that is after decompression.
+ */
+typedef struct AppendOnlyBlockCacheEntry
+{
+	/* unique within the cache, never 0 */
+	uint64		id;
+
+	int			segmentFileNum;
+	int64		firstRowNum;
+	int64		lastRowNum;
+
+	int64		fileOffset;
+	int			executorBlockKind;
+	int			rowCount;
+
+	/* the fetch that last used the entry, for eviction */
+	uint64		lastUsed;
+
+	int32		dataLen;
+	uint8	   *data;
+} AppendOnlyBlockCacheEntry;
+
+/*
+ * The entries of a column, or of the table for a row-oriented table, sorted
+ * by segment file number and first row number.
+ */
+typedef struct AppendOnlyBlockCacheColumn
+{
+	AppendOnlyBlockCacheEntry **entries;
+	int			nentries;
+	int			maxentries;
+} AppendOnlyBlockCacheColumn;
+
+typedef struct AppendOnlyBlockCache
+{
+	MemoryContext memoryContext;
+
+	int64		maxBytes;
+	int64		usedBytes;
+
+	int			ncolumns;
+	AppendOnlyBlockCacheColumn *columns;
+
+	/* counts the fetches */
+	uint64		clock;
+
+	uint64		nextId;
+
+	int64		hits;
+	int64		misses;
+	int64		evictions;
+} AppendOnlyBlockCache;
+
+/*
+ * Size in kilobytes of the cache of each fetch descriptor; 0 disables it.
+ */
+extern int gp_appendonly_fetch_cache_size;
+
+extern AppendOnlyBlockCache *AppendOnlyBlockCache_Create(int ncolumns);
+extern void AppendOnlyBlockCache_BeginFetch(AppendOnlyBlockCache *cache);
+extern AppendOnlyBlockCacheEntry *AppendOnlyBlockCache_Lookup(AppendOnlyBlockCache *cache,
+							int column,
+							int segmentFileNum,
+							int64 rowNum);
+extern void AppendOnlyBlockCache_Insert(AppendOnlyBlockCache *cache,
+							int column,
+							int segmentFileNum,
+							int64 firstRowNum,
+							int rowCount,
+							int64 fileOffset,
+							int executorBlockKind,
+							uint8 *data,
+							int32 dataLen);
+extern void AppendOnlyBlockCache_End(AppendOnlyBlockCache *cache,
+						 Relation aoRel);
+
+#endif							/* APPENDONLY_BLOCKCACHE_H */
@@ -0,0 +1,47 @@
+/*------------------------------------------------------------------------------
+ *
+ * appendonly_indexonly
+ *   decide the visibility of append-only rows for index-only scans.
+ *
+ * A heap index-only scan skips the fetch of a row whose page is marked
+ * all-visible in the visibility map.  An append-only table has no such map,
+ * but it does not need one: its rows are never updated in place, so a row
+ * is visible to a snapshot if
+ *
+ *   - its segment file is among those the snapshot sees in the segment file
+ *     catalog, and is not awaiting drop after a compaction,
+ *   - the visimap, read with the snapshot, does not hide it, and
+ *   - a block directory entry visible to the snapshot covers it, within the
+ *     committed EOF of the segment file.  Rows of aborted or still running
+ *     inserts are only covered by entries the snapshot cannot see.
+ *
+ * None of these reads the table itself.  Only when the block directory
+ * cannot vouch for the row, e.g. for the rows of an aborted insert or when
+ * the last entry of a segment file has an open range
+ * (gp_blockdirectory_entry_min_range), is the row fetched.
+ *
+ * Copyright (c) 2013-Present Pivotal Software, Inc.
+ *
+ *
+ * IDENTIFICATION
+ *	    src/include/access/appendonly_indexonly.h
+ *
+ *------------------------------------------------------------------------------
+*/
+#ifndef APPENDONLY_INDEXONLY_H
+#define APPENDONLY_INDEXONLY_H
+
+#include "access/appendonlytid.h"
+#include "utils/relcache.h"
+#include "utils/snapshot.h"
+
+typedef struct AppendOnlyIndexOnlyDescData *AppendOnlyIndexOnlyDesc;
+
+extern AppendOnlyIndexOnlyDesc AppendOnlyIndexOnly_Init(Relation aoRel,
+						 Snapshot snapshot);
+extern bool AppendOnlyIndexOnly_IsVisible(AppendOnlyIndexOnlyDesc desc,
+							  AOTupleId *aoTupleId,
+							  bool *fetched);
+extern void AppendOnlyIndexOnly_Finish(AppendOnlyIndexOnlyDesc desc);
+
+#endif							/* APPENDONLY_INDEXONLY_H */
@@ -0,0 +1,44 @@
+/*------------------------------------------------------------------------------
+ *
+ * appendonly_prefetch
+ *   hint the kernel about the append-only blocks a bitmap scan will fetch.
+ *
+ * A bitmap heap scan runs a second iterator a few pages ahead of the one it
+ * fetches from, and asks for those heap pages with PrefetchBuffer, so that
+ * with effective_io_concurrency the reads of several pages are in flight at
+ * once.  Append-only tables are not read through shared buffers: a fetch
+ * looks the row up in the block directory, and reads the varblock at the
+ * file offset of the entry.  The prefetch follows the same path, with its
+ * own block directory so as not to move the fetch's, and issues a
+ * FilePrefetch of the varblock of each projected column instead.
+ *
+ * Rows falling in the block directory entry prefetched last are skipped, so
+ * that the rows of a varblock cost one lookup.  The hints are advisory:
+ * rows the block directory does not know about, and segment files that
+ * cannot be opened, are silently passed over, and left to the fetch.
+ *
+ * Copyright (c) 2013-Present Pivotal Software, Inc.
+ *
+ *
+ * IDENTIFICATION
+ *	    src/include/access/appendonly_prefetch.h
+ *
+ *------------------------------------------------------------------------------
+*/
+#ifndef APPENDONLY_PREFETCH_H
+#define APPENDONLY_PREFETCH_H
+
+#include "access/appendonlytid.h"
+#include "utils/relcache.h"
+#include "utils/snapshot.h"
+
+typedef struct AppendOnlyPrefetchDescData *AppendOnlyPrefetchDesc;
+
+extern AppendOnlyPrefetchDesc AppendOnlyPrefetch_Init(Relation aoRel,
+						Snapshot appendOnlyMetaDataSnapshot,
+						bool *proj);
+extern void AppendOnlyPrefetch_Row(AppendOnlyPrefetchDesc desc,
+					   AOTupleId *aoTupleId);
+extern void AppendOnlyPrefetch_Finish(AppendOnlyPrefetchDesc desc);
+
+#endif							/* APPENDONLY_PREFETCH_H */
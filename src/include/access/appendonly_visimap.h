@@ -23,6 +23,7 @@
 #define APPENDONLY_VISIMAP_H
 
 #include "access/appendonlytid.h"
+#include "access/appendonly_visimap_cache.h"
 #include "access/appendonly_visimap_entry.h"
 #include "access/appendonly_visimap_store.h"
 #include "executor/execWorkfile.h"
@@ -57,6 +58,12 @@ typedef struct AppendOnlyVisimap
 	 */
 	AppendOnlyVisimapStore visimapStore;
 
+	/*
+	 * The visibility map of a whole segment file, for scans.  NULL unless
+	 * enabled by AppendOnlyVisimap_EnableCache.
+	 */
+	AppendOnlyVisimapCache *cache;
+
 } AppendOnlyVisimap;
 
 /*
@@ -105,6 +112,9 @@ void AppendOnlyVisimap_Init(
 					   LOCKMODE lockmode,
 					   Snapshot appendonlyMetaDataSnapshot);
 
+void AppendOnlyVisimap_EnableCache(
+							AppendOnlyVisimap *visiMap);
+
 bool AppendOnlyVisimap_IsVisible(
 							AppendOnlyVisimap *visiMap,
 							AOTupleId *tupleId);
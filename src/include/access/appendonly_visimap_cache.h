@@ -0,0 +1,90 @@
+/*------------------------------------------------------------------------------
+ *
+ * appendonly_visimap_cache
+ *   keep the visibility map of a segment file in memory during a scan.
+ *
+ * A sequential scan checks the visibility map for every row it returns.
+ * Through the visimap entry, moving to the next range of 32768 rows takes an
+ * index lookup in the visimap relation and the decompression of the range's
+ * bitmap, also for the many ranges without any hidden row.  When the scan
+ * moves to a segment file, the cache instead reads all of the segment file's
+ * visimap entries in one index scan, and keeps the hidden rows of each range
+ * in the smaller of two forms, like the containers of a roaring bitmap: the
+ * sorted offsets of the hidden rows when there are few of them, or the
+ * bitmap when there are many.  A range without hidden rows takes no memory.
+ * A visibility check is then an array lookup plus, for a range with hidden
+ * rows, a bitmap probe or a binary search of at most 4096 offsets.
+ *
+ * The cache is read-only: it is used by the visimaps of scans, which never
+ * change the visibility map.
+ *
+ * Copyright (c) 2013-Present Pivotal Software, Inc.
+ *
+ *
+ * IDENTIFICATION
+ *	    src/include/access/appendonly_visimap_cache.h
+ *
+ *------------------------------------------------------------------------------
+*/
+#ifndef APPENDONLY_VISIMAP_CACHE_H
+#define APPENDONLY_VISIMAP_CACHE_H
+
+#include "nodes/bitmapset.h"
+
+/*
+ * The hidden rows of one range of a segment file.
+ */
+typedef struct AppendOnlyVisimapCacheRange
+{
+	/* number of hidden rows, 0 if they are all visible */
+	int32		hiddenCount;
+
+	/*
+	 * Either the offsets of the hidden rows in the range, in increasing
+	 * order, or the bitmap of the hidden rows, whichever is smaller.
+	 */
+	uint16	   *offsets;
+	Bitmapset  *bitmap;
+} AppendOnlyVisimapCacheRange;
+
+typedef struct AppendOnlyVisimapCache
+{
+	/* parent of rangeContext, lives as long as the cache */
+	MemoryContext memoryContext;
+
+	/* holds the ranges of the current segment file, reset to load another */
+	MemoryContext rangeContext;
+
+	/* segment file whose ranges are loaded, -1 if none */
+	int			segmentFileNum;
+
+	/*
+	 * false if the visibility map of the segment file did not fit in the
+	 * cache, the ranges must not be used then.
+	 */
+	bool		complete;
+
+	/* indexed by first row number / APPENDONLY_VISIMAP_MAX_RANGE */
+	AppendOnlyVisimapCacheRange *ranges;
+	int			nranges;
+	int			maxranges;
+
+	int64		maxBytes;
+	int64		usedBytes;
+} AppendOnlyVisimapCache;
+
+/*
+ * Size in kilobytes of the visibility map cache of each scan; 0 disables it.
+ */
+extern int gp_appendonly_visimap_cache_size;
+
+extern AppendOnlyVisimapCache *AppendOnlyVisimapCache_Create(MemoryContext parentContext);
+extern void AppendOnlyVisimapCache_Reset(AppendOnlyVisimapCache *cache,
+							 int segmentFileNum);
+extern bool AppendOnlyVisimapCache_AddRange(AppendOnlyVisimapCache *cache,
+								int64 firstRowNum,
+								Bitmapset *hidden);
+extern bool AppendOnlyVisimapCache_IsVisible(AppendOnlyVisimapCache *cache,
+								 int64 rowNum);
+
+#endif							/* APPENDONLY_VISIMAP_CACHE_H */
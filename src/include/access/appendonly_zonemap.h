@@ -0,0 +1,93 @@
+/*------------------------------------------------------------------------------
+ *
+ * appendonly_zonemap
+ *   skip append-only blocks using the min/max summaries kept in the
+ *   block directory.
+ *
+ * Inserts into an append-only table that has a block directory record,
+ * for each minipage entry, the minimum and maximum value and the number of
+ * NULLs of the columns that can be summarized (see MinipageZone).  A scan
+ * turns the simple "column op constant" and "column IS [NOT] NULL" clauses
+ * of its qual into zone map keys, and skips over the blocks whose rows all
+ * lie in entries whose summaries cannot satisfy one of the keys.
+ *
+ * Copyright (c) 2013-Present Pivotal Software, Inc.
+ *
+ *
+ * IDENTIFICATION
+ *	    src/include/access/appendonly_zonemap.h
+ *
+ *------------------------------------------------------------------------------
+*/
+#ifndef APPENDONLY_ZONEMAP_H
+#define APPENDONLY_ZONEMAP_H
+
+#include "access/skey.h"
+#include "nodes/pg_list.h"
+#include "utils/rel.h"
+#include "utils/snapshot.h"
+
+/*
+ * A qual clause that can be checked against a zone.
+ */
+typedef struct AppendOnlyZoneMapKey
+{
+	AttrNumber	attnum;
+
+	/*
+	 * B-tree strategy of "column op value", or InvalidStrategy for a NULL
+	 * test.
+	 */
+	StrategyNumber strategy;
+	int64		value;
+
+	/* for NULL tests, true for IS NULL and false for IS NOT NULL */
+	bool		searchNull;
+} AppendOnlyZoneMapKey;
+
+/*
+ * A range of row numbers that cannot satisfy the keys.
+ */
+typedef struct AppendOnlyZoneMapRange
+{
+	int64		firstRowNum;
+	int64		lastRowNum;
+} AppendOnlyZoneMapRange;
+
+typedef struct AppendOnlyZoneMapScan
+{
+	Relation	aoRel;
+	Snapshot	appendOnlyMetaDataSnapshot;
+	MemoryContext memoryContext;
+
+	int			nkeys;
+	AppendOnlyZoneMapKey *keys;
+
+	/*
+	 * Excluded row ranges of the current segment file, sorted and not
+	 * overlapping, and the range the scan is currently at or before.
+	 */
+	AppendOnlyZoneMapRange *ranges;
+	int			nranges;
+	int			maxranges;
+	int			currange;
+
+	int64		blocksSkipped;
+} AppendOnlyZoneMapScan;
+
+extern bool AppendOnlyZoneMap_TypeIsSupported(Oid typid);
+extern int64 AppendOnlyZoneMap_DatumGetInt64(Oid typid, Datum value);
+
+extern AppendOnlyZoneMapScan *AppendOnlyZoneMap_BeginScan(Relation aoRel,
+							Snapshot appendOnlyMetaDataSnapshot,
+							List *qual);
+extern void AppendOnlyZoneMap_LoadSegmentFile(AppendOnlyZoneMapScan *zoneMap,
+								  int segno);
+extern bool AppendOnlyZoneMap_ExcludesRows(AppendOnlyZoneMapScan *zoneMap,
+							   int64 firstRowNum,
+							   int64 rowCount);
+extern int64 AppendOnlyZoneMap_SkipPastRow(AppendOnlyZoneMapScan *zoneMap,
+							  int64 rowNum);
+extern void AppendOnlyZoneMap_EndScan(AppendOnlyZoneMapScan *zoneMap);
+
+#endif							/* APPENDONLY_ZONEMAP_H */
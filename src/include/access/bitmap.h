@@ -426,6 +426,15 @@ typedef struct BMBuildState
 	 */
 	BMTidBuildBuf	*bm_tidLocsBuffer;
 
+	/*
+	 * For a sort-based build, the (values, tid) pairs of the heap, sorted
+	 * once the heap has been scanned and then written out one distinct
+	 * value at a time. NULL when the tids are added to the bitmap vectors
+	 * as the heap is scanned.
+	 */
+	void		   *bm_sortstate;	/* state data for tuplesort.c */
+	struct TupleTableSlot *bm_sortslot;
+
 	double 			ituples;	/* the number of index tuples */
 	bool			use_wal;	/* whether or not we write WAL records */
 } BMBuildState;
@@ -768,6 +777,9 @@ extern void _bitmap_doinsert(Relation rel, ItemPointerData ht_ctid,
 							 Datum *attdata, bool *nulls);
 extern void _bitmap_write_alltids(Relation rel, BMTidBuildBuf *tids,
 						  		  bool use_wal);
+extern void _bitmap_spool(ItemPointer ht_ctid, Datum *attdata, bool *nulls,
+						  BMBuildState *state);
+extern void _bitmap_write_sorted(Relation rel, BMBuildState *state);
 
 /* bitmaputil.c */
 extern BMLOVItem _bitmap_formitem(uint64 currTidNumber);
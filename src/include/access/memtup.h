@@ -43,6 +43,8 @@ typedef struct MemTupleBindingCols
 	short *null_saves_aligned;		/* saved space from each attribute when null - uses aligned length */
 	bool has_null_saves_alignment_mismatch;		/* true if one or more attributes has mismatching alignment and length  */
 	bool has_dropped_attr_alignment_mismatch;	/* true if one or more dropped attributes has mismatching alignment and length */
+	int *phys_order;		/* logical attr index of each physical column */
+	int *phys_limit;		/* physical columns to walk to deform the first n+1 attrs */
 } MemTupleBindingCols;
 
 typedef struct MemTupleBinding
@@ -150,6 +152,7 @@ extern uint32 compute_memtuple_size(MemTupleBinding *pbind, Datum *values, bool
 extern MemTuple memtuple_copy_to(MemTuple mtup, MemTuple dest, uint32 *destlen);
 extern MemTuple memtuple_form_to(MemTupleBinding *pbind, Datum *values, bool *isnull, MemTuple dest, uint32 *destlen, bool inline_toast);
 extern void memtuple_deform(MemTuple mtup, MemTupleBinding *pbind, Datum *datum, bool *isnull);
+extern void memtuple_deform_upto(MemTuple mtup, MemTupleBinding *pbind, int natts, Datum *datum, bool *isnull);
 extern void memtuple_deform_misaligned(MemTuple mtup, MemTupleBinding *pbind, Datum *datum, bool *isnull);
 
 extern Oid MemTupleGetOid(MemTuple mtup, MemTupleBinding *pbind);
@@ -126,6 +126,25 @@ typedef struct AOCSScanDescData
 
 	AppendOnlyVisimap visibilityMap;
 
+	/*
+	 * Zone maps of the scan qual, or NULL if blocks cannot be skipped.
+	 * Set by the caller after the scan has begun.
+	 */
+	struct AppendOnlyZoneMapScan *zoneMap;
+
+	/*
+	 * Dictionary filter of the scan qual, or NULL.  Set with
+	 * aocs_scan_set_dictfilter.
+	 */
+	struct AOCSDictFilter *dictFilter;
+
+	/*
+	 * The last row the lead column has skipped, because of the zone maps or
+	 * the dictionary filter, which the other projected columns still have to
+	 * skip; -1 if none.
+	 */
+	int64		skipPastRowNum;
+
 }	AOCSScanDescData;
 
 typedef AOCSScanDescData *AOCSScanDesc;
@@ -163,6 +182,14 @@ typedef struct AOCSFetchDescData
 
 	AppendOnlyVisimap visibilityMap;
 
+	/*
+	 * Recently fetched blocks, or NULL if the cache is disabled.  For each
+	 * column, the id of the cached block the datum stream is reading, or 0
+	 * when it is reading a block of the segment file.
+	 */
+	struct AppendOnlyBlockCache *blockCache;
+	uint64	   *cachedBlockId;
+
 } AOCSFetchDescData;
 
 typedef AOCSFetchDescData *AOCSFetchDesc;
@@ -210,6 +237,8 @@ extern AOCSScanDesc aocs_beginrangescan(Relation relation, Snapshot snapshot,
 
 extern void aocs_rescan(AOCSScanDesc scan);
 extern void aocs_endscan(AOCSScanDesc scan);
+extern void aocs_scan_set_dictfilter(AOCSScanDesc scan,
+						 struct AOCSDictFilter *filter);
 
 extern void aocs_getnext(AOCSScanDesc scan, ScanDirection direction, TupleTableSlot *slot);
 extern AOCSInsertDesc aocs_insert_init(Relation rel, int segno, bool update_mode);
@@ -222,6 +222,12 @@ typedef struct AppendOnlyScanDescData
 	 */ 
 	AppendOnlyVisimap visibilityMap;
 
+	/*
+	 * Zone maps of the scan qual, or NULL if blocks cannot be skipped.
+	 * Set by the caller after the scan has begun.
+	 */
+	struct AppendOnlyZoneMapScan *zoneMap;
+
 }	AppendOnlyScanDescData;
 
 typedef AppendOnlyScanDescData *AppendOnlyScanDesc;
@@ -313,6 +319,13 @@ typedef struct AppendOnlyFetchDescData
 
 	AppendOnlyVisimap visibilityMap;
 
+	/*
+	 * Recently fetched blocks, or NULL if the cache is disabled, and the id
+	 * of the cached block executorReadBlock is reading, or 0.
+	 */
+	struct AppendOnlyBlockCache *blockCache;
+	uint64		cachedBlockId;
+
 }	AppendOnlyFetchDescData;
 
 typedef AppendOnlyFetchDescData *AppendOnlyFetchDesc;
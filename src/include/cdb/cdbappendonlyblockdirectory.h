@@ -17,10 +17,12 @@
 #include "access/aosegfiles.h"
 #include "access/aocssegfiles.h"
 #include "access/appendonlytid.h"
+#include "access/memtup.h"
 #include "access/skey.h"
 
 extern int gp_blockdirectory_entry_min_range;
 extern int gp_blockdirectory_minipage_size;
+extern bool gp_appendonly_zone_maps;
 
 typedef struct AppendOnlyBlockDirectoryEntry
 {
@@ -48,6 +50,34 @@ typedef struct MinipageEntry
 	int64 rowCount;
 } MinipageEntry;
 
+/*
+ * Min/max summary ("zone map") of one column over the rows covered by a
+ * minipage entry.  Only kept for columns whose values order like an int64,
+ * see AppendOnlyZoneMap_TypeIsSupported().
+ */
+typedef struct MinipageZone
+{
+	int64 minValue;
+	int64 maxValue;
+	int64 nullCount;
+	int16 attnum;
+	int16 flags;
+	int32 padding;
+} MinipageZone;
+
+#define MINIPAGE_ZONE_VALID		0x0001	/* summary covers every row of the entry */
+#define MINIPAGE_ZONE_HASVALUES	0x0002	/* at least one row is not null */
+
+/*
+ * Minipage format versions.
+ *
+ * A MINIPAGE_VERSION_ZONEMAP minipage stores, after its nEntry entries, an
+ * int32 count of summarized columns (nZoneAtts), 4 bytes of padding, and
+ * nEntry * nZoneAtts MinipageZones ordered by entry.
+ */
+#define MINIPAGE_VERSION_ORIGINAL	0
+#define MINIPAGE_VERSION_ZONEMAP	1
+
 /*
  * Define a varlena type for a minipage.
  */
@@ -62,6 +92,12 @@ typedef struct Minipage
 	MinipageEntry entry[1];
 } Minipage;
 
+/*
+ * At most this many columns of a row-oriented table are summarized in
+ * each minipage entry.
+ */
+#define MAX_ZONE_ATTS_PER_MINIPAGE 4
+
 /*
  * Define the relevant info for a minipage for each
  * column group.
@@ -71,8 +107,28 @@ typedef struct MinipagePerColumnGroup
 	Minipage *minipage;
 	uint32 numMinipageEntries;
 	ItemPointerData tupleTid;
+
+	/*
+	 * Zone maps, only maintained by inserts that called
+	 * AppendOnlyBlockDirectory_InitZoneMaps().  zones holds nZoneAtts
+	 * summaries for each entry of the minipage; pendingZones accumulates
+	 * the rows that are not yet covered by an entry.
+	 */
+	int nZoneAtts;
+	Oid *zoneTypes;
+	MinipageZone *zones;
+	MinipageZone *pendingZones;
 } MinipagePerColumnGroup;
 
+/*
+ * Callback for AppendOnlyBlockDirectory_ScanZones().
+ */
+typedef void (*MinipageZoneCallback) (void *arg,
+									  int64 firstRowNum,
+									  int64 rowCount,
+									  MinipageZone *zones,
+									  int nZones);
+
 /*
  * I don't know the ideal value here. But let us put approximate
  * 8 minipages per heap page.
@@ -119,6 +175,12 @@ typedef struct AppendOnlyBlockDirectory
 	ScanKey scanKeys;
 	StrategyNumber *strategyNumbers;
 
+	/*
+	 * True if the inserter reports every row it adds to the zone maps,
+	 * see AppendOnlyBlockDirectory_InitZoneMaps().
+	 */
+	bool summarizeZones;
+
 }	AppendOnlyBlockDirectory;
 
 
@@ -218,6 +280,27 @@ extern void AppendOnlyBlockDirectory_End_forSearch(
 	AppendOnlyBlockDirectory *blockDirectory);
 extern void AppendOnlyBlockDirectory_End_addCol(
 	AppendOnlyBlockDirectory *blockDirectory);
+extern void AppendOnlyBlockDirectory_InitZoneMaps(
+	AppendOnlyBlockDirectory *blockDirectory);
+extern void AppendOnlyBlockDirectory_ZoneAddValue(
+	AppendOnlyBlockDirectory *blockDirectory,
+	int columnGroupNo,
+	Datum value,
+	bool isnull);
+extern void AppendOnlyBlockDirectory_ZoneAddMemTuple(
+	AppendOnlyBlockDirectory *blockDirectory,
+	MemTuple tuple,
+	MemTupleBinding *binding);
+extern void AppendOnlyBlockDirectory_ZoneAttachToLastEntry(
+	AppendOnlyBlockDirectory *blockDirectory,
+	int columnGroupNo);
+extern void AppendOnlyBlockDirectory_ScanZones(
+	Relation aoRel,
+	Snapshot snapshot,
+	int segno,
+	int columnGroupNo,
+	MinipageZoneCallback callback,
+	void *arg);
 extern void AppendOnlyBlockDirectory_DeleteSegmentFile(
 	Relation aoRel,
 		Snapshot snapshot,
@@ -172,6 +172,20 @@ typedef struct AppendOnlyStorageWrite
 	PGFunction *compression_functions;	/* For AO or CO compression.                   */
 	/* The array index corresponds to COMP_FUNC_*  */
 
+	/*
+	 * When not NULL, finished blocks are compressed in the background by the
+	 * compression pool (see AppendOnlyStorageWrite_UseCompressPool).  While
+	 * compressJobPending, the job holds a block that has not been appended
+	 * to the file yet; these are the header fields it will be written with.
+	 */
+	struct CompressPoolJob *compressJob;
+	bool		compressJobPending;
+	AoHeaderKind pendingAoHeaderKind;
+	bool		pendingIsFirstRowNumSet;
+	int64		pendingFirstRowNum;
+	int			pendingExecutorBlockKind;
+	int			pendingRowCount;
+
 } AppendOnlyStorageWrite;
 
 extern void AppendOnlyStorageWrite_Init(AppendOnlyStorageWrite *storageWrite,
@@ -181,6 +195,7 @@ extern void AppendOnlyStorageWrite_Init(AppendOnlyStorageWrite *storageWrite,
 										char *title,
 										AppendOnlyStorageAttributes *storageAttributes);
 extern void AppendOnlyStorageWrite_FinishSession(AppendOnlyStorageWrite *storageWrite);
+extern bool AppendOnlyStorageWrite_UseCompressPool(AppendOnlyStorageWrite *storageWrite);
 
 extern void AppendOnlyStorageWrite_TransactionCreateFile(AppendOnlyStorageWrite *storageWrite,
 											 char *filePathName,
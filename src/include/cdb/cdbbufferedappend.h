@@ -76,6 +76,15 @@ typedef struct BufferedAppend
     int64                fileLen;
     int64				 fileLen_uncompressed; /* for calculating compress ratio */
 
+	bool				 dropBehind;
+	int64				 dropBehindPosition;
+							/*
+							 * With gp_appendonly_direct_io, each large write is
+							 * handed to the kernel for writeback, and the writes
+							 * before it, from dropBehindPosition on, are dropped
+							 * from the kernel's cache.
+							 */
+
 } BufferedAppend;
 
 /*
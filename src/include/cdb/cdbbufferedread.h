@@ -70,6 +70,39 @@ typedef struct BufferedRead
     char				 *filePathName;
     int64                fileLen;
 
+	int64				 prefetchEnd;
+							/*
+							 * The end of the range of the file already handed to
+							 * the kernel for asynchronous read-ahead.
+							 */
+
+	/*
+	 * Direct I/O members.
+	 */
+	bool				 directIO;
+							/*
+							 * True when the current file was opened with
+							 * O_DIRECT.  The large reads are then copied out
+							 * of directBuffer, which is filled with aligned
+							 * reads of several large reads at a time.
+							 */
+
+	uint8				*directMemory;
+	uint8				*directBuffer;
+	int32				 directBufferSize;
+							/*
+							 * The memory as allocated, and aligned to
+							 * BUFFERED_READ_DIRECT_ALIGN.  Allocated for the
+							 * first direct I/O file.
+							 */
+
+	int64				 directBufferPosition;
+	int32				 directBufferLen;
+							/*
+							 * The position within the current file of the data
+							 * in directBuffer, and its length.
+							 */
+
 	/*
 	 * Temporary limit support for random reading.
 	 */
@@ -78,6 +111,16 @@ typedef struct BufferedRead
 
 } BufferedRead;
 
+/*
+ * The file offset, length and memory alignment required by O_DIRECT reads.
+ */
+#define BUFFERED_READ_DIRECT_ALIGN	4096
+
+/*
+ * Number of large reads to keep in flight beyond the current one.
+ */
+extern int gp_appendonly_read_ahead;
+
 /*
  * Determines the amount of memory to supply for
  * BufferedRead given the desired buffer and
@@ -103,12 +146,17 @@ extern void BufferedReadInit(
 
 /*
  * Takes an open file handle for the next file.
+ *
+ * directIO tells whether the file was opened with O_DIRECT.  If so, the
+ * memory for the aligned reads is allocated in the current memory context,
+ * the first time.
  */
 extern void BufferedReadSetFile(
     BufferedRead         *bufferedRead,
     File 				 file,
     char				 *filePathName,
-    int64                fileLen);
+    int64                fileLen,
+    bool				 directIO);
 
 /*
  * Set a temporary read range in the current open segment file.
@@ -0,0 +1,89 @@
+/*-------------------------------------------------------------------------
+ *
+ * cdbcompresspool.h
+ *	  Compress Append-Only Storage Blocks in background threads.
+ *
+ * A backend that writes many compressed columns at once (an insert into a
+ * column-oriented table) hands each full block to a small pool of threads,
+ * and carries on filling the blocks of the other columns while it is being
+ * compressed.  The threads run no PostgreSQL code: they only call the
+ * thread-safe compression libraries, on memory that belongs to the pool,
+ * and leave the outcome in the job for the backend to act on.
+ *
+ * Portions Copyright (c) 2012-Present Pivotal Software, Inc.
+ *
+ *
+ * IDENTIFICATION
+ *	    src/include/cdb/cdbcompresspool.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef CDBCOMPRESSPOOL_H
+#define CDBCOMPRESSPOOL_H
+
+typedef enum CompressPoolAlgorithm
+{
+	CompressPoolAlgorithm_Zlib,
+	CompressPoolAlgorithm_Zstd
+} CompressPoolAlgorithm;
+
+typedef enum CompressPoolJobState
+{
+	CompressPoolJobState_Idle,
+	CompressPoolJobState_Queued,
+	CompressPoolJobState_Running,
+	CompressPoolJobState_Done
+} CompressPoolJobState;
+
+typedef struct CompressPoolJob
+{
+	/*
+	 * Set by the backend before CompressPool_Submit.  The source and dest
+	 * buffers are allocated with the job and stay valid until it is
+	 * released.
+	 */
+	CompressPoolAlgorithm algorithm;
+	int			level;
+
+	uint8	   *source;
+	int32		sourceLen;
+
+	uint8	   *dest;
+	int32		destLen;
+
+	/*
+	 * Set by the worker.  compressedLen is at least sourceLen when the data
+	 * did not compress.  When failed, errorDetail is a static message from
+	 * the compression library.
+	 */
+	int32		compressedLen;
+	bool		failed;
+	const char *errorDetail;
+
+	/* Private to cdbcompresspool.c */
+	volatile CompressPoolJobState state;
+	SubTransactionId subid;
+	struct CompressPoolJob *queueNext;
+	struct CompressPoolJob *prev;
+	struct CompressPoolJob *next;
+} CompressPoolJob;
+
+/*
+ * Number of threads to compress blocks with; zero compresses them in the
+ * backend itself.
+ */
+extern int gp_aocs_compression_workers;
+
+extern bool CompressPool_Supports(const char *compressType,
+					  CompressPoolAlgorithm *algorithm);
+extern CompressPoolJob *CompressPool_GetJob(int32 sourceLen, int32 destLen);
+extern void CompressPool_ReleaseJob(CompressPoolJob *job);
+extern void CompressPool_Submit(CompressPoolJob *job);
+extern void CompressPool_Wait(CompressPoolJob *job);
+
+extern void AtEOXact_CompressPool(bool isCommit);
+extern void AtEOSubXact_CompressPool(bool isCommit,
+						 SubTransactionId mySubid,
+						 SubTransactionId parentSubid);
+
+#endif   /* CDBCOMPRESSPOOL_H */
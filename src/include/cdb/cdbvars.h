@@ -549,6 +549,33 @@ extern bool gp_enable_minmax_optimization;
  */
 extern bool gp_enable_multiphase_agg;
 
+/*
+ * "gp_enable_eager_agg"
+ *
+ * May the planner aggregate the rows of a table partially, on its join and
+ * grouping keys, before joining it to the other tables of the query?  This
+ * requires gp_enable_multiphase_agg, and is cost based when enabled.
+ */
+extern bool gp_enable_eager_agg;
+
+/*
+ * "gp_enable_subplan_cache"
+ *
+ * May the executor cache the results of a correlated subplan on the values of
+ * its parameters, and reuse them instead of rescanning the subplan when the
+ * values repeat?  The cache is bounded by work_mem.
+ */
+extern bool gp_enable_subplan_cache;
+
+/*
+ * "gp_enable_nestloop_cache"
+ *
+ * May the executor cache the inner rows of a nested loop on the values of the
+ * parameters passed to its inner side, and reuse them instead of rescanning
+ * the inner side when the values repeat?  The cache is bounded by work_mem.
+ */
+extern bool gp_enable_nestloop_cache;
+
 /*
  * Perform a post-planning scan of the final plan looking for motion deadlocks:
  * emit verbose messages about any found.
@@ -716,6 +743,7 @@ extern bool gp_enable_sort_distinct;
 /* Greenplum MK Sort */
 extern bool gp_enable_mk_sort;
 extern bool gp_enable_motion_mk_sort;
+extern bool gp_enable_mk_sort_radix;
 
 #ifdef USE_ASSERT_CHECKING
 extern bool gp_mk_sort_check;
@@ -766,10 +794,15 @@ extern bool 	gp_statistics_pullup_from_child_partition;
 /* Extract numdistinct from foreign key relationship */
 extern bool		gp_statistics_use_fkeys;
 
+/* Merge numdistinct of a partitioned table from the partitions' HLL counters */
+extern bool		gp_statistics_use_hll;
+
 /* Analyze related gucs */
 extern int 		gp_statistics_blocks_target;
 extern double	gp_statistics_ndistinct_scaling_ratio_threshold;
 extern double	gp_statistics_sampling_threshold;
+extern bool		gp_analyze_skip_unchanged_leaves;
+extern bool		gp_analyze_segment_summaries;
 
 /* Analyze tools */
 extern int gp_motion_slice_noop;
@@ -799,6 +832,7 @@ extern int gpperfmon_log_alert_level;
 
 
 extern int gp_workfile_compress_algorithm;
+extern int gp_workfile_zstd_level;
 extern bool gp_workfile_checksumming;
 extern double gp_workfile_limit_per_segment;
 extern double gp_workfile_limit_per_query;
@@ -806,6 +840,8 @@ extern int gp_workfile_limit_files_per_query;
 extern int gp_workfile_caching_loglevel;
 extern int gp_sessionstate_loglevel;
 extern int gp_workfile_bytes_to_checksum;
+extern int gp_workfile_prefetch_blocks;
+extern int gp_workfile_writeback_blocks;
 /* The type of work files that HashJoin should use */
 extern int gp_workfile_type_hashjoin;
 
@@ -829,6 +865,8 @@ extern int	gp_autostats_mode;
 extern int	gp_autostats_mode_in_functions;
 extern int	gp_autostats_on_change_threshold;
 extern bool	log_autostats;
+extern bool	gp_autostats_async;
+extern int	gp_autostats_async_naptime;
 
 
 /* --------------------------------------------------------------------------------------------------
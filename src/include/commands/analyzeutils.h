@@ -55,5 +55,7 @@ extern int aggregate_leaf_partition_histograms(Oid relationOid,
 											   void **result);
 extern bool needs_sample(VacAttrStats **vacattrstats, int attr_cnt);
 extern bool leaf_parts_analyzed(Oid attrelid, Oid relid_exclude, List *va_cols);
+extern int64 get_ao_modcount(Relation rel);
+extern bool leaf_part_stats_current(Oid relid, List *va_cols, bool fullscan);
 
 #endif  /* ANALYZEUTILS_H */
@@ -0,0 +1,166 @@
+/*-------------------------------------------------------------------------
+ *
+ * execExprProg.h
+ *	  Flat, linear-opcode representation of quals and projections.
+ *
+ * An ExprProgram is compiled from an already-initialized ExprState tree
+ * (see ExecInitExpr).  Instead of walking the tree through a function
+ * pointer per node, the program is a flat array of steps that is executed
+ * by a single interpreter loop.  Node types that have no dedicated opcode
+ * are evaluated through a fallback step that calls ExecEvalExpr() on the
+ * original ExprState, so any expression can be compiled.
+ *
+ * Portions Copyright (c) 2012-Present Pivotal Software, Inc.
+ *
+ *
+ * IDENTIFICATION
+ *	  src/include/executor/execExprProg.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef EXECEXPRPROG_H
+#define EXECEXPRPROG_H
+
+#include "fmgr.h"
+#include "nodes/execnodes.h"
+
+/*
+ * Opcodes of an ExprProgram.
+ */
+typedef enum ExprProgOpcode
+{
+	EPOP_DONE,					/* end of program, qual succeeded */
+	EPOP_VAR,					/* fetch a user attribute from a slot */
+	EPOP_CONST,					/* load a constant */
+	EPOP_NOOP,					/* do nothing */
+
+	EPOP_FUNC_INIT,				/* first-call permission check of a function */
+	EPOP_FUNC,					/* call a non-strict function */
+	EPOP_FUNC_STRICT,			/* call a strict function */
+	EPOP_FUNC_FUSAGE,			/* call a function, tracking usage stats */
+	EPOP_FUNC_VAR_CONST,		/* strict 2-arg function of a Var and a Const */
+	EPOP_CMP_VAR_CONST,			/* integer comparison of a Var to a Const */
+
+	EPOP_BOOL_INIT,				/* reset AND/OR null tracking */
+	EPOP_BOOL_AND_STEP,			/* short-circuit AND on a false argument */
+	EPOP_BOOL_AND_DONE,			/* compute the AND result */
+	EPOP_BOOL_OR_STEP,			/* short-circuit OR on a true argument */
+	EPOP_BOOL_OR_DONE,			/* compute the OR result */
+	EPOP_BOOL_NOT,				/* negate a non-null boolean */
+
+	EPOP_NULLTEST_ISNULL,		/* scalar IS NULL */
+	EPOP_NULLTEST_ISNOTNULL,	/* scalar IS NOT NULL */
+
+	EPOP_QUAL,					/* top-level qual clause: fail on false/null */
+	EPOP_ASSIGN,				/* store the result into an output column */
+
+	EPOP_EVAL_EXPRSTATE			/* fall back to ExecEvalExpr() */
+} ExprProgOpcode;
+
+/* Comparison kinds for EPOP_CMP_VAR_CONST */
+typedef enum ExprProgCmp
+{
+	EPCMP_EQ,
+	EPCMP_NE,
+	EPCMP_LT,
+	EPCMP_LE,
+	EPCMP_GT,
+	EPCMP_GE
+} ExprProgCmp;
+
+typedef struct ExprProgStep
+{
+	ExprProgOpcode opcode;
+
+	/* where to store the result of this step */
+	Datum	   *resvalue;
+	bool	   *resnull;
+
+	union
+	{
+		/* EPOP_VAR */
+		struct
+		{
+			int			slotoff;	/* offset of the slot in ExprContext */
+			AttrNumber	attnum;
+			Var		   *var;		/* for the one-time type check */
+		}			var;
+
+		/* EPOP_CONST */
+		struct
+		{
+			Datum		value;
+			bool		isnull;
+		}			constval;
+
+		/* EPOP_FUNC_INIT */
+		struct
+		{
+			Oid			funcid;
+		}			funcinit;
+
+		/* EPOP_FUNC, EPOP_FUNC_STRICT, EPOP_FUNC_FUSAGE */
+		struct
+		{
+			FmgrInfo   *finfo;
+			FunctionCallInfo fcinfo;
+			int			nargs;
+		}			func;
+
+		/* EPOP_FUNC_VAR_CONST, EPOP_CMP_VAR_CONST */
+		struct
+		{
+			int			slotoff;
+			AttrNumber	attnum;
+			Var		   *var;
+			int			varargno;	/* which argument the Var is */
+			FunctionCallInfo fcinfo;	/* EPOP_FUNC_VAR_CONST only */
+			Datum		constval;	/* EPOP_CMP_VAR_CONST only */
+			ExprProgCmp cmp;
+			int16		width;		/* 2, 4 or 8 bytes */
+		}			varconst;
+
+		/* EPOP_BOOL_* */
+		struct
+		{
+			bool	   *anynull;
+			int			jumpdone;	/* step to continue at on short-circuit */
+		}			boolexpr;
+
+		/* EPOP_ASSIGN */
+		struct
+		{
+			int			resultnum;
+		}			assign;
+
+		/* EPOP_EVAL_EXPRSTATE */
+		struct
+		{
+			ExprState  *state;
+		}			fallback;
+	}			d;
+} ExprProgStep;
+
+typedef struct ExprProgram
+{
+	int			nsteps;
+	ExprProgStep *steps;
+
+	/* the list this program was compiled from */
+	List	   *source;
+
+	/* scratch result of the expression being computed */
+	Datum		resvalue;
+	bool		resnull;
+
+	/* true once the Var steps have been checked against the input slots */
+	bool		validated;
+} ExprProgram;
+
+extern ExprProgram *ExecBuildQualProgram(List *qual);
+extern ExprProgram *ExecBuildProjectionProgram(List *targetlist);
+extern bool ExecQualProgram(ExprProgram *prog, ExprContext *econtext);
+extern void ExecProjectProgram(ExprProgram *prog, ExprContext *econtext,
+				   Datum *values, bool *isnull);
+
+#endif   /* EXECEXPRPROG_H */
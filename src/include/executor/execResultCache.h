@@ -0,0 +1,71 @@
+/*-------------------------------------------------------------------------
+ *
+ * execResultCache.h
+ *	  Caches of the results of rescanned plans, on their parameter values.
+ *
+ * A correlated subplan, or the inner side of a parameterized nested loop,
+ * is rescanned for every row of its parent, but what it returns depends
+ * only on the values of its parameters.  A ResultCache keeps the results on
+ * those values, so that the scan need not be run again when they repeat.
+ *
+ * Portions Copyright (c) 2012-Present Pivotal Software, Inc.
+ *
+ *
+ * IDENTIFICATION
+ *	  src/include/executor/execResultCache.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef EXECRESULTCACHE_H
+#define EXECRESULTCACHE_H
+
+#include "executor/instrument.h"
+#include "lib/ilist.h"
+#include "nodes/plannodes.h"
+#include "utils/hsearch.h"
+
+/*
+ * An entry of a result cache.  The users of a cache extend it with the
+ * fields of their results, it must be their first field.
+ */
+typedef struct ResultCacheEntry
+{
+	Datum	   *key;			/* parameter values; hash key, must be first */
+	void	   *value;			/* memory chunk of the result, or NULL */
+	Size		size;			/* memory taken by the entry */
+	dlist_node	lru_node;		/* most recently used first */
+} ResultCacheEntry;
+
+typedef struct ResultCache
+{
+	MemoryContext cxt;			/* holds the hash table and the entries */
+	HTAB	   *table;
+	Size		entrysize;		/* size of the entries, ResultCacheEntry or
+								 * the struct extending it */
+	dlist_head	lru;
+	int			nkeys;			/* number of parameters */
+	int16	   *keytyplen;
+	bool	   *keytypbyval;
+	Datum	   *probe;			/* parameter values of the current lookup */
+	Size		memused;
+	Size		memlimit;
+} ResultCache;
+
+/*
+ * A key is an array of nkeys parameter values, followed by their nkeys null
+ * flags.  Set the values to look up in cache->probe, and their null flags in
+ * RESULT_CACHE_KEY_ISNULL(cache, cache->probe).
+ */
+#define RESULT_CACHE_KEY_ISNULL(cache, key)	((bool *) ((key) + (cache)->nkeys))
+
+extern ResultCache *ResultCache_Create(const char *name, List *keytypes,
+				   Size entrysize);
+extern void ResultCache_Reset(ResultCache *cache);
+extern void ResultCache_Destroy(ResultCache *cache);
+extern ResultCacheEntry *ResultCache_Lookup(ResultCache *cache,
+				   uint32 *hashvalue);
+extern ResultCacheEntry *ResultCache_Insert(ResultCache *cache,
+				   uint32 hashvalue, void *value, Instrumentation *instr);
+extern bool ResultCache_PlanIsVolatile(PlannedStmt *stmt, Plan *plan);
+
+#endif   /* EXECRESULTCACHE_H */
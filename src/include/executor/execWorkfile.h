@@ -145,6 +145,7 @@ int64
 ExecWorkFile_Close(ExecWorkFile *workfile);
 
 int ExecWorkFile_Seek(ExecWorkFile *workfile, uint64 offset, int whence);
+void ExecWorkFile_Prefetch(ExecWorkFile *workfile, uint64 offset, int amount);
 void ExecWorkFile_Flush(ExecWorkFile *workfile);
 int64 ExecWorkFile_GetSize(ExecWorkFile *workfile);
 int64 ExecWorkFile_Suspend(ExecWorkFile *workfile);
@@ -77,6 +77,14 @@ typedef struct Instrumentation
 	instr_time	firststart;		/* CDB: Start time of first iteration of node */
 	bool		workfileCreated;	/* TRUE if workfiles are created in this
 									 * node */
+	double		workfileRawBytes;	/* CDB: workfile bytes before compression */
+	double		workfileDiskBytes;	/* CDB: workfile bytes after compression */
+	double		workfileCodecTime;	/* CDB: secs spent (de)compressing workfiles */
+	double		resultCacheHits;	/* CDB: results found in result cache */
+	double		resultCacheMisses;	/* CDB: results not in result cache */
+	double		resultCacheEvictions;	/* CDB: results evicted from cache */
+	double		resultCacheMemUsed; /* CDB: peak memory of cache (bytes) */
+	double		zoneMapBlocksSkipped;	/* CDB: AO blocks skipped by zone maps */
 	int			numPartScanned; /* Number of part tables scanned */
 	const char *sortMethod;		/* CDB: Type of sort */
 	const char *sortSpaceType;	/* CDB: Sort space type (Memory / Disk) */
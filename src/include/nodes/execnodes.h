@@ -250,6 +250,8 @@ typedef struct ReturnSetInfo
  *		lastInnerVar	highest attnum from inner tuple slot (0 if none)
  *		lastOuterVar	highest attnum from outer tuple slot (0 if none)
  *		lastScanVar		highest attnum from scan tuple slot (0 if none)
+ *		program			compiled form of targetlist, or NULL (see
+ *						execExprProg.c)
  * ----------------
  */
 typedef struct ProjectionInfo
@@ -267,6 +269,7 @@ typedef struct ProjectionInfo
 	int			pi_lastInnerVar;
 	int			pi_lastOuterVar;
 	int			pi_lastScanVar;
+	struct ExprProgram *pi_program;
 } ProjectionInfo;
 
 /* ----------------
@@ -1152,6 +1155,10 @@ typedef struct SubPlanState
 	FmgrInfo   *tab_eq_funcs;	/* equality functions for table datatype(s) */
 	FmgrInfo   *lhs_hash_funcs; /* hash functions for lefthand datatype(s) */
 	FmgrInfo   *cur_eq_funcs;	/* equality functions for LHS vs. table */
+	/* this is used when caching the results of a correlated subselect: */
+	struct ResultCache *resultcache;	/* NULL if results not cached */
+	int16		resultcache_typlen;	/* type of the cached results */
+	bool		resultcache_typbyval;
 } SubPlanState;
 
 /* ----------------
@@ -1417,6 +1424,7 @@ typedef struct PlanState
 	 */
 	List	   *targetlist;		/* target list to be computed at this node */
 	List	   *qual;			/* implicitly-ANDed qual conditions */
+	struct ExprProgram *qualprog;	/* compiled form of qual, or NULL */
 	struct PlanState *lefttree; /* input plan tree(s) */
 	struct PlanState *righttree;
 	List	   *initPlan;		/* Init SubPlanState nodes (un-correlated expr
@@ -1888,6 +1896,7 @@ typedef struct DynamicIndexScanState
  *		ScanDesc		   index scan descriptor
  *		VMBuffer		   buffer in use for visibility map testing, if any
  *		HeapFetches		   number of tuples we were forced to fetch from heap
+ *		AOIndexOnlyDesc	   visibility checks of an append-only table, if any
  * ----------------
  */
 typedef struct IndexOnlyScanState
@@ -1906,6 +1915,7 @@ typedef struct IndexOnlyScanState
 	IndexScanDesc ioss_ScanDesc;
 	Buffer		ioss_VMBuffer;
 	long		ioss_HeapFetches;
+	struct AppendOnlyIndexOnlyDescData *ioss_AOIndexOnlyDesc;
 } IndexOnlyScanState;
 
 /* ----------------
@@ -1997,6 +2007,10 @@ typedef struct BitmapHeapScanState
  *		bitmapqualorig	   execution state for bitmapqualorig expressions
  *		tbm				   bitmap obtained from child index scan(s)
  *		tbmres			   current-page data
+ *		prefetch_iterator  iterator for prefetching ahead of current page
+ *		prefetch_pages	   # pages prefetch iterator is ahead of current
+ *		prefetch_target    target prefetch distance
+ *		prefetchDesc	   block directory lookups for the prefetches
  * ----------------
  */
 typedef struct BitmapAppendOnlyScanState
@@ -2014,6 +2028,10 @@ typedef struct BitmapAppendOnlyScanState
 	bool		baos_lossy;
 	int			baos_ntuples;
 	bool        isAORow; /* If this is for AO Row tables. */
+	GenericBMIterator *baos_prefetch_iterator;
+	int			baos_prefetch_pages;
+	int			baos_prefetch_target;
+	struct AppendOnlyPrefetchDescData *baos_prefetchDesc;
 } BitmapAppendOnlyScanState;
 
 /* ----------------
@@ -2390,6 +2408,17 @@ typedef struct NestLoopState
 	List	   *nl_OuterJoinKeys;        /* list of ExprState nodes */
 	bool		nl_innerSideScanned;      /* set to true once we've scanned all inner tuples the first time */
 	bool		nl_qualResultForNull;     /* the value of the join condition when one of the sides contains a NULL */
+
+	/* this is used when caching the inner tuples on the nestParams values: */
+	struct ResultCache *nl_innerCache;	/* NULL if the inner side is not cached */
+	TupleTableSlot *nl_cachedInnerSlot;	/* slot of the cached inner tuples */
+	struct NestLoopCacheEntry *nl_cachedInner;	/* entry being returned, or NULL */
+	Size		nl_cachedInnerPos;	/* offset of its next tuple */
+	bool		nl_collectInner;	/* collecting the tuples of the inner scan? */
+	char	   *nl_collected;		/* tuples collected so far, or NULL */
+	Size		nl_collectedLen;
+	Size		nl_collectedAlloc;
+	uint32		nl_collectHash;		/* hash value of the nestParams values */
 } NestLoopState;
 
 /* ----------------
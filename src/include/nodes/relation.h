@@ -70,6 +70,8 @@ typedef struct AggClauseCosts
 	int			numPureOrderedAggs; /* CDB: number that use ORDER BY, not counting DISTINCT */
 	bool		hasNonCombine;	/* CDB: any agg func w/o a combine func? */
 	bool		hasNonSerial;	/* CDB: is any partial agg non-serializable? */
+	bool		hasPartialAggs; /* CDB: any agg in AGGSTAGE_PARTIAL? */
+	bool		hasFinalAggs;	/* CDB: any agg in AGGSTAGE_FINAL? */
 	QualCost	transCost;		/* total per-input-row execution costs */
 	Cost		finalCost;		/* total per-aggregated-row costs */
 	Size		transitionSpace;	/* space for pass-by-ref transition data */
@@ -475,6 +477,10 @@ static inline void planner_subplan_put_plan(struct PlannerInfo *root, SubPlan *s
  *				the attribute is needed as part of final targetlist
  *		attr_widths - cache space for per-attribute width estimates;
  *					  zero means not computed yet
+ *		attr_ndistinct - cache space for per-attribute ndistinct estimates
+ *					  of a partitioned table, merged from the HLL counters
+ *					  of its unpruned partitions; zero means not computed
+ *					  yet, negative means not available
  *		lateral_vars - lateral cross-references of rel, if any (list of
  *					   Vars and PlaceHolderVars)
  *		lateral_relids - required outer rels for LATERAL, as a Relids set
@@ -572,6 +578,7 @@ typedef struct RelOptInfo
 	AttrNumber	max_attr;		/* largest attrno of rel */
 	Relids	   *attr_needed;	/* array indexed [min_attr .. max_attr] */
 	int32	   *attr_widths;	/* array indexed [min_attr .. max_attr] */
+	double	   *attr_ndistinct;	/* array indexed [min_attr .. max_attr] */
 	List	   *lateral_vars;	/* LATERAL Vars and PHVs referenced by rel */
 	Relids		lateral_relids; /* minimum parameterization of rel */
 	Relids		lateral_referencers;	/* rels that reference me laterally */
@@ -88,20 +88,27 @@ typedef enum StreamType
 
 
 /*
- * The hashtable entries are represented by this data structure.  For
- * an exact page, blockno is the page number and bit k of the bitmap
- * represents tuple offset k+1.  For a lossy chunk, blockno is the first
- * page in the chunk (this must be a multiple of PAGES_PER_CHUNK) and
- * bit k represents page blockno+k.  Note that it is not possible to
- * have exact storage for the first page of a chunk if we are using
- * lossy storage for any page in the chunk's range, since the same
- * hashtable entry has to serve both purposes.
+ * A page of tids as the stream bitmaps pass it around.  For an exact page,
+ * blockno is the page number and bit k of the bitmap represents tuple
+ * offset k+1.  For a lossy chunk, blockno is the first page in the chunk
+ * (this must be a multiple of PAGES_PER_CHUNK) and bit k represents page
+ * blockno+k.  Note that it is not possible to have exact storage for the
+ * first page of a chunk if we are using lossy storage for any page in the
+ * chunk's range, since the same hashtable entry has to serve both purposes.
+ *
+ * The hashtable of a TIDBitmap keeps its pages in a more compact form,
+ * private to tidbitmap.c, and expands them into this one for streaming.
+ * Only the first nwords words of an exact page may be non-zero, so that a
+ * page with few matches is copied, merged and scanned at the cost of those
+ * words rather than of the whole bitmap; use tbm_reset_entry and
+ * tbm_copy_entry rather than clearing or copying the whole struct.
  */
 typedef struct PagetableEntry
 {
 	BlockNumber blockno;		/* page number (hashtable key) */
 	bool		ischunk;		/* T = lossy storage, F = exact */
 	bool		recheck;		/* should the tuples be rechecked? */
+	uint16		nwords;			/* words in use, the others are zero */
 	tbm_bitmapword	words[Max(WORDS_PER_PAGE, WORDS_PER_CHUNK)];
 } PagetableEntry;
 
@@ -176,7 +183,7 @@ struct StreamBMIterator
 	} input;						/* input iterator(s) */
 	void			   *opaque;		/* for the implementation in bitmap.c */
 
-	PagetableEntry	   *nextentry;	/* for IndexStream, a pointer to the next cached entry */
+	const struct TBMPage *nextentry;	/* for IndexStream, a pointer to the next cached entry */
 	BlockNumber			nextblock;	/* block number we're up to */
 	PagetableEntry		entry;		/* storage for a page of tids in this stream bitmap */
 
@@ -202,6 +209,9 @@ extern TBMIterator *tbm_begin_iterate(TIDBitmap *tbm);
 extern TBMIterateResult *tbm_iterate(TBMIterator *iterator);
 extern void tbm_end_iterate(TBMIterator *iterator);
 
+extern void tbm_reset_entry(PagetableEntry *e);
+extern void tbm_copy_entry(PagetableEntry *dst, const PagetableEntry *src);
+
 extern void stream_move_node(StreamBitmap *strm, StreamBitmap *other, StreamType kind);
 extern void stream_add_node(StreamBitmap *strm, StreamNode *node, StreamType kind);
 extern StreamNode *tbm_create_stream_node(TIDBitmap *tbm);
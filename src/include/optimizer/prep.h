@@ -33,6 +33,11 @@ extern Relids get_relids_for_join(PlannerInfo *root, int joinrelid);
 
 extern List *init_list_cteplaninfo(int numCtes);
 
+/*
+ * prototypes for prepeageragg.c
+ */
+extern void push_down_eager_aggregation(PlannerInfo *root);
+
 /*
  * prototypes for prepqual.c
  */
@@ -45,4 +45,10 @@ extern void autostats_get_cmdtype(QueryDesc *queryDesc,
 extern void auto_stats(AutoStatsCmdType cmdType, Oid relationOid,
 		   uint64 ntuples, bool inFunction);
 
+extern Size AutoStatsShmemSize(void);
+extern void AutoStatsShmemInit(void);
+extern void AtEOXact_AutoStats(bool isCommit);
+extern void AutoStatsDropDatabase(Oid dbid);
+extern void AutoStatsWorkerMain(Datum main_arg);
+
 #endif   /* AUTOSTATS_H */
@@ -1,6 +1,7 @@
 #ifndef BFZ_H
 #define BFZ_H
 
+#include "portability/instr_time.h"
 #include "storage/fd.h"
 
 #define BFZ_MODE_CLOSED		0
@@ -45,6 +46,9 @@ typedef struct bfz
 	unsigned char compression_index;
 	bool del_on_close;
 
+	/* Memory context the file was created in */
+	MemoryContext context;
+
 	/* Indicate if this bfz file stores block checksums. */
 	bool has_checksum;
 
@@ -59,12 +63,30 @@ typedef struct bfz
 	int64 numBlocks;
 	int64 blockNo;
 	int64 chosenBlockNo;
+
+	/*
+	 * Physical file offsets used for asynchronous read-ahead during a scan
+	 * and write-behind during append: the end of the range already
+	 * prefetched, and the start of the range not yet handed to writeback.
+	 */
+	int64 readaheadEnd;
+	int64 writebackStart;
+
+	/*
+	 * Compression statistics, kept across bfz_append_end() so that they can
+	 * be reported when the file is closed: the number of bytes appended
+	 * before compression, and the time spent in the compressor and
+	 * decompressor.
+	 */
+	int64 rawBytes;
+	instr_time codecTime;
 }	bfz_t;
 
 /* These functions are internal to bfz. */
 extern void bfz_nothing_init(bfz_t * thiz);
 extern void bfz_zlib_init(bfz_t * thiz);
 extern void bfz_lzop_init(bfz_t * thiz);
+extern void bfz_zstd_init(bfz_t * thiz);
 extern void bfz_write_ex(bfz_t * thiz, const char *buffer, int size);
 extern int	bfz_read_ex(bfz_t * thiz, char *buffer, int size);
 
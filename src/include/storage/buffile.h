@@ -46,6 +46,7 @@ extern Size BufFileWrite(BufFile *file, const void *ptr, Size size);
 extern int	BufFileSeek(BufFile *file, int fileno, off_t offset, int whence);
 extern void BufFileTell(BufFile *file, int *fileno, off_t *offset);
 extern int	BufFileSeekBlock(BufFile *file, int64 blknum);
+extern void BufFilePrefetch(BufFile *file, int64 offset, int amount);
 extern void BufFileFlush(BufFile *file);
 extern int64 BufFileGetSize(BufFile *buffile);
 extern void BufFileSetWorkfile(BufFile *buffile);
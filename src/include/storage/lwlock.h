@@ -138,7 +138,8 @@ extern PGDLLIMPORT LWLockPadded *MainLWLockArray;
 #define ErrorLogLock				(&MainLWLockArray[PG_NUM_INDIVIDUAL_LWLOCKS + 6].lock)
 #define SessionStateLock			(&MainLWLockArray[PG_NUM_INDIVIDUAL_LWLOCKS + 7].lock)
 #define RelfilenodeGenLock			(&MainLWLockArray[PG_NUM_INDIVIDUAL_LWLOCKS + 8].lock)
-#define GP_NUM_INDIVIDUAL_LWLOCKS		8
+#define AutoStatsLock				(&MainLWLockArray[PG_NUM_INDIVIDUAL_LWLOCKS + 9].lock)
+#define GP_NUM_INDIVIDUAL_LWLOCKS		10
 
 /*
  * It would probably be better to allocate separate LWLock tranches
@@ -242,6 +242,33 @@ datumstreamread_nth(DatumStreamRead * acc)
 	}
 }
 
+/*
+ * The distinct values of the current block, if it was written with a
+ * dictionary (see DSB_HAS_DICT_COMPRESSION), or NULL.  The value of the
+ * current datum is entry datumstreamread_dict_code(), or NULL if that is -1.
+ */
+inline static uint8 **
+datumstreamread_dict(DatumStreamRead * acc, int32 *dictCount)
+{
+	if (acc->largeObjectState != DatumStreamLargeObjectState_None ||
+		!acc->blockRead.dict_block_was_compressed)
+	{
+		*dictCount = 0;
+		return NULL;
+	}
+
+	*dictCount = acc->blockRead.dict_count;
+	return acc->blockRead.dict_entries;
+}
+
+inline static int32
+datumstreamread_dict_code(DatumStreamRead * acc)
+{
+	Assert(acc->largeObjectState == DatumStreamLargeObjectState_None);
+
+	return DatumStreamBlockRead_DictCode(&acc->blockRead);
+}
+
 /* ------------------------------------------------------------------------------ */
 
 extern int datumstreamwrite_put(
@@ -308,6 +335,9 @@ extern int64 datumstreamwrite_lob(DatumStreamWrite *ds,
 extern int	datumstreamread_block(DatumStreamRead * ds,
 								  AppendOnlyBlockDirectory *blockDirectory,
 								  int colGroupNo);
+extern int	datumstreamread_block_header(DatumStreamRead * ds);
+extern void datumstreamread_skip_block(DatumStreamRead * ds);
+extern void datumstreamread_skip_past_row(DatumStreamRead * ds, int64 rowNum);
 extern void datumstreamread_find(DatumStreamRead * datumStream,
 					 int32 rowNumInBlock);
 extern void datumstreamread_rewind_block(DatumStreamRead * datumStream);
@@ -322,6 +352,11 @@ extern void *datumstreamread_get_upgrade_space(DatumStreamRead *datumStream,
  * before calling datumstreamread_block_content.
  */
 extern void datumstreamread_block_content(DatumStreamRead * acc);
+extern void datumstreamread_block_from_cache(DatumStreamRead * acc,
+								 int64 firstRowNum,
+								 int32 rowCount,
+								 uint8 *content,
+								 int32 contentLen);
 extern bool init_datumstream_checksum(char *compName, bool checksum);
 
 #endif   /* DATUMSTREAM_H */
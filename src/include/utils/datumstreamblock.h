@@ -196,6 +196,48 @@ typedef struct DatumStreamBlock_Delta_Extension
 	 */
 }	DatumStreamBlock_Delta_Extension;
 
+/*
+ * Datum Stream Block dictionary of variable-length items.
+ *
+ * With DSB_HAS_DICT_COMPRESSION the data area does not hold the physical
+ * datums themselves.  It starts with this extension, followed by the
+ * distinct values of the block (stored and aligned just like the datums of
+ * a plain data area), followed by one code per physical datum which is the
+ * index of its value.  The NULL bit-map and the RLE_TYPE and delta metadata
+ * are unchanged, and still count physical datums.
+ * 16 bytes.
+ */
+typedef struct DatumStreamBlock_Dict_Extension
+{
+	int32		dict_count;
+	/*
+	 * Number of distinct values.
+	 */
+
+	int32		dict_size;
+	/*
+	 * Total size of the distinct values, including alignment padding.
+	 */
+
+	int32		codes_count;
+	/*
+	 * Number of codes, the same as the number of physical datums.
+	 */
+
+	int32		code_width;
+	/*
+	 * 1 byte codes for up to 256 distinct values, otherwise 2 byte codes
+	 * (little-endian).
+	 */
+}	DatumStreamBlock_Dict_Extension;
+
+/*
+ * Most distinct values a block dictionary may have.  Blocks with more are
+ * written without a dictionary.
+ */
+#define DATUMSTREAM_DICT_MAX_COUNT 1024
+#define DATUMSTREAM_DICT_HASH_SIZE (2 * DATUMSTREAM_DICT_MAX_COUNT)
+
 
 /* Flags */
 enum
@@ -203,6 +245,7 @@ enum
 	DSB_HAS_NULLBITMAP = 0x1,
 	DSB_HAS_RLE_COMPRESSION = 0x2,
 	DSB_HAS_DELTA_COMPRESSION = 0x4,
+	DSB_HAS_DICT_COMPRESSION = 0x8,
 };
 
 typedef struct DatumStreamBitMapWrite
@@ -1008,6 +1051,7 @@ typedef struct DatumStreamBlockWrite
 
 	bool		rle_want_compression;
 	bool		delta_want_compression;
+	bool		dict_want_compression;
 
 	int32		initialMaxDatumPerBlock;
 	int32		maxDatumPerBlock;
@@ -1057,6 +1101,9 @@ typedef struct DatumStreamBlockWrite
 	int32		deltas_count;
 	int32		deltas_current_size;
 
+	/* Dictionary variables, for the block being formatted */
+	bool		dict_has_compression;
+
 	/* Common buffers */
 	MemoryContext memctxt;
 
@@ -1082,6 +1129,15 @@ typedef struct DatumStreamBlockWrite
 	bool	   *delta_sign;
 	int32		deltas_maxcount;
 
+	/*
+	 * Dictionary buffers, allocated on first use.  The hash table maps the
+	 * bytes of a value to its index + 1 in dict_values, which point into
+	 * dict_buffer.
+	 */
+	uint8	   *dict_buffer;
+	int32	   *dict_hash;
+	uint8	  **dict_values;
+
 	/* EOF of current file */
 	int64		savings;
 	int64		remember_savings;
@@ -1164,6 +1220,14 @@ typedef struct DatumStreamBlockRead
 	bool		delta_block_was_compressed;
 	DatumStreamBitMapRead delta_bitmap;
 
+	/* Dictionary variables */
+	bool		dict_block_was_compressed;
+	int32		dict_count;
+	uint8	  **dict_entries;	/* pointers to the distinct values */
+	uint8	   *dict_codesp;
+	int32		dict_code_width;
+	int32		dict_code;		/* code of the current datum */
+
 	/*
 	 * Keep less frequently accessed fields down here for possible better CPU data cache
 	 * performance.
@@ -1435,6 +1499,35 @@ DatumStreamBlockRead_Get(DatumStreamBlockRead * dsr, Datum *datum, bool *null)
 	}
 }
 
+/*
+ * Position on the distinct value of the next physical datum of a block
+ * with a dictionary.
+ */
+inline static int
+DatumStreamBlockRead_AdvanceDict(DatumStreamBlockRead * dsr)
+{
+	int32		code;
+
+	++dsr->physical_datum_index;
+
+	if (dsr->dict_code_width == 1)
+	{
+		code = dsr->dict_codesp[0];
+		dsr->dict_codesp += 1;
+	}
+	else
+	{
+		code = dsr->dict_codesp[0] | (dsr->dict_codesp[1] << 8);
+		dsr->dict_codesp += 2;
+	}
+	Assert(code < dsr->dict_count);
+
+	dsr->dict_code = code;
+	dsr->datump = dsr->dict_entries[code];
+
+	return 1;
+}
+
 inline static int
 DatumStreamBlockRead_AdvanceOrig(DatumStreamBlockRead * dsr)
 {
@@ -1474,6 +1567,9 @@ DatumStreamBlockRead_AdvanceOrig(DatumStreamBlockRead * dsr)
 		}
 	}
 
+	if (dsr->dict_block_was_compressed)
+		return DatumStreamBlockRead_AdvanceDict(dsr);
+
 	Assert(dsr->datump >= dsr->datum_beginp);
 	Assert(dsr->datump < dsr->datum_afterp);
 
@@ -1918,6 +2014,9 @@ DatumStreamBlockRead_AdvanceDense(DatumStreamBlockRead * dsr)
 		}
 	}
 
+	if (dsr->dict_block_was_compressed)
+		return DatumStreamBlockRead_AdvanceDict(dsr);
+
 	Assert(dsr->datump >= dsr->datum_beginp);
 	Assert(dsr->datump < dsr->datum_afterp);
 
@@ -2062,6 +2161,21 @@ DatumStreamBlockRead_Nth(DatumStreamBlockRead * dsr)
 	return dsr->nth;
 }
 
+/*
+ * Dictionary code of the current datum, or -1 when it is NULL.  Only valid
+ * for blocks with DSB_HAS_DICT_COMPRESSION.
+ */
+inline static int32
+DatumStreamBlockRead_DictCode(DatumStreamBlockRead * dsr)
+{
+	Assert(dsr->dict_block_was_compressed);
+
+	if (dsr->has_null && DatumStreamBitMapRead_CurrentIsOn(&dsr->null_bitmap))
+		return -1;
+
+	return dsr->dict_code;
+}
+
 extern void DatumStreamBlockRead_GetReadyOrig(
 								  DatumStreamBlockRead * dsr,
 								  uint8 * buffer,
@@ -2152,6 +2266,7 @@ extern void DatumStreamBlockWrite_Init(
 						   DatumStreamVersion datumStreamVersion,
 						   bool rle_want_compression,
 						   bool delta_want_compression,
+						   bool dict_want_compression,
 						   int32 initialMaxDatumPerBlock,
 						   int32 maxDatumPerBlock,
 						   int32 maxDataBlockSize,
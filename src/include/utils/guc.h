@@ -245,6 +245,7 @@ extern bool Debug_appendonly_print_visimap;
 extern bool Debug_appendonly_print_compaction;
 extern bool gp_crash_recovery_abort_suppress_fatal;
 extern bool Debug_bitmap_print_insert;
+extern bool gp_enable_bitmap_sort_build;
 extern bool Test_appendonly_override;
 extern bool enable_checksum_on_tables;
 extern int  Test_compresslevel_override;
@@ -273,6 +274,8 @@ extern bool Debug_datumstream_block_read_check_integrity;
 extern bool Debug_datumstream_block_write_check_integrity;
 extern bool Debug_datumstream_read_print_varlena_info;
 extern bool Debug_datumstream_write_use_small_initial_buffers;
+extern bool gp_aocs_dictionary_encoding;
+extern bool gp_appendonly_direct_io;
 extern bool	Debug_database_command_print;
 extern bool gp_startup_integrity_checks;
 extern bool Debug_resource_group;
@@ -339,6 +342,8 @@ extern bool gp_perfmon_print_packet_info;
 
 extern bool gp_enable_relsize_collection;
 
+extern bool gp_enable_expression_program;
+
 /* Debug DTM Action */
 typedef enum
 {
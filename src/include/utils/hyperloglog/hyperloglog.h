@@ -154,8 +154,13 @@ typedef struct HLLData {
 	/* Number of pages in the partition */
 	float4 relPages;
 
+	/* Modification count (low 32 bits) and relfilenode of an append-optimized
+	 * partition when it was analyzed, or zeroes */
+	int32_t modcount;
+	Oid relfilenode;
+
 	/* padding to save more values for the future */
-	int32_t padding[11];
+	int32_t padding[9];
 
     /* largest observed 'rho' for each of the 'm' buckets (uses the very same
      * trick  as in the varlena type in include/c.h where additional memory 
@@ -201,6 +206,13 @@ HLLCounter hll_unpack(HLLCounter hloglog);
 #define DEFAULT_NDISTINCT   1ULL << 63
 #define DEFAULT_ERROR       0.008125
 
+/*
+ * For Hyperloglog, we define an error margin of 0.3%. If the number of
+ * distinct values estimated by hyperloglog is within an error of 0.3%,
+ * we consider everything as distinct.
+ */
+#define HLL_ERROR_MARGIN  0.003
+
 
 /* ------------- function declarations for local functions --------------- */
 extern HLLCounter hyperloglog_add_item(HLLCounter hllcounter, Datum element, int16 typlen, bool typbyval, char typalign);
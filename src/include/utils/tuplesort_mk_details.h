@@ -58,6 +58,15 @@ typedef struct MKEntry
      *   Deciphering of this field is done by the functions that are passed when the multi-key heap is prepared
      */
     void *ptr;
+
+    /**
+     * Abbreviated key of the datum at the current level, for the level types
+     * that have one (see mklv_has_abbrev).  It is an order preserving prefix
+     * of the key, compared as unsigned: entries whose abbreviations differ
+     * compare the same way as their datums; equal abbreviations need a full
+     * comparison.
+     */
+    uint64 abbrev;
 } MKEntry;
 
 /**
@@ -149,6 +158,7 @@ static inline void mke_set_empty(MKEntry *e)
     e->flags = 0;
 	e->d = 0;
 	e->ptr = 0;
+	e->abbrev = 0;
 }
 static inline bool mke_is_empty(MKEntry *e)
 {
@@ -221,8 +231,24 @@ typedef enum MKLvType
     MKLV_TYPE_INT32, /* this level contains int32 values */
     MKLV_TYPE_CHAR,  /* this level contains char (blank padded) values */
     MKLV_TYPE_TEXT,  /* this level contains text values */
+    MKLV_TYPE_INT64, /* this level contains int64 values */
+    MKLV_TYPE_TEXT_C, /* this level contains text values in the C collation */
+    MKLV_TYPE_NUMERIC, /* this level contains numeric values */
 } MKLvType;
 
+/* Is the datum at a level of this type an integer that can be radix sorted? */
+static inline bool mklv_is_integer(MKLvType t)
+{
+    return t == MKLV_TYPE_INT32 || t == MKLV_TYPE_INT64;
+}
+
+/* Does tupsort_prepare() compute an abbreviated key for a level of this type? */
+static inline bool mklv_has_abbrev(MKLvType t)
+{
+    return t == MKLV_TYPE_CHAR || t == MKLV_TYPE_TEXT ||
+        t == MKLV_TYPE_TEXT_C || t == MKLV_TYPE_NUMERIC;
+}
+
 typedef struct MKLvContext
 {
 	/* Is the type of datums in this level passed by value instead of reference */
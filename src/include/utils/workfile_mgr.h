@@ -90,6 +90,15 @@ typedef struct workfile_set
 	/* Operator-specific metadata */
 	workfile_set_op_metadata metadata;
 
+	/*
+	 * Compression statistics over the bfz files of this set closed so far:
+	 * bytes written before and after compression, and the time spent
+	 * compressing and decompressing them.
+	 */
+	int64 raw_size;
+	int64 compressed_size;
+	int64 codec_time_us;
+
   /*
    * To make sure we don't leak workfile_set handles on abort, we keep them in
    * a linked list. We use the ResourceOwner mechanism to free them on abort.
@@ -136,6 +145,7 @@ Size workfile_mgr_shmem_size(void);
 void workfile_mgr_cache_init(void);
 Cache *workfile_mgr_get_cache(void);
 void workfile_set_update_in_progress_size(workfile_set *work_set, int64 size);
+Instrumentation *workfile_mgr_get_instrument(workfile_set *work_set);
 
 /* Workfile File operations */
 ExecWorkFile *workfile_mgr_create_file(workfile_set *work_set);
@@ -0,0 +1,64 @@
+-- Test asynchronous auto-stats: the tables loaded by a transaction are
+-- queued at commit, and analyzed by a background worker of the database.
+
+-- Wait until the table has been analyzed 'n' times, as reported to the
+-- stats collector.
+CREATE OR REPLACE FUNCTION autostats_async_wait(rel regclass, n int)
+RETURNS bool AS
+$$
+  DECLARE
+    i int; /* in func */
+  BEGIN
+    FOR i IN 1..600 LOOP
+      PERFORM pg_stat_clear_snapshot(); /* in func */
+      IF (SELECT analyze_count FROM pg_stat_all_tables WHERE relid = rel) >= n THEN
+        RETURN true; /* in func */
+      END IF; /* in func */
+      PERFORM pg_sleep(0.1); /* in func */
+    END LOOP; /* in func */
+    RETURN false; /* in func */
+  END; /* in func */
+$$ LANGUAGE plpgsql;
+
+1: CREATE TABLE autostats_async_t1 (a int, b int) DISTRIBUTED BY (a);
+1: CREATE TABLE autostats_async_t2 (a int, b int) DISTRIBUTED BY (a);
+1: CREATE TABLE autostats_async_t3 (a int, b int) DISTRIBUTED BY (a);
+1: CREATE TABLE autostats_async_t4 (a int, b int) DISTRIBUTED BY (a);
+
+1: SET gp_autostats_mode = on_change;
+1: SET gp_autostats_on_change_threshold = 0;
+1: SET gp_autostats_async = on;
+
+-- Hold the worker back: the ANALYZE of the first table queued waits for
+-- the lock of session 2, while the other tables stay queued.
+2: BEGIN;
+2: LOCK autostats_async_t1 IN SHARE UPDATE EXCLUSIVE MODE;
+
+1: INSERT INTO autostats_async_t1 SELECT i, i FROM generate_series(1, 100) i;
+
+-- A table still queued is not queued again by another commit
+1: INSERT INTO autostats_async_t2 SELECT i, i FROM generate_series(1, 200) i;
+1: INSERT INTO autostats_async_t2 SELECT i, i FROM generate_series(1, 200) i;
+
+-- nor by another load of the same transaction
+1: BEGIN;
+1: INSERT INTO autostats_async_t3 SELECT i, i FROM generate_series(1, 300) i;
+1: INSERT INTO autostats_async_t3 SELECT i, i FROM generate_series(1, 300) i;
+1: COMMIT;
+
+-- Queued last, so analyzed once all the other tables are
+1: INSERT INTO autostats_async_t4 SELECT i, i FROM generate_series(1, 10) i;
+
+-- Nothing was analyzed by the loads themselves
+1: SELECT relname, reltuples FROM pg_class WHERE relname LIKE 'autostats_async_t_' ORDER BY relname;
+
+2: COMMIT;
+
+1: SELECT autostats_async_wait('autostats_async_t4', 1);
+
+1: SELECT relname, analyze_count FROM pg_stat_all_tables WHERE relname LIKE 'autostats_async_t_' ORDER BY relname;
+1: SELECT relname, reltuples FROM pg_class WHERE relname LIKE 'autostats_async_t_' ORDER BY relname;
+1: SELECT starelid::regclass, count(*) FROM pg_statistic WHERE starelid::regclass::text LIKE 'autostats_async_t_' GROUP BY starelid ORDER BY 1;
+
+1: DROP TABLE autostats_async_t1, autostats_async_t2, autostats_async_t3, autostats_async_t4;
+1: DROP FUNCTION autostats_async_wait(regclass, int);
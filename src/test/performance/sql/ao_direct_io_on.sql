@@ -0,0 +1,18 @@
+--
+-- Scans of the append-only tables loaded by the load tests, and a load of
+-- a scratch table, with gp_appendonly_direct_io on.  Compare the run time
+-- of this test with ao_direct_io_off, and the growth of the page cache
+-- ("Cached" in /proc/meminfo) on the segment hosts while each runs.
+--
+SET gp_appendonly_direct_io = on;
+
+SELECT count(*) >= 0 AS ran FROM ao_blocksz524288;
+SELECT count(*) >= 0 AS ran FROM ao_zlib_blocksz8192;
+SELECT count(a) >= 0 AS ran FROM aoco_blocksz524288;
+SELECT count(a) >= 0 AS ran FROM aoco_zlib_blocksz8192;
+
+-- bulk load of a column-oriented table
+CREATE TABLE ao_direct_io_load (LIKE base_table)
+  WITH (appendonly=true, orientation=column) DISTRIBUTED RANDOMLY;
+INSERT INTO ao_direct_io_load SELECT * FROM base_table;
+DROP TABLE ao_direct_io_load;
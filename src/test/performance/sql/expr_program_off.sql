@@ -0,0 +1,18 @@
+--
+-- TPC-H style predicates and projections over base_table, evaluated with
+-- gp_enable_expression_program = off.  Compare the run time of this test
+-- with expr_program_on.
+--
+SET gp_enable_expression_program = off;
+
+-- Q6-like: date range, numeric range and integer comparison
+SELECT count(*) >= 0 AS ran FROM base_table WHERE d >= date '1994-01-01' AND d < date '1995-01-01' AND j BETWEEN 0.05 AND 0.07 AND a < 24;
+
+-- Q19-like: OR of ANDs over several columns
+SELECT count(*) >= 0 AS ran FROM base_table WHERE (a = 1 AND b >= 10 AND c <= 20) OR (a = 2 AND b >= 20 AND c <= 30) OR (e = 'MED BAG' AND i BETWEEN 1 AND 10);
+
+-- NULL tests and NOT
+SELECT count(*) >= 0 AS ran FROM base_table WHERE f IS NOT NULL AND NOT (g = 0) AND k <> l;
+
+-- Q1-like: arithmetic projection under a date filter
+SELECT count(*) >= 0 AS ran FROM (SELECT k * (1 - j) AS disc_price, k * (1 - j) * (1 + j) AS charge, a + b AS ab FROM base_table WHERE d <= date '1998-09-02' OFFSET 0) s;
@@ -0,0 +1,53 @@
+--
+-- Deforming of AO row tuples (memtuples) of different widths and null
+-- densities.  Each query projects the first and the last column, so the
+-- scan deforms every attribute of every tuple.  Compare the run times of
+-- the queries across widths and null densities.
+--
+CREATE OR REPLACE FUNCTION create_deform_table(ncols int, nullpct int, nrows int) RETURNS void AS $$
+DECLARE
+	tname text := 'deform_w' || ncols || '_n' || nullpct;
+	cols text := '';
+	vals text := '';
+	expr text;
+BEGIN
+	FOR i IN 1..ncols LOOP
+		IF i % 4 = 0 THEN
+			cols := cols || ', c' || i || ' text';
+			expr := 'repeat(''x'', (g % 16)::int)';
+		ELSIF i % 2 = 0 THEN
+			cols := cols || ', c' || i || ' int8';
+			expr := 'g::int8 * ' || i;
+		ELSE
+			cols := cols || ', c' || i || ' int4';
+			expr := '(g % 100000)::int4 + ' || i;
+		END IF;
+		IF nullpct > 0 THEN
+			expr := 'CASE WHEN random() * 100 < ' || nullpct || ' THEN NULL ELSE ' || expr || ' END';
+		END IF;
+		vals := vals || ', ' || expr;
+	END LOOP;
+
+	EXECUTE 'DROP TABLE IF EXISTS ' || tname;
+	EXECUTE 'CREATE TABLE ' || tname || ' (id int4' || cols || ') WITH (appendonly = true) DISTRIBUTED BY (id)';
+	EXECUTE 'INSERT INTO ' || tname || ' SELECT g' || vals || ' FROM generate_series(1, ' || nrows || ') g';
+END;
+$$ LANGUAGE plpgsql;
+
+SELECT create_deform_table(w, n, 2000000) FROM (VALUES (4), (16), (64)) w(w), (VALUES (0), (10), (50)) n(n);
+
+SELECT count(*) >= 0 AS ran FROM (SELECT id, c4 FROM deform_w4_n0 OFFSET 0) s;
+SELECT count(*) >= 0 AS ran FROM (SELECT id, c4 FROM deform_w4_n10 OFFSET 0) s;
+SELECT count(*) >= 0 AS ran FROM (SELECT id, c4 FROM deform_w4_n50 OFFSET 0) s;
+SELECT count(*) >= 0 AS ran FROM (SELECT id, c16 FROM deform_w16_n0 OFFSET 0) s;
+SELECT count(*) >= 0 AS ran FROM (SELECT id, c16 FROM deform_w16_n10 OFFSET 0) s;
+SELECT count(*) >= 0 AS ran FROM (SELECT id, c16 FROM deform_w16_n50 OFFSET 0) s;
+SELECT count(*) >= 0 AS ran FROM (SELECT id, c64 FROM deform_w64_n0 OFFSET 0) s;
+SELECT count(*) >= 0 AS ran FROM (SELECT id, c64 FROM deform_w64_n10 OFFSET 0) s;
+SELECT count(*) >= 0 AS ran FROM (SELECT id, c64 FROM deform_w64_n50 OFFSET 0) s;
+
+-- Only a leading column is needed: trailing attributes are not deformed.
+SELECT count(*) >= 0 AS ran FROM (SELECT id, c2 FROM deform_w64_n0 OFFSET 0) s;
+SELECT count(*) >= 0 AS ran FROM (SELECT id, c2 FROM deform_w64_n50 OFFSET 0) s;
+
+DROP FUNCTION create_deform_table(int, int, int);
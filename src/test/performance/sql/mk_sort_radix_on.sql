@@ -0,0 +1,22 @@
+--
+-- Multi-key sort of integer, date, numeric and text keys over base_table,
+-- with gp_enable_mk_sort_radix = on.  Compare the run time of this test
+-- with mk_sort_radix_off.
+--
+SET gp_enable_mk_sort = on;
+SET gp_enable_mk_sort_radix = on;
+
+-- int8 key
+SELECT count(*) >= 0 AS ran FROM (SELECT k FROM base_table ORDER BY k OFFSET 0) s;
+
+-- date key, descending, then int8
+SELECT count(*) >= 0 AS ran FROM (SELECT d, k FROM base_table ORDER BY d DESC, k OFFSET 0) s;
+
+-- two int4 keys
+SELECT count(*) >= 0 AS ran FROM (SELECT a, b FROM base_table ORDER BY a, b OFFSET 0) s;
+
+-- numeric key
+SELECT count(*) >= 0 AS ran FROM (SELECT j FROM base_table ORDER BY j OFFSET 0) s;
+
+-- long text key
+SELECT count(*) >= 0 AS ran FROM (SELECT f FROM base_table ORDER BY f OFFSET 0) s;
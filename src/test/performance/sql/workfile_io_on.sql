@@ -0,0 +1,21 @@
+--
+-- Spilling sort, hash aggregate and hash join over base_table with a small
+-- statement_mem, with workfile read-ahead and write-behind turned on.
+-- Compare the run time of this test with workfile_io_off.
+--
+SET statement_mem = '2MB';
+SET gp_workfile_prefetch_blocks = 16;
+SET gp_workfile_writeback_blocks = 32;
+
+-- external sort; the merge reads every run through logtape
+SELECT count(*) >= 0 AS ran FROM (SELECT f, k FROM base_table ORDER BY f, k OFFSET 0) s;
+
+-- spilling hash aggregate; batches are reloaded sequentially
+SET enable_groupagg = off;
+SELECT count(*) >= 0 AS ran FROM (SELECT k, count(*) FROM base_table GROUP BY k) s;
+RESET enable_groupagg;
+
+-- spilling hash join; batch files are written and reloaded
+SET enable_mergejoin = off;
+SELECT count(*) >= 0 AS ran FROM base_table t1 JOIN base_table t2 ON t1.k = t2.k AND t1.a = t2.a;
+RESET enable_mergejoin;
@@ -396,3 +396,16 @@ INSERT INTO foo_stats values (repeat('b', 100000), 'bbbbb2', 'cccc2', 3);
 ANALYZE foo_stats;
 SELECT schemaname, tablename, attname, null_frac, avg_width, n_distinct, most_common_vals, most_common_freqs, histogram_bounds FROM pg_stats WHERE tablename='foo_stats' ORDER BY attname;
 DROP TABLE IF EXISTS foo_stats;
+
+--
+-- Statistics of an append-optimized table computed from the summaries of the
+-- segments, with gp_analyze_segment_summaries. The table is smaller than the
+-- sample, so the statistics are the same as when it is sampled to the master.
+--
+CREATE TABLE ao_summary_stats (a int, b text, c numeric) WITH (appendonly=true) DISTRIBUTED BY (a);
+INSERT INTO ao_summary_stats SELECT i, 'v' || (i % 5), CASE WHEN i % 4 = 0 THEN NULL ELSE i % 3 END FROM generate_series(1, 100) i;
+SET gp_analyze_segment_summaries = on;
+ANALYZE ao_summary_stats;
+RESET gp_analyze_segment_summaries;
+SELECT attname, null_frac, n_distinct, most_common_vals, most_common_freqs FROM pg_stats WHERE tablename='ao_summary_stats' ORDER BY attname;
+DROP TABLE ao_summary_stats;
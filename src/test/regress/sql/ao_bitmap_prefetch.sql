@@ -0,0 +1,42 @@
+--
+-- Bitmap scans of append-only tables prefetch the varblocks of the rows a
+-- few pages ahead when effective_io_concurrency is set.  The rows returned
+-- must not depend on it, also for the AND and OR of bitmap index streams.
+--
+create table ao_bmp_row (a int, b int, c int, d text) with (appendonly=true) distributed by (a);
+create table ao_bmp_col (a int, b int, c int, d text) with (appendonly=true, orientation=column) distributed by (a);
+insert into ao_bmp_row select i, i % 100, i % 7, 'row ' || i from generate_series(1, 50000) i;
+insert into ao_bmp_col select * from ao_bmp_row;
+create index ao_bmp_row_b on ao_bmp_row using bitmap (b);
+create index ao_bmp_row_c on ao_bmp_row using bitmap (c);
+create index ao_bmp_col_b on ao_bmp_col using bitmap (b);
+create index ao_bmp_col_c on ao_bmp_col using bitmap (c);
+delete from ao_bmp_row where a % 10 = 0;
+delete from ao_bmp_col where a % 10 = 0;
+set optimizer = off;
+set enable_seqscan = off;
+set enable_indexscan = off;
+set effective_io_concurrency = 0;
+select count(d), sum(a) from ao_bmp_row where b = 42;
+select count(d), sum(a) from ao_bmp_row where b = 42 or c = 3;
+select count(d), sum(a) from ao_bmp_row where b < 10 and c = 3;
+select count(d), sum(a) from ao_bmp_row where (b in (1, 2) or c = 5) and b < 30;
+select count(d), sum(a) from ao_bmp_col where b = 42;
+select count(d), sum(a) from ao_bmp_col where b = 42 or c = 3;
+select count(d), sum(a) from ao_bmp_col where b < 10 and c = 3;
+select count(d), sum(a) from ao_bmp_col where (b in (1, 2) or c = 5) and b < 30;
+set effective_io_concurrency = 8;
+select count(d), sum(a) from ao_bmp_row where b = 42;
+select count(d), sum(a) from ao_bmp_row where b = 42 or c = 3;
+select count(d), sum(a) from ao_bmp_row where b < 10 and c = 3;
+select count(d), sum(a) from ao_bmp_row where (b in (1, 2) or c = 5) and b < 30;
+select count(d), sum(a) from ao_bmp_col where b = 42;
+select count(d), sum(a) from ao_bmp_col where b = 42 or c = 3;
+select count(d), sum(a) from ao_bmp_col where b < 10 and c = 3;
+select count(d), sum(a) from ao_bmp_col where (b in (1, 2) or c = 5) and b < 30;
+reset effective_io_concurrency;
+reset enable_indexscan;
+reset enable_seqscan;
+reset optimizer;
+drop table ao_bmp_row;
+drop table ao_bmp_col;
@@ -0,0 +1,30 @@
+--
+-- gp_appendonly_direct_io: scans read the segment files with O_DIRECT, and
+-- inserts drop what they wrote from the page cache.  The results must be
+-- the same as through the page cache.  On file systems without O_DIRECT
+-- support the files are read through the cache instead.
+--
+create table ao_direct_row (a int, b text)
+  with (appendonly=true) distributed by (a);
+create table ao_direct_col (a int, b text)
+  with (appendonly=true, orientation=column, compresstype=zlib) distributed by (a);
+set gp_appendonly_direct_io = on;
+insert into ao_direct_row select i, repeat('x', i % 50) from generate_series(1, 20000) i;
+insert into ao_direct_col select * from ao_direct_row;
+-- The second inserts append at an unaligned end of file
+insert into ao_direct_row select i, 'y' from generate_series(20001, 20100) i;
+insert into ao_direct_col select i, 'y' from generate_series(20001, 20100) i;
+select count(*), sum(a), sum(length(b)) from ao_direct_row;
+select count(*), sum(a), sum(length(b)) from ao_direct_col;
+
+-- Index scans read single blocks at unaligned offsets
+create index ao_direct_row_a on ao_direct_row (a);
+create index ao_direct_col_a on ao_direct_col (a);
+set enable_seqscan = off;
+select a, b from ao_direct_row where a in (1, 7777, 20050) order by a;
+select a, b from ao_direct_col where a in (1, 7777, 20050) order by a;
+reset enable_seqscan;
+reset gp_appendonly_direct_io;
+select count(*), sum(a), sum(length(b)) from ao_direct_col;
+drop table ao_direct_row;
+drop table ao_direct_col;
@@ -0,0 +1,55 @@
+--
+-- gp_appendonly_fetch_cache_size: the fetches of a bitmap scan of an
+-- append-only table keep the decompressed blocks they fetched rows from, and
+-- fetch the rows of blocks they visit again, e.g. on the inner side of a
+-- nested loop, from the cache.  The results must be the same with the
+-- cache, with a cache too small to keep every block, and without it.
+--
+create table ao_fc_row (a int, b int, c text)
+  with (appendonly=true, compresstype=zlib, blocksize=8192)
+  distributed by (a);
+create table ao_fc_col (a int, b int, c text)
+  with (appendonly=true, orientation=column, compresstype=zlib, blocksize=8192)
+  distributed by (a);
+insert into ao_fc_row select i, (i * 7919) % 1000, repeat('x', i % 20) from generate_series(1, 20000) i;
+insert into ao_fc_col select * from ao_fc_row;
+create index ao_fc_row_b on ao_fc_row (b);
+create index ao_fc_col_b on ao_fc_col (b);
+-- every key twice, each probe of the index visits blocks all over the table
+create table ao_fc_keys (b int) distributed by (b);
+insert into ao_fc_keys select b from generate_series(100, 140) b, generate_series(1, 2);
+insert into ao_fc_keys select b from unnest(array[7, 300, 301, 999]) b, generate_series(1, 2);
+analyze ao_fc_keys;
+set enable_seqscan = off;
+set enable_hashjoin = off;
+set enable_mergejoin = off;
+select count(*), sum(a), sum(length(c)) from ao_fc_row where b between 100 and 140;
+select count(*), sum(t.a), sum(length(t.c)) from ao_fc_keys k join ao_fc_row t on t.b = k.b;
+select count(*), sum(a), sum(length(c)) from ao_fc_col where b between 100 and 140;
+select count(*), sum(t.a), sum(length(t.c)) from ao_fc_keys k join ao_fc_col t on t.b = k.b;
+
+-- the blocks are evicted and read again
+set gp_appendonly_fetch_cache_size = '64kB';
+select count(*), sum(a), sum(length(c)) from ao_fc_row where b between 100 and 140;
+select count(*), sum(t.a), sum(length(t.c)) from ao_fc_keys k join ao_fc_row t on t.b = k.b;
+select count(*), sum(a), sum(length(c)) from ao_fc_col where b between 100 and 140;
+select count(*), sum(t.a), sum(length(t.c)) from ao_fc_keys k join ao_fc_col t on t.b = k.b;
+
+set gp_appendonly_fetch_cache_size = 0;
+select count(*), sum(a), sum(length(c)) from ao_fc_row where b between 100 and 140;
+select count(*), sum(t.a), sum(length(t.c)) from ao_fc_keys k join ao_fc_row t on t.b = k.b;
+select count(*), sum(a), sum(length(c)) from ao_fc_col where b between 100 and 140;
+select count(*), sum(t.a), sum(length(t.c)) from ao_fc_keys k join ao_fc_col t on t.b = k.b;
+
+-- The cached blocks still have the deleted rows, the visibility map hides them
+reset gp_appendonly_fetch_cache_size;
+delete from ao_fc_row where a % 3 = 0;
+delete from ao_fc_col where a % 3 = 0;
+select count(*), sum(t.a), sum(length(t.c)) from ao_fc_keys k join ao_fc_row t on t.b = k.b;
+select count(*), sum(t.a), sum(length(t.c)) from ao_fc_keys k join ao_fc_col t on t.b = k.b;
+reset enable_seqscan;
+reset enable_hashjoin;
+reset enable_mergejoin;
+drop table ao_fc_keys;
+drop table ao_fc_row;
+drop table ao_fc_col;
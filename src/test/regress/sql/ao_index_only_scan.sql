@@ -0,0 +1,58 @@
+--
+-- Index-only scans of append-only tables tell the visibility of the rows
+-- from the segment files, the visimap and the block directory, without
+-- reading the rows.  Deleted rows, rows of aborted inserts and rows moved
+-- by a compaction must not be returned.
+--
+create table ao_ios_row (a int, b int, c text) with (appendonly=true) distributed by (a);
+create table ao_ios_col (a int, b int, c text) with (appendonly=true, orientation=column) distributed by (a);
+insert into ao_ios_row select i, i % 1000, 'row ' || i from generate_series(1, 20000) i;
+insert into ao_ios_col select * from ao_ios_row;
+create index ao_ios_row_b on ao_ios_row (b);
+create index ao_ios_col_b on ao_ios_col (b);
+delete from ao_ios_row where a % 5 = 0;
+delete from ao_ios_col where a % 5 = 0;
+begin;
+insert into ao_ios_row select i, 501, 'aborted' from generate_series(20001, 21000) i;
+insert into ao_ios_col select i, 501, 'aborted' from generate_series(20001, 21000) i;
+abort;
+-- The next insert into the same segment file continues the last block
+-- directory minipage, and stretches its last entry over the row numbers of
+-- the aborted insert.  Those rows must still not be returned.
+insert into ao_ios_row select i, 502, 'committed' from generate_series(21001, 21010) i;
+insert into ao_ios_col select i, 502, 'committed' from generate_series(21001, 21010) i;
+set optimizer = off;
+set enable_seqscan = off;
+set enable_bitmapscan = off;
+explain (costs off) select count(*) from ao_ios_row where b between 100 and 140;
+explain (costs off) select count(*) from ao_ios_col where b between 100 and 140;
+select count(*), sum(b) from ao_ios_row where b between 100 and 140;
+select count(*), sum(b) from ao_ios_col where b between 100 and 140;
+select count(*) from ao_ios_row where b = 501;
+select count(*) from ao_ios_col where b = 501;
+select b, count(*) from ao_ios_row where b between 501 and 502 group by b order by b;
+select b, count(*) from ao_ios_col where b between 501 and 502 group by b order by b;
+select b, count(*) from ao_ios_row where b < 5 group by b order by b;
+-- rows inserted earlier in the transaction are visible
+begin;
+insert into ao_ios_row select i, 777, 'new' from generate_series(30001, 30010) i;
+insert into ao_ios_col select i, 777, 'new' from generate_series(30001, 30010) i;
+select count(*) from ao_ios_row where b = 777;
+select count(*) from ao_ios_col where b = 777;
+abort;
+-- the last block directory entry of a segment file has an open range, the
+-- rows it covers are fetched
+set gp_blockdirectory_entry_min_range = 1000000;
+select count(*), sum(b) from ao_ios_row where b between 100 and 140;
+select count(*), sum(b) from ao_ios_col where b between 100 and 140;
+reset gp_blockdirectory_entry_min_range;
+-- the compacted segment files are no longer visible
+vacuum ao_ios_row;
+vacuum ao_ios_col;
+select count(*), sum(b) from ao_ios_row where b between 100 and 140;
+select count(*), sum(b) from ao_ios_col where b between 100 and 140;
+reset enable_seqscan;
+reset enable_bitmapscan;
+reset optimizer;
+drop table ao_ios_row;
+drop table ao_ios_col;
@@ -0,0 +1,35 @@
+--
+-- gp_appendonly_visimap_cache_size: scans load the visibility map of a
+-- segment file at once.  The rows returned must be the same with the cache,
+-- with a cache too small for the visibility map of a segment file, and
+-- without it.
+--
+create table ao_vc_row (a int, b text) with (appendonly=true) distributed by (a);
+create table ao_vc_col (a int, b text) with (appendonly=true, orientation=column) distributed by (a);
+insert into ao_vc_row select i, 'row ' || i from generate_series(1, 100000) i;
+insert into ao_vc_col select * from ao_vc_row;
+-- many hidden rows in each range, and a few
+delete from ao_vc_row where a % 3 = 0;
+delete from ao_vc_col where a % 3 = 0;
+delete from ao_vc_row where a % 1000 = 7;
+delete from ao_vc_col where a % 1000 = 7;
+select count(*), sum(a) from ao_vc_row;
+select count(*), sum(a) from ao_vc_col;
+set gp_appendonly_visimap_cache_size = '1kB';
+select count(*), sum(a) from ao_vc_row;
+select count(*), sum(a) from ao_vc_col;
+set gp_appendonly_visimap_cache_size = 0;
+select count(*), sum(a) from ao_vc_row;
+select count(*), sum(a) from ao_vc_col;
+-- the rows deleted by the transaction are hidden from its next scans
+reset gp_appendonly_visimap_cache_size;
+begin;
+select count(*), sum(a) from ao_vc_row;
+delete from ao_vc_row where a between 50000 and 50100;
+delete from ao_vc_col where a between 50000 and 50100;
+select count(*), sum(a) from ao_vc_row;
+select count(*), sum(a) from ao_vc_col;
+abort;
+select count(*), sum(a) from ao_vc_row;
+drop table ao_vc_row;
+drop table ao_vc_col;
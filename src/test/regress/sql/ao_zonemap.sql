@@ -0,0 +1,82 @@
+--
+-- Block min/max zone maps of append-only tables.
+--
+-- The zone maps are kept in the block directory, so the tables get an index
+-- before the data is loaded.  The queries run as sequential scans, with and
+-- without gp_appendonly_zone_maps, and must return the same results.
+-- The summaries are only collected while gp_appendonly_zone_maps is on.
+--
+set enable_indexscan = off;
+set enable_bitmapscan = off;
+set gp_appendonly_zone_maps = on;
+
+create table ao_zonemap (a int, b int8, c text, d date)
+  with (appendonly=true, blocksize=8192) distributed by (a);
+create index ao_zonemap_a on ao_zonemap (a);
+insert into ao_zonemap
+  select i, i * 2, case when i <= 1000 then null else 'row ' || i end,
+         date '2020-01-01' + i / 1000
+  from generate_series(1, 100000) i;
+
+create table aocs_zonemap (a int, b int8, c text, d date)
+  with (appendonly=true, orientation=column, blocksize=8192) distributed by (a);
+create index aocs_zonemap_a on aocs_zonemap (a);
+insert into aocs_zonemap select * from ao_zonemap;
+
+-- Did EXPLAIN ANALYZE of the query report blocks skipped by the zone maps?
+create function ao_zonemap_skipped(query text) returns bool as $$
+declare
+  line text;
+begin
+  for line in execute 'explain analyze ' || query loop
+    if line like '%Zone maps: % blocks skipped%' then
+      return true;
+    end if;
+  end loop;
+  return false;
+end;
+$$ language plpgsql;
+
+select ao_zonemap_skipped('select count(*) from ao_zonemap where a < 100');
+select ao_zonemap_skipped('select count(*) from aocs_zonemap where a < 100');
+-- nothing to skip on a column without summaries
+select ao_zonemap_skipped('select count(*) from ao_zonemap where c = ''row 5''');
+
+select count(*) from ao_zonemap where a < 100;
+select count(*), sum(a) from ao_zonemap where a between 20000 and 20999;
+select a, b, c from ao_zonemap where a = 50000;
+select count(*) from ao_zonemap where b >= 199990;
+select count(*) from ao_zonemap where 200000 < a;
+select count(*) from ao_zonemap where c is null;
+select count(*) from ao_zonemap where d = date '2020-01-11';
+
+select count(*) from aocs_zonemap where a < 100;
+select count(*), sum(a) from aocs_zonemap where a between 20000 and 20999;
+select a, b, c from aocs_zonemap where a = 50000;
+select c from aocs_zonemap where b >= 199990 order by a;
+select count(*) from aocs_zonemap where 200000 < a;
+select count(*) from aocs_zonemap where c is null;
+select count(*) from aocs_zonemap where d = date '2020-01-11';
+
+-- Deleted rows and rows added later
+delete from ao_zonemap where a between 20000 and 20499;
+delete from aocs_zonemap where a between 20000 and 20499;
+insert into ao_zonemap values (20000, 0, 'late', date '2020-01-01');
+insert into aocs_zonemap values (20000, 0, 'late', date '2020-01-01');
+select count(*), sum(a) from ao_zonemap where a between 20000 and 20999;
+select count(*), sum(a) from aocs_zonemap where a between 20000 and 20999;
+select c from ao_zonemap where b = 0;
+select c from aocs_zonemap where b = 0;
+
+set gp_appendonly_zone_maps = off;
+select ao_zonemap_skipped('select count(*) from ao_zonemap where a < 100');
+select count(*), sum(a) from ao_zonemap where a between 20000 and 20999;
+select count(*), sum(a) from aocs_zonemap where a between 20000 and 20999;
+select count(*) from aocs_zonemap where d = date '2020-01-11';
+
+reset gp_appendonly_zone_maps;
+reset enable_indexscan;
+reset enable_bitmapscan;
+drop function ao_zonemap_skipped(text);
+drop table ao_zonemap;
+drop table aocs_zonemap;
@@ -0,0 +1,39 @@
+--
+-- gp_aocs_compression_workers: inserts into column-oriented tables compress
+-- the full blocks of each column in background threads, and append them to
+-- the segment files in order.  What is written must read back the same as
+-- when the blocks are compressed by the backend.
+--
+create table aocs_cw_zlib (a int, b text, c int)
+  with (appendonly=true, orientation=column, compresstype=zlib, compresslevel=1)
+  distributed by (a);
+create table aocs_cw_rle (a int, b text, c int encoding (compresstype=rle_type, compresslevel=2))
+  with (appendonly=true, orientation=column, compresstype=zlib)
+  distributed by (a);
+set gp_aocs_compression_workers = 4;
+insert into aocs_cw_zlib select i, repeat('x', i % 50), i % 7 from generate_series(1, 50000) i;
+-- RLE encoded blocks are compressed with zlib on top
+insert into aocs_cw_rle select * from aocs_cw_zlib;
+select count(*), sum(a), sum(length(b)), sum(c) from aocs_cw_zlib;
+select count(*), sum(a), sum(length(b)), sum(c) from aocs_cw_rle;
+
+-- The block directory records the offsets the blocks were appended at
+create index aocs_cw_zlib_a on aocs_cw_zlib (a);
+insert into aocs_cw_zlib select i, 'y', 0 from generate_series(50001, 50100) i;
+set enable_seqscan = off;
+select a, b, c from aocs_cw_zlib where a in (1, 33333, 50050) order by a;
+reset enable_seqscan;
+
+-- An insert that fails leaves its blocks with the threads; they are waited
+-- for and freed when the subtransaction aborts
+begin;
+savepoint s1;
+insert into aocs_cw_zlib select a + 100000, b, 1 / (a - 15000) from aocs_cw_zlib where a <= 20000;
+rollback to savepoint s1;
+insert into aocs_cw_zlib values (70001, 'w', 1);
+commit;
+select count(*), sum(a), sum(length(b)), sum(c) from aocs_cw_zlib;
+reset gp_aocs_compression_workers;
+select count(*), sum(a), sum(length(b)), sum(c) from aocs_cw_zlib;
+drop table aocs_cw_zlib;
+drop table aocs_cw_rle;
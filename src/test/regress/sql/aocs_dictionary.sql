@@ -0,0 +1,46 @@
+--
+-- Per-block dictionary encoding of the variable-length columns of
+-- append-only column-oriented tables.
+--
+-- aocs_dict is loaded with gp_aocs_dictionary_encoding, aocs_dict_plain
+-- without.  Scans of aocs_dict evaluate the equality and IN clauses on the
+-- dictionary codes, and must return the same results as aocs_dict_plain.
+--
+create table aocs_dict_plain (a int, c text, v varchar(20))
+  with (appendonly=true, orientation=column) distributed by (a);
+insert into aocs_dict_plain
+  select i, case when i % 97 = 0 then null else 'color ' || (i % 50) end,
+         'v' || (i % 300)
+  from generate_series(1, 20000) i;
+
+set gp_aocs_dictionary_encoding = on;
+create table aocs_dict (a int, c text, v varchar(20) encoding (compresstype=rle_type))
+  with (appendonly=true, orientation=column) distributed by (a);
+insert into aocs_dict select * from aocs_dict_plain;
+reset gp_aocs_dictionary_encoding;
+
+-- The dictionary makes the column smaller
+select pg_relation_size('aocs_dict') < pg_relation_size('aocs_dict_plain') as smaller;
+
+select count(*) from aocs_dict_plain where c = 'color 7';
+select count(*) from aocs_dict where c = 'color 7';
+select count(*) from aocs_dict where 'color 9' = c;
+select count(*) from aocs_dict where c in ('color 1', 'color 2', 'nothing');
+select count(*) from aocs_dict where c in ('nothing', null);
+select count(*) from aocs_dict where c = 'missing';
+select count(*) from aocs_dict where c <> 'color 0';
+select count(*) from aocs_dict where c is null;
+select count(*) from aocs_dict_plain where v in ('v1', 'v2') and a > 10000;
+select count(*) from aocs_dict where v in ('v1', 'v2') and a > 10000;
+select a, c, v from aocs_dict where c = 'color 3' and v = 'v3' order by a limit 5;
+select a, c, v from aocs_dict_plain where c = 'color 3' and v = 'v3' order by a limit 5;
+
+-- Deleted rows
+delete from aocs_dict where a <= 1000;
+delete from aocs_dict_plain where a <= 1000;
+select count(*) from aocs_dict_plain where c = 'color 7';
+select count(*) from aocs_dict where c = 'color 7';
+select count(*), min(a) from aocs_dict where v = 'v10';
+
+drop table aocs_dict;
+drop table aocs_dict_plain;
@@ -0,0 +1,60 @@
+--
+-- Bitmap indexes built by sorting the values and tids, and by adding the
+-- tids one at a time as the table is scanned, must give the same results.
+--
+create table bm_sort (i int, v int, s text, w int) distributed by (i);
+insert into bm_sort select i, i % 7, case when i % 5 = 0 then null else (i % 1000)::text end, i / 3 from generate_series(1, 30000) i;
+set optimizer = off;
+set enable_seqscan = off;
+set enable_indexscan = off;
+set enable_bitmapscan = on;
+set gp_enable_bitmap_sort_build = on;
+create index bm_sort_v on bm_sort using bitmap (v);
+create index bm_sort_s on bm_sort using bitmap (s);
+create index bm_sort_vs on bm_sort using bitmap (v, s);
+create index bm_sort_w on bm_sort using bitmap (w);
+select count(*) from bm_sort where v = 3;
+select count(*), sum(i) from bm_sort where v between 2 and 4;
+select count(*) from bm_sort where s = '17';
+select count(*) from bm_sort where s is null;
+select i from bm_sort where v = 1 and s = '501' order by i;
+select count(*) from bm_sort where v = 2 and s is null;
+select i from bm_sort where w = 1234 order by i;
+-- inserts append to the bitmap vectors of a sorted build
+insert into bm_sort values (30001, 3, '17', 10000), (30002, 3, null, 10000);
+select count(*) from bm_sort where v = 3;
+select count(*), sum(i) from bm_sort where v between 2 and 4;
+select count(*) from bm_sort where s = '17';
+select count(*) from bm_sort where s is null;
+select i from bm_sort where v = 1 and s = '501' order by i;
+select count(*) from bm_sort where v = 2 and s is null;
+select i from bm_sort where w = 1234 order by i;
+drop index bm_sort_v;
+drop index bm_sort_s;
+drop index bm_sort_vs;
+drop index bm_sort_w;
+set gp_enable_bitmap_sort_build = off;
+create index bm_sort_v on bm_sort using bitmap (v);
+create index bm_sort_s on bm_sort using bitmap (s);
+create index bm_sort_vs on bm_sort using bitmap (v, s);
+create index bm_sort_w on bm_sort using bitmap (w);
+select count(*) from bm_sort where v = 3;
+select count(*), sum(i) from bm_sort where v between 2 and 4;
+select count(*) from bm_sort where s = '17';
+select count(*) from bm_sort where s is null;
+select i from bm_sort where v = 1 and s = '501' order by i;
+select count(*) from bm_sort where v = 2 and s is null;
+select i from bm_sort where w = 1234 order by i;
+reset gp_enable_bitmap_sort_build;
+-- append-optimized tables
+create table bm_sort_ao with (appendonly=true) as select * from bm_sort distributed by (i);
+create index bm_sort_ao_v on bm_sort_ao using bitmap (v);
+create index bm_sort_ao_s on bm_sort_ao using bitmap (s);
+select count(*), sum(i) from bm_sort_ao where v between 2 and 4;
+select count(*) from bm_sort_ao where s = '17';
+reset enable_seqscan;
+reset enable_indexscan;
+reset enable_bitmapscan;
+reset optimizer;
+drop table bm_sort;
+drop table bm_sort_ao;
@@ -0,0 +1,69 @@
+--
+-- Eager aggregation: with gp_enable_eager_agg, the rows of a table may be
+-- aggregated partially on their join and grouping keys before they are
+-- joined.  The results must not change.
+--
+create table eager_dim (id int, name text, grp int) distributed by (id);
+create table eager_fact (id int, dim_id int, amount numeric, qty int) distributed by (id);
+insert into eager_dim select i, 'dim' || i, i % 3 from generate_series(1, 10) i;
+insert into eager_fact select i, i % 10 + 1, i % 7, i % 5 from generate_series(1, 10000) i;
+analyze eager_dim;
+analyze eager_fact;
+-- Is there an aggregate below a join in the plan of the query?
+create function eager_agg_below_join(query text) returns bool as $$
+declare
+  line text;
+  join_indent int := -1;
+begin
+  for line in execute 'explain ' || query loop
+    if join_indent < 0 and (line like '%Join%' or line like '%Nested Loop%') then
+      join_indent := length(line) - length(ltrim(line));
+    elsif join_indent >= 0 and line like '%Aggregate%' and
+          length(line) - length(ltrim(line)) > join_indent then
+      return true;
+    end if;
+  end loop;
+  return false;
+end;
+$$ language plpgsql;
+set optimizer = off;
+set gp_enable_eager_agg = off;
+select eager_agg_below_join('select d.grp, sum(f.amount), count(*), round(avg(f.qty), 4) as avg, min(f.qty), max(f.amount) from eager_fact f join eager_dim d on f.dim_id = d.id group by d.grp order by d.grp');
+select d.grp, sum(f.amount), count(*), round(avg(f.qty), 4) as avg, min(f.qty), max(f.amount) from eager_fact f join eager_dim d on f.dim_id = d.id group by d.grp order by d.grp;
+set gp_enable_eager_agg = on;
+select eager_agg_below_join('select d.grp, sum(f.amount), count(*), round(avg(f.qty), 4) as avg, min(f.qty), max(f.amount) from eager_fact f join eager_dim d on f.dim_id = d.id group by d.grp order by d.grp');
+select d.grp, sum(f.amount), count(*), round(avg(f.qty), 4) as avg, min(f.qty), max(f.amount) from eager_fact f join eager_dim d on f.dim_id = d.id group by d.grp order by d.grp;
+-- a qual on the aggregated table is evaluated below the partial aggregate
+select d.name, count(*) from eager_fact f, eager_dim d where f.dim_id = d.id and f.qty > 2 group by d.name having count(*) > 390 order by d.name;
+-- grouping by a column of the aggregated table
+select f.qty, d.grp, sum(f.amount) from eager_fact f join eager_dim d on f.dim_id = d.id group by f.qty, d.grp order by 1, 2;
+-- no grouping
+select count(*), sum(f.qty) from eager_fact f join eager_dim d on f.dim_id = d.id where d.grp = 1;
+-- a partial result joining to several rows is counted for each of them
+select d1.grp, count(*), sum(f.amount) from eager_fact f join eager_dim d1 on f.dim_id = d1.id join eager_dim d2 on d2.grp = d1.grp group by d1.grp order by 1;
+-- not with outer joins
+select eager_agg_below_join('select d.grp, count(f.id) from eager_dim d left join eager_fact f on f.dim_id = d.id and f.qty = 0 group by d.grp order by 1');
+select d.grp, count(f.id) from eager_dim d left join eager_fact f on f.dim_id = d.id and f.qty = 0 group by d.grp order by 1;
+-- column aliases of the aggregated table: the final aggregate reads the
+-- subquery's partial sum, not a column named after the table's
+create function eager_agg_explain_mentions(query text, pattern text) returns bool as $$
+declare
+  line text;
+begin
+  for line in execute 'explain verbose ' || query loop
+    if line like pattern then
+      return true;
+    end if;
+  end loop;
+  return false;
+end;
+$$ language plpgsql;
+select eager_agg_below_join('select d.grp, sum(f.famt) from eager_fact f(fid, fdim, famt, fqty) join eager_dim d on f.fdim = d.id group by d.grp');
+select eager_agg_explain_mentions('select d.grp, sum(f.famt) from eager_fact f(fid, fdim, famt, fqty) join eager_dim d on f.fdim = d.id group by d.grp', '%sum(%.fdim)%');
+select d.grp, sum(f.famt) from eager_fact f(fid, fdim, famt, fqty) join eager_dim d on f.fdim = d.id group by d.grp order by d.grp;
+reset gp_enable_eager_agg;
+reset optimizer;
+drop function eager_agg_below_join(text);
+drop function eager_agg_explain_mentions(text, text);
+drop table eager_fact;
+drop table eager_dim;
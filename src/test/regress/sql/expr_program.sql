@@ -0,0 +1,49 @@
+--
+-- Test the flat expression interpreter used for scan quals and projections
+-- (gp_enable_expression_program).  Results must be the same as with the
+-- expression tree evaluator, including three-valued logic for NULLs.
+--
+create table expr_program (a int, b int8, c date, d text, e bool) distributed by (a);
+insert into expr_program values
+  (1, 10, '2000-01-01', 'one', true),
+  (2, null, '2000-06-01', 'two', false),
+  (3, 30, null, null, null),
+  (4, 40, '2001-01-01', 'four', true);
+
+set gp_enable_expression_program = on;
+
+-- integer and date comparisons against constants, on either side
+select a from expr_program where b > 15 order by a;
+select a from expr_program where 15 < b order by a;
+select a from expr_program where c >= '2000-03-01' and c < '2001-01-01' order by a;
+
+-- AND, OR, NOT and NULL tests
+select a from expr_program where e or b is null order by a;
+select a from expr_program where not e order by a;
+select a from expr_program where d = 'two' or a = 4 order by a;
+select a from expr_program where b is not null and (c is null or e) order by a;
+
+-- projections
+select a, b * 2 as b2, d || '!' as d2, b > 15 as big, e and b > 15 as both from expr_program order by a;
+
+-- same results with the program disabled
+set gp_enable_expression_program = off;
+select a from expr_program where e or b is null order by a;
+select a, b * 2 as b2, d || '!' as d2, b > 15 as big, e and b > 15 as both from expr_program order by a;
+
+-- The permission check on a function is made when the call is first
+-- reached, not when the program is built.
+set gp_enable_expression_program = on;
+create function expr_program_f(int) returns bool as 'select $1 > 2' language sql immutable strict;
+revoke execute on function expr_program_f(int) from public;
+create role expr_program_user;
+grant select on expr_program to expr_program_user;
+set role expr_program_user;
+select a from expr_program where a < 0 and expr_program_f(a) order by a;
+select a from expr_program where expr_program_f(a) order by a;
+reset role;
+
+drop role expr_program_user;
+drop function expr_program_f(int);
+reset gp_enable_expression_program;
+drop table expr_program;
@@ -796,3 +796,34 @@ INSERT INTO incr_analyze_test SELECT s, md5(s::varchar), '2018-01-02' FROM gener
 ANALYZE incr_analyze_test_1_prt_2;
 SELECT tablename, attname, null_frac, n_distinct, most_common_vals, most_common_freqs, histogram_bounds FROM pg_stats WHERE tablename like 'incr_analyze_test%' ORDER BY attname,tablename;
 SELECT relname, relpages, reltuples FROM pg_class WHERE relname LIKE 'incr_analyze_test%' ORDER BY relname;
+-- Test that with gp_analyze_skip_unchanged_leaves, ANALYZE of a partitioned
+-- table does not sample again the append-optimized leaves not modified since
+-- they were last analyzed. Heap leaves are always sampled.
+CREATE TABLE skip_unchanged (a int, b int) WITH (appendonly=true) DISTRIBUTED BY (a)
+PARTITION BY RANGE (b) (START (0) END (3) EVERY (1), START (3) END (4) WITH (appendonly=false));
+INSERT INTO skip_unchanged SELECT i, i % 4 FROM generate_series(1, 1000) i;
+ANALYZE skip_unchanged;
+CREATE TEMP TABLE skip_unchanged_analyzed AS
+  SELECT objid, statime FROM pg_stat_last_operation
+  WHERE staactionname = 'ANALYZE' AND objid IN (SELECT oid FROM pg_class WHERE relname LIKE 'skip_unchanged%')
+  DISTRIBUTED BY (objid);
+SET gp_analyze_skip_unchanged_leaves = on;
+INSERT INTO skip_unchanged SELECT i, 1 FROM generate_series(1, 100) i;
+ANALYZE skip_unchanged;
+SELECT c.relname, l.statime <> a.statime AS analyzed
+  FROM pg_stat_last_operation l JOIN pg_class c ON l.objid = c.oid JOIN skip_unchanged_analyzed a ON a.objid = l.objid
+  WHERE l.staactionname = 'ANALYZE' ORDER BY c.relname;
+-- TRUNCATE starts the modification count over
+TRUNCATE skip_unchanged_analyzed;
+INSERT INTO skip_unchanged_analyzed
+  SELECT objid, statime FROM pg_stat_last_operation
+  WHERE staactionname = 'ANALYZE' AND objid IN (SELECT oid FROM pg_class WHERE relname LIKE 'skip_unchanged%');
+TRUNCATE skip_unchanged_1_prt_3;
+INSERT INTO skip_unchanged SELECT i, 2 FROM generate_series(1, 250) i;
+ANALYZE skip_unchanged;
+SELECT c.relname, l.statime <> a.statime AS analyzed
+  FROM pg_stat_last_operation l JOIN pg_class c ON l.objid = c.oid JOIN skip_unchanged_analyzed a ON a.objid = l.objid
+  WHERE l.staactionname = 'ANALYZE' ORDER BY c.relname;
+SELECT tablename, attname, n_distinct FROM pg_stats WHERE tablename = 'skip_unchanged' AND attname = 'b';
+RESET gp_analyze_skip_unchanged_leaves;
+DROP TABLE skip_unchanged;
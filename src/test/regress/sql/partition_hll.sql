@@ -0,0 +1,40 @@
+--
+-- With gp_statistics_use_hll, the number of distinct values of a column of
+-- a partitioned table is merged from the hyperloglog counters ANALYZE keeps
+-- for the leaf partitions, only of those that survive pruning.
+--
+create table hll_part (a int, b int, c int) distributed by (a)
+partition by range (a) subpartition by list (c)
+subpartition template (subpartition c0 values (0), subpartition c1 values (1))
+(start (1) end (101) every (25));
+-- each range partition has 100 values of b of its own
+insert into hll_part select i % 100 + 1, (i % 100) / 25 * 1000 + (i / 100) % 100, i % 2 from generate_series(1, 10000) i;
+analyze hll_part;
+-- The estimated number of rows of the top plan node
+create function hll_est_rows(query text) returns int as $$
+declare
+  line text;
+begin
+  for line in execute 'explain ' || query loop
+    return substring(line from 'rows=(\d+)')::int;
+  end loop;
+end;
+$$ language plpgsql;
+set optimizer = off;
+select count(distinct b) from hll_part where a <= 50;
+-- without the counters, the largest partition stands for all
+set gp_statistics_use_hll = off;
+select hll_est_rows('select b from hll_part where a <= 50 group by b') < 150;
+set gp_statistics_use_hll = on;
+select hll_est_rows('select b from hll_part where a <= 50 group by b') between 180 and 220;
+select hll_est_rows('select b from hll_part where a <= 25 group by b') between 90 and 110;
+-- nothing pruned
+select hll_est_rows('select b from hll_part group by b') between 360 and 440;
+-- counters of full scans
+analyze fullscan hll_part;
+select hll_est_rows('select b from hll_part where a <= 50 group by b') between 180 and 220;
+select hll_est_rows('select b from hll_part group by b') between 360 and 440;
+reset gp_statistics_use_hll;
+reset optimizer;
+drop function hll_est_rows(text);
+drop table hll_part;
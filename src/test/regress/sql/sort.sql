@@ -110,3 +110,25 @@ select col1, col2, col3, col4, col5 from gpsort_alltypes order by col1, col2, co
 select col1, col2, col3, col4, col5 from gpsort_alltypes order by col3 desc, col2 asc, col1, col4, col5;
 select col1, col2, col3, col4, col5 from gpsort_alltypes order by col5 desc, col3 asc, col2 desc, col4 asc, col1 desc;
 
+
+-- Radix sort of integer keys, and abbreviated keys of numeric and text.
+-- Enough rows per segment to use the radix path; each query counts the
+-- rows that are out of order, which must be none.
+set gp_enable_mk_sort = on;
+set gp_enable_mk_sort_radix = on;
+create table sort_radix(id int, i4 int, i8 bigint, d date, n numeric, t text) distributed by (id);
+insert into sort_radix select g, g % 37, (g * 7919) % 100003 - 50000, date '2000-01-01' + (g % 1000), ((g * 31) % 2003) / 7.0 - 100, case when g % 11 = 0 then null else md5(g::text) end from generate_series(1, 5000) g;
+select count(*) from (select i8, lag(i8) over () p from (select i8 from sort_radix order by i8 offset 0) s) q where p > i8;
+select count(*) from (select d, lag(d) over () p from (select d from sort_radix order by d desc offset 0) s) q where p < d;
+select count(*) from (select i4, i8, lag(i4) over () p4, lag(i8) over () p8 from (select i4, i8 from sort_radix order by i4, i8 desc offset 0) s) q where p4 > i4 or (p4 = i4 and p8 < i8);
+select count(*) from (select n, lag(n) over () p from (select n from sort_radix order by n desc offset 0) s) q where p < n;
+select count(*) from (select t, lag(t) over () p from (select t from sort_radix order by t collate "C" nulls first offset 0) s) q where p collate "C" > t or (p is not null and t is null);
+select count(*) from (select t, lag(t) over () p from (select t from sort_radix order by t desc offset 0) s) q where p < t or (p is not null and t is null);
+set gp_enable_mk_sort_radix = off;
+select count(*) from (select i4, i8, lag(i4) over () p4, lag(i8) over () p8 from (select i4, i8 from sort_radix order by i4, i8 desc offset 0) s) q where p4 > i4 or (p4 = i4 and p8 < i8);
+reset gp_enable_mk_sort_radix;
+-- Sort with DISTINCT: of each run of equal keys, exactly one entry is kept.
+set enable_hashagg = off;
+select count(*) from (select distinct i4 from sort_radix) s;
+select count(*) from (select distinct i4, md5((id % 50)::text) from sort_radix) s;
+reset enable_hashagg;
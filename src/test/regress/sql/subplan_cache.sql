@@ -0,0 +1,106 @@
+--
+-- Tests for the result caches of correlated subplans (gp_enable_subplan_cache)
+-- and of the inner sides of nested loops (gp_enable_nestloop_cache)
+--
+create schema subplan_cache;
+set search_path to subplan_cache;
+set optimizer = off;
+
+-- Each value of k is on a single segment, so the number of cache misses is
+-- the number of distinct values of k, whatever the number of segments.
+create table sc_outer (id int, k int) distributed by (k);
+create table sc_inner (k int, v int) distributed by (k);
+insert into sc_outer select i, i % 10 from generate_series(1, 1000) i;
+insert into sc_outer values (1001, null);
+insert into sc_inner select i % 20, i from generate_series(1, 200) i;
+analyze sc_outer;
+analyze sc_inner;
+
+-- Returns the result cache line of the EXPLAIN ANALYZE of a query, without
+-- the memory used, and whether there were evictions rather than how many.
+create or replace function subplan_cache_stats(query text) returns setof text as
+$$
+declare
+  ln text;
+begin
+  for ln in execute 'explain analyze ' || query loop
+    if ln like '%Result cache:%' then
+      ln := regexp_replace(btrim(ln), '  Max memory: .*', '');
+      return next regexp_replace(ln, '  [1-9][0-9]* evictions', '  some evictions');
+    end if;
+  end loop;
+end;
+$$ language plpgsql;
+
+set gp_enable_subplan_cache = on;
+
+-- Expression sublink
+select count(*), sum(s) from (select (select sum(v) from sc_inner i where i.k = o.k) s from sc_outer o) x;
+select subplan_cache_stats('select (select sum(v) from sc_inner i where i.k = o.k) from sc_outer o');
+
+-- EXISTS and NOT EXISTS sublinks
+select sum(case when exists (select 1 from sc_inner i where i.k = o.k group by i.k having max(i.v) > 190) then 1 else 0 end) from sc_outer o;
+select sum(case when not exists (select 1 from sc_inner i where i.k = o.k group by i.k having max(i.v) > 190) then 1 else 0 end) from sc_outer o;
+
+-- ARRAY sublink
+select o.id, array(select v from sc_inner i where i.k = o.k order by v limit 3) from sc_outer o where o.id <= 12 order by o.id;
+
+-- The same results without the cache
+set gp_enable_subplan_cache = off;
+select count(*), sum(s) from (select (select sum(v) from sc_inner i where i.k = o.k) s from sc_outer o) x;
+select subplan_cache_stats('select (select sum(v) from sc_inner i where i.k = o.k) from sc_outer o');
+set gp_enable_subplan_cache = on;
+
+-- Parameter values are compared in binary: 1.0 and 1.00 are equal numerics,
+-- but they are not the same text.
+create table sc_num (g int, id int, n numeric) distributed by (g);
+insert into sc_num values (1, 1, 1.0), (1, 2, 1.00), (1, 3, 1.0), (1, 4, 1);
+select id, (select o.n::text) from sc_num o order by id;
+select subplan_cache_stats('select (select o.n::text) from sc_num o');
+
+-- A subplan calling volatile functions is not cached
+select count(distinct s) > 11 from (select (select random() + o.k * 0) s from sc_outer o) x;
+select subplan_cache_stats('select (select random() + o.k * 0) from sc_outer o');
+
+-- Entries are evicted to stay within work_mem
+create table sc_wide (id int, t text) distributed by (id);
+insert into sc_wide select i, repeat('x', 1000) || i from generate_series(1, 1000) i;
+set work_mem = '64kB';
+select count(*), sum(s) from (select (select count(*) from sc_inner i where i.k = length(w.t) % 20) s from sc_wide w) x;
+select subplan_cache_stats('select (select count(*) from sc_inner i where i.k = length(w.t) % 20) from sc_wide w');
+reset work_mem;
+
+-- The inner side of a parameterized nested loop (gp_enable_nestloop_cache)
+create index sc_inner_k on sc_inner (k);
+set enable_hashjoin = off;
+set enable_mergejoin = off;
+set gp_enable_nestloop_cache = on;
+select count(*), sum(i.v) from sc_outer o join sc_inner i on i.k = o.k;
+select subplan_cache_stats('select * from sc_outer o join sc_inner i on i.k = o.k');
+select count(*), count(i.v) from sc_outer o left join sc_inner i on i.k = o.k;
+select subplan_cache_stats('select * from sc_outer o left join sc_inner i on i.k = o.k');
+
+-- The same results without the cache
+set gp_enable_nestloop_cache = off;
+select count(*), sum(i.v) from sc_outer o join sc_inner i on i.k = o.k;
+select subplan_cache_stats('select * from sc_outer o join sc_inner i on i.k = o.k');
+select count(*), count(i.v) from sc_outer o left join sc_inner i on i.k = o.k;
+set gp_enable_nestloop_cache = on;
+
+-- The inner tuples of a parameter value are evicted as a whole
+create table sc_wide_inner (k int, t text) distributed by (k);
+alter table sc_wide_inner alter column t set storage plain;
+insert into sc_wide_inner select i % 20, repeat('x', 3000) from generate_series(1, 200) i;
+create index sc_wide_inner_k on sc_wide_inner (k);
+analyze sc_wide_inner;
+set work_mem = '64kB';
+select count(*), sum(length(w.t)) from sc_outer o join sc_wide_inner w on w.k = o.k;
+select s like '%some evictions' as evicted from subplan_cache_stats('select * from sc_outer o join sc_wide_inner w on w.k = o.k') s;
+reset work_mem;
+
+reset gp_enable_nestloop_cache;
+reset enable_mergejoin;
+reset enable_hashjoin;
+
+reset gp_enable_subplan_cache;
+reset optimizer;
@@ -0,0 +1,19 @@
+-- @Description Tests that (lazy) vacuum compacts the same when vacuum_cost_delay throttles its I/O.
+CREATE TABLE uao_cost_delay (a INT, b INT, c TEXT) WITH (appendonly=true) distributed by (b);
+CREATE INDEX uao_cost_delay_index ON uao_cost_delay(a);
+INSERT INTO uao_cost_delay SELECT i as a, 1 as b, repeat('x', 100) as c FROM generate_series(1, 10000) AS i;
+DELETE FROM uao_cost_delay WHERE a <= 5000;
+-- Compaction reads about 140 pages and writes about 70, for a cost of about
+-- 2800: at 40 ms per 200 it naps for more than half a second.
+SET vacuum_cost_delay = 40;
+SET vacuum_cost_limit = 200;
+SELECT clock_timestamp() AS vacuum_start \gset
+VACUUM uao_cost_delay;
+SELECT clock_timestamp() - :'vacuum_start'::timestamptz >= interval '250 ms' AS throttled;
+SELECT segno, tupcount, state FROM gp_toolkit.__gp_aoseg('uao_cost_delay');
+SELECT COUNT(*), SUM(a) FROM uao_cost_delay;
+SET enable_seqscan = off;
+SELECT COUNT(*) FROM uao_cost_delay WHERE a BETWEEN 4991 AND 5010;
+RESET enable_seqscan;
+RESET vacuum_cost_limit;
+RESET vacuum_cost_delay;
@@ -0,0 +1,25 @@
+-- @Description Tests that (lazy) vacuum compacts the same when vacuum_cost_delay throttles its I/O.
+CREATE TABLE uaocs_cost_delay (a INT, b INT, c TEXT) WITH (appendonly=true, orientation=column) distributed by (b);
+CREATE INDEX uaocs_cost_delay_index ON uaocs_cost_delay(a);
+INSERT INTO uaocs_cost_delay SELECT i as a, 1 as b, repeat('x', 100) as c FROM generate_series(1, 10000) AS i;
+DELETE FROM uaocs_cost_delay WHERE a <= 5000;
+-- Compaction reads about 140 pages and writes about 70, for a cost of about
+-- 2800: at 40 ms per 200 it naps for more than half a second.
+SET vacuum_cost_delay = 40;
+SET vacuum_cost_limit = 200;
+SELECT clock_timestamp() AS vacuum_start \gset
+VACUUM uaocs_cost_delay;
+SELECT clock_timestamp() - :'vacuum_start'::timestamptz >= interval '250 ms' AS throttled;
+SELECT DISTINCT segno, tupcount, state FROM gp_toolkit.__gp_aocsseg('uaocs_cost_delay') ORDER BY segno;
+SELECT COUNT(*), SUM(a) FROM uaocs_cost_delay;
+SET enable_seqscan = off;
+SELECT COUNT(*) FROM uaocs_cost_delay WHERE a BETWEEN 4991 AND 5010;
+RESET enable_seqscan;
+-- values larger than the block size take several blocks each
+CREATE TABLE uaocs_cost_delay_large (a INT, b INT, c TEXT) WITH (appendonly=true, orientation=column, blocksize=8192) distributed by (b);
+INSERT INTO uaocs_cost_delay_large SELECT i as a, 1 as b, repeat(i::text, 20000) as c FROM generate_series(1, 6) AS i;
+DELETE FROM uaocs_cost_delay_large WHERE a <= 3;
+VACUUM uaocs_cost_delay_large;
+SELECT a, length(c) FROM uaocs_cost_delay_large ORDER BY a;
+RESET vacuum_cost_limit;
+RESET vacuum_cost_delay;
@@ -0,0 +1,63 @@
+-- Test spilling to compressed workfiles, and the compression statistics
+-- reported by EXPLAIN ANALYZE.  zstd is only available in builds configured
+-- --with-zstd; compression_spill_1.out covers the other builds.
+create schema compression_spill;
+set search_path to compression_spill;
+
+-- start_ignore
+create language plpythonu;
+-- end_ignore
+
+-- Reports whether EXPLAIN ANALYZE showed any workfile compression, and
+-- whether the compressed workfiles were smaller than the uncompressed data
+create or replace function compression_spill.workfile_compression(explain_query text)
+returns text as
+$$
+import re
+rv = plpy.execute(explain_query)
+p = re.compile('.*Workfile compression: ([\d]+)kB to ([\d]+)kB')
+result = 'not reported'
+for i in range(len(rv)):
+    m = p.match(rv[i]['QUERY PLAN'])
+    if m:
+        if int(m.group(2)) < int(m.group(1)):
+            return 'compressed'
+        result = 'not compressed'
+return result
+$$
+language plpythonu;
+
+create table cspill (i int, j int, t text) distributed by (i);
+insert into cspill select i, i % 1000, repeat('workfile', 4) || i from generate_series(1, 200000) i;
+
+set statement_mem = '2MB';
+set enable_groupagg = off;
+set gp_workfile_type_hashjoin = bfz;
+set gp_workfile_compress_algorithm = zstd;
+
+-- spilling hash aggregate
+select count(*), sum(c) from (select t, count(*) c from cspill group by t) g;
+select compression_spill.workfile_compression('explain analyze select count(*) from (select t, count(*) c from cspill group by t) g');
+
+-- spilling hash join
+select count(*) from cspill a join cspill b on a.t = b.t;
+
+-- one of the fast levels
+set gp_workfile_zstd_level = -5;
+select count(*), sum(c) from (select t, count(*) c from cspill group by t) g;
+
+-- zlib reports its statistics too
+set gp_workfile_compress_algorithm = zlib;
+select compression_spill.workfile_compression('explain analyze select count(*) from (select t, count(*) c from cspill group by t) g');
+
+-- uncompressed workfiles do not
+set gp_workfile_compress_algorithm = none;
+select compression_spill.workfile_compression('explain analyze select count(*) from (select t, count(*) c from cspill group by t) g');
+
+reset gp_workfile_compress_algorithm;
+reset gp_workfile_zstd_level;
+reset gp_workfile_type_hashjoin;
+reset enable_groupagg;
+reset statement_mem;
+
+drop schema compression_spill cascade;